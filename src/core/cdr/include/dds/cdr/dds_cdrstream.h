@@ -267,6 +267,19 @@ uint32_t dds_stream_key_flags (struct dds_cdrstream_desc *desc, uint32_t *keysz_
 /** @component cdr_serializer */
 bool dds_stream_extensibility (const uint32_t * __restrict ops, enum dds_cdr_type_extensibility *ext);
 
+/**
+ * @brief Returns the ADR instruction of a member of a final or appendable aggregated type
+ * @component cdr_serializer
+ *
+ * Members are numbered in the order of the instructions, so that a base type,
+ * if any, is member 0.
+ *
+ * @param[in] ops    instructions of the type
+ * @param[in] index  index of the member
+ * @return pointer to the ADR instruction, or NULL if the type has no such member or is mutable
+ */
+DDS_EXPORT const uint32_t *dds_stream_member_op (const uint32_t * __restrict ops, uint32_t index);
+
 /** @component cdr_serializer */
 dds_data_type_properties_t dds_stream_data_types (const uint32_t * __restrict ops);
 
@@ -5150,6 +5150,31 @@ bool dds_stream_extensibility (const uint32_t * __restrict ops, enum dds_cdr_typ
   return false;
 }
 
+const uint32_t *dds_stream_member_op (const uint32_t * __restrict ops, uint32_t index)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR:
+        if (index == 0)
+          return ops;
+        index--;
+        ops = dds_stream_skip_adr (insn, ops);
+        break;
+      case DDS_OP_JSR:
+        return (DDS_OP_JUMP (insn) > 0) ? dds_stream_member_op (ops + DDS_OP_JUMP (insn), index) : NULL;
+      case DDS_OP_DLC:
+        ops++;
+        break;
+      case DDS_OP_PLC: case DDS_OP_RTS: case DDS_OP_JEQ: case DDS_OP_JEQ4: case DDS_OP_KOF: case DDS_OP_PLM:
+        return NULL;
+    }
+  }
+  return NULL;
+}
+
 uint32_t dds_stream_type_nesting_depth (const uint32_t * __restrict ops)
 {
   struct dds_cdrstream_ops_info info;
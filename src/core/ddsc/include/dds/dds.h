@@ -111,6 +111,7 @@ struct ddsi_serdata;
  * DOC_TODO
  */
 struct ddsi_config;
+struct ddsi_config_compiled;
 
 /**
  * @brief Indicates that the library uses ddsi_sertype instead of ddsi_sertopic
@@ -1099,6 +1100,59 @@ dds_create_domain(const dds_domainid_t domain, const char *config);
 DDS_EXPORT dds_entity_t
 dds_create_domain_with_rawconfig(const dds_domainid_t domain, const struct ddsi_config *config);
 
+/**
+ * @brief Function for overriding settings in a domain's copy of a compiled configuration
+ * @ingroup domain
+ *
+ * Only the fields in the configuration object itself may be changed, anything it
+ * references is shared with all other users of the compiled configuration.  Replacing a
+ * pointer is allowed, in which case the lifetime of the referenced data must be at least
+ * that of the domain.
+ *
+ * @param[in,out] config  the domain's private copy of the configuration
+ * @param[in]     arg     argument passed to @ref dds_create_domain_with_compiled_config
+ */
+typedef void (*dds_config_override_fn) (struct ddsi_config *config, void *arg);
+
+/**
+ * @brief Creates a domain from a configuration compiled with ddsi_config_compile
+ * (unstable interface)
+ * @ingroup domain
+ * @component domain
+ * @unstable
+ *
+ * This avoids reading, parsing and validating the configuration each time a domain is
+ * created, which is worthwhile if many domains are created with the same configuration.
+ * See dds/ddsi/ddsi_config.h:ddsi_config_compile.  The domain gets its own copy of the
+ * configuration object (but not of the strings and most of the lists it references),
+ * which the optional override function can modify before it is used.  A domain created
+ * in this manner must be explicitly deleted by calling @ref dds_delete on the domain (or
+ * on DDS_CYCLONEDDS_HANDLE).
+ *
+ * The domain holds a reference to the compiled configuration, and so the compiled
+ * configuration may be freed with ddsi_config_compiled_free while the domain exists.
+ *
+ * Please be aware that the given domain_id always takes precedence over the
+ * configuration, but that the selection of Domain elements in the configuration and the
+ * expansion of environment variables is done using the domain id given when compiling.
+ *
+ * @param[in]  domain   The domain to be created. DDS_DEFAULT_DOMAIN is not allowed.
+ * @param[in]  config   A compiled configuration.
+ * @param[in]  override Function to override settings in the domain's copy, may be NULL.
+ * @param[in]  arg      Argument passed to override.
+ *
+ * @returns A valid entity handle or an error code.
+ *
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             Illegal value for domain id or the config parameter is NULL.
+ * @retval DDS_RETCODE_PRECONDITION_NOT_MET
+ *             The domain already existed and cannot be created again.
+ * @retval DDS_RETCODE_ERROR
+ *             An internal error has occurred.
+ */
+DDS_EXPORT dds_entity_t
+dds_create_domain_with_compiled_config(const dds_domainid_t domain, struct ddsi_config_compiled *config, dds_config_override_fn override, void *arg);
+
 /**
  * @brief Get entity parent.
  * @ingroup entity
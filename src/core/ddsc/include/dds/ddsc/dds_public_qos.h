@@ -591,6 +591,36 @@ dds_qset_entity_name (
   dds_qos_t * __restrict qos,
   const char * name);
 
+/**
+ * @ingroup qos_setters
+ * @component qos_obj
+ * @brief Set the content filter expression of a reader (Cyclone DDS extension)
+ *
+ * The expression is a subset of DDS-SQL: comparisons of a (possibly nested) member
+ * of the data type with a constant, combined using AND, OR, NOT and parentheses,
+ * e.g. "(x > 3 OR pos.z <= 1.5) AND color = RED AND name LIKE 'abc%'".
+ * Supported comparisons are =, <>, !=, <, <=, >, >=, BETWEEN and, for strings,
+ * LIKE; constants are integers, floating-point numbers, TRUE/FALSE, strings in
+ * single quotes and enumerator names.  Members of primitive, enumerated and
+ * string types can be used, provided they are not optional and are not preceded
+ * by members the filter can't skip (optional members, unions and, in XCDR1
+ * encoded data, sequences of non-primitive types).
+ *
+ * The expression is compiled when the reader is created and evaluated directly
+ * on the serialized data, without deserializing the sample.
+ *
+ * The reader only accepts samples matching the expression.  The expression is
+ * advertised in discovery, so that remote Cyclone DDS writers can avoid sending
+ * data that the reader would drop anyway.
+ *
+ * @param[in,out] qos - Pointer to a dds_qos_t structure that will store the expression
+ * @param[in] expression - Pointer to the content filter expression to set.
+ */
+DDS_EXPORT void
+dds_qset_content_filter (
+  dds_qos_t * __restrict qos,
+  const char * expression);
+
 /**
  * @ingroup qos_setters
  * @component qos_obj
@@ -1110,6 +1140,19 @@ dds_qget_data_representation (
  */
 DDS_EXPORT bool dds_qget_entity_name (const dds_qos_t * __restrict qos, char **name);
 
+/**
+ * @ingroup qos_getters
+ * @component qos_obj
+ * @brief Get the content filter expression from a qos structure
+ *
+ * @param[in] qos - Pointer to a dds_qos_t structure storing the expression
+ * @param[in,out] expression - Pointer to a string that will store the returned expression
+ *
+ * @returns - false iff any of the arguments is invalid or the qos is not present in the qos object
+ *            or if a buffer to store the expression could not be allocated.
+ */
+DDS_EXPORT bool dds_qget_content_filter (const dds_qos_t * __restrict qos, char **expression);
+
 
 /**
  * @ingroup qos_getters
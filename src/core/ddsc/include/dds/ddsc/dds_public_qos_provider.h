@@ -82,6 +82,30 @@ DDS_EXPORT dds_return_t
 dds_create_qos_provider_scope (const char *path, dds_qos_provider_t **provider,
                                const char *key);
 
+/**
+ * @brief Initialize Qos Provider with certain scope, deferring the parsing of profiles.
+ * @ingroup qos_provider
+ * @component qos_provider_api
+ *
+ * Create dds_qos_provider with provided system definition file path and scope, like
+ * dds_create_qos_provider_scope, but only index the QoS profiles in the system definition
+ * on creation. A profile is parsed and validated when a QoS from it is first requested,
+ * together with the profiles it refers to via "base_name". This makes creating a provider
+ * from a large system definition of which only a few profiles are used much cheaper.
+ *
+ * Errors in a profile are reported by dds_qos_provider_get_qos, and only for profiles
+ * from which a QoS is requested.
+ *
+ * @param[in] path - String that contains system definition inself or path to system defenition file.
+ * @param[in,out] provider - Pointer to the Qos Provider structure.
+ * @param[in] key - String that contains pattern of interested qos from `path` in format '<library name>::<profile name>::<entity name>'.
+ *
+ * @return a DDS return code
+ */
+DDS_EXPORT dds_return_t
+dds_create_qos_provider_indexed (const char *path, dds_qos_provider_t **provider,
+                                 const char *key);
+
 /**
  * @brief Get Qos from Qos Provider.
  * @ingroup qos_provider
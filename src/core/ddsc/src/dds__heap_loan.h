@@ -18,6 +18,7 @@ extern "C" {
 #endif
 
 struct dds_loaned_sample;
+struct dds_heap_loan_pool;
 
 dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
   ddsrt_nonnull_all;
@@ -25,6 +26,54 @@ dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_s
 void dds_heap_loan_reset (struct dds_loaned_sample *loaned_sample)
   ddsrt_nonnull_all;
 
+/**
+ * @brief Create a pool of recycled heap loans for a type
+ *
+ * Heap loans taken from the pool are returned to it when their reference count
+ * drops to 0, whichever thread that happens in.  The pool remains in existence
+ * until the owner has freed it and all outstanding loans have been released.
+ *
+ * @param[out] ppool  Gets a pointer to the newly created pool
+ * @param[in] type    Type of the samples in the pool
+ * @return a DDS return code
+ */
+dds_return_t dds_heap_loan_pool_create (struct dds_heap_loan_pool **ppool, const struct ddsi_sertype *type)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Drop the owner's reference to a pool of heap loans
+ *
+ * @param[in] pool  The pool
+ */
+void dds_heap_loan_pool_free (struct dds_heap_loan_pool *pool)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Get a heap loan from the pool, allocating a new one if the pool is empty
+ *
+ * The sample is in the same state as a newly allocated one.  Calls must be serialized
+ * by the owner of the pool.
+ *
+ * @param[in] pool  The pool
+ * @param[in] sample_state  Initial state of the loaned sample
+ * @param[out] loaned_sample  Gets a pointer to the loaned sample
+ * @return a DDS return code
+ */
+dds_return_t dds_heap_loan_pool_get_loan (struct dds_heap_loan_pool *pool, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Get the number of loans allocated and reused by the pool
+ *
+ * Calls must be serialized with `dds_heap_loan_pool_get_loan`.
+ *
+ * @param[in] pool  The pool
+ * @param[out] n_allocs  Number of loans that had to be allocated
+ * @param[out] n_reuses  Number of loans that were taken from the pool
+ */
+void dds_heap_loan_pool_get_stats (const struct dds_heap_loan_pool *pool, uint64_t *n_allocs, uint64_t *n_reuses)
+  ddsrt_nonnull_all;
+
 #if defined(__cplusplus)
 }
 #endif
@@ -34,10 +34,13 @@ typedef struct dds_qos_item
   enum dds_qos_kind kind;
 } dds_qos_item_t;
 
+struct dds_qos_provider_index;
+
 struct dds_qos_provider
 {
   char* file_path;
   struct ddsrt_hh *keyed_qos;
+  struct dds_qos_provider_index *index; // NULL unless created with dds_create_qos_provider_indexed
 };
 
 #if defined (__cplusplus)
@@ -30,6 +30,17 @@ struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_dom
 /** @component rhc */
 struct dds_rhc *dds_rhc_default_new (struct dds_reader *reader, const struct ddsi_sertype *type);
 
+/**
+ * @brief Number of instances and valid samples in a reader history cache
+ * @component rhc
+ *
+ * @param[in] rhc         reader history cache
+ * @param[out] instances  number of instances, including empty ones
+ * @param[out] samples    number of valid samples over all instances
+ * @returns true if rhc is a default RHC, false (without touching the outputs) if not
+ */
+bool dds_rhc_default_get_stats (struct dds_rhc *rhc, uint32_t *instances, uint32_t *samples);
+
 #ifdef DDS_HAS_LIFESPAN
 /** @component rhc */
 ddsrt_mtime_t dds_rhc_default_sample_expired_cb(void *hc, ddsrt_mtime_t tnow);
@@ -45,6 +45,7 @@ struct dds_readcond;
 struct dds_guardcond;
 struct dds_statuscond;
 struct dds_loan_pool;
+struct dds_heap_loan_pool;
 
 struct ddsi_sertype;
 struct ddsi_rhc;
@@ -284,6 +285,7 @@ typedef struct dds_domain {
   dds_domainid_t m_id;
 
   struct ddsi_cfgst *cfgst; // NULL if config initializer provided
+  struct ddsi_config_compiled_instance *compiled_config; // non-NULL if compiled configuration provided
 
   struct ddsi_sertype *builtin_participant_type;
 #ifdef DDS_HAS_TOPIC_DISCOVERY
@@ -394,6 +396,10 @@ typedef struct dds_reader {
   struct ddsi_reader *m_rd;
   struct dds_loan_pool *m_loans; /* administration of outstanding loans */
   struct dds_loan_pool *m_heap_loan_cache;
+#ifdef DDS_HAS_TYPELIB
+  struct ddsi_content_filter *m_content_filter; /* compiled content filter QoS, NULL if none, constant */
+  struct ddsi_sertype *m_content_filter_stype; /* refc'd, for converting data the filter can't handle, NULL if it is evaluated on samples in memory, constant */
+#endif
 
   /* Status metrics */
   dds_sample_rejected_status_t m_sample_rejected_status;
@@ -413,6 +419,7 @@ typedef struct dds_writer {
   struct ddsi_whc *m_whc; /* FIXME: ownership still with underlying DDSI writer (cos of DDSI built-in writers )*/
   bool whc_batch; /* FIXME: channels + latency budget */
   struct dds_loan_pool *m_loans; /* administration of associated loans */
+  struct dds_heap_loan_pool *m_heap_loan_pool; /* recycled heap loans, created on first use, lock(wr) */
 
   /* Status metrics */
 
@@ -30,6 +30,20 @@ struct whc_writer_info *dds_whc_make_wrinfo (struct dds_writer *wr, const dds_qo
 /** @component whc */
 void dds_whc_free_wrinfo (struct whc_writer_info *info);
 
+/**
+ * @brief Number of samples, indexed instances and unacknowledged bytes in a WHC
+ * @component whc
+ *
+ * Instances are only tracked if the history setting requires keeping an index
+ * on instance, that is, for KEEP_LAST and for transient-local writers.
+ *
+ * @param[in] whc             a WHC created using @ref dds_whc_new
+ * @param[out] samples        number of samples
+ * @param[out] instances      number of instances in the index
+ * @param[out] unacked_bytes  number of bytes not yet acknowledged by all readers
+ */
+void dds_whc_get_stats (const struct ddsi_whc *whc, uint32_t *samples, uint32_t *instances, uint64_t *unacked_bytes);
+
 #if defined (__cplusplus)
 }
 #endif
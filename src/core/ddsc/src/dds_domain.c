@@ -14,6 +14,7 @@
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/static_assert.h"
 #include "dds/ddsi/ddsi_iid.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_serdata.h"
@@ -23,6 +24,7 @@
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_typelib.h"
 #include "dds/ddsi/ddsi_init.h"
+#include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__init.h"
 #include "dds__domain.h"
@@ -31,17 +33,87 @@
 #include "dds__entity.h"
 #include "dds__serdata_default.h"
 #include "dds__psmx.h"
+#include "dds__statistics.h"
 
 static dds_return_t dds_domain_free (dds_entity *vdomain);
 
+/* See struct ddsi_domain_stats for the meaning of everything following the
+   packet capture statistics, the order must match the table below */
+static const struct dds_stat_keyvalue_descriptor dds_domain_statistics_kv[] = {
+  { "pcap_packets", DDS_STAT_KIND_UINT64 },
+  { "pcap_dropped", DDS_STAT_KIND_UINT64 },
+  { "dqueue_length", DDS_STAT_KIND_UINT64 },
+  { "dqueue_delivered", DDS_STAT_KIND_UINT64 },
+  { "dqueue_wait_time", DDS_STAT_KIND_UINT64 },
+  { "dqueue_max_wait_time", DDS_STAT_KIND_UINT64 },
+  { "dqueue_full_waits", DDS_STAT_KIND_UINT64 },
+  { "xevq_length", DDS_STAT_KIND_UINT64 },
+  { "xevq_nontimed_handled", DDS_STAT_KIND_UINT64 },
+  { "xevq_timed_handled", DDS_STAT_KIND_UINT64 },
+  { "xevq_timed_lateness", DDS_STAT_KIND_UINT64 },
+  { "xevq_max_timed_lateness", DDS_STAT_KIND_UINT64 },
+  { "sendq_length", DDS_STAT_KIND_UINT64 },
+  { "sendq_packets", DDS_STAT_KIND_UINT64 },
+  { "sendq_blocked", DDS_STAT_KIND_UINT64 },
+  { "rbuf_count", DDS_STAT_KIND_UINT64 },
+  { "rbuf_bytes", DDS_STAT_KIND_UINT64 },
+  { "rx_packets", DDS_STAT_KIND_UINT64 },
+  { "rx_bytes", DDS_STAT_KIND_UINT64 },
+  { "tx_packets", DDS_STAT_KIND_UINT64 },
+  { "tx_bytes", DDS_STAT_KIND_UINT64 }
+};
+
+static const size_t dds_domain_statistics_offsets[] = {
+  offsetof (struct ddsi_domain_stats, dqueue_length),
+  offsetof (struct ddsi_domain_stats, dqueue_delivered),
+  offsetof (struct ddsi_domain_stats, dqueue_wait_time),
+  offsetof (struct ddsi_domain_stats, dqueue_max_wait_time),
+  offsetof (struct ddsi_domain_stats, dqueue_full_waits),
+  offsetof (struct ddsi_domain_stats, xevq_length),
+  offsetof (struct ddsi_domain_stats, xevq_nontimed_handled),
+  offsetof (struct ddsi_domain_stats, xevq_timed_handled),
+  offsetof (struct ddsi_domain_stats, xevq_timed_lateness),
+  offsetof (struct ddsi_domain_stats, xevq_max_timed_lateness),
+  offsetof (struct ddsi_domain_stats, sendq_length),
+  offsetof (struct ddsi_domain_stats, sendq_packets),
+  offsetof (struct ddsi_domain_stats, sendq_blocked),
+  offsetof (struct ddsi_domain_stats, rbuf_count),
+  offsetof (struct ddsi_domain_stats, rbuf_bytes),
+  offsetof (struct ddsi_domain_stats, rx_packets),
+  offsetof (struct ddsi_domain_stats, rx_bytes),
+  offsetof (struct ddsi_domain_stats, tx_packets),
+  offsetof (struct ddsi_domain_stats, tx_bytes)
+};
+
+static const struct dds_stat_descriptor dds_domain_statistics_desc = {
+  .count = sizeof (dds_domain_statistics_kv) / sizeof (dds_domain_statistics_kv[0]),
+  .kv = dds_domain_statistics_kv
+};
+
+static struct dds_statistics *dds_domain_create_statistics (const struct dds_entity *entity)
+{
+  return dds_alloc_statistics (entity, &dds_domain_statistics_desc);
+}
+
+static void dds_domain_refresh_statistics (const struct dds_entity *entity, struct dds_statistics *stat)
+{
+  dds_domain * const domain = (dds_domain *) entity;
+  struct ddsi_domain_stats st;
+  ddsi_get_pcap_stats (&domain->gv, &stat->kv[0].u.u64, &stat->kv[1].u.u64);
+  ddsi_get_domain_stats (&domain->gv, &st);
+  DDSRT_STATIC_ASSERT (sizeof (dds_domain_statistics_kv) / sizeof (dds_domain_statistics_kv[0]) == 2 + sizeof (dds_domain_statistics_offsets) / sizeof (dds_domain_statistics_offsets[0]));
+  for (size_t i = 0; i < sizeof (dds_domain_statistics_offsets) / sizeof (dds_domain_statistics_offsets[0]); i++)
+    memcpy (&stat->kv[2 + i].u.u64, (const char *) &st + dds_domain_statistics_offsets[i], sizeof (uint64_t));
+}
+
 const struct dds_entity_deriver dds_entity_deriver_domain = {
   .interrupt = dds_entity_deriver_dummy_interrupt,
   .close = dds_entity_deriver_dummy_close,
   .delete = dds_domain_free,
   .set_qos = dds_entity_deriver_dummy_set_qos,
   .validate_status = dds_entity_deriver_dummy_validate_status,
-  .create_statistics = dds_entity_deriver_dummy_create_statistics,
-  .refresh_statistics = dds_entity_deriver_dummy_refresh_statistics,
+  .create_statistics = dds_domain_create_statistics,
+  .refresh_statistics = dds_domain_refresh_statistics,
   .invoke_cbs_for_pending_events = dds_entity_deriver_dummy_invoke_cbs_for_pending_events
 };
 
@@ -56,10 +128,15 @@ static const ddsrt_avl_treedef_t dds_domaintree_def = DDSRT_AVL_TREEDEF_INITIALI
   offsetof (dds_domain, m_node), offsetof (dds_domain, m_id), dds_domain_compare, NULL);
 
 struct config_source {
-  enum { CFGKIND_XML, CFGKIND_RAW } kind;
+  enum { CFGKIND_XML, CFGKIND_RAW, CFGKIND_COMPILED } kind;
   union {
     const char *xml;
     const struct ddsi_config *raw;
+    struct {
+      struct ddsi_config_compiled *cc;
+      dds_config_override_fn override;
+      void *arg;
+    } compiled;
   } u;
 };
 
@@ -105,6 +182,15 @@ static dds_entity_t dds_domain_init (dds_domain *domain, dds_domainid_t domain_i
         domain->gv.config.domainId = domain_id;
       break;
 
+    case CFGKIND_COMPILED:
+      domain->cfgst = NULL;
+      domain->compiled_config = ddsi_config_compiled_instantiate (config->u.compiled.cc, &domain->gv.config);
+      if (domain_id != DDS_DOMAIN_DEFAULT)
+        domain->gv.config.domainId = domain_id;
+      if (config->u.compiled.override)
+        config->u.compiled.override (&domain->gv.config, config->u.compiled.arg);
+      break;
+
     case CFGKIND_XML:
       domain->cfgst = ddsi_config_init (config->u.xml, &domain->gv.config, domain_id);
       if (domain->cfgst == NULL)
@@ -211,6 +297,8 @@ fail_psmx_init:
 fail_ddsi_config:
   if (domain->cfgst)
     ddsi_config_fini (domain->cfgst);
+  else if (domain->compiled_config)
+    ddsi_config_compiled_fini_instance (domain->compiled_config, &domain->gv.config);
 fail_config:
   dds_handle_delete (&domain->m_entity.m_hdllink);
   return ret;
@@ -325,6 +413,26 @@ dds_entity_t dds_create_domain_with_rawconfig (const dds_domainid_t domain, cons
   return ret;
 }
 
+dds_entity_t dds_create_domain_with_compiled_config (const dds_domainid_t domain, struct ddsi_config_compiled *config, dds_config_override_fn override, void *arg)
+{
+  dds_domain *dom;
+  dds_entity_t ret;
+
+  if (domain == DDS_DOMAIN_DEFAULT)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if (config == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+
+  /* Make sure DDS instance is initialized. */
+  if ((ret = dds_init ()) < 0)
+    return ret;
+
+  const struct config_source config_src = { .kind = CFGKIND_COMPILED, .u = { .compiled = { .cc = config, .override = override, .arg = arg } } };
+  ret = dds_domain_create_internal_xml_or_raw (&dom, domain, false, &config_src);
+  dds_entity_unpin_and_drop_ref (&dds_global.m_entity);
+  return ret;
+}
+
 static dds_return_t dds_domain_free (dds_entity *vdomain)
 {
   struct dds_domain *domain = (struct dds_domain *) vdomain;
@@ -353,6 +461,8 @@ static dds_return_t dds_domain_free (dds_entity *vdomain)
   dds_entity_final_deinit_before_free (vdomain);
   if (domain->cfgst)
     ddsi_config_fini (domain->cfgst);
+  else if (domain->compiled_config)
+    ddsi_config_compiled_fini_instance (domain->compiled_config, &domain->gv.config);
   dds_free (vdomain);
   ddsrt_cond_broadcast (&dds_global.m_cond);
   ddsrt_mutex_unlock (&dds_global.m_mutex);
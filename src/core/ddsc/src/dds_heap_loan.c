@@ -11,28 +11,77 @@
 #include <string.h>
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsi/ddsi_sertype.h"
+#include "dds/ddsi/ddsi_freelist.h"
 #include "dds/cdr/dds_cdrstream.h"
 #include "dds__loaned_sample.h"
 #include "dds__heap_loan.h"
 #include "dds__entity.h"
 
+/* Maximum number of returned loans cached by a writer, anything beyond that gets
+   freed.  A writer with a large history and local readers can have many loans
+   outstanding, but in a steady state most of them will be referenced by the WHC
+   and the readers, rather than waiting in the pool. */
+#define MAX_HEAP_LOAN_POOL_SIZE 256
+
+struct dds_heap_loan_pool {
+  ddsrt_atomic_uint32_t refc; /* 1 for the owner + 1 for each outstanding loan */
+  const struct ddsi_sertype *m_stype; /* refc'd */
+  struct ddsi_freelist freelist;
+  uint64_t n_allocs; /* protected by the owner's lock */
+  uint64_t n_reuses; /* protected by the owner's lock */
+};
+
 typedef struct dds_heap_loan {
   dds_loaned_sample_t c;
   struct dds_psmx_metadata metadata; // pointed to by c.metadata
   const struct ddsi_sertype *m_stype;
+  struct dds_heap_loan_pool *m_pool; // pool it is returned to, refc'd while loan is outstanding
+  struct dds_heap_loan *next; // link in the pool's freelist
 } dds_heap_loan_t;
 
 static void heap_loan_free (dds_loaned_sample_t *loaned_sample)
   ddsrt_nonnull_all;
 
-static void heap_loan_free (dds_loaned_sample_t *loaned_sample)
+static void heap_loan_realfree (dds_heap_loan_t *hl)
 {
-  dds_heap_loan_t *hl = (dds_heap_loan_t *) loaned_sample;
   assert (hl->c.sample_ptr != NULL);
   ddsi_sertype_free_sample (hl->m_stype, hl->c.sample_ptr, DDS_FREE_ALL);
   ddsrt_free (hl);
 }
 
+static void heap_loan_realfree_wrap (void *elem)
+{
+  heap_loan_realfree (elem);
+}
+
+static void heap_loan_pool_unref (struct dds_heap_loan_pool *pool)
+{
+  if (ddsrt_atomic_dec32_ov (&pool->refc) == 1)
+  {
+    ddsi_freelist_fini (&pool->freelist, heap_loan_realfree_wrap);
+    ddsi_sertype_unref ((struct ddsi_sertype *) pool->m_stype);
+    ddsrt_free (pool);
+  }
+}
+
+static void heap_loan_free (dds_loaned_sample_t *loaned_sample)
+{
+  dds_heap_loan_t *hl = (dds_heap_loan_t *) loaned_sample;
+  struct dds_heap_loan_pool * const pool = hl->m_pool;
+  if (pool == NULL)
+    heap_loan_realfree (hl);
+  else
+  {
+    // Resetting it here rather than when it is handed out again keeps the cost of
+    // zeroing the sample out of the writer's path (this is usually called when the
+    // last reference to the sample gets dropped, which is often in another thread)
+    dds_heap_loan_reset (&hl->c);
+    if (!ddsi_freelist_push (&pool->freelist, hl))
+      heap_loan_realfree (hl);
+    heap_loan_pool_unref (pool);
+  }
+}
+
 void dds_heap_loan_reset (struct dds_loaned_sample *loaned_sample)
 {
   dds_heap_loan_t *hl = (dds_heap_loan_t *) loaned_sample;
@@ -45,10 +94,8 @@ const dds_loaned_sample_ops_t dds_loan_heap_ops = {
   .free = heap_loan_free
 };
 
-dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
+static dds_return_t heap_loan_new (const struct ddsi_sertype *type, dds_heap_loan_t **hl)
 {
-  assert (sample_state == DDS_LOANED_SAMPLE_STATE_UNITIALIZED || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_KEY || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_DATA);
-
   dds_heap_loan_t *s = ddsrt_malloc (sizeof (*s));
   if (s == NULL)
     return DDS_RETCODE_OUT_OF_RESOURCES;
@@ -56,12 +103,19 @@ dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_s
   s->c.metadata = &s->metadata;
   s->c.ops = dds_loan_heap_ops;
   s->m_stype = type;
+  s->m_pool = NULL;
+  s->next = NULL;
   if ((s->c.sample_ptr = ddsi_sertype_alloc_sample (type)) == NULL)
   {
     dds_free (s);
     return DDS_RETCODE_OUT_OF_RESOURCES;
   }
+  *hl = s;
+  return DDS_RETCODE_OK;
+}
 
+static void heap_loan_init (dds_heap_loan_t *s, const struct ddsi_sertype *type, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
+{
   s->c.metadata->sample_state = sample_state;
   s->c.metadata->cdr_identifier = DDSI_RTPS_SAMPLE_NATIVE;
   s->c.metadata->cdr_options = 0;
@@ -72,5 +126,62 @@ dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_s
   s->c.loan_origin.psmx_endpoint = NULL;
   ddsrt_atomic_st32 (&s->c.refc, 1);
   *loaned_sample = &s->c;
+}
+
+dds_return_t dds_heap_loan (const struct ddsi_sertype *type, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
+{
+  assert (sample_state == DDS_LOANED_SAMPLE_STATE_UNITIALIZED || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_KEY || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_DATA);
+  dds_return_t ret;
+  dds_heap_loan_t *s;
+  if ((ret = heap_loan_new (type, &s)) != DDS_RETCODE_OK)
+    return ret;
+  heap_loan_init (s, type, sample_state, loaned_sample);
   return DDS_RETCODE_OK;
 }
+
+dds_return_t dds_heap_loan_pool_create (struct dds_heap_loan_pool **ppool, const struct ddsi_sertype *type)
+{
+  struct dds_heap_loan_pool *pool;
+  if ((pool = ddsrt_malloc (sizeof (*pool))) == NULL)
+    return DDS_RETCODE_OUT_OF_RESOURCES;
+  ddsrt_atomic_st32 (&pool->refc, 1);
+  pool->m_stype = ddsi_sertype_ref (type);
+  ddsi_freelist_init (&pool->freelist, MAX_HEAP_LOAN_POOL_SIZE, offsetof (dds_heap_loan_t, next));
+  pool->n_allocs = 0;
+  pool->n_reuses = 0;
+  *ppool = pool;
+  return DDS_RETCODE_OK;
+}
+
+void dds_heap_loan_pool_free (struct dds_heap_loan_pool *pool)
+{
+  heap_loan_pool_unref (pool);
+}
+
+dds_return_t dds_heap_loan_pool_get_loan (struct dds_heap_loan_pool *pool, dds_loaned_sample_state_t sample_state, struct dds_loaned_sample **loaned_sample)
+{
+  assert (sample_state == DDS_LOANED_SAMPLE_STATE_UNITIALIZED || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_KEY || sample_state == DDS_LOANED_SAMPLE_STATE_RAW_DATA);
+  dds_heap_loan_t *s;
+  if ((s = ddsi_freelist_pop (&pool->freelist)) != NULL)
+  {
+    assert (s->m_pool == pool && s->m_stype == pool->m_stype);
+    pool->n_reuses++;
+  }
+  else
+  {
+    dds_return_t ret;
+    if ((ret = heap_loan_new (pool->m_stype, &s)) != DDS_RETCODE_OK)
+      return ret;
+    s->m_pool = pool;
+    pool->n_allocs++;
+  }
+  ddsrt_atomic_inc32 (&pool->refc);
+  heap_loan_init (s, pool->m_stype, sample_state, loaned_sample);
+  return DDS_RETCODE_OK;
+}
+
+void dds_heap_loan_pool_get_stats (const struct dds_heap_loan_pool *pool, uint64_t *n_allocs, uint64_t *n_reuses)
+{
+  *n_allocs = pool->n_allocs;
+  *n_reuses = pool->n_reuses;
+}
@@ -440,6 +440,16 @@ void dds_qset_entity_name (dds_qos_t * __restrict qos, const char * name)
   qos->present |= DDSI_QP_ENTITY_NAME;
 }
 
+void dds_qset_content_filter (dds_qos_t * __restrict qos, const char * expression)
+{
+  if (qos == NULL || expression == NULL)
+    return;
+  if (qos->present & DDSI_QP_CYCLONE_CONTENT_FILTER)
+    dds_free (qos->content_filter);
+  qos->content_filter = dds_string_dup (expression);
+  qos->present |= DDSI_QP_CYCLONE_CONTENT_FILTER;
+}
+
 void dds_qset_type_consistency (dds_qos_t * __restrict qos, dds_type_consistency_kind_t kind,
   bool ignore_sequence_bounds, bool ignore_string_bounds, bool ignore_member_names, bool prevent_type_widening, bool force_type_validation)
 {
@@ -1003,6 +1013,15 @@ bool dds_qget_entity_name (const dds_qos_t * __restrict qos, char **name)
   return *name != NULL;
 }
 
+bool dds_qget_content_filter (const dds_qos_t * __restrict qos, char **expression)
+{
+  if (qos == NULL || expression == NULL || !(qos->present & DDSI_QP_CYCLONE_CONTENT_FILTER))
+    return false;
+
+  *expression = dds_string_dup (qos->content_filter);
+  return *expression != NULL;
+}
+
 void dds_apply_entity_naming(dds_qos_t *qos, /* optional */ dds_qos_t *parent_qos, struct ddsi_domaingv *gv)
 {
   if (gv->config.entity_naming_mode == DDSI_ENTITY_NAMING_DEFAULT_FANCY && !(qos->present & DDSI_QP_ENTITY_NAME)) {
@@ -15,6 +15,8 @@
 #include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/xmlparser.h"
 
 #include "dds__sysdef_model.h"
 #include "dds__sysdef_parser.h"
@@ -47,6 +49,31 @@ static dds_return_t read_sysdef (const char *path, struct dds_sysdef_system **sy
   return ret;
 }
 
+/* Indexed providers: a single pass over the XML only records the location of each QoS
+   profile and the profiles it references via "base_name".  A profile is parsed, validated
+   and converted into QoS items the first time a QoS from it is requested, together with
+   the profiles it (indirectly) references, which are then cached as well. */
+
+struct qos_profile_loc {
+  char *lib_name;
+  char *prof_name;
+  size_t start, end; /* [start,end) in index->text */
+  uint32_t nbases;
+  char **bases; /* "<library>::<profile>" */
+  uint32_t visited; /* generation in which it was last visited while collecting */
+  bool materialized;
+};
+
+struct dds_qos_provider_index {
+  ddsrt_mutex_t lock;
+  char *text;
+  char *lib_scope, *prof_scope, *ent_scope;
+  struct ddsrt_hh *profiles; /* struct qos_profile_loc */
+  uint32_t generation;
+};
+
+static dds_return_t materialize_profile (const dds_qos_provider_t *provider, const char *key);
+
 static uint32_t qos_item_hash_fn(const void *a)
 {
   dds_qos_item_t *item = (dds_qos_item_t *)a;
@@ -77,6 +104,12 @@ static void cleanup_qos_items (void *vnode, void *varg)
    DDS_SUBSCRIBER_QOS_MASK | DDS_PUBLISHER_QOS_MASK | DDS_PARTICIPANT_QOS_MASK) ^ \
   (DDSI_QP_ENTITY_NAME | DDSI_QP_ADLINK_ENTITY_FACTORY | \
     DDSI_QP_CYCLONE_IGNORELOCAL | DDSI_QP_PSMX)
+static dds_return_t validate_sysdef (const struct dds_sysdef_system *sysdef)
+{
+  return dds_validate_qos_lib (sysdef, PROVIDER_ALLOWED_QOS_MASK);
+}
+#undef PROVIDER_ALLOWED_QOS_MASK
+
 static dds_return_t read_validate_sysdef(const char *path, struct dds_sysdef_system **sysdef)
 {
   dds_return_t ret = DDS_RETCODE_OK;
@@ -86,7 +119,7 @@ static dds_return_t read_validate_sysdef(const char *path, struct dds_sysdef_sys
     QOSPROV_ERROR("Failed during read sysdef: %s\n", path);
     goto err_read;
   }
-  if ((ret = dds_validate_qos_lib (def, PROVIDER_ALLOWED_QOS_MASK)) != DDS_RETCODE_OK)
+  if ((ret = validate_sysdef (def)) != DDS_RETCODE_OK)
   {
     QOSPROV_ERROR("Failed during validate sysdef: %s\n", path);
     goto err_validate;
@@ -99,7 +132,96 @@ err_validate:
 err_read:
   return ret;
 }
-#undef PROVIDER_ALLOWED_QOS_MASK
+
+static bool in_scope (const char *scope, const char *name)
+{
+  return scope == NULL || strcmp (scope, PROVIDER_ITEM_SCOPE_NONE) == 0 || (name != NULL && strcmp (name, scope) == 0);
+}
+
+static bool qos_kind_from_sysdef (enum dds_sysdef_qos_kind sysdef_kind, dds_qos_kind_t *kind)
+{
+  switch(sysdef_kind)
+  {
+    case DDS_SYSDEF_TOPIC_QOS:
+      *kind = DDS_TOPIC_QOS;
+      return true;
+    case DDS_SYSDEF_READER_QOS:
+      *kind = DDS_READER_QOS;
+      return true;
+    case DDS_SYSDEF_WRITER_QOS:
+      *kind = DDS_WRITER_QOS;
+      return true;
+    case DDS_SYSDEF_SUBSCRIBER_QOS:
+      *kind = DDS_SUBSCRIBER_QOS;
+      return true;
+    case DDS_SYSDEF_PUBLISHER_QOS:
+      *kind = DDS_PUBLISHER_QOS;
+      return true;
+    case DDS_SYSDEF_PARTICIPANT_QOS:
+      *kind = DDS_PARTICIPANT_QOS;
+      return true;
+  }
+  return false;
+}
+
+static void remove_profile_qos_items (struct ddsrt_hh *keyed_qos, const struct dds_sysdef_qos_profile *prof, const char *prefix, const struct dds_sysdef_qos *end)
+{
+  for (const struct dds_sysdef_qos *qos = prof->qos; qos != end; qos = (const struct dds_sysdef_qos *)qos->xmlnode.next)
+  {
+    dds_qos_item_t template = { .full_name = NULL }, *item;
+    if (!qos_kind_from_sysdef(qos->kind, &template.kind))
+      continue;
+    if (qos->name != NULL)
+      (void) ddsrt_asprintf(&template.full_name, "%s"PROVIDER_ITEM_SEP"%s", prefix, qos->name);
+    else
+      template.full_name = ddsrt_strdup(prefix);
+    if ((item = ddsrt_hh_lookup(keyed_qos, &template)) != NULL)
+    {
+      ddsrt_hh_remove_present(keyed_qos, item);
+      cleanup_qos_items(item, NULL);
+    }
+    ddsrt_free(template.full_name);
+  }
+}
+
+static dds_return_t add_profile_qos_items (struct ddsrt_hh *keyed_qos, const struct dds_sysdef_qos_lib *lib, const struct dds_sysdef_qos_profile *prof, const char *path, const char *ent_scope)
+{
+  dds_return_t ret = DDS_RETCODE_OK;
+  char *prefix;
+  (void) ddsrt_asprintf(&prefix, "%s"PROVIDER_ITEM_SEP"%s", lib->name, prof->name);
+  for (const struct dds_sysdef_qos *qos = prof->qos; qos != NULL; qos = (const struct dds_sysdef_qos *)qos->xmlnode.next)
+  {
+    if (!in_scope(ent_scope, qos->name))
+      continue;
+    dds_qos_kind_t kind;
+    if (!qos_kind_from_sysdef(qos->kind, &kind))
+    {
+      ret = DDS_RETCODE_BAD_PARAMETER;
+      remove_profile_qos_items(keyed_qos, prof, prefix, qos);
+      goto err;
+    }
+    dds_qos_item_t *item = ddsrt_malloc(sizeof(*item));
+    item->kind = kind;
+    item->qos = dds_create_qos();
+    dds_merge_qos(item->qos, qos->qos);
+    if (qos->name != NULL)
+      (void) ddsrt_asprintf(&item->full_name, "%s"PROVIDER_ITEM_SEP"%s", prefix, qos->name);
+    else
+      item->full_name = ddsrt_strdup(prefix);
+    if (!ddsrt_hh_add(keyed_qos, item))
+    {
+      QOSPROV_ERROR("Qos duplicate name: %s kind: %d file: %s.\n",
+                    item->full_name, item->kind, path);
+      ret = DDS_RETCODE_BAD_PARAMETER;
+      cleanup_qos_items(item, NULL);
+      remove_profile_qos_items(keyed_qos, prof, prefix, qos);
+      goto err;
+    }
+  }
+err:
+  ddsrt_free(prefix);
+  return ret;
+}
 
 static dds_return_t init_qos_provider (const struct dds_sysdef_system *sysdef, const char *path, dds_qos_provider_t **provider, char *lib_scope, char *prof_scope, char *ent_scope)
 {
@@ -108,69 +230,19 @@ static dds_return_t init_qos_provider (const struct dds_sysdef_system *sysdef, c
   struct ddsrt_hh *keyed_qos = ddsrt_hh_new(1, qos_item_hash_fn, qos_item_equals_fn);
   for (const struct dds_sysdef_qos_lib *lib = sysdef->qos_libs; lib != NULL; lib = (const struct dds_sysdef_qos_lib *)lib->xmlnode.next)
   {
-    char *lib_name = lib->name;
-    if (lib_scope != NULL && strcmp(lib_scope, PROVIDER_ITEM_SCOPE_NONE) != 0 && strcmp(lib_name, lib_scope) != 0)
+    if (!in_scope(lib_scope, lib->name))
       continue;
     for (const struct dds_sysdef_qos_profile *prof = lib->qos_profiles; prof != NULL; prof = (const struct dds_sysdef_qos_profile *)prof->xmlnode.next)
     {
-      char *prof_name = prof->name;
-      if (prof_scope != NULL && strcmp(prof_scope, PROVIDER_ITEM_SCOPE_NONE) != 0 && strcmp(prof_name, prof_scope) != 0)
+      if (!in_scope(prof_scope, prof->name))
         continue;
-      char *prefix;
-      (void) ddsrt_asprintf(&prefix, "%s"PROVIDER_ITEM_SEP"%s", lib_name, prof_name);
-      for (const struct dds_sysdef_qos *qos = prof->qos; qos != NULL; qos = (const struct dds_sysdef_qos *)qos->xmlnode.next)
-      {
-        if (ent_scope != NULL && strcmp(ent_scope, PROVIDER_ITEM_SCOPE_NONE) != 0 && (qos->name == NULL || strcmp(qos->name, ent_scope) != 0))
-          continue;
-        dds_qos_item_t *item = ddsrt_malloc(sizeof(*item));
-        dds_qos_kind_t kind;
-        switch(qos->kind)
-        {
-          case DDS_SYSDEF_TOPIC_QOS:
-            kind = DDS_TOPIC_QOS;
-            break;
-          case DDS_SYSDEF_READER_QOS:
-            kind = DDS_READER_QOS;
-            break;
-          case DDS_SYSDEF_WRITER_QOS:
-            kind = DDS_WRITER_QOS;
-            break;
-          case DDS_SYSDEF_SUBSCRIBER_QOS:
-            kind = DDS_SUBSCRIBER_QOS;
-            break;
-          case DDS_SYSDEF_PUBLISHER_QOS:
-            kind = DDS_PUBLISHER_QOS;
-            break;
-          case DDS_SYSDEF_PARTICIPANT_QOS:
-            kind = DDS_PARTICIPANT_QOS;
-            break;
-          default:
-            ddsrt_free(prefix);
-            ddsrt_free(item);
-            goto err_prov;
-        }
-        item->kind = kind;
-        item->qos = dds_create_qos();
-        dds_merge_qos(item->qos, qos->qos);
-        if (qos->name != NULL)
-          (void) ddsrt_asprintf(&item->full_name, "%s"PROVIDER_ITEM_SEP"%s", prefix, qos->name);
-        else
-          item->full_name = ddsrt_strdup(prefix);
-        if (!ddsrt_hh_add(keyed_qos, item))
-        {
-          QOSPROV_ERROR("Qos duplicate name: %s kind: %d file: %s.\n",
-                        item->full_name, item->kind, path);
-          ret = DDS_RETCODE_BAD_PARAMETER;
-          ddsrt_free(prefix);
-          cleanup_qos_items(item, NULL);
-          goto err_prov;
-        }
-      }
-      ddsrt_free(prefix);
+      if ((ret = add_profile_qos_items(keyed_qos, lib, prof, path, ent_scope)) != DDS_RETCODE_OK)
+        goto err_prov;
     }
   }
   qos_provider->file_path = ddsrt_strdup(path);
   qos_provider->keyed_qos = keyed_qos;
+  qos_provider->index = NULL;
   *provider = qos_provider;
 
   return ret;
@@ -203,13 +275,21 @@ dds_return_t dds_qos_provider_get_qos (const dds_qos_provider_t *provider, dds_q
   QOSPROV_TRACE("request qos for entity type: %d, scope: %s", type, key);
   dds_qos_item_t it = {.full_name = ddsrt_strdup(key), .kind = type};
   dds_qos_item_t *item;
-  if ((item = ddsrt_hh_lookup(provider->keyed_qos, &it)) == NULL)
+  if (provider->index != NULL)
+    ddsrt_mutex_lock(&provider->index->lock);
+  if ((item = ddsrt_hh_lookup(provider->keyed_qos, &it)) == NULL &&
+      provider->index != NULL && materialize_profile(provider, key) == DDS_RETCODE_OK)
+    item = ddsrt_hh_lookup(provider->keyed_qos, &it);
+  if (provider->index != NULL)
+    ddsrt_mutex_unlock(&provider->index->lock);
+  if (item == NULL)
   {
     QOSPROV_WARN("Failed to get qos with name: %s, kind: %d ref file: %s\n",
                             it.full_name, it.kind, provider->file_path);
     ret = DDS_RETCODE_BAD_PARAMETER;
     goto err2;
   }
+  /* items are never removed before the provider is deleted, so this remains valid */
   *qos = item->qos;
 
 err2:
@@ -280,10 +360,432 @@ err:
   return ret;
 }
 
+enum index_elem {
+  IDX_ROOT = 1,
+  IDX_LIB,
+  IDX_PROFILE,
+  IDX_PROFILE_CONTENTS
+};
+
+struct index_state {
+  struct ddsrt_xmlp_state *xmlps;
+  struct dds_qos_provider_index *index;
+  struct ddsrt_hh *lib_names;
+  char *lib_name;
+  struct qos_profile_loc *prof;
+  dds_return_t ret;
+};
+
+static uint32_t qos_profile_loc_hash (const void *va)
+{
+  const struct qos_profile_loc *a = va;
+  uint32_t x = ddsrt_mh3(a->lib_name, strlen(a->lib_name), 0);
+  return ddsrt_mh3(a->prof_name, strlen(a->prof_name), x);
+}
+
+static bool qos_profile_loc_equal (const void *va, const void *vb)
+{
+  const struct qos_profile_loc *a = va, *b = vb;
+  return strcmp(a->lib_name, b->lib_name) == 0 && strcmp(a->prof_name, b->prof_name) == 0;
+}
+
+static uint32_t string_hash (const void *va)
+{
+  return ddsrt_mh3(va, strlen(va), 0);
+}
+
+static bool string_equal (const void *va, const void *vb)
+{
+  return strcmp(va, vb) == 0;
+}
+
+static void free_qos_profile_loc (void *vnode, void *varg)
+{
+  struct qos_profile_loc *loc = vnode;
+  (void) varg;
+  ddsrt_free(loc->lib_name);
+  ddsrt_free(loc->prof_name);
+  for (uint32_t i = 0; i < loc->nbases; i++)
+    ddsrt_free(loc->bases[i]);
+  ddsrt_free(loc->bases);
+  ddsrt_free(loc);
+}
+
+static void free_string (void *vnode, void *varg)
+{
+  (void) varg;
+  ddsrt_free(vnode);
+}
+
+static void free_index (struct dds_qos_provider_index *index)
+{
+  ddsrt_hh_enum(index->profiles, free_qos_profile_loc, NULL);
+  ddsrt_hh_free(index->profiles);
+  empty_tokens_str(index->lib_scope, index->prof_scope, index->ent_scope);
+  ddsrt_free(index->text);
+  ddsrt_mutex_destroy(&index->lock);
+  ddsrt_free(index);
+}
+
+static int index_error (struct index_state *st, dds_return_t ret, const char *msg, const char *name, int line)
+{
+  QOSPROV_ERROR("Error indexing system definition: %s '%s' (line %d)\n", msg, name ? name : "", line);
+  st->ret = ret;
+  return -1;
+}
+
+static int index_elem_open (void *varg, uintptr_t parentinfo, uintptr_t *eleminfo, const char *name, int line)
+{
+  struct index_state * const st = varg;
+  switch (parentinfo)
+  {
+    case 0:
+      if (ddsrt_strcasecmp(name, "dds") != 0)
+        return index_error(st, DDS_RETCODE_ERROR, "Unknown element", name, line);
+      *eleminfo = IDX_ROOT;
+      break;
+    case IDX_ROOT:
+      if (ddsrt_strcasecmp(name, "qos_library") != 0)
+        return index_error(st, DDS_RETCODE_ERROR, "Unknown element", name, line);
+      ddsrt_free(st->lib_name);
+      st->lib_name = NULL;
+      *eleminfo = IDX_LIB;
+      break;
+    case IDX_LIB:
+      if (ddsrt_strcasecmp(name, "qos_profile") != 0)
+        return index_error(st, DDS_RETCODE_ERROR, "Unknown element", name, line);
+      if (st->lib_name == NULL)
+        return index_error(st, DDS_RETCODE_ERROR, "Missing name for library containing", name, line);
+      st->prof = ddsrt_calloc(1, sizeof(*st->prof));
+      st->prof->lib_name = ddsrt_strdup(st->lib_name);
+      /* the parser has just consumed the '<' and the element name */
+      st->prof->start = ddsrt_xmlp_get_bufpos(st->xmlps) - strlen(name) - 1;
+      *eleminfo = IDX_PROFILE;
+      break;
+    default:
+      *eleminfo = IDX_PROFILE_CONTENTS;
+      break;
+  }
+  return 0;
+}
+
+static int index_attr (void *varg, uintptr_t eleminfo, const char *name, const char *value, int line)
+{
+  struct index_state * const st = varg;
+  switch (eleminfo)
+  {
+    case IDX_LIB:
+      if (ddsrt_strcasecmp(name, "name") == 0)
+      {
+        if (st->lib_name != NULL || ddsrt_hh_lookup(st->lib_names, value) != NULL)
+          return index_error(st, DDS_RETCODE_BAD_PARAMETER, "Duplicate library", value, line);
+        st->lib_name = ddsrt_strdup(value);
+        ddsrt_hh_add_absent(st->lib_names, ddsrt_strdup(value));
+      }
+      break;
+    case IDX_PROFILE:
+      if (ddsrt_strcasecmp(name, "name") == 0)
+      {
+        if (st->prof->prof_name != NULL)
+          return index_error(st, DDS_RETCODE_ERROR, "Duplicate name for profile", value, line);
+        st->prof->prof_name = ddsrt_strdup(value);
+        break;
+      }
+      /* fall through */
+    case IDX_PROFILE_CONTENTS:
+      if (ddsrt_strcasecmp(name, "base_name") == 0)
+      {
+        st->prof->bases = ddsrt_realloc(st->prof->bases, (st->prof->nbases + 1) * sizeof(*st->prof->bases));
+        st->prof->bases[st->prof->nbases++] = ddsrt_strdup(value);
+      }
+      break;
+  }
+  return 0;
+}
+
+static int index_elem_close (void *varg, uintptr_t eleminfo, int line)
+{
+  struct index_state * const st = varg;
+  switch (eleminfo)
+  {
+    case IDX_LIB:
+      if (st->lib_name == NULL)
+        return index_error(st, DDS_RETCODE_ERROR, "Missing name for", "qos_library", line);
+      break;
+    case IDX_PROFILE: {
+      struct qos_profile_loc *prof = st->prof;
+      st->prof = NULL;
+      if (prof->prof_name == NULL)
+      {
+        free_qos_profile_loc(prof, NULL);
+        return index_error(st, DDS_RETCODE_ERROR, "Missing name for", "qos_profile", line);
+      }
+      /* the parser has just consumed the closing '>' */
+      prof->end = ddsrt_xmlp_get_bufpos(st->xmlps);
+      if (!ddsrt_hh_add(st->index->profiles, prof))
+      {
+        int r = index_error(st, DDS_RETCODE_BAD_PARAMETER, "Duplicate profile", prof->prof_name, line);
+        free_qos_profile_loc(prof, NULL);
+        return r;
+      }
+      break;
+    }
+  }
+  return 0;
+}
+
+static void index_error_cb (void *varg, const char *msg, int line)
+{
+  struct index_state * const st = varg;
+  if (st->ret == DDS_RETCODE_OK)
+    (void) index_error(st, DDS_RETCODE_ERROR, "Syntax error", msg, line);
+}
+
+static dds_return_t read_text (const char *path, char **text)
+{
+  if (path[0] == '<')
+  {
+    *text = ddsrt_strdup(path);
+    return DDS_RETCODE_OK;
+  }
+  FILE *fp;
+  long size;
+  DDSRT_WARNING_MSVC_OFF(4996)
+  if ((fp = fopen(path, "rb")) == NULL)
+  {
+    SYSDEF_ERROR("Error reading system definition: can't read from path '%s'\n", path);
+    return DDS_RETCODE_BAD_PARAMETER;
+  }
+  DDSRT_WARNING_MSVC_ON(4996)
+  if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0)
+  {
+    (void) fclose(fp);
+    return DDS_RETCODE_ERROR;
+  }
+  *text = ddsrt_malloc((size_t) size + 1);
+  if (fread(*text, 1, (size_t) size, fp) != (size_t) size)
+  {
+    ddsrt_free(*text);
+    (void) fclose(fp);
+    return DDS_RETCODE_ERROR;
+  }
+  (*text)[size] = 0;
+  (void) fclose(fp);
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t build_index (struct dds_qos_provider_index *index)
+{
+  struct index_state st = {
+    .index = index, .lib_names = ddsrt_hh_new(1, string_hash, string_equal),
+    .lib_name = NULL, .prof = NULL, .ret = DDS_RETCODE_OK
+  };
+  const struct ddsrt_xmlp_callbacks cb = {
+    .elem_open = index_elem_open,
+    .attr = index_attr,
+    .elem_close = index_elem_close,
+    .error = index_error_cb
+  };
+  st.xmlps = ddsrt_xmlp_new_string(index->text, &st, &cb);
+  if (ddsrt_xmlp_parse(st.xmlps) < 0 && st.ret == DDS_RETCODE_OK)
+    st.ret = DDS_RETCODE_ERROR;
+  ddsrt_xmlp_free(st.xmlps);
+  if (st.prof != NULL)
+    free_qos_profile_loc(st.prof, NULL);
+  ddsrt_free(st.lib_name);
+  ddsrt_hh_enum(st.lib_names, free_string, NULL);
+  ddsrt_hh_free(st.lib_names);
+  return st.ret;
+}
+
+dds_return_t dds_create_qos_provider_indexed (const char *path, dds_qos_provider_t **provider, const char *key)
+{
+  dds_return_t ret;
+  if (path == NULL || provider == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  struct dds_qos_provider_index *index = ddsrt_malloc(sizeof(*index));
+  if ((ret = read_text(path, &index->text)) != DDS_RETCODE_OK)
+  {
+    ddsrt_free(index);
+    return ret;
+  }
+  ddsrt_mutex_init(&index->lock);
+  index->lib_scope = index->prof_scope = index->ent_scope = NULL;
+  index->profiles = ddsrt_hh_new(1, qos_profile_loc_hash, qos_profile_loc_equal);
+  index->generation = 0;
+  (void) resolve_token(key, &index->lib_scope, &index->prof_scope, &index->ent_scope);
+  if ((ret = build_index(index)) != DDS_RETCODE_OK)
+  {
+    QOSPROV_ERROR("Failed to create qos provider file: %s, scope: %s", path, key ? key : PROVIDER_ITEM_SCOPE_NONE);
+    free_index(index);
+    return ret;
+  }
+  dds_qos_provider_t *qos_provider = ddsrt_malloc(sizeof(*qos_provider));
+  qos_provider->file_path = ddsrt_strdup(path);
+  qos_provider->keyed_qos = ddsrt_hh_new(1, qos_item_hash_fn, qos_item_equals_fn);
+  qos_provider->index = index;
+  *provider = qos_provider;
+  return DDS_RETCODE_OK;
+}
+
+static struct qos_profile_loc *lookup_profile_loc (const struct dds_qos_provider_index *index, const char *ref)
+{
+  /* "<library>::<profile>", optionally followed by "::<entity>" */
+  const char *sep1, *sep2;
+  if ((sep1 = strstr(ref, PROVIDER_ITEM_SEP)) == NULL)
+    return NULL;
+  const char *prof_name = sep1 + strlen(PROVIDER_ITEM_SEP);
+  sep2 = strstr(prof_name, PROVIDER_ITEM_SEP);
+  struct qos_profile_loc template = {
+    .lib_name = ddsrt_strndup(ref, (size_t) (sep1 - ref)),
+    .prof_name = (sep2 == NULL) ? ddsrt_strdup(prof_name) : ddsrt_strndup(prof_name, (size_t) (sep2 - prof_name))
+  };
+  struct qos_profile_loc *loc = ddsrt_hh_lookup(index->profiles, &template);
+  ddsrt_free(template.lib_name);
+  ddsrt_free(template.prof_name);
+  return loc;
+}
+
+struct profile_locs {
+  uint32_t n, sz;
+  struct qos_profile_loc **locs;
+};
+
+static void collect_profiles (struct dds_qos_provider_index *index, struct qos_profile_loc *loc, struct profile_locs *locs)
+{
+  if (loc->visited == index->generation)
+    return;
+  loc->visited = index->generation;
+  if (locs->n == locs->sz)
+  {
+    locs->sz = (locs->sz == 0) ? 8 : 2 * locs->sz;
+    locs->locs = ddsrt_realloc(locs->locs, locs->sz * sizeof(*locs->locs));
+  }
+  locs->locs[locs->n++] = loc;
+  /* references that can't be resolved are left to the sysdef parser to report */
+  for (uint32_t i = 0; i < loc->nbases; i++)
+  {
+    struct qos_profile_loc *base;
+    if ((base = lookup_profile_loc(index, loc->bases[i])) != NULL)
+      collect_profiles(index, base, locs);
+  }
+}
+
+static int cmp_profile_loc_start (const void *va, const void *vb)
+{
+  const struct qos_profile_loc * const *a = va, * const *b = vb;
+  return ((*a)->start == (*b)->start) ? 0 : ((*a)->start < (*b)->start) ? -1 : 1;
+}
+
+static void append_text (char **buf, size_t *n, size_t *sz, const char *text, size_t len)
+{
+  if (*n + len + 1 > *sz)
+  {
+    *sz = 2 * (*n + len + 1);
+    *buf = ddsrt_realloc(*buf, *sz);
+  }
+  memcpy(*buf + *n, text, len);
+  *n += len;
+  (*buf)[*n] = 0;
+}
+
+static void append_escaped (char **buf, size_t *n, size_t *sz, const char *text)
+{
+  for (const char *c = text; *c; c++)
+  {
+    switch (*c)
+    {
+      case '&': append_text(buf, n, sz, "&amp;", 5); break;
+      case '<': append_text(buf, n, sz, "&lt;", 4); break;
+      case '>': append_text(buf, n, sz, "&gt;", 4); break;
+      case '"': append_text(buf, n, sz, "&quot;", 6); break;
+      default: append_text(buf, n, sz, c, 1); break;
+    }
+  }
+}
+
+static char *make_partial_sysdef (const struct dds_qos_provider_index *index, const struct profile_locs *locs)
+{
+  /* Profiles in the order in which they appear in the input, so that references are
+     resolved exactly as they would be when parsing the full document */
+  char *buf = NULL;
+  size_t n = 0, sz = 0;
+  const char *lib_name = NULL;
+  append_text(&buf, &n, &sz, "<dds>", 5);
+  for (uint32_t i = 0; i < locs->n; i++)
+  {
+    const struct qos_profile_loc *loc = locs->locs[i];
+    if (lib_name == NULL || strcmp(lib_name, loc->lib_name) != 0)
+    {
+      if (lib_name != NULL)
+        append_text(&buf, &n, &sz, "</qos_library>", 14);
+      append_text(&buf, &n, &sz, "<qos_library name=\"", 19);
+      append_escaped(&buf, &n, &sz, loc->lib_name);
+      append_text(&buf, &n, &sz, "\">", 2);
+      lib_name = loc->lib_name;
+    }
+    append_text(&buf, &n, &sz, index->text + loc->start, loc->end - loc->start);
+  }
+  if (lib_name != NULL)
+    append_text(&buf, &n, &sz, "</qos_library>", 14);
+  append_text(&buf, &n, &sz, "</dds>", 6);
+  return buf;
+}
+
+static dds_return_t materialize_profile (const dds_qos_provider_t *provider, const char *key)
+{
+  struct dds_qos_provider_index * const index = provider->index;
+  struct qos_profile_loc *loc;
+  if ((loc = lookup_profile_loc(index, key)) == NULL || loc->materialized)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if (!in_scope(index->lib_scope, loc->lib_name) || !in_scope(index->prof_scope, loc->prof_name))
+    return DDS_RETCODE_BAD_PARAMETER;
+
+  struct profile_locs locs = { .n = 0, .sz = 0, .locs = NULL };
+  index->generation++;
+  collect_profiles(index, loc, &locs);
+  qsort(locs.locs, locs.n, sizeof(*locs.locs), cmp_profile_loc_start);
+  char *partial = make_partial_sysdef(index, &locs);
+  ddsrt_free(locs.locs);
+
+  dds_return_t ret;
+  struct dds_sysdef_system *sysdef;
+  ret = dds_sysdef_init_sysdef_str(partial, &sysdef, SYSDEF_SCOPE_QOS_LIB);
+  ddsrt_free(partial);
+  if (ret != DDS_RETCODE_OK)
+  {
+    QOSPROV_ERROR("Failed during read sysdef: %s\n", provider->file_path);
+    return ret;
+  }
+  if ((ret = validate_sysdef(sysdef)) != DDS_RETCODE_OK)
+  {
+    QOSPROV_ERROR("Failed during validate sysdef: %s\n", provider->file_path);
+    goto err;
+  }
+  for (const struct dds_sysdef_qos_lib *lib = sysdef->qos_libs; lib != NULL; lib = (const struct dds_sysdef_qos_lib *)lib->xmlnode.next)
+  {
+    for (const struct dds_sysdef_qos_profile *prof = lib->qos_profiles; prof != NULL; prof = (const struct dds_sysdef_qos_profile *)prof->xmlnode.next)
+    {
+      struct qos_profile_loc template = { .lib_name = lib->name, .prof_name = prof->name }, *ploc;
+      if ((ploc = ddsrt_hh_lookup(index->profiles, &template)) == NULL || ploc->materialized)
+        continue;
+      if (in_scope(index->lib_scope, lib->name) && in_scope(index->prof_scope, prof->name) &&
+          (ret = add_profile_qos_items(provider->keyed_qos, lib, prof, provider->file_path, index->ent_scope)) != DDS_RETCODE_OK)
+        goto err;
+      ploc->materialized = true;
+    }
+  }
+err:
+  dds_sysdef_fini_sysdef(sysdef);
+  return ret;
+}
+
 void dds_delete_qos_provider (dds_qos_provider_t *provider)
 {
   if (provider)
   {
+    if (provider->index != NULL)
+      free_index(provider->index);
     ddsrt_hh_enum(provider->keyed_qos, cleanup_qos_items, NULL);
     ddsrt_hh_free(provider->keyed_qos);
     ddsrt_free(provider->file_path);
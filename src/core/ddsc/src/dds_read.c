@@ -10,6 +10,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include "dds/ddsrt/probes.h"
 #include "dds__entity.h"
 #include "dds__reader.h"
 #include "dds__read.h"
@@ -246,6 +247,12 @@ static dds_return_t dds_read_impl (enum dds_read_impl_common_oper oper, dds_enti
   const bool use_loan = (buf[0] == NULL);
   const dds_read_with_collector_fn_t collect_sample = use_loan ? dds_read_collect_sample_loan : dds_read_collect_sample;
   ret = dds_read_impl_common (oper, rd, cond, maxs, mask, hand, collect_sample, &collect_arg);
+#ifdef DDSRT_HAVE_USDT
+  // one probe per sample: the publication handle and source timestamp are what ties it
+  // to the rhc_store probe for the same sample
+  for (int32_t i = 0; i < ret; i++)
+    DDSRT_PROBE4 (read, rd->m_rhc, si[i].publication_handle, si[i].source_timestamp, oper);
+#endif
 
   // If use_loan, make sure the `buf` is either fully initialized or ends on a null pointer
   // so the various paths returning loans know when to stop.  (If no data returned and using
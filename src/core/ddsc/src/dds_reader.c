@@ -26,6 +26,8 @@
 #include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsi/ddsi_endpoint_match.h"
 #include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_typelib.h"
+#include "dds/ddsi/ddsi_content_filter.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds/ddsc/dds_internal_api.h"
 #include "dds__participant.h"
@@ -34,6 +36,7 @@
 #include "dds__listener.h"
 #include "dds__init.h"
 #include "dds__rhc_default.h"
+#include "dds__serdata_default.h"
 #include "dds__topic.h"
 #include "dds__get_status.h"
 #include "dds__qos.h"
@@ -69,6 +72,15 @@ static void dds_reader_close (dds_entity *e)
   ddsrt_mutex_unlock (&e->m_mutex);
 }
 
+#ifdef DDS_HAS_TYPELIB
+static void free_content_filter (struct ddsi_content_filter *cf, struct ddsi_sertype *cf_stype)
+{
+  ddsi_content_filter_free (cf);
+  if (cf_stype)
+    ddsi_sertype_unref (cf_stype);
+}
+#endif
+
 static dds_return_t dds_reader_delete (dds_entity *e) ddsrt_nonnull_all;
 
 static dds_return_t dds_reader_delete (dds_entity *e)
@@ -82,6 +94,9 @@ static dds_return_t dds_reader_delete (dds_entity *e)
 
   dds_loan_pool_free (rd->m_heap_loan_cache);
   dds_loan_pool_free (rd->m_loans);
+#ifdef DDS_HAS_TYPELIB
+  free_content_filter (rd->m_content_filter, rd->m_content_filter_stype);
+#endif
 
   for (uint32_t i = 0; ret == DDS_RETCODE_OK && i < rd->m_endpoint.psmx_endpoints.length; i++)
   {
@@ -95,6 +110,47 @@ static dds_return_t dds_reader_delete (dds_entity *e)
   return ret;
 }
 
+#ifdef DDS_HAS_TYPELIB
+static dds_return_t compile_content_filter (struct ddsi_content_filter **cf, struct ddsi_sertype **cf_stype, struct ddsi_domaingv *gv, const struct ddsi_sertype *sertype, const dds_qos_t *rqos)
+{
+  struct ddsi_type *type;
+  dds_return_t ret;
+  *cf = NULL;
+  *cf_stype = NULL;
+  if (!(rqos->present & DDSI_QP_CYCLONE_CONTENT_FILTER))
+    return DDS_RETCODE_OK;
+  if ((ret = ddsi_type_ref_local (gv, &type, sertype, DDSI_TYPEID_KIND_COMPLETE)) != DDS_RETCODE_OK)
+    return ret;
+  if (type == NULL)
+    return DDS_RETCODE_UNSUPPORTED;
+  ret = ddsi_content_filter_compile (cf, gv, type, rqos->content_filter);
+  ddsi_type_unref (gv, type);
+  if (ret != DDS_RETCODE_OK)
+    return ret;
+
+  /* Data in a representation the compiled filter can't handle is evaluated
+     after deserializing it if the layout of the samples is known, otherwise
+     it is converted using a sertype for a representation it does handle */
+  if (sertype->ops == &dds_sertype_ops_default &&
+      ddsi_content_filter_bind_sample_layout (*cf, ((const struct dds_sertype_default *) sertype)->type.ops.ops))
+    return DDS_RETCODE_OK;
+  const dds_data_representation_id_t repr =
+    ddsi_content_filter_supports_representation (*cf, DDS_DATA_REPRESENTATION_XCDR2) ? DDS_DATA_REPRESENTATION_XCDR2 : DDS_DATA_REPRESENTATION_XCDR1;
+  struct ddsi_sertype *derived = ddsi_sertype_derive_sertype (sertype, repr, ddsi_default_qos_topic.type_consistency);
+  *cf_stype = ddsi_sertype_ref (derived ? derived : sertype);
+  return DDS_RETCODE_OK;
+}
+#else
+static dds_return_t compile_content_filter (struct ddsi_content_filter **cf, struct ddsi_sertype **cf_stype, struct ddsi_domaingv *gv, const struct ddsi_sertype *sertype, const dds_qos_t *rqos)
+{
+  (void) gv;
+  (void) sertype;
+  *cf = NULL;
+  *cf_stype = NULL;
+  return (rqos->present & DDSI_QP_CYCLONE_CONTENT_FILTER) ? DDS_RETCODE_UNSUPPORTED : DDS_RETCODE_OK;
+}
+#endif
+
 static dds_return_t validate_reader_qos (const dds_qos_t *rqos)
 {
 #ifndef DDS_HAS_DEADLINE_MISSED
@@ -452,8 +508,20 @@ void dds_reader_invoke_cbs_for_pending_events(struct dds_entity *e, uint32_t sta
   }
 }
 
+/* Latencies are from source timestamp to insertion in the reader history cache, in
+   nanoseconds; they are only recorded once statistics for the reader are created */
 static const struct dds_stat_keyvalue_descriptor dds_reader_statistics_kv[] = {
-  { "discarded_bytes", DDS_STAT_KIND_UINT64 }
+  { "discarded_bytes", DDS_STAT_KIND_UINT64 },
+  { "latency_count", DDS_STAT_KIND_UINT64 },
+  { "latency_min", DDS_STAT_KIND_UINT64 },
+  { "latency_p50", DDS_STAT_KIND_UINT64 },
+  { "latency_p90", DDS_STAT_KIND_UINT64 },
+  { "latency_p99", DDS_STAT_KIND_UINT64 },
+  { "latency_p999", DDS_STAT_KIND_UINT64 },
+  { "latency_max", DDS_STAT_KIND_UINT64 },
+  { "discarded_samples", DDS_STAT_KIND_UINT64 },
+  { "rhc_instances", DDS_STAT_KIND_UINT32 },
+  { "rhc_samples", DDS_STAT_KIND_UINT32 }
 };
 
 static const struct dds_stat_descriptor dds_reader_statistics_desc = {
@@ -463,6 +531,9 @@ static const struct dds_stat_descriptor dds_reader_statistics_desc = {
 
 static struct dds_statistics *dds_reader_create_statistics (const struct dds_entity *entity)
 {
+  const struct dds_reader *rd = (const struct dds_reader *) entity;
+  if (rd->m_rd)
+    ddsi_reader_enable_latency_stats (rd->m_rd);
   return dds_alloc_statistics (entity, &dds_reader_statistics_desc);
 }
 
@@ -470,7 +541,12 @@ static void dds_reader_refresh_statistics (const struct dds_entity *entity, stru
 {
   const struct dds_reader *rd = (const struct dds_reader *) entity;
   if (rd->m_rd)
-    ddsi_get_reader_stats (rd->m_rd, &stat->kv[0].u.u64);
+  {
+    ddsi_get_reader_stats (rd->m_rd, &stat->kv[0].u.u64, &stat->kv[8].u.u64);
+    ddsi_get_reader_latency_stats (rd->m_rd, &stat->kv[1].u.u64, &stat->kv[2].u.u64, &stat->kv[3].u.u64, &stat->kv[4].u.u64, &stat->kv[5].u.u64, &stat->kv[6].u.u64, &stat->kv[7].u.u64);
+  }
+  if (rd->m_rhc)
+    (void) dds_rhc_default_get_stats (rd->m_rhc, &stat->kv[9].u.u32, &stat->kv[10].u.u32);
 }
 
 const struct dds_entity_deriver dds_entity_deriver_reader = {
@@ -588,6 +664,14 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
     goto err_bad_qos;
   }
 
+  struct ddsi_content_filter *content_filter;
+  struct ddsi_sertype *content_filter_stype;
+  if ((rc = compile_content_filter (&content_filter, &content_filter_stype, gv, tp->m_stype, rqos)) != DDS_RETCODE_OK)
+  {
+    GVTRACE ("dds_create_reader: invalid content filter\n");
+    goto err_bad_qos;
+  }
+
   ddsi_thread_state_awake (ddsi_lookup_thread_state (), gv);
   const struct ddsi_guid * ppguid = dds_entity_participant_guid (&sub->m_entity);
   struct ddsi_participant * pp = ddsi_entidx_lookup_participant_guid (gv->entity_index, ppguid);
@@ -606,6 +690,9 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
     {
       rc = DDS_RETCODE_NOT_ALLOWED_BY_SECURITY;
       ddsi_thread_state_asleep(ddsi_lookup_thread_state());
+#ifdef DDS_HAS_TYPELIB
+      free_content_filter (content_filter, content_filter_stype);
+#endif
       goto err_not_allowed;
     }
   }
@@ -625,6 +712,10 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
   ddsrt_atomic_or32 (&rd->m_entity.m_status.m_status_and_mask, DDS_DATA_ON_READERS_STATUS << SAM_ENABLED_SHIFT);
   rd->m_sample_rejected_status.last_reason = DDS_NOT_REJECTED;
   rd->m_topic = tp;
+#ifdef DDS_HAS_TYPELIB
+  rd->m_content_filter = content_filter;
+  rd->m_content_filter_stype = content_filter_stype;
+#endif
   rd->m_rhc = rhc ? rhc : dds_rhc_default_new (rd, tp->m_stype);
   rc = dds_loan_pool_create (&rd->m_loans, 0);
   assert (rc == DDS_RETCODE_OK); // FIXME: can be out of resources
@@ -32,6 +32,7 @@
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/circlist.h"
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_rhc.h"
 #include "dds/ddsi/ddsi_xqos.h"
 #include "dds/ddsi/ddsi_unused.h"
@@ -39,6 +40,7 @@
 #include "dds/ddsi/ddsi_radmin.h" /* sampleinfo */
 #include "dds/ddsi/ddsi_entity.h"
 #include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_content_filter.h"
 #ifdef DDS_HAS_LIFESPAN
 #include "dds/ddsi/ddsi_lifespan.h"
 #endif
@@ -594,6 +596,18 @@ struct dds_rhc *dds_rhc_default_new (struct dds_reader *reader, const struct dds
   return dds_rhc_default_new_xchecks (reader, &reader->m_entity.m_domain->gv, type, (reader->m_entity.m_domain->gv.config.enabled_xchecks & DDSI_XCHECK_RHC) != 0);
 }
 
+bool dds_rhc_default_get_stats (struct dds_rhc *rhc_common, uint32_t *instances, uint32_t *samples)
+{
+  if (rhc_common->common.ops != &dds_rhc_default_ops)
+    return false;
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  ddsrt_mutex_lock (&rhc->lock);
+  *instances = rhc->n_instances;
+  *samples = rhc->n_vsamples;
+  ddsrt_mutex_unlock (&rhc->lock);
+  return true;
+}
+
 static dds_return_t dds_rhc_default_associate (struct dds_rhc *rhc, dds_reader *reader, const struct ddsi_sertype *type, struct ddsi_tkmap *tkmap)
 {
   /* ignored out of laziness */
@@ -974,12 +988,55 @@ static void content_filter_make_sampleinfo (struct dds_sample_info *si, const st
   }
 }
 
+#ifdef DDS_HAS_TYPELIB
+static bool content_filter_qos_accepts (const dds_reader *reader, const struct ddsi_serdata *sample)
+{
+  enum ddsi_content_filter_result res = ddsi_content_filter_eval (reader->m_content_filter, sample);
+  if (res == DDSI_CONTENT_FILTER_UNKNOWN)
+  {
+    /* Not a representation the filter handles (it was written using a different
+       encoding), so evaluate it on the deserialized sample, or if the filter
+       doesn't know the layout of the sample, convert it to one it does handle */
+    const struct ddsi_sertype *st = reader->m_topic->m_stype;
+    char *tmp = ddsi_sertype_alloc_sample (st);
+    if (!ddsi_serdata_to_sample (sample, tmp, NULL, NULL))
+    {
+      // Samples we can't deserialize are (presumably) best never inserted
+      res = DDSI_CONTENT_FILTER_REJECT;
+    }
+    else if (reader->m_content_filter_stype == NULL)
+    {
+      res = ddsi_content_filter_eval_sample (reader->m_content_filter, tmp);
+    }
+    else
+    {
+      struct ddsi_serdata *conv = ddsi_serdata_from_sample (reader->m_content_filter_stype, SDK_DATA, tmp);
+      if (conv == NULL)
+        res = DDSI_CONTENT_FILTER_REJECT;
+      else
+      {
+        res = ddsi_content_filter_eval (reader->m_content_filter, conv);
+        ddsi_serdata_unref (conv);
+      }
+    }
+    ddsi_sertype_free_sample (st, tmp, DDS_FREE_ALL);
+  }
+  return res != DDSI_CONTENT_FILTER_REJECT;
+}
+#endif
+
 static bool content_filter_accepts (const dds_reader *reader, const struct ddsi_serdata *sample, const struct rhc_instance *inst, uint64_t wr_iid, uint64_t iid)
 {
   bool ret = true;
   if (reader)
   {
     const struct dds_topic *tp = reader->m_topic;
+#ifdef DDS_HAS_TYPELIB
+    /* The compiled filter operates on the serialized data, so evaluate it before
+       a topic filter that requires deserializing the sample */
+    if (reader->m_content_filter && !content_filter_qos_accepts (reader, sample))
+      return false;
+#endif
     switch (tp->m_filter.mode)
     {
       case DDS_TOPIC_FILTER_NONE:
@@ -1598,6 +1655,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   ddsi_status_cb_data_t cb_data;   /* Callback data for reader status callback */
   bool notify_data_available;
 
+  DDSRT_PROBE4 (rhc_store, rhc, &wrinfo->guid, wr_iid, sample->timestamp.v);
   TRACE ("rhc_store %"PRIx64",%"PRIx64" si %"PRIx32" has_data %d:", tk->m_iid, wr_iid, statusinfo, has_data);
   if (!has_data && statusinfo == 0)
   {
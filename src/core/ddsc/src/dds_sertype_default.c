@@ -14,10 +14,13 @@
 #include <string.h>
 
 #include "dds/features.h"
+#include "dds/ddsrt/cdtors.h"
 #include "dds/ddsrt/md5.h"
 #include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_freelist.h"
 #include "dds/ddsi/ddsi_xqos.h"
@@ -28,6 +31,99 @@
 #include "dds__serdata_default.h"
 #include "dds__psmx.h"
 
+/* Table of the serializer ops, key descriptors and serialized type information
+ and type mapping of all default sertypes in the process.  Identical contents are
+ stored only once and shared with reference counting, regardless of the domain,
+ participant or type builder that created the sertype.  The table is created
+ lazily when the first blob is interned and freed when the last one is released.
+ Protected by ddsrt_get_singleton_mutex (). */
+struct sertype_blob {
+  uint32_t hash;
+  uint32_t refc;
+  size_t size;
+  const void *data; /* points to payload, or to the caller's data for a lookup */
+  uint64_t payload[];
+};
+
+static uint32_t sertype_blob_count;
+static struct ddsrt_hh *sertype_blobs;
+
+static uint32_t sertype_blob_hash (const void *vx)
+{
+  const struct sertype_blob *x = vx;
+  return x->hash;
+}
+
+static bool sertype_blob_equal (const void *va, const void *vb)
+{
+  const struct sertype_blob *a = va, *b = vb;
+  return a->hash == b->hash && a->size == b->size && memcmp (a->data, b->data, a->size) == 0;
+}
+
+static void *sertype_blob_intern (const void *data, size_t size)
+{
+  if (size == 0)
+    return NULL;
+  struct sertype_blob template = { .hash = ddsrt_mh3 (data, size, 0), .size = size, .data = data }, *x;
+  ddsrt_mutex_lock (ddsrt_get_singleton_mutex ());
+  if (sertype_blob_count == 0)
+    sertype_blobs = ddsrt_hh_new (32, sertype_blob_hash, sertype_blob_equal);
+  if ((x = ddsrt_hh_lookup (sertype_blobs, &template)) != NULL)
+    x->refc++;
+  else
+  {
+    x = ddsrt_malloc (sizeof (*x) + size);
+    x->hash = template.hash;
+    x->refc = 1;
+    x->size = size;
+    x->data = x->payload;
+    memcpy (x->payload, data, size);
+    ddsrt_hh_add_absent (sertype_blobs, x);
+    sertype_blob_count++;
+  }
+  ddsrt_mutex_unlock (ddsrt_get_singleton_mutex ());
+  return (void *) x->data;
+}
+
+static void sertype_blob_release (const void *data)
+{
+  if (data == NULL)
+    return;
+  struct sertype_blob *x = (struct sertype_blob *) ((char *) data - offsetof (struct sertype_blob, payload));
+  ddsrt_mutex_lock (ddsrt_get_singleton_mutex ());
+  assert (x->data == data && x->refc > 0);
+  if (--x->refc == 0)
+  {
+    ddsrt_hh_remove_present (sertype_blobs, x);
+    ddsrt_free (x);
+    if (--sertype_blob_count == 0)
+    {
+      ddsrt_hh_free (sertype_blobs);
+      sertype_blobs = NULL;
+    }
+  }
+  ddsrt_mutex_unlock (ddsrt_get_singleton_mutex ());
+}
+
+/* Replaces the privately allocated arrays in a freshly initialized cdrstream
+ descriptor by shared ones */
+static void sertype_default_intern_desc (struct dds_cdrstream_desc *type)
+{
+  uint32_t *ops = sertype_blob_intern (type->ops.ops, type->ops.nops * sizeof (*type->ops.ops));
+  dds_free (type->ops.ops);
+  type->ops.ops = ops;
+  if (type->keys.nkeys > 0)
+  {
+    const size_t keys_size = type->keys.nkeys * sizeof (*type->keys.keys);
+    struct dds_cdrstream_desc_key *keys = sertype_blob_intern (type->keys.keys, keys_size);
+    struct dds_cdrstream_desc_key *keys_defo = sertype_blob_intern (type->keys.keys_definition_order, keys_size);
+    dds_free (type->keys.keys);
+    dds_free (type->keys.keys_definition_order);
+    type->keys.keys = keys;
+    type->keys.keys_definition_order = keys_defo;
+  }
+}
+
 static bool sertype_default_equal (const struct ddsi_sertype *acmn, const struct ddsi_sertype *bcmn)
 {
   const struct dds_sertype_default *a = (struct dds_sertype_default *) acmn;
@@ -43,13 +139,13 @@ static bool sertype_default_equal (const struct ddsi_sertype *acmn, const struct
   if (a->type.keys.nkeys != b->type.keys.nkeys)
     return false;
   if (
-    (a->type.keys.nkeys > 0) &&
+    (a->type.keys.nkeys > 0) && a->type.keys.keys != b->type.keys.keys &&
     memcmp (a->type.keys.keys, b->type.keys.keys, a->type.keys.nkeys * sizeof (*a->type.keys.keys)) != 0)
     return false;
   if (a->type.ops.nops != b->type.ops.nops)
     return false;
   if (
-    (a->type.ops.nops > 0) &&
+    (a->type.ops.nops > 0) && a->type.ops.ops != b->type.ops.ops &&
     memcmp (a->type.ops.ops, b->type.ops.ops, a->type.ops.nops * sizeof (*a->type.ops.ops)) != 0)
     return false;
   assert (a->type.opt_size_xcdr1 == b->type.opt_size_xcdr1);
@@ -112,14 +208,12 @@ static void sertype_default_free (struct ddsi_sertype *tpcmn)
   struct dds_sertype_default *tp = (struct dds_sertype_default *) tpcmn;
   if (tp->type.keys.nkeys > 0)
   {
-    dds_free (tp->type.keys.keys);
-    dds_free (tp->type.keys.keys_definition_order);
+    sertype_blob_release (tp->type.keys.keys);
+    sertype_blob_release (tp->type.keys.keys_definition_order);
   }
-  dds_free (tp->type.ops.ops);
-  if (tp->typeinfo_ser.data != NULL)
-    dds_free (tp->typeinfo_ser.data);
-  if (tp->typemap_ser.data != NULL)
-    dds_free (tp->typemap_ser.data);
+  sertype_blob_release (tp->type.ops.ops);
+  sertype_blob_release (tp->typeinfo_ser.data);
+  sertype_blob_release (tp->typemap_ser.data);
   ddsi_sertype_fini (&tp->c);
   ddsrt_free (tp);
 }
@@ -207,6 +301,7 @@ static struct ddsi_sertype * sertype_default_derive_sertype (const struct ddsi_s
     uint32_t refc = ddsrt_atomic_ld32 (&derived_sertype->c.flags_refc);
     ddsrt_atomic_st32 (&derived_sertype->c.flags_refc, refc & ~DDSI_SERTYPE_REFC_MASK);
     derived_sertype->c.base_sertype = ddsi_sertype_ref (base_sertype);
+    ddsrt_atomic_stvoidp (&derived_sertype->c.type_info_cache, NULL);
     derived_sertype->c.serdata_ops = required_ops;
     derived_sertype->write_encoding_version = data_representation == DDS_DATA_REPRESENTATION_XCDR1 ? DDSI_RTPS_CDR_ENC_VERSION_1 : DDSI_RTPS_CDR_ENC_VERSION_2;
   }
@@ -301,6 +396,8 @@ dds_return_t dds_sertype_default_init (const struct dds_domain *domain, struct d
   st->serpool = domain->serpool;
 
   dds_cdrstream_desc_init (&st->type, &dds_cdrstream_default_allocator, desc->m_size, desc->m_align, desc->m_flagset, desc->m_ops, desc->m_keys, desc->m_nkeys);
+  sertype_default_intern_desc (&st->type);
+  st->typeinfo_ser.data = st->typemap_ser.data = NULL;
 
   if (min_xcdrv == DDSI_RTPS_CDR_ENC_VERSION_2 && dds_stream_type_nesting_depth (desc->m_ops) > DDS_CDRSTREAM_MAX_NESTING_DEPTH)
   {
@@ -318,9 +415,9 @@ dds_return_t dds_sertype_default_init (const struct dds_domain *domain, struct d
       GVTRACE ("Flag DDS_TOPIC_XTYPES_METADATA set for type %s but topic descriptor does not contains type information\n", desc->m_typename);
       return DDS_RETCODE_BAD_PARAMETER;
     }
-    st->typeinfo_ser.data = ddsrt_memdup (desc->type_information.data, desc->type_information.sz);
+    st->typeinfo_ser.data = sertype_blob_intern (desc->type_information.data, desc->type_information.sz);
     st->typeinfo_ser.sz = desc->type_information.sz;
-    st->typemap_ser.data = ddsrt_memdup (desc->type_mapping.data, desc->type_mapping.sz);
+    st->typemap_ser.data = sertype_blob_intern (desc->type_mapping.data, desc->type_mapping.sz);
     st->typemap_ser.sz = desc->type_mapping.sz;
   }
   else
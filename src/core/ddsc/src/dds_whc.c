@@ -591,6 +591,17 @@ static void whc_default_get_state (const struct ddsi_whc *whc_generic, struct dd
   ddsrt_mutex_unlock ((ddsrt_mutex_t *)&whc->lock);
 }
 
+void dds_whc_get_stats (const struct ddsi_whc *whc_generic, uint32_t *samples, uint32_t *instances, uint64_t *unacked_bytes)
+{
+  const struct whc_impl * const whc = (const struct whc_impl *)whc_generic;
+  assert (whc->common.ops == &whc_ops);
+  ddsrt_mutex_lock ((ddsrt_mutex_t *)&whc->lock);
+  *samples = whc->seq_size;
+  *instances = whc->n_instances;
+  *unacked_bytes = whc->unacked_bytes;
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *)&whc->lock);
+}
+
 static struct dds_whc_default_node *find_nextseq_intv (struct whc_intvnode **p_intv, const struct whc_impl *whc, ddsi_seqno_t seq)
 {
   struct dds_whc_default_node *n;
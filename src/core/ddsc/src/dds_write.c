@@ -10,6 +10,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_thread.h"
 #include "dds/ddsi/ddsi_xmsg.h"
@@ -682,6 +683,7 @@ dds_return_t dds_write_impl (dds_writer *wr, const void *data, dds_time_t timest
 
   if (!evaluate_topic_filter (wr, data, sdkind))
     return DDS_RETCODE_OK;
+  DDSRT_PROBE2 (write, &wr->m_entity.m_guid, timestamp);
 
   // I. psmx loan => assert (psmx && is_memcpy_safe)
   //   a. psmx only
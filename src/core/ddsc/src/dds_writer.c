@@ -229,6 +229,8 @@ static dds_return_t dds_writer_delete (dds_entity *e)
   ddsi_thread_state_asleep (ddsi_lookup_thread_state ());
   dds_entity_drop_ref (&wr->m_topic->m_entity);
   dds_loan_pool_free (wr->m_loans);
+  if (wr->m_heap_loan_pool)
+    dds_heap_loan_pool_free (wr->m_heap_loan_pool);
   return ret;
 }
 
@@ -261,6 +263,8 @@ static dds_return_t dds_writer_qos_set (dds_entity *e, const dds_qos_t *qos, boo
     if ((wr = ddsi_entidx_lookup_writer_guid (e->m_domain->gv.entity_index, &e->m_guid)) != NULL)
       ddsi_update_writer_qos (wr, qos);
     ddsi_thread_state_asleep (ddsi_lookup_thread_state ());
+    if (qos->present & DDSI_QP_TRANSPORT_PRIORITY)
+      ddsi_xpack_set_priority (((struct dds_writer *) e)->m_xp, qos->transport_priority.value);
   }
   return DDS_RETCODE_OK;
 }
@@ -269,7 +273,12 @@ static const struct dds_stat_keyvalue_descriptor dds_writer_statistics_kv[] = {
   { "rexmit_bytes", DDS_STAT_KIND_UINT64 },
   { "throttle_count", DDS_STAT_KIND_UINT32 },
   { "time_throttle", DDS_STAT_KIND_UINT64 },
-  { "time_rexmit", DDS_STAT_KIND_UINT64 }
+  { "time_rexmit", DDS_STAT_KIND_UINT64 },
+  { "loan_allocs", DDS_STAT_KIND_UINT64 },
+  { "loan_reuses", DDS_STAT_KIND_UINT64 },
+  { "whc_samples", DDS_STAT_KIND_UINT32 },
+  { "whc_instances", DDS_STAT_KIND_UINT32 },
+  { "whc_unacked_bytes", DDS_STAT_KIND_UINT64 }
 };
 
 static const struct dds_stat_descriptor dds_writer_statistics_desc = {
@@ -284,9 +293,16 @@ static struct dds_statistics *dds_writer_create_statistics (const struct dds_ent
 
 static void dds_writer_refresh_statistics (const struct dds_entity *entity, struct dds_statistics *stat)
 {
-  const struct dds_writer *wr = (const struct dds_writer *) entity;
+  // the entity lock protects the loan pool statistics, so cast away the const
+  struct dds_writer *wr = (struct dds_writer *) entity;
   if (wr->m_wr)
     ddsi_get_writer_stats (wr->m_wr, &stat->kv[0].u.u64, &stat->kv[1].u.u32, &stat->kv[2].u.u64, &stat->kv[3].u.u64);
+  ddsrt_mutex_lock (&wr->m_entity.m_mutex);
+  if (wr->m_heap_loan_pool)
+    dds_heap_loan_pool_get_stats (wr->m_heap_loan_pool, &stat->kv[4].u.u64, &stat->kv[5].u.u64);
+  ddsrt_mutex_unlock (&wr->m_entity.m_mutex);
+  if (wr->m_whc)
+    dds_whc_get_stats (wr->m_whc, &stat->kv[6].u.u32, &stat->kv[7].u.u32, &stat->kv[8].u.u64);
 }
 
 const struct dds_entity_deriver dds_entity_deriver_writer = {
@@ -410,6 +426,8 @@ static dds_entity_t dds_create_writer_int (dds_entity_t participant_or_publisher
   wr->m_topic = tp;
   dds_entity_add_ref_locked (&tp->m_entity);
   wr->m_xp = ddsi_xpack_new (gv, async_mode);
+  ddsi_xpack_set_priority (wr->m_xp, wqos->transport_priority.value);
+  ddsi_xpack_set_max_blocking_time (wr->m_xp, wqos->reliability.max_blocking_time);
   wrinfo = dds_whc_make_wrinfo (wr, wqos);
   wr->m_whc = dds_whc_new (gv, wrinfo);
   rc = dds_loan_pool_create (&wr->m_loans, 0);
@@ -563,8 +581,8 @@ dds_return_t dds_request_writer_loan (dds_writer *wr, enum dds_writer_loan_type
         if ((loan = dds_psmx_endpoint_request_loan (wr->m_endpoint.psmx_endpoints.endpoints[0], wr->m_topic->m_stype->sizeof_type)) != NULL)
           ret = DDS_RETCODE_OK;
       }
-      else
-        ret = dds_heap_loan (wr->m_topic->m_stype, DDS_LOANED_SAMPLE_STATE_UNITIALIZED, &loan);
+      else if (wr->m_heap_loan_pool != NULL || (ret = dds_heap_loan_pool_create (&wr->m_heap_loan_pool, wr->m_topic->m_stype)) == DDS_RETCODE_OK)
+        ret = dds_heap_loan_pool_get_loan (wr->m_heap_loan_pool, DDS_LOANED_SAMPLE_STATE_UNITIALIZED, &loan);
       break;
   }
 
@@ -0,0 +1,439 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+#include "dds/dds.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_endpoint.h"
+#include "dds/ddsi/ddsi_thread.h"
+#include "dds__entity.h"
+#include "test_common.h"
+#include "ContentFilterTypes.h"
+
+#define DDS_DOMAINID1 0
+#define DDS_DOMAINID2 1
+#define DDS_CONFIG "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+
+static dds_entity_t d1, d2, dp1, dp2;
+
+static void content_filter_init (void)
+{
+  char *conf = ddsrt_expand_envvars (DDS_CONFIG, DDS_DOMAINID1);
+  d1 = dds_create_domain (DDS_DOMAINID1, conf);
+  CU_ASSERT_FATAL (d1 > 0);
+  ddsrt_free (conf);
+  conf = ddsrt_expand_envvars (DDS_CONFIG, DDS_DOMAINID2);
+  d2 = dds_create_domain (DDS_DOMAINID2, conf);
+  CU_ASSERT_FATAL (d2 > 0);
+  ddsrt_free (conf);
+
+  dp1 = dds_create_participant (DDS_DOMAINID1, NULL, NULL);
+  CU_ASSERT_FATAL (dp1 > 0);
+  dp2 = dds_create_participant (DDS_DOMAINID2, NULL, NULL);
+  CU_ASSERT_FATAL (dp2 > 0);
+}
+
+static void content_filter_fini (void)
+{
+  dds_delete (d1);
+  dds_delete (d2);
+}
+
+static dds_entity_t create_filtered_reader (dds_entity_t pp, dds_entity_t tp, const char *expression)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  dds_qset_content_filter (qos, expression);
+  dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  dds_delete_qos (qos);
+  return rd;
+}
+
+static dds_entity_t create_writer (dds_entity_t pp, dds_entity_t tp)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+  return wr;
+}
+
+static void wait_for_matched (dds_entity_t wr, uint32_t n)
+{
+  /* the publication matched status remains set after the first match, so
+     sync_reader_writer doesn't suffice for subsequent readers */
+  dds_publication_matched_status_t st;
+  dds_time_t tend = dds_time () + DDS_SECS (5);
+  dds_return_t ret;
+  while ((ret = dds_get_publication_matched_status (wr, &st)) == DDS_RETCODE_OK && st.current_count < n && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (st.current_count >= n);
+}
+
+static void write_type1 (dds_entity_t wr, int32_t n)
+{
+  static const char *names[] = { "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine" };
+  for (int32_t i = 0; i < n; i++)
+  {
+    ContentFilterTypes_Type1 s = {
+      .id = i, .o = (uint8_t) i, .pos = { .x = i, .y = 0.25 * i },
+      .color = (ContentFilterTypes_Color) (i % 3), .flag = (i % 2) != 0,
+      .ull = UINT64_MAX - (uint64_t) i, .inner = { .s = (int16_t) -i, .ll = -1000 * i },
+      .f = 1.5f * (float) i, .str = (char *) names[i % 10], .after_string = i
+    };
+    dds_return_t ret = dds_write (wr, &s);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+}
+
+static uint32_t count_bits (uint32_t mask)
+{
+  uint32_t n = 0;
+  for (; mask; mask &= mask - 1)
+    n++;
+  return n;
+}
+
+static uint32_t take_ids (dds_entity_t rd, uint32_t expected_count)
+{
+  /* returns a bitmask of received ids */
+  uint32_t mask = 0, count = 0;
+  dds_time_t tend = dds_time () + DDS_SECS (5);
+  while (count < expected_count && dds_time () < tend)
+  {
+    void *raw[10] = { NULL };
+    dds_sample_info_t si[10];
+    int32_t n = dds_take (rd, raw, si, 10, 10);
+    CU_ASSERT_FATAL (n >= 0);
+    for (int32_t i = 0; i < n; i++)
+    {
+      if (si[i].valid_data)
+      {
+        mask |= 1u << *((int32_t *) raw[i]);
+        count++;
+      }
+    }
+    if (n > 0)
+      dds_return_loan (rd, raw, n);
+    else
+      dds_sleepfor (DDS_MSECS (10));
+  }
+  return mask;
+}
+
+CU_Test (ddsc_content_filter, qos)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  char *expr = NULL;
+  CU_ASSERT_FATAL (!dds_qget_content_filter (qos, &expr));
+  dds_qset_content_filter (qos, "id = 1");
+  dds_qset_content_filter (qos, "id = 2");
+  CU_ASSERT_FATAL (dds_qget_content_filter (qos, &expr));
+  CU_ASSERT_STRING_EQUAL (expr, "id = 2");
+  dds_free (expr);
+  dds_delete_qos (qos);
+}
+
+CU_Test (ddsc_content_filter, invalid, .init = content_filter_init, .fini = content_filter_fini)
+{
+  static const char *invalid[] = {
+    "", "id", "id =", "id = 1 AND", "id = 1 OR", "(id = 1", "id = 1)", "NOT", "id == 1",
+    "nonexistent = 1", "str = 1", "str = x", "str = 'x", "id LIKE 'x'", "id NOT = 1",
+    "id BETWEEN 1", "id BETWEEN 1 OR 2", "pos = 1", "pos.z = 1", "inner = 1", "color = PURPLE",
+    "color = 'PURPLE'", "color = 1x", "id = TRUE", "id = RED", "id = 'x'", "id = 1.0.0",
+    "flag = RED", "and = 1"
+  };
+  char topicname[100];
+  create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+  dds_entity_t tp = dds_create_topic (dp1, &ContentFilterTypes_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  for (size_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); i++)
+  {
+    dds_entity_t rd = create_filtered_reader (dp1, tp, invalid[i]);
+    CU_ASSERT_EQUAL (rd, DDS_RETCODE_BAD_PARAMETER);
+  }
+}
+
+CU_Test (ddsc_content_filter, local, .init = content_filter_init, .fini = content_filter_fini)
+{
+  static const struct { const char *expr; uint32_t mask; } tests[] = {
+    { "id >= 3", 0x3f8 },
+    { "id<3", 0x7 },
+    { "id <> 4 AND id != 5 AND id <= 6", 0x4f },
+    { "o = 0x2", 0x4 },
+    { "pos.y > 1.0 AND pos.x < 7", 0x60 },
+    { "color = GREEN", 0x92 },
+    { "flag = TRUE AND color = RED", 0x208 },
+    { "ull > 18446744073709551612", 0x7 },
+    { "ull > -1 AND id < 2", 0x3 },
+    { "id < 9999999999999999999", 0x3ff },
+    { "inner.s = -2", 0x4 },
+    { "inner.ll <= -8000", 0x300 },
+    { "f = 3.0", 0x4 },
+    { "f > 2", 0x3fc },
+    { "id < 2 OR id > 7", 0x303 },
+    { "NOT (id < 2 OR id > 7)", 0xfc },
+    { "(id = 1 OR id = 2) AND flag = TRUE", 0x2 },
+    { "id = 1 OR id = 2 AND flag = FALSE", 0x6 },
+    { "id BETWEEN 3 AND 5", 0x38 },
+    { "id NOT BETWEEN 1 AND 8", 0x201 },
+    { "str = 'three'", 0x8 },
+    { "str <= 'five'", 0x120 },
+    { "str LIKE 't%'", 0xc },
+    { "str LIKE '%e'", 0x22a },
+    { "str LIKE '_i%'", 0x360 },
+    { "str NOT LIKE '%e%' AND after_string > 0", 0x54 },
+    { "after_string >= 8", 0x300 },
+    { "color = 'BLUE'", 0x124 }
+  };
+  char topicname[100];
+  create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+  dds_entity_t tp = dds_create_topic (dp1, &ContentFilterTypes_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  dds_entity_t rds[sizeof (tests) / sizeof (tests[0])];
+  for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+  {
+    rds[i] = create_filtered_reader (dp1, tp, tests[i].expr);
+    CU_ASSERT_FATAL (rds[i] > 0);
+  }
+  dds_entity_t wr = create_writer (dp1, tp);
+  write_type1 (wr, 10);
+  for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+  {
+    uint32_t mask = take_ids (rds[i], count_bits (tests[i].mask));
+    CU_ASSERT_EQUAL (mask, tests[i].mask);
+  }
+}
+
+static uint32_t writer_num_readers_with_content_filter (dds_entity_t writer)
+{
+  struct dds_entity *wr_entity;
+  struct ddsi_writer *wr;
+  uint32_t n;
+  CU_ASSERT_EQUAL_FATAL (dds_entity_pin (writer, &wr_entity), 0);
+  ddsi_thread_state_awake (ddsi_lookup_thread_state (), &wr_entity->m_domain->gv);
+  wr = ddsi_entidx_lookup_writer_guid (wr_entity->m_domain->gv.entity_index, &wr_entity->m_guid);
+  CU_ASSERT_FATAL (wr != NULL);
+  ddsrt_mutex_lock (&wr->e.lock);
+  n = wr->num_readers_with_content_filter;
+  ddsrt_mutex_unlock (&wr->e.lock);
+  ddsi_thread_state_asleep (ddsi_lookup_thread_state ());
+  dds_entity_unpin (wr_entity);
+  return n;
+}
+
+CU_Test (ddsc_content_filter, remote, .init = content_filter_init, .fini = content_filter_fini)
+{
+  char topicname[100];
+  create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+  dds_entity_t tp1 = dds_create_topic (dp1, &ContentFilterTypes_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp1 > 0);
+  dds_entity_t tp2 = dds_create_topic (dp2, &ContentFilterTypes_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp2 > 0);
+  dds_entity_t rd1 = create_filtered_reader (dp2, tp2, "id > 6 AND color <> BLUE");
+  CU_ASSERT_FATAL (rd1 > 0);
+  dds_entity_t rd2 = create_filtered_reader (dp2, tp2, "pos.y < 0.5");
+  CU_ASSERT_FATAL (rd2 > 0);
+  dds_entity_t wr = create_writer (dp1, tp1);
+  sync_reader_writer (dp2, rd1, dp1, wr);
+  sync_reader_writer (dp2, rd2, dp1, wr);
+  wait_for_matched (wr, 2);
+  CU_ASSERT_EQUAL (writer_num_readers_with_content_filter (wr), 2);
+
+  write_type1 (wr, 10);
+  /* samples rejected by both readers are not sent, but the readers must still
+     acknowledge them */
+  dds_return_t ret = dds_wait_for_acks (wr, DDS_SECS (5));
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  uint32_t mask1 = take_ids (rd1, 2);
+  CU_ASSERT_EQUAL (mask1, 0x280);
+  uint32_t mask2 = take_ids (rd2, 2);
+  CU_ASSERT_EQUAL (mask2, 0x3);
+
+  /* with a reader without a filter everything goes out */
+  dds_entity_t rd3 = create_filtered_reader (dp2, tp2, "id >= 0");
+  CU_ASSERT_FATAL (rd3 > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_entity_t rd4 = dds_create_reader (dp2, tp2, qos, NULL);
+  dds_delete_qos (qos);
+  CU_ASSERT_FATAL (rd4 > 0);
+  sync_reader_writer (dp2, rd3, dp1, wr);
+  sync_reader_writer (dp2, rd4, dp1, wr);
+  wait_for_matched (wr, 4);
+  CU_ASSERT_EQUAL (writer_num_readers_with_content_filter (wr), 3);
+  write_type1 (wr, 10);
+  ret = dds_wait_for_acks (wr, DDS_SECS (5));
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  mask1 = take_ids (rd1, 2);
+  CU_ASSERT_EQUAL (mask1, 0x280);
+  uint32_t mask4 = take_ids (rd4, 10);
+  CU_ASSERT_EQUAL (mask4, 0x3ff);
+}
+
+CU_Test (ddsc_content_filter, appendable, .init = content_filter_init, .fini = content_filter_fini)
+{
+  char topicname[100];
+  create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+  dds_entity_t tp1 = dds_create_topic (dp1, &ContentFilterTypes_Type2_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp1 > 0);
+  dds_entity_t tp2 = dds_create_topic (dp2, &ContentFilterTypes_Type2_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp2 > 0);
+  dds_entity_t rdl = create_filtered_reader (dp1, tp1, "v > 104");
+  CU_ASSERT_FATAL (rdl > 0);
+  dds_entity_t rdr = create_filtered_reader (dp2, tp2, "v <= 102");
+  CU_ASSERT_FATAL (rdr > 0);
+  dds_entity_t wr = create_writer (dp1, tp1);
+  sync_reader_writer (dp2, rdr, dp1, wr);
+  wait_for_matched (wr, 2);
+  for (int32_t i = 0; i < 10; i++)
+  {
+    ContentFilterTypes_Type2 s = { .id = i, .arr = { 1, 2, 3 }, .v = 100 + i };
+    dds_return_t ret = dds_write (wr, &s);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+  dds_return_t ret = dds_wait_for_acks (wr, DDS_SECS (5));
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  uint32_t maskl = take_ids (rdl, 5);
+  CU_ASSERT_EQUAL (maskl, 0x3e0);
+  uint32_t maskr = take_ids (rdr, 3);
+  CU_ASSERT_EQUAL (maskr, 0x7);
+}
+
+CU_Test (ddsc_content_filter, xcdr1, .init = content_filter_init, .fini = content_filter_fini)
+{
+  char topicname[100];
+  create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+  dds_entity_t tp = dds_create_topic (dp1, &Space_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  dds_entity_t rd = create_filtered_reader (dp1, tp, "long_3 = 3 AND long_2 > 1");
+  CU_ASSERT_FATAL (rd > 0);
+  dds_entity_t wr = create_writer (dp1, tp);
+  for (int32_t i = 0; i < 10; i++)
+  {
+    Space_Type1 s = { .long_1 = i, .long_2 = i, .long_3 = i % 4 };
+    dds_return_t ret = dds_write (wr, &s);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+  uint32_t mask = take_ids (rd, 2);
+  CU_ASSERT_EQUAL (mask, 0x88);
+}
+
+CU_Test (ddsc_content_filter, variable, .init = content_filter_init, .fini = content_filter_fini)
+{
+  /* members following strings and sequences: "tail" can only be located in
+     XCDR2, so the reader has to deserialize XCDR1 data before filtering it */
+  static const struct { const char *expr; uint32_t mask; } tests[] = {
+    { "name = 'n3' OR name = 'n7'", 0x88 },
+    { "c >= 'g'", 0x3c0 },
+    { "tail > 60 AND c <> 'h'", 0x300 },
+    { "tail < 20 OR name LIKE '%5'", 0x23 }
+  };
+  static const dds_data_representation_id_t reprs[] = { DDS_DATA_REPRESENTATION_XCDR1, DDS_DATA_REPRESENTATION_XCDR2 };
+  for (size_t r = 0; r < sizeof (reprs) / sizeof (reprs[0]); r++)
+  {
+    char topicname[100];
+    create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+    dds_entity_t tp = dds_create_topic (dp1, &ContentFilterTypes_Type3_desc, topicname, NULL, NULL);
+    CU_ASSERT_FATAL (tp > 0);
+    dds_entity_t rds[sizeof (tests) / sizeof (tests[0])];
+    for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      rds[i] = create_filtered_reader (dp1, tp, tests[i].expr);
+      CU_ASSERT_FATAL (rds[i] > 0);
+    }
+    dds_qos_t *qos = dds_create_qos ();
+    dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+    dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+    dds_qset_data_representation (qos, 1, &reprs[r]);
+    dds_entity_t wr = dds_create_writer (dp1, tp, qos, NULL);
+    CU_ASSERT_FATAL (wr > 0);
+    dds_delete_qos (qos);
+    for (int32_t i = 0; i < 10; i++)
+    {
+      int16_t seq[10];
+      ContentFilterTypes_Elem elems[3];
+      char name[10];
+      for (int32_t j = 0; j < 10; j++)
+        seq[j] = (int16_t) j;
+      for (int32_t j = 0; j < 3; j++)
+        elems[j].a = j;
+      (void) snprintf (name, sizeof (name), "n%d", (int) i);
+      ContentFilterTypes_Type3 s = {
+        .id = i, .seq = { ._length = (uint32_t) i, ._buffer = seq }, .name = name,
+        .elems = { ._length = (uint32_t) (i % 3), ._buffer = elems }, .c = (char) ('a' + i), .tail = 10 * i
+      };
+      dds_return_t ret = dds_write (wr, &s);
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+    }
+    for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      uint32_t mask = take_ids (rds[i], count_bits (tests[i].mask));
+      CU_ASSERT_EQUAL (mask, tests[i].mask);
+    }
+  }
+}
+
+CU_Test (ddsc_content_filter, sample_layout, .init = content_filter_init, .fini = content_filter_fini)
+{
+  /* members following a sequence of structs can't be located in XCDR1, so the
+     reader evaluates the filter on the deserialized XCDR1 data, which involves
+     base types, nested structs, enums, bounded strings and external members */
+  static const struct { const char *expr; uint32_t mask; } tests[] = {
+    { "id >= 7", 0x380 },
+    { "pos.y > 1.0 AND color = BLUE", 0x120 },
+    { "bstr = 'b4' OR ext.x = -6", 0x50 }
+  };
+  static const dds_data_representation_id_t reprs[] = { DDS_DATA_REPRESENTATION_XCDR1, DDS_DATA_REPRESENTATION_XCDR2 };
+  for (size_t r = 0; r < sizeof (reprs) / sizeof (reprs[0]); r++)
+  {
+    char topicname[100];
+    create_unique_topic_name ("ddsc_content_filter", topicname, sizeof (topicname));
+    dds_entity_t tp = dds_create_topic (dp1, &ContentFilterTypes_Type4_desc, topicname, NULL, NULL);
+    CU_ASSERT_FATAL (tp > 0);
+    dds_entity_t rds[sizeof (tests) / sizeof (tests[0])];
+    for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      rds[i] = create_filtered_reader (dp1, tp, tests[i].expr);
+      CU_ASSERT_FATAL (rds[i] > 0);
+    }
+    dds_qos_t *qos = dds_create_qos ();
+    dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+    dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+    dds_qset_data_representation (qos, 1, &reprs[r]);
+    dds_entity_t wr = dds_create_writer (dp1, tp, qos, NULL);
+    CU_ASSERT_FATAL (wr > 0);
+    dds_delete_qos (qos);
+    for (int32_t i = 0; i < 10; i++)
+    {
+      ContentFilterTypes_Elem elems[2] = { { .a = 1 }, { .a = 2 } };
+      ContentFilterTypes_Pos ext = { .x = -i, .y = 0.0 };
+      ContentFilterTypes_Type4 s = {
+        .parent = { .id = i }, .elems = { ._length = (uint32_t) (i % 3), ._buffer = elems },
+        .pos = { .x = i, .y = 0.25 * i }, .color = (ContentFilterTypes_Color) (i % 3), .ext = &ext
+      };
+      (void) snprintf (s.bstr, sizeof (s.bstr), "b%d", (int) i);
+      dds_return_t ret = dds_write (wr, &s);
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+    }
+    for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      uint32_t mask = take_ids (rds[i], count_bits (tests[i].mask));
+      CU_ASSERT_EQUAL (mask, tests[i].mask);
+    }
+  }
+}
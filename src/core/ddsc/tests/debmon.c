@@ -0,0 +1,171 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "ddsi__debmon.h"
+#include "test_common.h"
+
+static char *debmon_fetch (dds_entity_t participant, const char *request, size_t *size)
+{
+  ddsi_locator_t loc;
+  CU_ASSERT_FATAL (ddsi_get_debug_monitor_locator (get_domaingv (participant)->debmon, &loc));
+
+  struct sockaddr_in addr;
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = htons ((uint16_t) loc.port);
+  ddsrt_socket_t sock;
+  dds_return_t rc = ddsrt_socket (&sock, AF_INET, SOCK_STREAM, 0);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = ddsrt_connect (sock, (struct sockaddr *) &addr, sizeof (addr));
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  ssize_t n;
+  rc = ddsrt_send (sock, request, strlen (request), 0, &n);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+
+  // the debug monitor closes the connection once it has sent the response
+  size_t sz = 0, cap = 4096;
+  char *buf = ddsrt_malloc (cap);
+  while ((rc = ddsrt_recv (sock, buf + sz, cap - sz - 1, 0, &n)) == DDS_RETCODE_OK && n > 0)
+  {
+    sz += (size_t) n;
+    if (cap - sz < 1024)
+      buf = ddsrt_realloc (buf, cap *= 2);
+  }
+  ddsrt_close (sock);
+  buf[sz] = 0;
+  *size = sz;
+  return buf;
+}
+
+static char *http_dechunk (const char *response)
+{
+  // body follows the first empty line, then a sequence of "<hex size>\r\n<data>\r\n"
+  // terminated by a chunk of size 0
+  const char *p = strstr (response, "\r\n\r\n");
+  CU_ASSERT_FATAL (p != NULL);
+  p += 4;
+  char *body = ddsrt_malloc (strlen (p) + 1);
+  size_t pos = 0;
+  while (true)
+  {
+    char *endp;
+    const unsigned long chunksz = strtoul (p, &endp, 16);
+    CU_ASSERT_FATAL (endp != p && strncmp (endp, "\r\n", 2) == 0);
+    if (chunksz == 0)
+      break;
+    p = endp + 2;
+    CU_ASSERT_FATAL (strlen (p) >= chunksz + 2 && strncmp (p + chunksz, "\r\n", 2) == 0);
+    memcpy (body + pos, p, chunksz);
+    pos += chunksz;
+    p += chunksz + 2;
+  }
+  body[pos] = 0;
+  return body;
+}
+
+CU_Test (ddsc_debmon, openmetrics, .timeout = 20)
+{
+  const dds_entity_t domain = dds_create_domain (0, "<Internal><MonitorPort>0</MonitorPort></Internal>");
+  CU_ASSERT_FATAL (domain > 0);
+  const dds_entity_t participant = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (participant > 0);
+  char topicname[100];
+  create_unique_topic_name ("ddsc_debmon", topicname, sizeof (topicname));
+  const dds_entity_t topic = dds_create_topic (participant, &Space_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  const dds_entity_t writer = dds_create_writer (participant, topic, NULL, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+
+  // a connection is served the JSON dump if nothing has been received by the time the
+  // debug monitor accepts it, that may happen before the request sent right after
+  // connecting arrives
+  size_t size;
+  char *response;
+  int tries = 0;
+  while ((response = debmon_fetch (participant, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n", &size)) != NULL && strstr (response, "openmetrics") == NULL && ++tries < 10)
+    ddsrt_free (response);
+  CU_ASSERT_FATAL (size > 0);
+  CU_ASSERT (strncmp (response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+  CU_ASSERT (strstr (response, "\r\nContent-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n") != NULL);
+  CU_ASSERT (strstr (response, "\r\nTransfer-Encoding: chunked\r\n") != NULL);
+
+  char *body = http_dechunk (response);
+  ddsrt_free (response);
+
+  // every family is announced before its samples and the exposition ends with "# EOF"
+  static const char *expected[] = {
+    "# TYPE cyclonedds_dqueue_length gauge\n",
+    "\ncyclonedds_dqueue_length{domain=\"0\"} ",
+    "# TYPE cyclonedds_sendq_packets counter\n",
+    "\ncyclonedds_sendq_packets_total{domain=\"0\"} ",
+    "\ncyclonedds_entities{domain=\"0\",kind=\"participant\"} 1\n",
+    "\ncyclonedds_entities{domain=\"0\",kind=\"writer\"} ",
+    "# TYPE cyclonedds_socket_tx_packets counter\n",
+    "# TYPE cyclonedds_thread_awake gauge\n",
+    "\ncyclonedds_thread_awake{domain=\"0\",thread=\"debmon\"} ",
+    "# TYPE cyclonedds_writer_unacked_bytes gauge\n",
+    "# TYPE cyclonedds_reader_latency_seconds summary\n"
+  };
+  for (size_t i = 0; i < sizeof (expected) / sizeof (expected[0]); i++)
+  {
+    const bool found = (strstr (body, expected[i]) != NULL);
+    if (!found)
+      printf ("missing: %s\n", expected[i]);
+    CU_ASSERT (found);
+  }
+  // the application writer is reported alongside the built-in ones, with its topic name as label
+  char wrlabel[150];
+  (void) snprintf (wrlabel, sizeof (wrlabel), ",topic=\"%s\"} 0\n", topicname);
+  bool wrfound = false;
+  for (const char *wr = body; !wrfound && (wr = strstr (wr, "\ncyclonedds_writer_unacked_bytes{domain=\"0\",guid=\"")) != NULL; wr++)
+  {
+    const char *eol = strchr (wr + 1, '\n');
+    const size_t n = strlen (wrlabel);
+    wrfound = (eol != NULL && (size_t) (eol + 1 - wr) > n && strncmp (eol + 1 - n, wrlabel, n) == 0);
+  }
+  CU_ASSERT (wrfound);
+  const size_t len = strlen (body);
+  CU_ASSERT (len >= 6 && strcmp (body + len - 6, "# EOF\n") == 0);
+
+  // each line is a comment or a sample: a metric name, optional labels and a value
+  for (const char *line = body; *line; )
+  {
+    const char *eol = strchr (line, '\n');
+    CU_ASSERT_FATAL (eol != NULL);
+    if (*line != '#')
+    {
+      CU_ASSERT (strncmp (line, "cyclonedds_", 11) == 0);
+      const char *sp = memchr (line, ' ', (size_t) (eol - line));
+      CU_ASSERT (sp != NULL && sp + 1 < eol);
+    }
+    line = eol + 1;
+  }
+  ddsrt_free (body);
+
+  // without a request, the original JSON dump is still sent
+  response = debmon_fetch (participant, "", &size);
+  CU_ASSERT (strncmp (response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+  CU_ASSERT (strstr (response, "openmetrics") == NULL);
+  body = http_dechunk (response);
+  CU_ASSERT (body[0] == '{');
+  ddsrt_free (body);
+  ddsrt_free (response);
+
+  dds_return_t rc = dds_delete (domain);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+}
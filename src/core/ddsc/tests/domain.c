@@ -393,3 +393,50 @@ CU_Test(ddsc_domain_create, raw_config)
   ddsrt_free (arg_raw.buf);
 }
 
+
+static void compiled_config_override (struct ddsi_config *config, void *varg)
+{
+  uint32_t *count = varg;
+  (*count)++;
+  config->max_participants = 7;
+}
+
+CU_Test(ddsc_domain_create, compiled_config)
+{
+  CU_ASSERT_FATAL (ddsi_config_compile ("<CycloneDDS incorrect XML", DDS_DOMAIN_DEFAULT) == NULL);
+
+  struct ddsi_config_compiled *cc = ddsi_config_compile ("<Discovery><Tag>${CYCLONEDDS_DOMAIN_ID}</Tag></Discovery>", 3);
+  CU_ASSERT_FATAL (cc != NULL);
+  const struct ddsi_config *cfg = ddsi_config_compiled_get (cc);
+  CU_ASSERT_FATAL (cfg->domainTag != NULL);
+  CU_ASSERT_STRING_EQUAL (cfg->domainTag, "3");
+  CU_ASSERT (cfg->max_participants == 0);
+
+  CU_ASSERT (dds_create_domain_with_compiled_config (DDS_DOMAIN_DEFAULT, cc, 0, NULL) == DDS_RETCODE_BAD_PARAMETER);
+  CU_ASSERT (dds_create_domain_with_compiled_config (1, NULL, 0, NULL) == DDS_RETCODE_BAD_PARAMETER);
+
+  // several domains sharing one configuration, each with its own domain id and with
+  // changes to one not affecting the others or the compiled configuration
+  uint32_t count = 0;
+  const dds_entity_t d1 = dds_create_domain_with_compiled_config (1, cc, 0, NULL);
+  CU_ASSERT_FATAL (d1 > 0);
+  const dds_entity_t d2 = dds_create_domain_with_compiled_config (2, cc, compiled_config_override, &count);
+  CU_ASSERT_FATAL (d2 > 0);
+  CU_ASSERT (count == 1);
+  CU_ASSERT (cfg->max_participants == 0);
+  CU_ASSERT (dds_create_domain_with_compiled_config (2, cc, 0, NULL) == DDS_RETCODE_PRECONDITION_NOT_MET);
+
+  // the domains keep the compiled configuration alive
+  ddsi_config_compiled_free (cc);
+
+  for (dds_domainid_t id = 1; id <= 2; id++)
+  {
+    const dds_entity_t pp = dds_create_participant (id, NULL, NULL);
+    CU_ASSERT_FATAL (pp > 0);
+    dds_domainid_t ppid;
+    CU_ASSERT (dds_get_domainid (pp, &ppid) == 0);
+    CU_ASSERT (ppid == id);
+  }
+  CU_ASSERT (dds_delete (d1) == 0);
+  CU_ASSERT (dds_delete (d2) == 0);
+}
@@ -376,6 +376,67 @@ CU_Test (ddsc_nwpart, mapping_multiple)
 #endif
 }
 
+CU_Test (ddsc_nwpart, compiled_config)
+{
+#ifndef DDS_HAS_NETWORK_PARTITIONS
+  CU_PASS ("no network partitions in build");
+#else
+  // The addresses of the network partitions are resolved when a domain starts and stored
+  // in the domain's configuration, so domains sharing a compiled configuration must each
+  // have their own network partitions and mappings that refer to them.
+  const char *config =
+    "${CYCLONEDDS_URI},<Partitioning>"
+    "  <NetworkPartitions>"
+    "    <NetworkPartition name=\"p1\" address=\"239.255.0.12\"/>"
+    "    <NetworkPartition name=\"p0\" address=\"239.255.0.11\"/>"
+    "  </NetworkPartitions>"
+    "  <PartitionMappings>"
+    "    <PartitionMapping DCPSPartitionTopic=\"a.b\" networkpartition=\"p0\"/>"
+    "  </PartitionMappings>"
+    "</Partitioning>";
+  char *config1 = ddsrt_expand_envvars (config, 0);
+  struct ddsi_config_compiled *cc = ddsi_config_compile (config1, DDS_DOMAIN_DEFAULT);
+  ddsrt_free (config1);
+  CU_ASSERT_FATAL (cc != NULL);
+  const struct ddsi_config *cfg = ddsi_config_compiled_get (cc);
+
+  const dds_entity_t d1 = dds_create_domain_with_compiled_config (1, cc, 0, NULL);
+  CU_ASSERT_FATAL (d1 > 0);
+  const dds_entity_t d2 = dds_create_domain_with_compiled_config (2, cc, 0, NULL);
+  CU_ASSERT_FATAL (d2 > 0);
+  struct ddsi_domaingv * const gv1 = get_domaingv (d1);
+  struct ddsi_domaingv * const gv2 = get_domaingv (d2);
+  for (int i = 0; i < 2; i++)
+  {
+    const struct ddsi_config *c = (i == 0) ? &gv1->config : &gv2->config;
+    CU_ASSERT_FATAL (c->networkPartitions != cfg->networkPartitions);
+    CU_ASSERT_FATAL (c->partitionMappings != cfg->partitionMappings);
+    const struct ddsi_config_networkpartition_listelem *p1 = c->networkPartitions, *p0 = p1->next;
+    CU_ASSERT_FATAL (p0 != NULL && p0->next == NULL);
+    CU_ASSERT_FATAL (strcmp (p1->name, "p1") == 0 && strcmp (p0->name, "p0") == 0);
+    CU_ASSERT_FATAL (c->partitionMappings->partition == p0);
+    CU_ASSERT_FATAL (p0->asm_addresses != NULL && p1->asm_addresses != NULL);
+  }
+  // multicast port numbers depend on the domain id
+  CU_ASSERT (gv1->config.networkPartitions->asm_addresses->loc.port != gv2->config.networkPartitions->asm_addresses->loc.port);
+  // the compiled configuration itself is never touched
+  for (const struct ddsi_config_networkpartition_listelem *np = cfg->networkPartitions; np; np = np->next)
+    CU_ASSERT (np->uc_addresses == NULL && np->asm_addresses == NULL);
+  CU_ASSERT (cfg->partitionMappings->partition == cfg->networkPartitions->next);
+
+  // deleting one domain doesn't affect the other
+  const uint32_t port2 = gv2->config.networkPartitions->asm_addresses->loc.port;
+  ddsi_config_compiled_free (cc);
+  dds_return_t rc = dds_delete (d1);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (gv2->config.networkPartitions->asm_addresses->loc.port == port2);
+  const dds_entity_t pp = dds_create_participant (2, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  rc = dds_delete (d2);
+  CU_ASSERT_FATAL (rc == 0);
+#endif
+}
+
 struct check_address_present_arg {
   const char **expected;
   bool ok;
@@ -10,6 +10,11 @@
 
 #include <assert.h>
 #include <limits.h>
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/md5.h"
@@ -17,6 +22,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/bswap.h"
 #include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/process.h"
 #include "dds/ddsrt/static_assert.h"
 
 #include "dds/dds.h"
@@ -1101,6 +1107,104 @@ CU_Test(ddsc_psmx, return_loan)
   CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
 }
 
+#ifndef _WIN32
+static dds_entity_t create_shm_reclaim_writer (const char *topicname, int service_id, uint32_t chunk_count)
+{
+  char *configstr;
+  ddsrt_asprintf (&configstr, "\
+${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}\
+<General>\
+  <AllowMulticast>spdp</AllowMulticast>\
+  <Interfaces>\
+    <PubSubMessageExchange name=\"shm\" library=\"psmx_shm\" priority=\"1000000\" config=\"SERVICE_NAME=reclaim%d;CHUNK_COUNT=%"PRIu32";\" />\
+  </Interfaces>\
+</General>\
+<Discovery>\
+  <Tag>${CYCLONEDDS_PID}</Tag>\
+</Discovery>", service_id, chunk_count);
+  char *xconfigstr = ddsrt_expand_envvars (configstr, 0);
+  const dds_entity_t dom = dds_create_domain (0, xconfigstr);
+  ddsrt_free (xconfigstr);
+  ddsrt_free (configstr);
+  if (dom <= 0)
+    return 0;
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  const dds_entity_t tp = dds_create_topic (pp, &PsmxType1_desc, topicname, NULL, NULL);
+  return dds_create_writer (pp, tp, NULL, NULL);
+}
+#endif
+
+CU_Test(ddsc_psmx, shm_reclaim_dead_writer, .timeout = 60)
+{
+#ifndef _WIN32
+  // Only meaningful for the native shared memory plugin: a process holding loans is
+  // killed and the chunks it held must become available to another process again
+  const char *psmx_name;
+  if (ddsrt_getenv ("CDDS_PSMX_NAME", &psmx_name) != DDS_RETCODE_OK || strcmp (psmx_name, "shm") != 0)
+  {
+    CU_PASS ("only for the shared memory plugin");
+    return;
+  }
+  const uint32_t chunk_count = 4;
+  char topicname[100];
+  create_unique_topic_name ("test_psmx_reclaim", topicname, sizeof (topicname));
+  // the parent's pid, for a segment not shared with any other test
+  const int service_id = (int) ddsrt_getpid ();
+  int fds[2];
+  CU_ASSERT_FATAL (pipe (fds) == 0);
+  // fork before creating any entity in this process, the child must not inherit threads
+  const pid_t child = fork ();
+  CU_ASSERT_FATAL (child >= 0);
+  if (child == 0)
+  {
+    // child: loan all chunks, report success and wait to be killed
+    const dds_entity_t wr = create_shm_reclaim_writer (topicname, service_id, chunk_count);
+    char ok = (wr > 0);
+    for (uint32_t i = 0; ok && i < chunk_count; i++)
+    {
+      void *sample;
+      ok = (dds_request_loan_of_size (wr, sizeof (PsmxType1), &sample) == DDS_RETCODE_OK);
+    }
+    if (write (fds[1], &ok, 1) != 1)
+      _exit (1);
+    while (true)
+      pause ();
+  }
+  char child_ok = 0;
+  CU_ASSERT_FATAL (read (fds[0], &child_ok, 1) == 1);
+  (void) close (fds[0]);
+  (void) close (fds[1]);
+  if (!child_ok)
+  {
+    (void) kill (child, SIGKILL);
+    (void) waitpid (child, NULL, 0);
+    CU_FAIL_FATAL ("child could not loan all chunks");
+  }
+
+  // attaching while the child is alive keeps the segment and its state
+  const dds_entity_t wr = create_shm_reclaim_writer (topicname, service_id, chunk_count);
+  CU_ASSERT_FATAL (wr > 0);
+  CU_ASSERT_FATAL (endpoint_has_psmx_enabled (wr));
+  void *samples[4];
+  DDSRT_STATIC_ASSERT (sizeof (samples) / sizeof (samples[0]) == 4);
+  CU_ASSERT_FATAL (dds_request_loan_of_size (wr, sizeof (PsmxType1), &samples[0]) != DDS_RETCODE_OK);
+
+  (void) kill (child, SIGKILL);
+  CU_ASSERT_FATAL (waitpid (child, NULL, 0) == child);
+
+  // requesting a loan with all chunks in use reclaims those held by dead processes
+  for (uint32_t i = 0; i < chunk_count; i++)
+    CU_ASSERT_FATAL (dds_request_loan_of_size (wr, sizeof (PsmxType1), &samples[i]) == DDS_RETCODE_OK);
+  void *extra;
+  CU_ASSERT_FATAL (dds_request_loan_of_size (wr, sizeof (PsmxType1), &extra) != DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (dds_return_loan (wr, samples, (int32_t) chunk_count) == DDS_RETCODE_OK);
+  dds_return_t rc = dds_delete (DDS_CYCLONEDDS_HANDLE);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+#else
+  CU_PASS ("no fork on Windows");
+#endif
+}
+
 CU_Test(ddsc_psmx, partition_xtalk)
 {
   dds_return_t rc;
@@ -261,6 +261,137 @@ CU_Theory((char *configuration, char *key, dds_qos_kind_t kind, dds_return_t cod
   dds_delete_qos_provider(provider);
 }
 
+// @brief This tests that an indexed qos_provider provides the same qos as one that parses everything up front.
+CU_Test(qos_provider, get_qos_indexed)
+{
+  static const char *scopes[] = {
+    "*", "lib1", "lib0::*", "lib0::pro00", "*::pro00::*", "*::*::rd0",
+    "lib3", "lib0::pro01::rd0", "lib2::*::tp0", "::pro03::rd0"
+  };
+  static const char *keys[] = {
+    "lib0::pro00", "lib0::pro00::rd1", "lib0::pro00::pb0", "lib0::pro01::rd0", "lib0::pro03",
+    "lib0::pro03::wr1", "lib1::pro01::tp0", "lib1::pro03::sb0", "lib2::pro01::rd0", "lib2::pro03::pb0",
+    "lib2::pro01", "lib0::*", "*::pro00::rd1", "*", "lib3::pro00", "lib2::pro00"
+  };
+  static const dds_qos_kind_t kinds[] = {
+    DDS_PARTICIPANT_QOS, DDS_PUBLISHER_QOS, DDS_SUBSCRIBER_QOS, DDS_TOPIC_QOS, DDS_READER_QOS, DDS_WRITER_QOS
+  };
+  for (size_t s = 0; s < sizeof(scopes) / sizeof(scopes[0]); s++)
+  {
+    dds_qos_provider_t *eager = NULL, *indexed = NULL;
+    dds_return_t ret = dds_create_qos_provider_scope(NO_QOS_PROVIDER_CONF, &eager, scopes[s]);
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    ret = dds_create_qos_provider_indexed(NO_QOS_PROVIDER_CONF, &indexed, scopes[s]);
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    // twice, so that the second round finds the materialized profiles
+    for (int round = 0; round < 2; round++)
+    {
+      for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+      {
+        for (size_t t = 0; t < sizeof(kinds) / sizeof(kinds[0]); t++)
+        {
+          const dds_qos_t *qos_e, *qos_i;
+          dds_return_t ret_e = dds_qos_provider_get_qos(eager, kinds[t], keys[k], &qos_e);
+          dds_return_t ret_i = dds_qos_provider_get_qos(indexed, kinds[t], keys[k], &qos_i);
+          CU_ASSERT_EQUAL(ret_e, ret_i);
+          if (ret_e == DDS_RETCODE_OK && ret_i == DDS_RETCODE_OK)
+            CU_ASSERT(dds_qos_equal(qos_e, qos_i));
+        }
+      }
+    }
+    dds_delete_qos_provider(indexed);
+    dds_delete_qos_provider(eager);
+  }
+}
+
+#define BASE_PRO(prof_name,base,ents) \
+  "\n  <qos_profile name=\""#prof_name"\" base_name=\""#base"\">"ents"\n  </qos_profile>"
+CU_TheoryDataPoints(qos_provider, create_indexed) = {
+  CU_DataPoints(char *,
+    DEF(LIB(lib0,PRO(pro0,ENT("",datareader)))),
+    DEF(LIB(lib0,PRO(pro0,ENT_N(rd0,"",datareader)
+                          ENT_N(rd0,"",datareader)))),
+    DEF(LIB(lib0,PRO(pro0,ENT("",datareader))
+                 PRO(pro0,ENT("",datareader)))),
+    DEF(LIB(lib0,PRO(pro0,ENT("",datareader)))
+        LIB(lib0,PRO(pro1,ENT("",datareader)))),
+    DEF(LIB(lib0,N_PRO(   ENT("",datareader)))),
+    DEF(N_LIB(   PRO(pro0,ENT("",datareader)))),
+    DEF(LIB(lib0,PRO(pro0,ENT("<history><kind>KEEP_ALL_HISTORY_QOS</kind></history>",datareader)))
+        LIB(lib1,BASE_PRO(pro0,lib0::pro0,ENT("",datareader))
+                 BASE_PRO(pro1,lib1::pro0,ENT("",datareader)))),
+    DEF(LIB(lib0,BASE_PRO(pro0,lib1::pro0,ENT("",datareader)))
+        LIB(lib1,PRO(pro0,ENT("",datareader)))),
+    DEF(LIB(lib0,BASE_PRO(pro0,lib0::pro1,ENT("",datareader)))),
+    DEF(LIB(lib0,PRO(pro0,ENT("<deadline><period><sec>x</sec></period></deadline>",datareader))))
+  ),
+  // Expected retcode from creating the provider
+  CU_DataPoints(dds_return_t,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_BAD_PARAMETER,
+    DDS_RETCODE_BAD_PARAMETER,
+    DDS_RETCODE_ERROR,
+    DDS_RETCODE_ERROR,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK
+  ),
+  // Qos to get from the provider
+  CU_DataPoints(char *,
+    "lib0::pro0", "lib0::pro0::rd0", NULL, NULL, NULL, NULL,
+    "lib1::pro1", "lib0::pro0", "lib0::pro0", "lib0::pro0"
+  ),
+  // Expected retcode from getting the qos
+  CU_DataPoints(dds_return_t,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_BAD_PARAMETER,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_OK,
+    DDS_RETCODE_BAD_PARAMETER,
+    DDS_RETCODE_BAD_PARAMETER,
+    DDS_RETCODE_BAD_PARAMETER
+  )
+};
+#undef BASE_PRO
+
+static void count_qos_items(void *vnode, void *vargs)
+{
+  (void) vnode;
+  ++*(int32_t *)vargs;
+}
+
+// @brief This tests that an indexed qos_provider checks the structure on creation, and the profiles when they are used.
+CU_Theory((char *configuration, dds_return_t create_code, char *key, dds_return_t get_code), qos_provider, create_indexed)
+{
+  dds_qos_provider_t *provider = NULL;
+  dds_return_t ret = dds_create_qos_provider_indexed(configuration, &provider, NULL);
+  CU_ASSERT_EQUAL(ret, create_code);
+  if (ret != DDS_RETCODE_OK)
+    return;
+  if (key != NULL)
+  {
+    const dds_qos_t *qos;
+    ret = dds_qos_provider_get_qos(provider, DDS_READER_QOS, key, &qos);
+    CU_ASSERT_EQUAL(ret, get_code);
+    // the profiles referenced via base_name are part of the same document, and so are cached as well
+    if (ret == DDS_RETCODE_OK && strcmp(key, "lib1::pro1") == 0)
+    {
+      int32_t n = 0;
+      ddsrt_hh_enum(provider->keyed_qos, count_qos_items, &n);
+      CU_ASSERT_EQUAL(n, 3);
+      ret = dds_qos_provider_get_qos(provider, DDS_READER_QOS, "lib0::pro0", &qos);
+      CU_ASSERT_EQUAL(ret, DDS_RETCODE_OK);
+      CU_ASSERT(qos->present & DDSI_QP_HISTORY);
+    }
+  }
+  dds_delete_qos_provider(provider);
+}
+
 #define QOS_DURATION_FMT(unit) \
   "<"#unit">%lli</"#unit">"
 #define QOS_DURATION_FMT_STR(unit) \
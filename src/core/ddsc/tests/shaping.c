@@ -0,0 +1,114 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "ddsi__xmsg.h"
+#include "test_common.h"
+
+// The writer's domain sends at most RATE bytes/s, so writing NSAMPLES samples of
+// SAMPLESIZE bytes takes about NSAMPLES * SAMPLESIZE / RATE = 2s to transmit.  The
+// history cache is made large enough that the writer doesn't get throttled waiting
+// for acknowledgements.
+#define RATE "100kB/s"
+#define NSAMPLES 25
+#define SAMPLESIZE 8000
+
+static const char *config =
+  "<General><Interfaces><NetworkInterface address=\"127.0.0.1\" max_rate=\"" RATE "\"/></Interfaces><AllowMulticast>false</AllowMulticast></General>"
+  "<Discovery><ExternalDomainId>0</ExternalDomainId><ParticipantIndex>auto</ParticipantIndex><Peers><Peer address=\"127.0.0.1\"/></Peers></Discovery>"
+  "<Internal><Watermarks><WhcHigh>1MB</WhcHigh><WhcHighInit>1MB</WhcHighInit></Watermarks></Internal>";
+
+CU_Test (ddsc_shaping, paced_writes_dont_block, .timeout = 30)
+{
+  const dds_entity_t dom0 = dds_create_domain (0, config);
+  CU_ASSERT_FATAL (dom0 > 0);
+  const dds_entity_t dom1 = dds_create_domain (1, config);
+  CU_ASSERT_FATAL (dom1 > 0);
+  const dds_entity_t pp0 = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp0 > 0);
+  const dds_entity_t pp1 = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (pp1 > 0);
+
+  char topicname[100];
+  create_unique_topic_name ("ddsc_shaping", topicname, sizeof (topicname));
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_SECS (10));
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t tp0 = dds_create_topic (pp0, &RoundTripModule_DataType_desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (tp0 > 0);
+  const dds_entity_t tp1 = dds_create_topic (pp1, &RoundTripModule_DataType_desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (tp1 > 0);
+  const dds_entity_t rd = dds_create_reader (pp1, tp1, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  const dds_entity_t wr = dds_create_writer (pp0, tp0, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+  sync_reader_writer (pp1, rd, pp0, wr);
+
+  RoundTripModule_DataType sample;
+  sample.payload._length = sample.payload._maximum = SAMPLESIZE;
+  sample.payload._buffer = ddsrt_malloc (SAMPLESIZE);
+  sample.payload._release = false;
+  memset (sample.payload._buffer, 0x55, SAMPLESIZE);
+
+  // packets that exceed the budget are handed to the send queue instead of delaying
+  // the writer, so writing takes much less time than transmitting
+  const dds_time_t tstart = dds_time ();
+  for (int i = 0; i < NSAMPLES; i++)
+  {
+    dds_return_t rc = dds_write (wr, &sample);
+    CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  }
+  const dds_time_t twritten = dds_time ();
+  printf ("writing took %"PRId64"ns\n", twritten - tstart);
+  CU_ASSERT (twritten - tstart < DDS_SECS (1));
+  ddsrt_free (sample.payload._buffer);
+
+  uint32_t length;
+  uint64_t packets, blocked;
+  ddsi_xpack_sendq_stats (get_domaingv (pp0), &length, &packets, &blocked);
+  CU_ASSERT (packets > 0);
+
+  // the data still arrives, but at the configured rate
+  const dds_entity_t ws = dds_create_waitset (pp1);
+  CU_ASSERT_FATAL (ws > 0);
+  const dds_entity_t rdcond = dds_create_readcondition (rd, DDS_ANY_STATE);
+  CU_ASSERT_FATAL (rdcond > 0);
+  dds_return_t rc = dds_waitset_attach (ws, rdcond, 0);
+  CU_ASSERT_FATAL (rc == 0);
+  int nreceived = 0;
+  const dds_time_t tabort = dds_time () + DDS_SECS (15);
+  while (nreceived < NSAMPLES && dds_time () < tabort)
+  {
+    void *raw = NULL;
+    dds_sample_info_t si;
+    (void) dds_waitset_wait (ws, NULL, 0, DDS_MSECS (100));
+    while ((rc = dds_take (rd, &raw, &si, 1, 1)) > 0)
+    {
+      const RoundTripModule_DataType *s = raw;
+      CU_ASSERT (s->payload._length == SAMPLESIZE);
+      nreceived++;
+      dds_return_loan (rd, &raw, rc);
+    }
+  }
+  const dds_time_t treceived = dds_time ();
+  printf ("receiving took %"PRId64"ns\n", treceived - tstart);
+  CU_ASSERT_EQUAL (nreceived, NSAMPLES);
+  CU_ASSERT (treceived - tstart >= DDS_SECS (1));
+
+  rc = dds_delete (dom0);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = dds_delete (dom1);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+}
@@ -0,0 +1,237 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+#include "dds/dds.h"
+#include "dds/ddsrt/process.h"
+#include "dds/ddsc/dds_statistics.h"
+#include "dds/ddsi/ddsi_statistics.h"
+#include "dds__types.h"
+#include "dds__entity.h"
+#include "test_common.h"
+
+static dds_entity_t participant, topic, reader, writer;
+
+static void create_entities (void)
+{
+  char topicname[100];
+  create_unique_topic_name ("ddsc_statistics_test", topicname, sizeof topicname);
+  participant = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (participant > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  topic = dds_create_topic (participant, &Space_Type1_desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  dds_delete_qos (qos);
+  writer = dds_create_writer (participant, topic, NULL, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  reader = dds_create_reader (participant, topic, NULL, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+}
+
+static void delete_entities (void)
+{
+  dds_return_t rc = dds_delete (DDS_CYCLONEDDS_HANDLE);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
+
+static uint64_t get_stat (const struct dds_statistics *stat, const char *name)
+{
+  const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, name);
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+  return kv->u.u64;
+}
+
+static void write_samples (int32_t first, int32_t n, dds_duration_t age)
+{
+  for (int32_t i = first; i < first + n; i++)
+  {
+    const Space_Type1 sample = { i, 0, 0 };
+    dds_return_t rc = dds_write_ts (writer, &sample, dds_time () - age);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+}
+
+CU_Test (ddsc_statistics, reader_latency, .init = create_entities, .fini = delete_entities)
+{
+  /* recording only starts once statistics for the reader exist */
+  write_samples (0, 5, 0);
+  struct dds_statistics *stat = dds_create_statistics (reader);
+  CU_ASSERT_FATAL (stat != NULL);
+  CU_ASSERT (get_stat (stat, "latency_count") == 0);
+  CU_ASSERT (get_stat (stat, "latency_max") == 0);
+
+  /* backdating the source timestamp gives a lower bound on the latency */
+  write_samples (5, 10, DDS_MSECS (10));
+  dds_return_t rc = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT (get_stat (stat, "latency_count") == 10);
+  const uint64_t min = get_stat (stat, "latency_min");
+  const uint64_t p50 = get_stat (stat, "latency_p50");
+  const uint64_t p90 = get_stat (stat, "latency_p90");
+  const uint64_t p99 = get_stat (stat, "latency_p99");
+  const uint64_t p999 = get_stat (stat, "latency_p999");
+  const uint64_t max = get_stat (stat, "latency_max");
+  CU_ASSERT (min >= DDS_MSECS (10));
+  CU_ASSERT (min <= p50 && p50 <= p90 && p90 <= p99 && p99 <= p999 && p999 <= max);
+  dds_delete_statistics (stat);
+}
+
+CU_Test (ddsc_statistics, domain_pcap)
+{
+  char file[100], conf[300];
+  (void) snprintf (file, sizeof (file), "ddsc_statistics_%"PRIdPID".pcap", ddsrt_getpid ());
+  (void) snprintf (conf, sizeof (conf), "<Tracing><PacketCaptureFile>%s</PacketCaptureFile></Tracing>", file);
+  const dds_entity_t domain = dds_create_domain (0, conf);
+  CU_ASSERT_FATAL (domain > 0);
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  struct dds_statistics *stat = dds_create_statistics (domain);
+  CU_ASSERT_FATAL (stat != NULL);
+
+  /* the participant announces itself to itself, so some packets must get captured */
+  dds_time_t tend = dds_time () + DDS_SECS (5);
+  while (get_stat (stat, "pcap_packets") == 0 && dds_time () < tend)
+  {
+    dds_sleepfor (DDS_MSECS (10));
+    dds_return_t rc = dds_refresh_statistics (stat);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  CU_ASSERT (get_stat (stat, "pcap_packets") > 0);
+  CU_ASSERT (get_stat (stat, "pcap_dropped") == 0);
+  dds_delete_statistics (stat);
+  dds_return_t rc = dds_delete (domain);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  (void) remove (file);
+}
+
+CU_Test (ddsc_statistics, history_caches, .init = create_entities, .fini = delete_entities)
+{
+  struct dds_statistics *wrstat = dds_create_statistics (writer);
+  struct dds_statistics *rdstat = dds_create_statistics (reader);
+  CU_ASSERT_FATAL (wrstat != NULL && rdstat != NULL);
+  CU_ASSERT (get_stat (rdstat, "discarded_samples") == 0);
+
+  /* keep-all, volatile, local reader: all samples are in the RHC but none remain in the WHC */
+  write_samples (0, 10, 0);
+  dds_return_t rc;
+  rc = dds_refresh_statistics (wrstat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  rc = dds_refresh_statistics (rdstat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv;
+  kv = dds_lookup_statistic (rdstat, "rhc_instances");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT32);
+  CU_ASSERT (kv->u.u32 == 10);
+  kv = dds_lookup_statistic (rdstat, "rhc_samples");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT32);
+  CU_ASSERT (kv->u.u32 == 10);
+  kv = dds_lookup_statistic (wrstat, "whc_samples");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT32);
+  CU_ASSERT (kv->u.u32 == 0);
+  CU_ASSERT (get_stat (wrstat, "whc_unacked_bytes") == 0);
+
+  /* taking the data empties the samples, but the instances remain */
+  Space_Type1 buf[10];
+  void *ptrs[10];
+  dds_sample_info_t si[10];
+  for (int i = 0; i < 10; i++)
+    ptrs[i] = &buf[i];
+  CU_ASSERT (dds_take (reader, ptrs, si, 10, 10) == 10);
+  rc = dds_refresh_statistics (rdstat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT (dds_lookup_statistic (rdstat, "rhc_samples")->u.u32 == 0);
+  CU_ASSERT (dds_lookup_statistic (rdstat, "rhc_instances")->u.u32 == 10);
+  dds_delete_statistics (rdstat);
+  dds_delete_statistics (wrstat);
+}
+
+CU_Test (ddsc_statistics, domain_queues, .init = create_entities, .fini = delete_entities)
+{
+  const dds_entity_t domain = dds_get_parent (participant);
+  CU_ASSERT_FATAL (domain > 0);
+  struct dds_statistics *stat = dds_create_statistics (domain);
+  CU_ASSERT_FATAL (stat != NULL);
+
+  /* discovery of its own participant involves sending and receiving packets, handling
+     timed events and delivering the SEDP samples through the builtins delivery queue */
+  dds_time_t tend = dds_time () + DDS_SECS (5);
+  while ((get_stat (stat, "rx_packets") == 0 || get_stat (stat, "dqueue_delivered") == 0) && dds_time () < tend)
+  {
+    dds_sleepfor (DDS_MSECS (10));
+    dds_return_t rc = dds_refresh_statistics (stat);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  CU_ASSERT (get_stat (stat, "rx_packets") > 0);
+  CU_ASSERT (get_stat (stat, "rx_bytes") >= get_stat (stat, "rx_packets") * 20);
+  CU_ASSERT (get_stat (stat, "tx_packets") > 0);
+  CU_ASSERT (get_stat (stat, "tx_bytes") >= get_stat (stat, "tx_packets") * 20);
+  CU_ASSERT (get_stat (stat, "dqueue_delivered") > 0);
+  CU_ASSERT (get_stat (stat, "dqueue_max_wait_time") <= get_stat (stat, "dqueue_wait_time"));
+  CU_ASSERT (get_stat (stat, "xevq_timed_handled") > 0);
+  CU_ASSERT (get_stat (stat, "xevq_max_timed_lateness") <= get_stat (stat, "xevq_timed_lateness"));
+  CU_ASSERT (get_stat (stat, "rbuf_count") > 0);
+  CU_ASSERT (get_stat (stat, "rbuf_bytes") > 0);
+  /* no asynchronous writers, so the send queue doesn't even exist */
+  CU_ASSERT (get_stat (stat, "sendq_packets") == 0);
+  dds_delete_statistics (stat);
+}
+
+struct thread_profile_arg {
+  int n;
+  uint64_t tev_awake_count;
+};
+
+static void check_thread_stats (const struct ddsi_thread_stats *st, void *varg)
+{
+  struct thread_profile_arg * const arg = varg;
+  arg->n++;
+  CU_ASSERT (st->awake_p50 <= st->awake_p90 && st->awake_p90 <= st->awake_p99 && st->awake_p99 <= st->awake_max);
+  if (strcmp (st->name, "tev") == 0)
+    arg->tev_awake_count = st->awake_count;
+}
+
+static struct thread_profile_arg get_thread_stats (dds_entity_t pp)
+{
+  struct thread_profile_arg arg = { 0, 0 };
+  dds_entity *x;
+  dds_return_t rc = dds_entity_pin (pp, &x);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  ddsi_enum_thread_stats (&x->m_domain->gv, check_thread_stats, &arg);
+  dds_entity_unpin (x);
+  return arg;
+}
+
+CU_Test (ddsc_statistics, thread_profile)
+{
+  const dds_entity_t dom_prof = dds_create_domain (0, "<Internal><LivelinessMonitoring Profiling=\"true\">true</LivelinessMonitoring></Internal>");
+  CU_ASSERT_FATAL (dom_prof > 0);
+  const dds_entity_t dom_noprof = dds_create_domain (1, "<Internal><LivelinessMonitoring>true</LivelinessMonitoring></Internal>");
+  CU_ASSERT_FATAL (dom_noprof > 0);
+  const dds_entity_t pp_prof = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp_prof > 0);
+  const dds_entity_t pp_noprof = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (pp_noprof > 0);
+
+  /* the participant announces itself, so the timed-event thread does some work */
+  struct thread_profile_arg arg;
+  dds_time_t tend = dds_time () + DDS_SECS (5);
+  while ((arg = get_thread_stats (pp_prof)).tev_awake_count == 0 && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT (arg.n > 0);
+  CU_ASSERT (arg.tev_awake_count > 0);
+  arg = get_thread_stats (pp_noprof);
+  CU_ASSERT (arg.n == 0);
+
+  dds_return_t rc = dds_delete (DDS_CYCLONEDDS_HANDLE);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
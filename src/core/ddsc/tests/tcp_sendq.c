@@ -0,0 +1,214 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <string.h>
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "ddsi__tran.h"
+#include "test_common.h"
+
+// Messages are written directly on the transmit connection of a domain using TCP
+// to a socket that doesn't read, so that the socket buffers fill up and the send
+// queue gets used.  Each message consists of two fragments filled with its sequence
+// number, which allows checking that messages arrive whole, in order and that the
+// dropped ones are absent.
+#define MSGSIZE 8192
+#define HDRSIZE 16
+#define MAXMSGS 100000
+
+struct sendq_test {
+  dds_entity_t domain;
+  struct ddsi_domaingv *gv;
+  ddsrt_socket_t listener, peer;
+  ddsi_locator_t loc;
+  uint32_t seq;
+};
+
+static void sendq_test_init (struct sendq_test *t, const char *sendq_size, const char *write_timeout)
+{
+  char config[256];
+  (void) snprintf (config, sizeof (config), "<General><Interfaces><NetworkInterface address=\"127.0.0.1\"/></Interfaces><Transport>tcp</Transport></General><TCP><SendQueueSize>%s</SendQueueSize><WriteTimeout>%s</WriteTimeout></TCP>", sendq_size, write_timeout);
+  t->domain = dds_create_domain (0, config);
+  CU_ASSERT_FATAL (t->domain > 0);
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  t->gv = get_domaingv (pp);
+  t->seq = 0;
+
+  // small receive buffer, so that only little data fits in the kernel
+  struct sockaddr_in addr;
+  socklen_t addrlen = (socklen_t) sizeof (addr);
+  int rcvbuf = 4096;
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  dds_return_t rc = ddsrt_socket (&t->listener, AF_INET, SOCK_STREAM, 0);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = ddsrt_setsockopt (t->listener, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = ddsrt_bind (t->listener, (struct sockaddr *) &addr, sizeof (addr));
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = ddsrt_getsockname (t->listener, (struct sockaddr *) &addr, &addrlen);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  rc = ddsrt_listen (t->listener, 1);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  t->peer = DDSRT_INVALID_SOCKET;
+
+  memset (&t->loc, 0, sizeof (t->loc));
+  t->loc.kind = DDSI_LOCATOR_KIND_TCPv4;
+  t->loc.port = ntohs (addr.sin_port);
+  memcpy (t->loc.address + 12, &addr.sin_addr.s_addr, 4);
+}
+
+static void sendq_test_fini (struct sendq_test *t)
+{
+  if (t->peer != DDSRT_INVALID_SOCKET)
+    ddsrt_close (t->peer);
+  ddsrt_close (t->listener);
+  dds_return_t rc = dds_delete (t->domain);
+  CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+}
+
+static bool sendq_test_write (struct sendq_test *t)
+{
+  // returns true if the message was written or queued, false if it was dropped
+  unsigned char hdr[HDRSIZE], body[MSGSIZE - HDRSIZE];
+  memset (hdr, (unsigned char) t->seq, sizeof (hdr));
+  memset (body, (unsigned char) t->seq, sizeof (body));
+  t->seq++;
+  DDSI_DECL_CONST_TRAN_WRITE_MSGFRAGS_PTR (msgfrags,
+    ((ddsrt_iovec_t){ .iov_base = hdr, .iov_len = sizeof (hdr) }),
+    ((ddsrt_iovec_t){ .iov_base = body, .iov_len = sizeof (body) }));
+  const ssize_t n = ddsi_conn_write (t->gv->xmit_conns[0], &t->loc, msgfrags, 0);
+  CU_ASSERT_FATAL (n == -1 || n == MSGSIZE);
+  if (t->peer == DDSRT_INVALID_SOCKET)
+  {
+    // first write establishes the connection
+    dds_return_t rc = ddsrt_accept (t->listener, NULL, NULL, &t->peer);
+    CU_ASSERT_EQUAL_FATAL (rc, DDS_RETCODE_OK);
+  }
+  return n == MSGSIZE;
+}
+
+static uint32_t sendq_test_fill (struct sendq_test *t, bool *accepted)
+{
+  // writes until the first message gets dropped, returns the sequence number of that one
+  while (t->seq < MAXMSGS)
+  {
+    const uint32_t seq = t->seq;
+    if (!(accepted[seq] = sendq_test_write (t)))
+      return seq;
+  }
+  CU_FAIL_FATAL ("send queue never filled up");
+  return 0;
+}
+
+static size_t sendq_test_read (struct sendq_test *t, unsigned char *buf, size_t size, dds_duration_t timeout, bool *eof)
+{
+  // reads up to size bytes, until end-of-file or until nothing arrives within timeout
+  size_t pos = 0;
+  *eof = false;
+  while (pos < size)
+  {
+    fd_set rdset;
+    FD_ZERO (&rdset);
+    FD_SET (t->peer, &rdset);
+    if (ddsrt_select (t->peer + 1, &rdset, NULL, NULL, timeout) <= 0)
+      break;
+    ssize_t n;
+    dds_return_t rc = ddsrt_recv (t->peer, buf + pos, size - pos, 0, &n);
+    if (rc != DDS_RETCODE_OK || n == 0)
+    {
+      *eof = true;
+      break;
+    }
+    pos += (size_t) n;
+  }
+  return pos;
+}
+
+static void check_stream (const unsigned char *buf, size_t size, const bool *accepted, uint32_t nmsgs)
+{
+  // the stream must be the concatenation of the accepted messages
+  size_t pos = 0;
+  for (uint32_t seq = 0; seq < nmsgs && pos < size; seq++)
+  {
+    if (!accepted[seq])
+      continue;
+    CU_ASSERT_FATAL (pos + MSGSIZE <= size);
+    for (size_t i = 0; i < MSGSIZE; i++)
+      CU_ASSERT_FATAL (buf[pos + i] == (unsigned char) seq);
+    pos += MSGSIZE;
+  }
+  CU_ASSERT (pos == size);
+}
+
+CU_Test (ddsc_tcp_sendq, drop_whole_messages, .timeout = 60)
+{
+  struct sendq_test t;
+  sendq_test_init (&t, "64 kB", "10 s");
+  bool *accepted = ddsrt_malloc (MAXMSGS * sizeof (*accepted));
+
+  // writes must never block, once the queue is full messages get dropped
+  const uint32_t first_drop = sendq_test_fill (&t, accepted);
+  CU_ASSERT (first_drop > 64 * 1024 / MSGSIZE);
+  for (int i = 0; i < 3; i++)
+    accepted[t.seq] = sendq_test_write (&t);
+
+  // draining the socket allows the queue to make progress and all accepted data
+  // must arrive, without the dropped messages
+  size_t expected = 0;
+  for (uint32_t seq = 0; seq < t.seq; seq++)
+    expected += accepted[seq] ? MSGSIZE : 0;
+  unsigned char *buf = ddsrt_malloc (expected + MSGSIZE);
+  bool eof;
+  size_t n = sendq_test_read (&t, buf, expected, DDS_SECS (5), &eof);
+  CU_ASSERT_FATAL (!eof);
+  CU_ASSERT_FATAL (n == expected);
+  check_stream (buf, n, accepted, t.seq);
+
+  // once drained, messages are accepted again
+  const uint32_t seq = t.seq;
+  CU_ASSERT_FATAL ((accepted[seq] = sendq_test_write (&t)));
+  n = sendq_test_read (&t, buf, MSGSIZE, DDS_SECS (5), &eof);
+  CU_ASSERT_FATAL (n == MSGSIZE);
+  for (size_t i = 0; i < MSGSIZE; i++)
+    CU_ASSERT_FATAL (buf[i] == (unsigned char) seq);
+
+  ddsrt_free (buf);
+  ddsrt_free (accepted);
+  sendq_test_fini (&t);
+}
+
+CU_Test (ddsc_tcp_sendq, write_timeout_closes, .timeout = 60)
+{
+  struct sendq_test t;
+  sendq_test_init (&t, "64 kB", "500 ms");
+  bool *accepted = ddsrt_malloc (MAXMSGS * sizeof (*accepted));
+  (void) sendq_test_fill (&t, accepted);
+  size_t queued = 0;
+  for (uint32_t seq = 0; seq < t.seq; seq++)
+    queued += accepted[seq] ? MSGSIZE : 0;
+
+  // without progress for longer than the write timeout the queue is discarded and
+  // the connection closed: what was in the socket buffers arrives, then end-of-file
+  dds_sleepfor (DDS_MSECS (1500));
+  unsigned char *buf = ddsrt_malloc (queued);
+  bool eof;
+  const size_t n = sendq_test_read (&t, buf, queued, DDS_SECS (5), &eof);
+  CU_ASSERT (eof);
+  CU_ASSERT (n < queued);
+  ddsrt_free (buf);
+  ddsrt_free (accepted);
+  sendq_test_fini (&t);
+}
@@ -13,6 +13,7 @@
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/threads.h"
 
+#include "dds__serdata_default.h"
 #include "test_common.h"
 
 /* Test fixtures */
@@ -119,6 +120,35 @@ CU_Test(ddsc_topic_create, recreate, .init = ddsc_topic_init, .fini = ddsc_topic
   CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
 }
 
+CU_Test(ddsc_topic_create, shared_type_data)
+{
+  /* same type in two domains: distinct sertypes, but shared ops, keys and type meta-data */
+  struct dds_sertype_default *st[2];
+  dds_entity_t pp[2], tp[2];
+  char name[MAX_NAME_SIZE];
+  create_unique_topic_name("ddsc_topic_shared_type_data", name, MAX_NAME_SIZE);
+  for (int i = 0; i < 2; i++)
+  {
+    const struct ddsi_sertype *sertype;
+    pp[i] = dds_create_participant((dds_domainid_t) i, NULL, NULL);
+    CU_ASSERT_FATAL(pp[i] > 0);
+    tp[i] = dds_create_topic(pp[i], &Space_Type1_desc, name, NULL, NULL);
+    CU_ASSERT_FATAL(tp[i] > 0);
+    dds_return_t ret = dds_get_entity_sertype(tp[i], &sertype);
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    st[i] = (struct dds_sertype_default *) sertype;
+  }
+  CU_ASSERT(st[0] != st[1]);
+  CU_ASSERT(st[0]->type.ops.ops == st[1]->type.ops.ops);
+  CU_ASSERT_FATAL(st[0]->type.keys.nkeys > 0);
+  CU_ASSERT(st[0]->type.keys.keys == st[1]->type.keys.keys);
+  CU_ASSERT(st[0]->type.keys.keys_definition_order == st[1]->type.keys.keys_definition_order);
+  CU_ASSERT(st[0]->typeinfo_ser.data == st[1]->typeinfo_ser.data);
+  CU_ASSERT(st[0]->typemap_ser.data == st[1]->typemap_ser.data);
+  for (int i = 0; i < 2; i++)
+    dds_delete(pp[i]);
+}
+
 CU_Test(ddsc_topic_create, desc_null, .init = ddsc_topic_init, .fini = ddsc_topic_fini)
 {
   DDSRT_WARNING_MSVC_OFF(6387); /* Disable SAL warning on intentional misuse of the API */
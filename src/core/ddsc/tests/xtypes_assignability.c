@@ -492,6 +492,22 @@ CU_Test (ddsc_xtypes_assignability, type_consistency_enforcement_force_validatio
   }
 }
 
+/* Assignability results are remembered per pair of types and type consistency enforcement
+   policy: repeatedly matching the same types with alternating policies must give the result
+   for the policy in use each time */
+CU_Test (ddsc_xtypes_assignability, type_consistency_enforcement_memo, .init = xtypes_assignability_init, .fini = xtypes_assignability_fini)
+{
+  for (uint32_t n = 0; n < 4; n++)
+  {
+    bool ignore_seq_bounds = (n % 2) == 0;
+    printf ("Running test type_consistency_enforcement_memo: ignore_seq_bounds = %s\n", ignore_seq_bounds ? "true" : "false");
+    dds_qos_t *rd_qos = dds_create_qos ();
+    dds_qset_type_consistency (rd_qos, DDS_TYPE_CONSISTENCY_ALLOW_TYPE_COERCION, ignore_seq_bounds, true, false, false, false);
+    do_test (&XSpaceTypeConsistencyEnforcement_t1_1_desc, rd_qos, &XSpaceTypeConsistencyEnforcement_t1_2_desc, NULL, ignore_seq_bounds, 0, false, 0);
+    dds_delete_qos (rd_qos);
+  }
+}
+
 
 /* Enum extensibility test cases */
 static void sample_init_en_wr1_1 (void *ptr)
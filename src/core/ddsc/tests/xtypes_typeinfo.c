@@ -25,6 +25,7 @@
 #include "dds/ddsi/ddsi_typelib.h"
 #include "dds/ddsi/ddsi_xt_typelookup.h"
 #include "ddsi__xt_impl.h"
+#include "ddsi__typelib.h"
 #include "ddsi__addrset.h"
 #include "ddsi__endpoint_match.h"
 #include "ddsi__proxy_endpoint.h"
@@ -36,6 +37,7 @@
 #include "dds/dds.h"
 #include "dds/version.h"
 #include "dds__entity.h"
+#include "dds__serdata_default.h"
 #include "config_env.h"
 #include "test_common.h"
 #include "xtypes_common.h"
@@ -370,3 +372,123 @@ CU_Test (ddsc_xtypes_typeinfo, get_type_info, .init = xtypes_typeinfo_init, .fin
   dds_free_typeinfo (type_info_wr);
   dds_free_typeinfo (type_info_rd);
 }
+
+static const struct ddsi_sertype_ops *counting_orig_ops;
+static uint32_t counting_type_map_calls, counting_type_info_calls;
+
+static ddsi_typemap_t *counting_type_map (const struct ddsi_sertype *tp)
+{
+  counting_type_map_calls++;
+  return counting_orig_ops->type_map (tp);
+}
+
+static ddsi_typeinfo_t *counting_type_info (const struct ddsi_sertype *tp)
+{
+  counting_type_info_calls++;
+  return counting_orig_ops->type_info (tp);
+}
+
+static void counting_sertype_init (struct dds_sertype_default *st, struct ddsi_sertype_ops *ops, dds_entity_t topic)
+{
+  // copy of the topic's sertype that counts how often the type information and the
+  // type map are deserialized, for passing to ddsi_type_ref_local only
+  const struct ddsi_sertype *sertype;
+  dds_return_t ret = dds_get_entity_sertype (topic, &sertype);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  memcpy (st, sertype, sizeof (*st));
+  counting_orig_ops = sertype->ops;
+  *ops = *sertype->ops;
+  ops->type_map = counting_type_map;
+  ops->type_info = counting_type_info;
+  st->c.ops = ops;
+  ddsrt_atomic_stvoidp (&st->c.type_info_cache, NULL);
+  counting_type_map_calls = 0;
+  counting_type_info_calls = 0;
+}
+
+static void counting_sertype_fini (struct dds_sertype_default *st)
+{
+  ddsi_typeinfo_t *type_info = ddsrt_atomic_ldvoidp (&st->c.type_info_cache);
+  if (type_info != NULL)
+    ddsi_typeinfo_free (type_info);
+}
+
+CU_Test (ddsc_xtypes_typeinfo, ref_local_resolved, .init = xtypes_typeinfo_init, .fini = xtypes_typeinfo_fini)
+{
+  // a type that is known and resolved, including its dependencies, is referenced
+  // without deserializing the type map, but the first reference needs it; the type
+  // information is deserialized only once for the sertype
+  char topic_name[100];
+  create_unique_topic_name ("ddsc_xtypes_typeinfo", topic_name, sizeof (topic_name));
+  dds_entity_t topic = dds_create_topic (g_participant1, &XSpace_XType3_desc, topic_name, NULL, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  struct dds_sertype_default st;
+  struct ddsi_sertype_ops ops;
+  counting_sertype_init (&st, &ops, topic);
+
+  // domain 2 doesn't know the type yet
+  struct ddsi_domaingv *gv = get_domaingv (g_participant2);
+  struct ddsi_type *type1, *type2;
+  dds_return_t ret = ddsi_type_ref_local (gv, &type1, &st.c, DDSI_TYPEID_KIND_COMPLETE);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL_FATAL (counting_type_map_calls, 1);
+  CU_ASSERT_FATAL (ddsi_type_resolved (gv, type1, DDSI_TYPE_INCLUDE_DEPS));
+  const uint32_t refc = type1->refc;
+
+  ret = ddsi_type_ref_local (gv, &type2, &st.c, DDSI_TYPEID_KIND_COMPLETE);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL_FATAL (counting_type_map_calls, 1);
+  CU_ASSERT_FATAL (type2 == type1);
+  CU_ASSERT_EQUAL_FATAL (type1->refc, refc + 1);
+
+  struct ddsi_type *type_m;
+  ret = ddsi_type_ref_local (gv, &type_m, &st.c, DDSI_TYPEID_KIND_MINIMAL);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL (counting_type_info_calls, 1);
+
+  ddsi_type_unref (gv, type_m);
+  ddsi_type_unref (gv, type2);
+  ddsi_type_unref (gv, type1);
+  counting_sertype_fini (&st);
+}
+
+CU_Test (ddsc_xtypes_typeinfo, ref_local_unresolved_dep, .init = xtypes_typeinfo_init, .fini = xtypes_typeinfo_fini)
+{
+  // a type that is resolved itself but has an unresolved dependency, as can happen
+  // for types learnt from remote type information, takes the type map to resolve it
+  char topic_name[100];
+  create_unique_topic_name ("ddsc_xtypes_typeinfo", topic_name, sizeof (topic_name));
+  dds_entity_t topic = dds_create_topic (g_participant1, &XSpace_XType3_desc, topic_name, NULL, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  struct dds_sertype_default st;
+  struct ddsi_sertype_ops ops;
+  counting_sertype_init (&st, &ops, topic);
+
+  struct ddsi_domaingv *gv = get_domaingv (g_participant2);
+  ddsi_typeinfo_t *type_info = ddsi_sertype_typeinfo (&st.c);
+  ddsi_typemap_t *type_map = counting_orig_ops->type_map (&st.c);
+  CU_ASSERT_FATAL (type_info != NULL && type_map != NULL);
+  struct ddsi_type *type_proxy, *type;
+  dds_return_t ret = ddsi_type_ref_proxy (gv, &type_proxy, type_info, DDSI_TYPEID_KIND_COMPLETE, NULL);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  ddsrt_mutex_lock (&gv->typelib_lock);
+  ret = ddsi_type_add_typeobj (gv, type_proxy, ddsi_typemap_typeobj (type_map, &ddsi_typeinfo_complete_typeid (type_info)->x));
+  ddsrt_mutex_unlock (&gv->typelib_lock);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsi_type_resolved (gv, type_proxy, DDSI_TYPE_IGNORE_DEPS));
+  CU_ASSERT_FATAL (!ddsi_type_resolved (gv, type_proxy, DDSI_TYPE_INCLUDE_DEPS));
+
+  ret = ddsi_type_ref_local (gv, &type, &st.c, DDSI_TYPEID_KIND_COMPLETE);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL_FATAL (counting_type_map_calls, 1);
+  CU_ASSERT_FATAL (type == type_proxy);
+  CU_ASSERT_FATAL (ddsi_type_resolved (gv, type, DDSI_TYPE_INCLUDE_DEPS));
+
+  ddsi_type_unref (gv, type);
+  ddsi_type_unref (gv, type_proxy);
+  ddsi_typeinfo_fini (type_info);
+  ddsrt_free (type_info);
+  ddsi_typemap_fini (type_map);
+  ddsrt_free (type_map);
+  counting_sertype_fini (&st);
+}
@@ -45,6 +45,8 @@ void ddsi_config_init_default (struct ddsi_config *cfg)
   cfg->lease_duration = INT64_C (10000000000);
   cfg->tracefile = "cyclonedds.log";
   cfg->pcap_file = "";
+  cfg->pcap_bufsize = UINT32_C (4194304);
+  cfg->pcap_snaplen = UINT32_C (65535);
   cfg->delivery_queue_maxsamples = UINT32_C (256);
   cfg->primary_reorder_maxsamples = UINT32_C (128);
   cfg->secondary_reorder_maxsamples = UINT32_C (128);
@@ -99,10 +101,10 @@ void ddsi_config_init_default (struct ddsi_config *cfg)
   cfg->ssl_min_version.minor = 3;
 #endif /* DDS_HAS_TCP_TLS */
 }
-/* generated from ddsi_config.h[e6e75c7c07b3b91a92715063cfd8abdd0fbd8b08] */
+/* generated from ddsi_config.h[754f74aecd29fe82f27026a250954b1e8a9f400e] */
 /* generated from ddsi__cfgunits.h[bd22f0c0ed210501d0ecd3b07c992eca549ef5aa] */
-/* generated from ddsi__cfgelems.h[69679834d0a592a339803ed27e3966adc900d592] */
-/* generated from ddsi_config.c[8d7ef0ae962a47cb2138de27ac0f6751e3393c66] */
+/* generated from ddsi__cfgelems.h[7288267ac31c3795ecb81d8a2ddf773f6cda8e62] */
+/* generated from ddsi_config.c[221b2ed2f2173dc6dd2aa6b3dedba8c7b38d648c] */
 /* generated from _confgen.h[9554f1d72645c0b8bb66ffbfbc3c0fb664fc1a43] */
 /* generated from _confgen.c[237308acd53897a34e8c643e16e05a61d73ffd65] */
 /* generated from generate_rnc.c[b50e4b7ab1d04b2bc1d361a0811247c337b74934] */
@@ -85,6 +85,7 @@ struct ddsi_config_networkpartition_listelem {
   char *name;
   char *address_string;
   char *interface_names;
+  uint32_t max_rate; /* bytes/s for each writer mapped to it, 0 = unlimited */
   struct ddsi_networkpartition_address *uc_addresses;
   struct ddsi_networkpartition_address *asm_addresses;
 #ifdef DDSRT_HAVE_SSM
@@ -231,6 +232,7 @@ struct ddsi_config_network_interface {
   enum ddsi_boolean_default multicast;
   struct ddsi_config_maybe_int32 priority;
   uint32_t allow_multicast; // no need for a "maybe" type: DDSI_AMC_DEFAULT takes care of that
+  uint32_t max_rate; // bytes/s, 0 = unlimited
 };
 
 struct ddsi_config_network_interface_listelem {
@@ -274,6 +276,9 @@ struct ddsi_config
   uint32_t tracemask;
   uint32_t enabled_xchecks;
   char *pcap_file;
+  uint32_t pcap_bufsize;
+  uint32_t pcap_snaplen;
+  uint32_t pcap_max_file_size;
 
   /* interfaces */
   struct ddsi_config_network_interface_listelem *network_interfaces;
@@ -291,6 +296,7 @@ struct ddsi_config
   FILE *tracefp;
   char *tracefile;
   int tracingAppendToFile;
+  int tracingAsyncWrite;
   enum ddsi_transport_selector transport_selector;
   enum ddsi_boolean_default compat_use_ipv6;
   enum ddsi_boolean_default compat_tcp_enable;
@@ -315,6 +321,7 @@ struct ddsi_config
   int squash_participants;
   int liveliness_monitoring;
   int noprogress_log_stacktraces;
+  int thread_profiling;
   int64_t liveliness_monitoring_interval;
   int prioritize_retransmit;
   enum ddsi_boolean_default multiple_recv_threads;
@@ -344,6 +351,7 @@ struct ddsi_config
   int tcp_port;
   int64_t tcp_read_timeout;
   int64_t tcp_write_timeout;
+  uint32_t tcp_sendq_size;
   int tcp_use_peeraddr_for_unicast;
 
 #ifdef DDS_HAS_TCP_TLS
@@ -402,6 +410,8 @@ struct ddsi_config
   int64_t ds_grace_period;
   uint32_t max_queued_rexmit_bytes;
   unsigned max_queued_rexmit_msgs;
+  uint32_t max_rexmit_rate;
+  int fec_group_size;
   int late_ack_mode;
   int retry_on_reject_besteffort;
   int generate_keyhash;
@@ -454,6 +464,58 @@ struct ddsi_cfgst *ddsi_config_init (const char *config, struct ddsi_config *cfg
 /** @component config */
 DDS_EXPORT void ddsi_config_fini (struct ddsi_cfgst *cfgst);
 
+struct ddsi_config_compiled;
+
+/**
+ * @brief Parses and validates a configuration once for use in many domains (unstable)
+ * @component config
+ *
+ * The configuration string is interpreted exactly as in @ref dds_create_domain, including
+ * the expansion of environment variables and the selection of Domain elements based on
+ * the domain id.  The result is immutable and reference counted, and can be used for
+ * any number of domains, concurrently, via @ref dds_create_domain_with_compiled_config.
+ *
+ * @param[in] config  configuration string: file names and/or XML fragments
+ * @param[in] domid   domain id used for selecting Domain elements and expanding
+ *                    ${CYCLONEDDS_DOMAIN_ID}, or DDS_DOMAIN_DEFAULT
+ * @return the compiled configuration, or NULL if the configuration is invalid
+ */
+DDS_EXPORT struct ddsi_config_compiled *ddsi_config_compile (const char *config, uint32_t domid)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Releases a reference to a compiled configuration (unstable)
+ * @component config
+ *
+ * The memory is freed once the last domain using it has been deleted as well.
+ *
+ * @param[in] cc  compiled configuration
+ */
+DDS_EXPORT void ddsi_config_compiled_free (struct ddsi_config_compiled *cc);
+
+/**
+ * @brief Returns the configuration represented by a compiled configuration (unstable)
+ * @component config
+ *
+ * Everything referenced by the returned configuration is shared between all domains
+ * using it and must not be modified.
+ *
+ * @param[in] cc  compiled configuration
+ * @return the configuration, valid until the compiled configuration is freed
+ */
+DDS_EXPORT const struct ddsi_config *ddsi_config_compiled_get (const struct ddsi_config_compiled *cc)
+  ddsrt_nonnull_all;
+
+struct ddsi_config_compiled_instance;
+
+/** @component config */
+struct ddsi_config_compiled_instance *ddsi_config_compiled_instantiate (struct ddsi_config_compiled *cc, struct ddsi_config *cfg)
+  ddsrt_nonnull_all;
+
+/** @component config */
+void ddsi_config_compiled_fini_instance (struct ddsi_config_compiled_instance *inst, struct ddsi_config *cfg)
+  ddsrt_nonnull_all;
+
 #if defined (__cplusplus)
 }
 #endif
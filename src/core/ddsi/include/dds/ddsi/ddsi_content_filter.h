@@ -0,0 +1,126 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef DDSI_CONTENT_FILTER_H
+#define DDSI_CONTENT_FILTER_H
+
+#include "dds/features.h"
+#include "dds/export.h"
+#include "dds/ddsrt/retcode.h"
+#include "dds/ddsrt/attributes.h"
+#include "dds/ddsc/dds_public_qosdefs.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#ifdef DDS_HAS_TYPELIB
+
+struct ddsi_domaingv;
+struct ddsi_type;
+struct ddsi_serdata;
+struct ddsi_content_filter;
+
+enum ddsi_content_filter_result {
+  DDSI_CONTENT_FILTER_REJECT,
+  DDSI_CONTENT_FILTER_ACCEPT,
+  DDSI_CONTENT_FILTER_UNKNOWN /**< data is in a representation the filter can't handle */
+};
+
+/**
+ * @brief Compiles a content filter expression for a type
+ * @component content_filter
+ *
+ * The expression is a subset of DDS-SQL: comparisons of a member with a constant
+ * combined using AND, OR, NOT and parentheses.  Members are identified by name
+ * (using "." for selecting members of nested structs), comparisons use =, <>,
+ * !=, <, <=, >, >=, BETWEEN and (for strings) LIKE.  The constant can be an
+ * integer, a floating-point number, TRUE or FALSE, a string in single quotes or
+ * the name of an enumerator of the member's type.
+ *
+ * The expression is compiled into a program that locates the members in the
+ * serialized representation and compares them in place, skipping over strings
+ * and sequences of primitive types where necessary.
+ *
+ * @param[out] cf          compiled content filter
+ * @param[in] gv           domain globals
+ * @param[in] type         top-level type of the data
+ * @param[in] expression   filter expression
+ * @return DDS_RETCODE_OK if successful, DDS_RETCODE_BAD_PARAMETER if the
+ *   expression is invalid or references members it can't handle
+ */
+DDS_EXPORT dds_return_t ddsi_content_filter_compile (struct ddsi_content_filter **cf, struct ddsi_domaingv *gv, const struct ddsi_type *type, const char *expression)
+  ddsrt_nonnull_all ddsrt_attribute_warn_unused_result;
+
+/** @component content_filter */
+DDS_EXPORT void ddsi_content_filter_free (struct ddsi_content_filter *cf);
+
+/**
+ * @brief Evaluates a compiled content filter on a serialized sample
+ * @component content_filter
+ *
+ * Anything other than a sample containing data is accepted.
+ *
+ * @param[in] cf   compiled content filter
+ * @param[in] sd   sample
+ * @return whether the sample passes the filter, or DDSI_CONTENT_FILTER_UNKNOWN
+ *   if the serialized representation is not one supported by the filter
+ */
+DDS_EXPORT enum ddsi_content_filter_result ddsi_content_filter_eval (const struct ddsi_content_filter *cf, const struct ddsi_serdata *sd)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Binds a compiled content filter to the memory layout of samples
+ * @component content_filter
+ *
+ * Data in a representation the filter can't handle can then be evaluated after
+ * deserializing it, using ddsi_content_filter_eval_sample.  It must be called
+ * at most once, before the filter is used.
+ *
+ * @param[in,out] cf   compiled content filter
+ * @param[in] ops      (de)serializer instructions of the type the filter was compiled for
+ * @return true if all members referenced by the filter could be located in memory
+ */
+DDS_EXPORT bool ddsi_content_filter_bind_sample_layout (struct ddsi_content_filter *cf, const uint32_t *ops)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Evaluates a compiled content filter on a deserialized sample
+ * @component content_filter
+ *
+ * @param[in] cf       compiled content filter
+ * @param[in] sample   sample in memory
+ * @return whether the sample passes the filter, or DDSI_CONTENT_FILTER_UNKNOWN
+ *   if the filter is not bound to the memory layout
+ */
+DDS_EXPORT enum ddsi_content_filter_result ddsi_content_filter_eval_sample (const struct ddsi_content_filter *cf, const void *sample)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Returns whether the filter can be evaluated on data in a representation
+ * @component content_filter
+ *
+ * Members following, e.g., sequences of structs can only be located in XCDR2,
+ * but a successfully compiled filter supports at least one representation.
+ *
+ * @param[in] cf                   compiled content filter
+ * @param[in] data_representation  DDS_DATA_REPRESENTATION_XCDR1 or _XCDR2
+ * @return true if it supports data in that representation
+ */
+DDS_EXPORT bool ddsi_content_filter_supports_representation (const struct ddsi_content_filter *cf, dds_data_representation_id_t data_representation)
+  ddsrt_nonnull_all;
+
+#endif /* DDS_HAS_TYPELIB */
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI_CONTENT_FILTER_H */
@@ -33,6 +33,7 @@ extern "C" {
 #endif
 
 struct ddsi_xmsgpool;
+struct ddsi_tokenbucket;
 struct ddsi_dqueue;
 struct ddsi_reorder;
 struct ddsi_defrag;
@@ -250,6 +251,9 @@ struct ddsi_domaingv {
   dds_qos_t builtin_stateless_xqos_wr;
 #endif
 
+  /* Interned partition QoS settings and cached outcomes of matching them */
+  struct ddsi_partition_cache *partition_cache;
+
   /* SPDP packets get very special treatment (they're the only packets
      we accept from writers we don't know) and have their very own
      do-nothing defragmentation and reordering thingummies, as well as a
@@ -293,6 +297,10 @@ struct ddsi_domaingv {
   ddsrt_mutex_t sendq_lock;
   ddsrt_cond_t sendq_cond;
   unsigned sendq_length;
+  uint64_t sendq_packets;
+  uint64_t sendq_blocked;
+  unsigned sendq_paced; /* number of queued packets deferred by traffic shaping */
+  uint64_t sendq_vtime; /* virtual finish time of the packet last taken from the send queue */
   struct ddsi_xpack *sendq_head;
   struct ddsi_xpack *sendq_tail;
   int sendq_stop;
@@ -300,9 +308,14 @@ struct ddsi_domaingv {
   bool sendq_running;
   ddsrt_mutex_t sendq_running_lock;
 
+  /* Traffic shaping: per-interface token buckets (indexed like interfaces)
+     and one for retransmits, NULL if unlimited */
+  struct ddsi_tokenbucket *intf_tokenbuckets[MAX_XMIT_CONNS];
+  struct ddsi_tokenbucket *rexmit_tokenbucket;
+  bool xpack_shaping; /* any of the above non-NULL, requires the send queue */
+
   /* File for dumping captured packets, NULL if disabled */
-  FILE *pcap_fp;
-  ddsrt_mutex_t pcap_lock;
+  struct ddsi_pcap *pcap;
 
   struct ddsi_builtin_topic_interface *builtin_topic_interface;
 
@@ -317,6 +330,7 @@ struct ddsi_domaingv {
   ddsrt_avl_tree_t typedeps;
   ddsrt_avl_tree_t typedeps_reverse;
   ddsrt_cond_t typelib_resolved_cond;
+  struct ddsrt_hh *assignability_memo; /* protected by typelib_lock */
 #endif
 #ifdef DDS_HAS_TOPIC_DISCOVERY
   ddsrt_mutex_t topic_defs_lock;
@@ -30,6 +30,7 @@ struct ddsi_entity_common;
 struct ddsi_endpoint_common;
 struct ddsi_ldur_fhnode;
 struct ddsi_entity_index;
+struct ddsi_tokenbucket;
 struct dds_qos;
 
 /* Liveliness changed is more complicated than just add/remove. Encode the event
@@ -111,10 +112,15 @@ struct ddsi_writer
   uint32_t num_readers; /* total number of matching PROXY readers */
   uint32_t num_reliable_readers; /* number of matching reliable PROXY readers */
   uint32_t num_readers_requesting_keyhash; /* also +1 for protected keys and config override for generating keyhash */
+  uint32_t num_readers_accepting_fec; /* number of matching PROXY readers that can use FEC parity messages */
+#ifdef DDS_HAS_TYPELIB
+  uint32_t num_readers_with_content_filter; /* number of matching PROXY readers for which the writer evaluates a content filter */
+#endif
   ddsrt_avl_tree_t readers; /* all matching PROXY readers, see struct ddsi_wr_prd_match */
   ddsrt_avl_tree_t local_readers; /* all matching LOCAL readers, see struct ddsi_wr_rd_match */
 #ifdef DDS_HAS_NETWORK_PARTITIONS
   const struct ddsi_config_networkpartition_listelem *network_partition;
+  struct ddsi_tokenbucket *tokenbucket; /* rate limit from the network partition, NULL if unlimited */
 #endif
   uint32_t num_acks_received; /* cum received ACKNACKs with no request for retransmission */
   uint32_t num_nacks_received; /* cum received ACKNACKs that did request retransmission */
@@ -160,6 +166,7 @@ struct ddsi_reader
   uint32_t num_writers; /* total number of matching PROXY writers */
   ddsrt_avl_tree_t writers; /* all matching PROXY writers, see struct ddsi_rd_pwr_match */
   ddsrt_avl_tree_t local_writers; /* all matching LOCAL writers, see struct ddsi_rd_wr_match */
+  ddsrt_atomic_voidp_t latency_hist; /* struct ddsrt_hdrhist *, null until latency statistics are requested */
 #ifdef DDS_HAS_SECURITY
   struct ddsi_reader_sec_attributes *sec_attr;
 #endif
@@ -35,6 +35,7 @@ struct ddsi_network_interface {
   unsigned is_psmx: 1;
   uint32_t allow_multicast;
   int32_t priority;
+  uint32_t max_rate; // bytes/s, 0 = unlimited
   char *name;
 };
 
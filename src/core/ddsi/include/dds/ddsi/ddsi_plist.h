@@ -149,6 +149,7 @@ typedef struct ddsi_plist {
   uint32_t cyclone_receive_buffer_size;
   unsigned char cyclone_requests_keyhash;
   unsigned char cyclone_redundant_networking;
+  unsigned char cyclone_accepts_fec;
 } ddsi_plist_t;
 
 /**
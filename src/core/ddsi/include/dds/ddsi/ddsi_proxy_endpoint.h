@@ -92,6 +92,7 @@ struct ddsi_proxy_reader {
   unsigned deleting: 1; /* set when being deleted */
   unsigned is_fict_trans_reader: 1; /* only true when it is certain that is a fictitious transient data reader (affects built-in topic generation) */
   unsigned requests_keyhash: 1; /* 1 iff this reader would like to receive keyhashes */
+  unsigned accepts_fec: 1; /* 1 iff this reader can reconstruct fragments from FEC parity messages */
   unsigned redundant_networking: 1; /* 1 iff requests receiving data on all advertised interfaces */
 #ifdef DDSRT_HAVE_SSM
   unsigned favours_ssm: 1; /* iff 1, this proxy reader favours SSM when available */
@@ -57,6 +57,7 @@ struct ddsi_sertype {
   const struct ddsi_sertype *base_sertype; /* counted ref to sertype used to derive this sertype, used to overwrite the serdata_ops for a specific data representation */
   uint32_t sizeof_type;
   dds_data_type_properties_t data_type_props; /* representation of properties of the data type */
+  ddsrt_atomic_voidp_t type_info_cache; /* deserialized type information, set on first use by the type library */
 };
 
 /* The old and the new happen to have the same memory layout on a 64-bit machine
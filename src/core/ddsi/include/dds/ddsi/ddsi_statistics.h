@@ -12,6 +12,8 @@
 #define _DDSI_STATISTICS_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "dds/ddsi/ddsi_locator.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -23,8 +25,147 @@ struct ddsi_writer;
 /** @component ddsi_statistics */
 void ddsi_get_writer_stats (struct ddsi_writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit);
 
+struct ddsi_domaingv;
+
+/** @component packet_capturing */
+void ddsi_get_pcap_stats (struct ddsi_domaingv *gv, uint64_t * __restrict packets, uint64_t * __restrict dropped);
+
+/**
+ * @brief Bytes and samples discarded by the reader's defragmenting and reordering
+ * @component ddsi_statistics
+ *
+ * Discarded samples includes duplicates, samples rejected because the delivery queue
+ * was full and incomplete fragmented samples dropped because of resource limits.
+ *
+ * @param[in] rd  reader
+ * @param[out] discarded_bytes    number of bytes discarded
+ * @param[out] discarded_samples  number of samples discarded
+ */
+void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discarded_bytes, uint64_t * __restrict discarded_samples);
+
+/**
+ * @brief Start recording end-to-end latencies for a reader
+ * @component ddsi_statistics
+ *
+ * Latency is the time from the source timestamp of a sample to the moment it is
+ * stored in the reader history cache.  Recording is off by default so that readers
+ * for which nobody asks for statistics do not incur the cost of reading the clock.
+ *
+ * @param[in] rd  reader, enabling it more than once is allowed
+ */
+void ddsi_reader_enable_latency_stats (struct ddsi_reader *rd);
+
 /** @component ddsi_statistics */
-void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discarded_bytes);
+void ddsi_get_reader_latency_stats (struct ddsi_reader *rd, uint64_t * __restrict count, uint64_t * __restrict min, uint64_t * __restrict p50, uint64_t * __restrict p90, uint64_t * __restrict p99, uint64_t * __restrict p999, uint64_t * __restrict max);
+
+/**
+ * @brief Domain-wide statistics of the internal queues, buffers and sockets
+ *
+ * Times are in nanoseconds; lengths are the current values, everything else
+ * counts from the creation of the domain.
+ */
+struct ddsi_domain_stats {
+  uint64_t dqueue_length;           /**< samples in the delivery queues */
+  uint64_t dqueue_delivered;        /**< samples delivered by the delivery queues */
+  uint64_t dqueue_wait_time;        /**< sum of times the oldest sample waited for the delivery thread */
+  uint64_t dqueue_max_wait_time;    /**< maximum of those */
+  uint64_t dqueue_full_waits;       /**< times a receive thread blocked on a full delivery queue */
+  uint64_t xevq_length;             /**< messages and other non-timed events queued for transmit thread */
+  uint64_t xevq_nontimed_handled;   /**< non-timed events handled */
+  uint64_t xevq_timed_handled;      /**< timed events (heartbeats, acknacks, &c.) handled */
+  uint64_t xevq_timed_lateness;     /**< sum of delays between scheduled and actual time */
+  uint64_t xevq_max_timed_lateness; /**< maximum of those */
+  uint64_t sendq_length;            /**< packets in the asynchronous send queue */
+  uint64_t sendq_packets;           /**< packets that went through the send queue */
+  uint64_t sendq_blocked;           /**< times a writer blocked on a full send queue */
+  uint64_t rbuf_count;              /**< receive buffers in use */
+  uint64_t rbuf_bytes;              /**< memory occupied by receive buffers in use */
+  uint64_t rx_packets;              /**< packets received on the domain's own sockets */
+  uint64_t rx_bytes;                /**< bytes received on the domain's own sockets */
+  uint64_t tx_packets;              /**< packets sent */
+  uint64_t tx_bytes;                /**< bytes sent */
+};
+
+/**
+ * @brief Retrieve the domain-wide statistics
+ * @component ddsi_statistics
+ *
+ * @param[in] gv   domain
+ * @param[out] st  statistics
+ */
+void ddsi_get_domain_stats (struct ddsi_domaingv *gv, struct ddsi_domain_stats * __restrict st);
+
+/** @brief Traffic statistics of a single socket */
+struct ddsi_conn_stats {
+  uint64_t rx_packets;
+  uint64_t rx_bytes;
+  uint64_t tx_packets;
+  uint64_t tx_bytes;
+};
+
+/** @brief Callback for @ref ddsi_enum_conn_stats */
+typedef void (*ddsi_conn_stats_cb_t) (const ddsi_locator_t *loc, const struct ddsi_conn_stats *st, void *arg);
+
+/**
+ * @brief Invoke a callback with the traffic statistics for each of the domain's sockets
+ * @component ddsi_statistics
+ *
+ * This covers the sockets for receiving discovery and data on unicast and multicast
+ * addresses and those used for transmitting, each socket reported only once.
+ * Connections accepted by connection-oriented transports are not included.
+ *
+ * @param[in] gv   domain
+ * @param[in] cb   callback, invoked with the locator of the socket and its statistics
+ * @param[in] arg  argument passed to the callback
+ */
+void ddsi_enum_conn_stats (struct ddsi_domaingv *gv, ddsi_conn_stats_cb_t cb, void *arg);
+
+struct ddsi_thread_state;
+
+/**
+ * @brief Profile of an internal thread
+ *
+ * Only available when enabled using Internal/LivelinessMonitoring[@Profiling].
+ * Times are in nanoseconds and count from the creation of the thread; the CPU
+ * times are those sampled by the liveliness monitor.
+ */
+struct ddsi_thread_stats {
+  const char *name;          /**< name of the thread */
+  uint64_t utime;            /**< user CPU time */
+  uint64_t stime;            /**< system CPU time */
+  uint64_t awake_time;       /**< time spent awake, i.e., doing work */
+  uint64_t awake_count;      /**< number of intervals spent awake */
+  uint64_t awake_p50;        /**< median duration of an interval spent awake */
+  uint64_t awake_p90;        /**< 90th percentile of those */
+  uint64_t awake_p99;        /**< 99th percentile of those */
+  uint64_t awake_max;        /**< maximum of those */
+};
+
+/**
+ * @brief Retrieve the profile of a thread
+ * @component ddsi_statistics
+ *
+ * @param[in] thrst  thread state
+ * @param[out] st    profile, the name refers to the thread state
+ * @returns true if profiling is enabled for the thread and the profile was retrieved
+ */
+bool ddsi_get_thread_stats (const struct ddsi_thread_state *thrst, struct ddsi_thread_stats * __restrict st);
+
+/** @brief Callback for @ref ddsi_enum_thread_stats */
+typedef void (*ddsi_thread_stats_cb_t) (const struct ddsi_thread_stats *st, void *arg);
+
+/**
+ * @brief Invoke a callback with the profile of each internal thread of the domain
+ * @component ddsi_statistics
+ *
+ * The callback is invoked with the lock protecting the set of threads held, and so
+ * it must return quickly.  Threads for which profiling is not enabled are skipped.
+ *
+ * @param[in] gv   domain
+ * @param[in] cb   callback
+ * @param[in] arg  argument passed to the callback
+ */
+void ddsi_enum_thread_stats (const struct ddsi_domaingv *gv, ddsi_thread_stats_cb_t cb, void *arg);
 
 #if defined (__cplusplus)
 }
@@ -87,11 +87,14 @@ void ddsi_thread_vtime_trace (struct ddsi_thread_state *thrst);
 #define THREAD_BASE_NESTEDGV
 #endif
 
+struct ddsi_thread_profile;
+
 #define THREAD_BASE                             \
   ddsrt_atomic_uint32_t vtime;                  \
   enum ddsi_thread_state_kind state;            \
   ddsrt_atomic_voidp_t gv;                      \
   THREAD_BASE_NESTEDGV                          \
+  struct ddsi_thread_profile *profile;          \
   ddsrt_thread_t tid;                           \
   uint32_t (*f) (void *arg);                    \
   void *f_arg;                                  \
@@ -186,6 +189,25 @@ inline bool ddsi_thread_is_asleep (void)
   return ddsi_vtime_asleep_p (vt);
 }
 
+/**
+ * @brief Note the start of an interval during which the thread is awake
+ * @component thread_support
+ *
+ * Only called for threads for which profiling is enabled, i.e., that have a non-null
+ * profile pointer.
+ *
+ * @param[in] thrst  thread state of the calling thread
+ */
+DDS_EXPORT void ddsi_thread_profile_awake (struct ddsi_thread_state *thrst);
+
+/**
+ * @brief Note the end of an interval during which the thread is awake
+ * @component thread_support
+ *
+ * @param[in] thrst  thread state of the calling thread
+ */
+DDS_EXPORT void ddsi_thread_profile_asleep (struct ddsi_thread_state *thrst);
+
 /** @component thread_support */
 DDS_INLINE_EXPORT inline void ddsi_thread_state_asleep (struct ddsi_thread_state *thrst)
 {
@@ -195,7 +217,11 @@ DDS_INLINE_EXPORT inline void ddsi_thread_state_asleep (struct ddsi_thread_state
   ddsrt_atomic_fence_rel ();
   ddsi_thread_vtime_trace (thrst);
   if ((vt & DDSI_VTIME_NEST_MASK) == 1)
+  {
+    if (thrst->profile)
+      ddsi_thread_profile_asleep (thrst);
     vt += (1u << DDSI_VTIME_TIME_SHIFT) - 1u;
+  }
   else
     vt -= 1u;
   ddsrt_atomic_st32 (&thrst->vtime, vt);
@@ -222,6 +248,8 @@ DDS_INLINE_EXPORT inline void ddsi_thread_state_awake (struct ddsi_thread_state
   assert ((vt & DDSI_VTIME_NEST_MASK) == 0 || gv == ddsrt_atomic_ldvoidp (&thrst->gv));
   ddsrt_atomic_stvoidp (&thrst->gv, (struct ddsi_domaingv *) gv);
 #endif
+  if ((vt & DDSI_VTIME_NEST_MASK) == 0 && thrst->profile)
+    ddsi_thread_profile_awake (thrst);
   ddsrt_atomic_fence_stst ();
   ddsrt_atomic_st32 (&thrst->vtime, vt + 1u);
   /* nested calls a rare and an extra fence doesn't break things */
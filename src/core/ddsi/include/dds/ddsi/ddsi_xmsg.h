@@ -12,6 +12,7 @@
 #define DDSI_XMSG_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "dds/features.h"
 
@@ -28,6 +29,32 @@ DDS_EXPORT struct ddsi_xpack * ddsi_xpack_new (struct ddsi_domaingv *gv, bool as
 /** @component rtps_msg */
 DDS_EXPORT void ddsi_xpack_free (struct ddsi_xpack *xp);
 
+/**
+ * @brief Sets the priority of the packets with which the xpack is queued for transmission
+ * @component rtps_msg
+ *
+ * Only affects asynchronous xpacks: packets in the send queue are sent in order of
+ * decreasing priority, and in FIFO order for a given priority.  The default is 0.
+ *
+ * @param[in] xp        xpack
+ * @param[in] priority  priority, typically the writer's transport priority
+ */
+DDS_EXPORT void ddsi_xpack_set_priority (struct ddsi_xpack *xp, int32_t priority);
+
+/**
+ * @brief Sets how long sending a packet may wait for space in the send queue
+ * @component rtps_msg
+ *
+ * Packets that are delayed by the per-interface or retransmit rate limits are
+ * handed to the send queue instead of being sent immediately.  If the queue is
+ * full, the caller waits at most this long before queueing it anyway.  The default
+ * is 0.
+ *
+ * @param[in] xp                 xpack
+ * @param[in] max_blocking_time  maximum time to wait, typically the writer's reliability max_blocking_time
+ */
+DDS_EXPORT void ddsi_xpack_set_max_blocking_time (struct ddsi_xpack *xp, dds_duration_t max_blocking_time);
+
 /** @component rtps_msg */
 DDS_EXPORT void ddsi_xpack_send (struct ddsi_xpack *xp, bool immediately /* unused */);
 
@@ -234,6 +234,7 @@ typedef ddsi_stringseq_t dds_pubsub_message_exchange_qospolicy_t;
 #define DDSI_QP_PSMX                              ((uint64_t)1 << 34)
 #define DDSI_QP_DATA_REPRESENTATION               ((uint64_t)1 << 35)
 #define DDSI_QP_ENTITY_NAME                       ((uint64_t)1 << 36)
+#define DDSI_QP_CYCLONE_CONTENT_FILTER            ((uint64_t)1 << 37)
 
 
 /* Partition QoS is not RxO according to the specification (DDS 1.2,
@@ -294,6 +295,7 @@ struct dds_qos {
   /*xxxR*/dds_type_consistency_enforcement_qospolicy_t type_consistency;
   /*xxxX*/dds_pubsub_message_exchange_qospolicy_t psmx;
   /*xxx */dds_data_representation_qospolicy_t data_representation;
+  /*xxxR*/char *content_filter;
 };
 
 DDS_EXPORT extern const dds_qos_t ddsi_default_qos_reader;
@@ -103,6 +103,15 @@ static struct cfgelem network_interface_attributes[] = {
       "<p>The special value \"default\" takes the value from the global"
       "General/AllowMulticast setting.</p>"),
     VALUES("false","spdp","asm","ssm","true","default")),
+  STRING("max_rate", NULL, 1, "0 B/s",
+    MEMBEROF(ddsi_config_network_interface_listelem, cfg.max_rate),
+    FUNCTIONS(0, uf_bandwidth, 0, pf_bandwidth),
+    DESCRIPTION(
+      "<p>This attribute limits the rate at which data is transmitted via "
+      "this interface, using a token bucket with a depth of "
+      "General/MaxMessageSize. Packets exceeding the budget are paced by "
+      "delaying their transmission. The default of 0 means unlimited.</p>"),
+    UNIT("bandwidth")),
   END_MARKER
 };
 
@@ -721,6 +730,15 @@ static struct cfgelem networkpartition_cfgattrs[] = {
       "implemented by adding the interface addresses to the set address "
       "set configured using the sibling \"Address\" attribute. See "
       "there for more details.</p>")),
+  STRING("MaxRate", NULL, 1, "0 B/s",
+    MEMBEROF(ddsi_config_networkpartition_listelem, max_rate),
+    FUNCTIONS(0, uf_bandwidth, 0, pf_bandwidth),
+    DESCRIPTION(
+      "<p>This attribute limits the rate at which each writer mapped to this "
+      "network partition publishes data. Writes exceeding the budget are "
+      "delayed for at most the writer's reliability max blocking time. The "
+      "default of 0 means unlimited.</p>"),
+    UNIT("bandwidth")),
   END_MARKER
 };
 
@@ -880,6 +898,10 @@ static struct cfgelem thread_properties_cfgattrs[] = {
       "general timed-event handling, retransmits and discovery;</li>\n"
       "<li><i>fsm</i>: "
       "finite state machine thread for handling security handshake;</li>\n"
+      "<li><i>pcap</i>: "
+      "writes captured packets to the packet capture file;</li>\n"
+      "<li><i>tcpsend</i>: "
+      "writes queued data to TCP connections that would otherwise block;</li>\n"
       "<li><i>xmit.CHAN</i>: "
       "transmit thread for channel CHAN;</li>\n"
       "<li><i>dq.CHAN</i>: "
@@ -1135,6 +1157,14 @@ static struct cfgelem liveliness_monitoring_attrs[] = {
       "<p>This element controls whether or not to write stack traces to the "
       "DDSI2 trace when a thread fails to make progress (on select platforms "
       "only).</p>")),
+  BOOL("Profiling", NULL, 1, "false",
+    MEMBER(thread_profiling),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element controls whether or not to measure the CPU time used by "
+      "each internal thread and the durations of the intervals in which it is "
+      "doing work. The results are available in the statistics of the threads, "
+      "the debug monitor and the timing category of the trace.</p>")),
   STRING("Interval", NULL, 1, "1s",
     MEMBER(liveliness_monitoring_interval),
     FUNCTIONS(0, uf_duration_100ms_1hr, 0, pf_duration),
@@ -1358,6 +1388,28 @@ static struct cfgelem internal_cfgelems[] = {
       "<p>This setting limits the maximum number of samples queued for "
       "retransmission.</p>"
     )),
+  STRING("MaxRexmitRate", NULL, 1, "0 B/s",
+    MEMBER(max_rexmit_rate),
+    FUNCTIONS(0, uf_bandwidth, 0, pf_bandwidth),
+    DESCRIPTION(
+      "<p>This setting limits the rate at which retransmissions are sent, "
+      "using a token bucket with a depth of General/MaxRexmitMessageSize that "
+      "is separate from the per-interface and per-writer limits. Packets "
+      "exceeding the budget are paced by delaying their transmission. "
+      "The default of 0 means unlimited.</p>"),
+    UNIT("bandwidth")),
+  INT("FECGroupSize", NULL, 1, "0",
+    MEMBER(fec_group_size),
+    FUNCTIONS(0, uf_natint_255, 0, pf_int),
+    DESCRIPTION(
+      "<p>This element enables forward error correction for fragmented "
+      "samples. When set to N > 0, a writer follows every group of N "
+      "fragment messages of a new sample with a parity message from which "
+      "readers can reconstruct any one lost message of that group without "
+      "waiting for a retransmit. Parity messages are only sent if at least "
+      "one matched remote reader advertises support for them. The default of "
+      "0 disables it.</p>"),
+    RANGE("0;255")),
   MOVED("LeaseDuration", "CycloneDDS/Domain/Discovery/LeaseDuration"),
   STRING("WriterLingerDuration", NULL, 1, "1 s",
     MEMBER(writer_linger_duration),
@@ -1513,7 +1565,10 @@ static struct cfgelem internal_cfgelems[] = {
       "<p>This element allows configuring a service that dumps a text "
       "description of part the internal state to TCP clients. By default "
       "(-1), this is disabled; specifying 0 means a kernel-allocated port is "
-      "used; a positive number is used as the TCP port number.</p>"
+      "used; a positive number is used as the TCP port number.</p>\n"
+      "<p>An HTTP request for <code>/metrics</code> returns the statistics of the "
+      "domain, its queues, sockets, threads, readers and writers in the OpenMetrics "
+      "text format instead, suitable for scraping by Prometheus.</p>"
     )),
   STRING(DEPRECATED("AssumeMulticastCapable"), NULL, 1, "",
     MEMBER(depr_assumeMulticastCapable),
@@ -1727,6 +1782,19 @@ static struct cfgelem tcp_cfgelems[] = {
       "<p>This element specifies the timeout for blocking TCP write "
       "operations. If this timeout expires then the connection is closed.</p>"),
     UNIT("duration")),
+  STRING("SendQueueSize", NULL, 1, "0 B",
+    MEMBER(tcp_sendq_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum amount of data queued per TCP "
+      "connection when the socket can't accept it immediately. If non-zero, "
+      "writing never blocks: data that doesn't fit in the socket buffer is "
+      "queued and written by a separate thread, and messages that would cause "
+      "the queue to exceed this size are dropped, as if lost on the network. "
+      "The connection is closed if no progress is made for the duration of "
+      "WriteTimeout. If zero, writes block until complete or until "
+      "WriteTimeout expires. The queue is not used with SSL/TLS.</p>"),
+    UNIT("memsize")),
   BOOL("AlwaysUsePeeraddrForUnicast", NULL, 1, "false",
     MEMBER(tcp_use_peeraddr_for_unicast),
     FUNCTIONS(0, uf_boolean, 0, pf_boolean),
@@ -2087,6 +2155,16 @@ static struct cfgelem tracing_cfgelems[] = {
       "existing log file. The default is to create a new log file each time, "
       "which is generally the best option if a detailed log is generated.</p>"
     )),
+  BOOL("AsyncWrite", NULL, 1, "false",
+    MEMBER(tracingAsyncWrite),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This option specifies whether the log is written to the file by a "
+      "background thread rather than by the thread producing the output. "
+      "This greatly reduces the overhead of detailed tracing at the cost of a "
+      "1MB buffer, and the output still in that buffer is lost if the process "
+      "crashes.</p>"
+    )),
   STRING("PacketCaptureFile", NULL, 1, "",
     MEMBER(pcap_file),
     FUNCTIONS(0, uf_string, ff_free, pf_string),
@@ -2097,8 +2175,36 @@ static struct cfgelem tracing_cfgelems[] = {
       "fictitious, in particular the destination address of received packets. "
       "The TTL may be used to distinguish between sent and received packets: "
       "it is 255 for sent packets and 128 for received ones. Currently IPv4 "
-      "only.</p>"
-    )),
+      "only.</p>\n"
+      "<p>Packets are written to the file by a separate thread. If the file "
+      "can't be written quickly enough, packets are dropped from the capture "
+      "(but not from the network). The number of dropped packets is available "
+      "in the statistics of the domain entity.</p>"
+    )),
+  STRING("PacketCaptureBufferSize", NULL, 1, "4 MiB",
+    MEMBER(pcap_bufsize),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the size of the buffer holding captured "
+      "packets until they are written to the file.</p>"),
+    UNIT("memsize")),
+  STRING("PacketCaptureSnapLength", NULL, 1, "65535 B",
+    MEMBER(pcap_snaplen),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum number of bytes of each packet "
+      "that is stored in the capture file, including the IP and UDP "
+      "headers.</p>"),
+    UNIT("memsize")),
+  STRING("PacketCaptureMaxFileSize", NULL, 1, "0 B",
+    MEMBER(pcap_max_file_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the size at which the packet capture file "
+      "is closed and a new one is started. The files are numbered: "
+      "PacketCaptureFile.1, PacketCaptureFile.2, etc. The default of 0 means "
+      "the size is unlimited.</p>"),
+    UNIT("memsize")),
   END_MARKER
 };
 
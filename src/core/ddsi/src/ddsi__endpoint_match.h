@@ -31,6 +31,8 @@ struct ddsi_proxy_writer;
 struct ddsi_proxy_reader;
 struct ddsi_alive_state;
 struct ddsi_generic_proxy_endpoint;
+struct ddsi_serdata;
+struct ddsi_content_filter;
 
 struct ddsi_bestab {
   unsigned besflag;
@@ -112,6 +114,9 @@ struct ddsi_wr_prd_match {
 #ifdef DDS_HAS_SECURITY
   int64_t crypto_handle;
 #endif
+#ifdef DDS_HAS_TYPELIB
+  struct ddsi_content_filter *content_filter; /* reader's content filter compiled for writer's type, or NULL */
+#endif
 };
 
 struct ddsi_prd_wr_match {
@@ -200,6 +205,20 @@ void ddsi_free_wr_rd_match (struct ddsi_wr_rd_match *m);
 /** @component endpoint_matching */
 void ddsi_writer_add_connection (struct ddsi_writer *wr, struct ddsi_proxy_reader *prd, int64_t crypto_handle);
 
+/**
+ * @brief Whether the content filter of a matched proxy reader rejects a sample
+ * @component endpoint_matching
+ *
+ * @param[in] m        writer-proxy reader match
+ * @param[in] serdata  sample
+ * @return true iff the reader has a content filter that the writer can
+ *   evaluate and that filter rejects the sample
+ */
+bool ddsi_writer_content_filter_rejects (const struct ddsi_wr_prd_match *m, const struct ddsi_serdata *serdata);
+
+/** @component endpoint_matching */
+bool ddsi_wr_prd_match_has_content_filter (const struct ddsi_wr_prd_match *m);
+
 /** @component endpoint_matching */
 void ddsi_writer_add_local_connection (struct ddsi_writer *wr, struct ddsi_reader *rd);
 
@@ -0,0 +1,60 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef DDSI__PARTITION_MATCH_H
+#define DDSI__PARTITION_MATCH_H
+
+#include <stdbool.h>
+#include "dds/ddsrt/attributes.h"
+#include "dds/ddsi/ddsi_xqos.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_partition_cache;
+
+/**
+ * @brief Creates a cache of interned partition sets
+ * @component qos_matching
+ *
+ * Partition QoS settings are interned into sets that have the exact names in a
+ * hash-ordered array and the wildcard patterns precompiled, so that two sets can be
+ * matched without comparing every pair of strings.  The outcome of matching two sets
+ * is cached as well.  The cache is bounded: when it grows too large, it is emptied.
+ *
+ * @return a new, empty cache
+ */
+struct ddsi_partition_cache *ddsi_partition_cache_new (void)
+  ddsrt_attribute_warn_unused_result;
+
+/** @component qos_matching */
+void ddsi_partition_cache_free (struct ddsi_partition_cache *pc);
+
+/**
+ * @brief Checks whether the partition QoS settings of a reader and a writer match
+ * @component qos_matching
+ *
+ * A missing or empty partition QoS is treated as the default partition (""), a pair of
+ * names matches if they are equal or if one is a wildcard pattern matching the other,
+ * and two wildcard patterns never match.  Safe to call concurrently.
+ *
+ * @param[in] pc  partition cache
+ * @param[in] a   QoS of one endpoint
+ * @param[in] b   QoS of the other endpoint
+ * @return true iff the partitions match
+ */
+bool ddsi_partition_cache_match (struct ddsi_partition_cache *pc, const dds_qos_t *a, const dds_qos_t *b);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI__PARTITION_MATCH_H */
@@ -20,9 +20,13 @@ extern "C" {
 #endif
 
 struct msghdr;
+struct ddsi_pcap;
 
 /** @component packet_capturing */
-FILE * ddsi_new_pcap_file (struct ddsi_domaingv *gv, const char *name);
+struct ddsi_pcap *ddsi_pcap_new (struct ddsi_domaingv *gv, const char *name);
+
+/** @component packet_capturing */
+void ddsi_pcap_free (struct ddsi_pcap *pc);
 
 /** @component packet_capturing */
 void ddsi_write_pcap_received (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, unsigned char *buf, size_t sz);
@@ -152,6 +152,14 @@ typedef struct ddsi_rtps_datafrag {
 #define DDSI_DATAFRAG_FLAG_INLINE_QOS 0x02u
 #define DDSI_DATAFRAG_FLAG_KEYFLAG 0x04u
 
+/* CYCLONE_FEC_PARITY uses the DataFrag layout: the payload is the XOR of
+   "extraFlags" consecutive slots of "fragmentsInSubmessage" fragments each,
+   starting at "fragmentStartingNum", so that a receiver missing any one
+   slot can reconstruct it as a regular DataFrag.  Inline QoS (and the
+   preceding INFO_TS) are the same as those of the first fragment if the
+   group starts with fragment 1. */
+typedef ddsi_rtps_datafrag_t ddsi_rtps_fecparity_t;
+
 DDSRT_WARNING_MSVC_OFF(4200)
 typedef struct ddsi_rtps_acknack {
   ddsi_rtps_submessage_header_t smhdr;
@@ -369,6 +377,8 @@ typedef union ddsi_rtps_submessage {
 #define DDSI_PID_CYCLONE_TOPIC_GUID                  (DDSI_PID_VENDORSPECIFIC_FLAG | 0x1bu)
 #define DDSI_PID_CYCLONE_REQUESTS_KEYHASH            (DDSI_PID_VENDORSPECIFIC_FLAG | 0x1cu)
 #define DDSI_PID_CYCLONE_REDUNDANT_NETWORKING        (DDSI_PID_VENDORSPECIFIC_FLAG | 0x1du)
+#define DDSI_PID_CYCLONE_ACCEPTS_FEC                 (DDSI_PID_VENDORSPECIFIC_FLAG | 0x1eu)
+#define DDSI_PID_CYCLONE_CONTENT_FILTER              (DDSI_PID_VENDORSPECIFIC_FLAG | 0x1fu)
 
 
 #if defined (__cplusplus)
@@ -128,6 +128,16 @@ void ddsi_rbufpool_setowner (struct ddsi_rbufpool *rbp, ddsrt_thread_t tid);
 /** @component receive_buffers */
 void ddsi_rbufpool_free (struct ddsi_rbufpool *rbp);
 
+/**
+ * @brief Current occupancy of a receive buffer pool
+ * @component receive_buffers
+ *
+ * @param[in] rbp     receive buffer pool
+ * @param[out] nbufs  number of receive buffers still in use
+ * @param[out] bytes  memory occupied by those buffers
+ */
+void ddsi_rbufpool_stats (struct ddsi_rbufpool *rbp, uint32_t *nbufs, uint64_t *bytes);
+
 /** @component receive_buffers */
 struct ddsi_rmsg *ddsi_rmsg_new (struct ddsi_rbufpool *rbufpool);
 
@@ -174,6 +184,28 @@ enum ddsi_defrag_nackmap_result ddsi_defrag_nackmap (struct ddsi_defrag *defrag,
 /** @component receive_buffers */
 void ddsi_defrag_prune (struct ddsi_defrag *defrag, ddsi_guid_prefix_t *dst, ddsi_seqno_t min);
 
+/**
+ * @brief Reconstructs a missing slot of a partially received sample from XOR parity
+ * @component receive_buffers
+ *
+ * The byte range [gmin,gmaxp1) of the sample is covered by consecutive slots of
+ * slotsize bytes (the last one possibly shorter) and parity contains the XOR of all
+ * of them.  If all bytes in the range except for those in a single slot are present,
+ * the parity buffer is overwritten with the contents of the missing slot.
+ *
+ * @param[in] defrag     defragmenter
+ * @param[in] seq        sequence number of the sample
+ * @param[in] size       size of the sample
+ * @param[in] gmin       first byte covered by the parity
+ * @param[in] gmaxp1     one past the last byte covered by the parity
+ * @param[in] slotsize   number of bytes in a slot, at least the length of the parity
+ * @param[in,out] parity parity on input, contents of the missing slot on output
+ * @param[out] slotmin   first byte of the reconstructed slot
+ * @param[out] slotmaxp1 one past the last byte of the reconstructed slot
+ * @return true iff the parity was used to reconstruct a slot
+ */
+bool ddsi_defrag_fec_recover (struct ddsi_defrag *defrag, ddsi_seqno_t seq, uint32_t size, uint32_t gmin, uint32_t gmaxp1, uint32_t slotsize, unsigned char *parity, uint32_t *slotmin, uint32_t *slotmaxp1);
+
 /** @component receive_buffers */
 struct ddsi_reorder *ddsi_reorder_new (const struct ddsrt_log_cfg *logcfg, enum ddsi_reorder_mode mode, uint32_t max_samples, bool late_ack_mode);
 
@@ -220,6 +252,20 @@ struct ddsi_dqueue *ddsi_dqueue_new (const char *name, const struct ddsi_domaing
 /** @component receive_buffers */
 bool ddsi_dqueue_start (struct ddsi_dqueue *q);
 
+/** @brief arranges for the delivery thread to be created by the first call to ddsi_dqueue_ensure_started
+    @component receive_buffers */
+void ddsi_dqueue_start_on_demand (struct ddsi_dqueue *q);
+
+/** @brief creates the delivery thread of a queue started on demand if it doesn't exist yet
+
+    Must be called without holding any locks before anything is enqueued, samples
+    enqueued while the thread doesn't exist are dropped.
+
+    @component receive_buffers
+    @param[in] q  the queue
+    @returns false iff the thread doesn't exist and couldn't be created */
+bool ddsi_dqueue_ensure_started (struct ddsi_dqueue *q);
+
 /** @component receive_buffers */
 void ddsi_dqueue_free (struct ddsi_dqueue *q);
 
@@ -248,12 +294,27 @@ void ddsi_dqueue_wait_until_empty_if_full (struct ddsi_dqueue *q);
     @component receive_buffers */
 bool ddsi_dqueue_step_deaf (struct ddsi_dqueue *q);
 
+/**
+ * @brief Delivery queue statistics
+ * @component receive_buffers
+ *
+ * @param[in] q               delivery queue
+ * @param[out] length         number of samples currently queued
+ * @param[out] delivered      number of samples delivered so far
+ * @param[out] wait_time      sum of the times (in ns) the oldest sample in the queue
+ *                            waited for the delivery thread to pick it up
+ * @param[out] max_wait_time  largest such time (in ns)
+ * @param[out] full_waits     number of times a receive thread had to wait for the
+ *                            queue to drain because it was full
+ */
+void ddsi_dqueue_stats (struct ddsi_dqueue *q, uint32_t *length, uint64_t *delivered, uint64_t *wait_time, uint64_t *max_wait_time, uint64_t *full_waits);
+
 
 /** @component receive_buffers */
-void ddsi_defrag_stats (struct ddsi_defrag *defrag, uint64_t *discarded_bytes);
+void ddsi_defrag_stats (struct ddsi_defrag *defrag, uint64_t *discarded_bytes, uint64_t *discarded_samples);
 
 /** @component receive_buffers */
-void ddsi_reorder_stats (struct ddsi_reorder *reorder, uint64_t *discarded_bytes);
+void ddsi_reorder_stats (struct ddsi_reorder *reorder, uint64_t *discarded_bytes, uint64_t *discarded_samples);
 
 #if defined (__cplusplus)
 }
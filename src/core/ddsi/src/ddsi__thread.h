@@ -16,6 +16,7 @@
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds/ddsi/ddsi_thread.h"
 
@@ -31,6 +32,24 @@ typedef int32_t ddsi_svtime_t; /* signed version of ddsi_vtime_t */
 
 #define DDSI_THREAD_STATE_BATCH 32
 
+/* Profiling data for a thread, allocated when the thread is created if profiling is
+   enabled and freed when it is reaped, both with the thread states lock held.  The
+   awake/asleep transitions are recorded by the thread itself, the CPU times are
+   sampled by the thread liveliness monitor. */
+struct ddsi_thread_profile {
+  ddsrt_mtime_t t_awake; /* start of the current awake interval, accessed by the thread only */
+  ddsrt_atomic_uint64_t awake_time; /* total time spent awake (ns) */
+  struct ddsrt_hdrhist *awake_hist; /* durations of the intervals spent awake (ns) */
+#if DDSRT_HAVE_THREAD_LIST
+  ddsrt_atomic_uint32_t have_list_id;
+  ddsrt_thread_list_id_t list_id;
+#endif
+  ddsrt_atomic_uint64_t utime; /* user CPU time (ns) at the last sample */
+  ddsrt_atomic_uint64_t stime; /* system CPU time (ns) at the last sample */
+  ddsrt_mtime_t t_sample; /* time of the last sample, accessed by the monitor only */
+  uint64_t awake_time_sample; /* awake_time at the last sample, accessed by the monitor only */
+};
+
 struct ddsi_thread_states_list {
   struct ddsi_thread_state thrst[DDSI_THREAD_STATE_BATCH];
   struct ddsi_thread_states_list *next;
@@ -46,6 +65,22 @@ dds_return_t ddsi_create_thread_with_properties (struct ddsi_thread_state **thrs
 /** @component thread_support */
 void ddsi_log_stack_traces (const struct ddsrt_log_cfg *logcfg, const struct ddsi_domaingv *gv);
 
+/**
+ * @brief Invoke a callback for each of the internal threads of a domain
+ * @component thread_support
+ *
+ * The callback is invoked while holding the lock protecting the set of threads, and
+ * so must not create or stop threads and should return quickly.
+ *
+ * @param[in] gv   domain
+ * @param[in] cb   callback
+ * @param[in] arg  argument passed to the callback
+ */
+void ddsi_enum_thread_states (const struct ddsi_domaingv *gv, void (*cb) (const struct ddsi_thread_state *thrst, void *arg), void *arg);
+
+/** @component thread_support */
+void ddsi_thread_profile_awake_to_awake (struct ddsi_thread_state *thrst);
+
 /** @component thread_support */
 inline bool ddsi_vtime_gt (ddsi_vtime_t vtime1, ddsi_vtime_t vtime0)
 {
@@ -60,6 +95,8 @@ inline void ddsi_thread_state_awake_domain_ok (struct ddsi_thread_state *thrst)
   assert ((vt & DDSI_VTIME_NEST_MASK) < DDSI_VTIME_NEST_MASK);
   assert (ddsrt_atomic_ldvoidp (&thrst->gv) != NULL);
   ddsi_thread_vtime_trace (thrst);
+  if ((vt & DDSI_VTIME_NEST_MASK) == 0 && thrst->profile)
+    ddsi_thread_profile_awake (thrst);
   ddsrt_atomic_st32 (&thrst->vtime, vt + 1u);
   /* nested calls a rare and an extra fence doesn't break things */
   ddsrt_atomic_fence_acq ();
@@ -80,6 +117,8 @@ inline void ddsi_thread_state_awake_to_awake_no_nest (struct ddsi_thread_state *
   assert ((vt & DDSI_VTIME_NEST_MASK) == 1);
   ddsrt_atomic_fence_rel ();
   ddsi_thread_vtime_trace (thrst);
+  if (thrst->profile)
+    ddsi_thread_profile_awake_to_awake (thrst);
   ddsrt_atomic_st32 (&thrst->vtime, vt + (1u << DDSI_VTIME_TIME_SHIFT));
   ddsrt_atomic_fence_acq ();
 }
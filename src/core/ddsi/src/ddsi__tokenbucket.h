@@ -0,0 +1,72 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef DDSI__TOKENBUCKET_H
+#define DDSI__TOKENBUCKET_H
+
+#include <stdint.h>
+#include "dds/ddsrt/attributes.h"
+#include "dds/ddsrt/time.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_tokenbucket;
+
+/**
+ * @brief Creates a token bucket for shaping traffic to the specified rate
+ * @component traffic_shaping
+ *
+ * Tokens are bytes.  The bucket is allowed to go into debt: a packet is charged
+ * in its entirety once the bucket is no longer in debt, so packets larger than
+ * the bucket depth are paced rather than blocked forever.
+ *
+ * @param[in] rate    rate in bytes/s, must be > 0
+ * @param[in] burst   bucket depth in bytes
+ * @param[in] tnow    current time, the bucket starts out full
+ * @return a new token bucket
+ */
+struct ddsi_tokenbucket *ddsi_tokenbucket_new (uint32_t rate, uint32_t burst, ddsrt_mtime_t tnow)
+  ddsrt_attribute_warn_unused_result;
+
+/** @component traffic_shaping */
+void ddsi_tokenbucket_free (struct ddsi_tokenbucket *tb);
+
+/**
+ * @brief Returns how long to wait before the bucket is no longer in debt
+ * @component traffic_shaping
+ *
+ * @param[in] tb    token bucket
+ * @param[in] tnow  current time
+ * @return 0 if data may be sent immediately, else the time to wait
+ */
+dds_duration_t ddsi_tokenbucket_delay (struct ddsi_tokenbucket *tb, ddsrt_mtime_t tnow);
+
+/**
+ * @brief Charges the bucket for transmitting some data
+ * @component traffic_shaping
+ *
+ * Returns the time the caller must wait before transmitting, which is the time
+ * it takes to pay off the debt that existed prior to charging for this data.
+ * Concurrent callers thus each reserve a slot and get spaced out in time.
+ *
+ * @param[in] tb      token bucket
+ * @param[in] tnow    current time
+ * @param[in] nbytes  number of bytes to charge
+ * @return 0 if data may be sent immediately, else the time to wait
+ */
+dds_duration_t ddsi_tokenbucket_charge (struct ddsi_tokenbucket *tb, ddsrt_mtime_t tnow, uint32_t nbytes);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI__TOKENBUCKET_H */
@@ -20,6 +20,7 @@
 #include "dds/ddsi/ddsi_locator.h"
 #include "dds/ddsi/ddsi_config.h"
 #include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_thread.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -35,6 +36,9 @@ struct ddsi_domaingv;
 /* Flags */
 #define DDSI_TRAN_ON_CONNECT 0x0001
 
+/* Number of copies of the traffic counters of a connection, see ddsi_conn_counters */
+#define DDSI_CONN_COUNTER_STRIPES 8
+
 /* Magic value for port number argument in create_conn and create_listener to indicate
    that a random port number is requested.  Note that 0 also happens to be illegal in UDP
    and TCP and is DDSI_LOCATOR_PORT_INVALID in the DDSI spec.  What a fortunate
@@ -169,6 +173,16 @@ struct ddsi_tran_base
   ddsi_tran_handle_fn_t m_handle_fn;
 };
 
+/* Traffic counters, one set per cache line.  Threads update the set selected by
+   their thread state so that threads sending (or receiving) on the same connection
+   at the same time don't all update the same cache line; reading them adds them
+   all up. */
+struct ddsi_conn_counters {
+  ddsrt_atomic_uint64_t packets;
+  ddsrt_atomic_uint64_t bytes;
+  char pad[DDSI_CACHE_LINE_SIZE - 2 * sizeof (ddsrt_atomic_uint64_t)];
+};
+
 struct ddsi_tran_conn
 {
   struct ddsi_tran_base m_base;
@@ -189,6 +203,11 @@ struct ddsi_tran_conn
   bool m_closed;
   ddsrt_atomic_uint32_t m_count;
 
+  /* Traffic counters: sending may happen from any thread, receiving
+     counted by the receive thread once a complete message is in */
+  struct ddsi_conn_counters m_rx[DDSI_CONN_COUNTER_STRIPES];
+  struct ddsi_conn_counters m_tx[DDSI_CONN_COUNTER_STRIPES];
+
   /* Relationships */
 
   const struct ddsi_network_interface *m_interf;
@@ -387,9 +406,24 @@ inline int ddsi_conn_locator (struct ddsi_tran_conn * conn, ddsi_locator_t * loc
   return conn->m_locator_fn (conn->m_factory, &conn->m_base, loc);
 }
 
+/** @component transport */
+inline void ddsi_conn_counters_add (struct ddsi_conn_counters *cs, size_t sz) {
+  /* Thread states are allocated consecutively, each a multiple of a cache line
+     in size, so consecutive ones map to different sets */
+  const uintptr_t ts = (uintptr_t) ddsi_lookup_thread_state () / sizeof (struct ddsi_thread_state);
+  struct ddsi_conn_counters * const c = &cs[ts % DDSI_CONN_COUNTER_STRIPES];
+  ddsrt_atomic_inc64 (&c->packets);
+  ddsrt_atomic_add64 (&c->bytes, (uint64_t) sz);
+}
+
 /** @component transport */
 inline ssize_t ddsi_conn_write (struct ddsi_tran_conn * conn, const ddsi_locator_t *dst, const ddsi_tran_write_msgfrags_t *msgfrags, uint32_t flags) {
-  return conn->m_closed ? -1 : (conn->m_write_fn) (conn, dst, msgfrags, flags);
+  if (conn->m_closed)
+    return -1;
+  const ssize_t ret = (conn->m_write_fn) (conn, dst, msgfrags, flags);
+  if (ret > 0)
+    ddsi_conn_counters_add (conn->m_tx, (size_t) ret);
+  return ret;
 }
 
 /** @component transport */
@@ -397,6 +431,14 @@ inline ssize_t ddsi_conn_read (struct ddsi_tran_conn * conn, unsigned char * buf
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, pktinfo);
 }
 
+/** @component transport */
+inline void ddsi_conn_count_rx (struct ddsi_tran_conn * conn, size_t sz) {
+  ddsi_conn_counters_add (conn->m_rx, sz);
+}
+
+/** @component transport */
+void ddsi_conn_stats (const struct ddsi_tran_conn * conn, uint64_t *rx_packets, uint64_t *rx_bytes, uint64_t *tx_packets, uint64_t *tx_bytes);
+
 /** @component transport */
 bool ddsi_conn_peer_locator (struct ddsi_tran_conn * conn, ddsi_locator_t * loc);
 
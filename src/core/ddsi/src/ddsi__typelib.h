@@ -103,6 +103,21 @@ bool ddsi_type_resolved_locked (struct ddsi_domaingv *gv, const struct ddsi_type
 /** @component type_system */
 void ddsi_type_free (struct ddsi_type *type);
 
+/**
+ * @brief Returns the type information of a sertype, deserialized once and owned by the sertype
+ * @component type_system
+ *
+ * @param sertype  the sertype
+ * @return the type information, or NULL if the sertype has none
+ */
+const ddsi_typeinfo_t *ddsi_sertype_typeinfo_cached (const struct ddsi_sertype *sertype);
+
+
+/** @component type_system */
+void ddsi_assignability_memo_init (struct ddsi_domaingv *gv);
+
+/** @component type_system */
+void ddsi_assignability_memo_fini (struct ddsi_domaingv *gv);
 
 /** @component type_system */
 bool ddsi_is_assignable_from (struct ddsi_domaingv *gv, const struct ddsi_type_pair *rd_type_pair, uint32_t rd_resolved, const struct ddsi_type_pair *wr_type_pair, uint32_t wr_resolved, const dds_type_consistency_enforcement_qospolicy_t *tce);
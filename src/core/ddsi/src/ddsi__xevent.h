@@ -58,6 +58,20 @@ dds_return_t ddsi_xeventq_start (struct ddsi_xeventq *evq, const char *name); /*
 /** @component timed_events */
 void ddsi_xeventq_stop (struct ddsi_xeventq *evq);
 
+/**
+ * @brief Event queue statistics
+ * @component timed_events
+ *
+ * @param[in] evq                  the event queue
+ * @param[out] nontimed_length     number of queued messages and other non-timed events
+ * @param[out] nontimed_handled    number of non-timed events handled so far
+ * @param[out] timed_handled       number of timed events handled so far
+ * @param[out] timed_lateness      sum of the delays (in ns) between the scheduled time and the
+ *                                 time the timed events actually got handled
+ * @param[out] max_timed_lateness  largest such delay (in ns)
+ */
+void ddsi_xeventq_stats (struct ddsi_xeventq *evq, uint32_t *nontimed_length, uint64_t *nontimed_handled, uint64_t *timed_handled, uint64_t *timed_lateness, uint64_t *max_timed_lateness);
+
 /** @component timed_events */
 void ddsi_qxev_msg (struct ddsi_xeventq *evq, struct ddsi_xmsg *msg);
 
@@ -300,6 +300,33 @@ int64_t ddsi_xpack_maxdelay (const struct ddsi_xpack *xp)
 unsigned ddsi_xpack_packetid (const struct ddsi_xpack *xp)
   ddsrt_nonnull_all;
 
+/** @component rtps_msg */
+int32_t ddsi_xpack_priority (const struct ddsi_xpack *xp)
+  ddsrt_nonnull_all;
+
+/** @component rtps_msg */
+void ddsi_xpack_shaping_init (struct ddsi_domaingv *gv)
+  ddsrt_nonnull_all;
+
+/** @component rtps_msg */
+void ddsi_xpack_shaping_fini (struct ddsi_domaingv *gv)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Removes the packet at the head of the send queue
+ * @component rtps_msg
+ *
+ * The send queue is ordered on priority, and within a priority packets from different
+ * xpacks are interleaved in proportion to their sizes, while those of one xpack stay
+ * in order.  The caller must hold `gv->sendq_lock` and becomes the owner of the
+ * returned packet.
+ *
+ * @param[in] gv  domain
+ * @return the packet to send next, or NULL if the queue is empty
+ */
+struct ddsi_xpack *ddsi_xpack_sendq_dequeue_locked (struct ddsi_domaingv *gv)
+  ddsrt_nonnull_all;
+
 /** @component rtps_msg */
 void ddsi_xpack_sendq_stop (struct ddsi_domaingv *gv)
   ddsrt_nonnull_all;
@@ -308,6 +335,18 @@ void ddsi_xpack_sendq_stop (struct ddsi_domaingv *gv)
 void ddsi_xpack_sendq_fini (struct ddsi_domaingv *gv)
   ddsrt_nonnull_all;
 
+/**
+ * @brief Send queue statistics, all 0 if the send queue hasn't been started
+ * @component rtps_msg
+ *
+ * @param[in] gv        domain
+ * @param[out] length   number of packets currently queued
+ * @param[out] packets  number of packets queued so far
+ * @param[out] blocked  number of times a thread had to wait because the queue was full
+ */
+void ddsi_xpack_sendq_stats (struct ddsi_domaingv *gv, uint32_t *length, uint64_t *packets, uint64_t *blocked)
+  ddsrt_nonnull_all;
+
 #if defined (__cplusplus)
 }
 #endif
@@ -283,6 +283,7 @@ struct ddsi_type {
   ddsi_seqno_t request_seqno;                        /* sequence number of the last type lookup request message */
   struct ddsi_type_proxy_guid_list proxy_guids; /* administration for proxy endpoints (not proxy topics) that are using this type */
   uint32_t refc;                                /* refcount for this record */
+  uint32_t assignability_memo_refc;             /* number of references from the assignability memo */
 };
 
 /* The xt_type member must be at offset 0 so that the type identifier field
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <math.h>
 
+#include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/md5.h"
@@ -167,6 +168,7 @@ DUPF(participantIndex);
 DU(dyn_port);
 DUPF(memsize);
 DUPF(memsize16);
+DUPF(bandwidth);
 DU(duration_inf);
 DU(duration_ms_1hr);
 DU(duration_ms_1s);
@@ -324,6 +326,37 @@ static const struct unit unittab_memsize[] = {
   { NULL, 0 }
 };
 
+/* bandwidths are parsed in bits/s for the benefit of the "b/s" and "bps"
+   units, but stored and printed in bytes/s */
+static const struct unit unittab_bandwidth_bps[] = {
+  { "b/s", 1 }, { "bps", 1 },
+  { "Kib/s", 1024 }, { "Kibps", 1024 },
+  { "kb/s", 1000 }, { "kbps", 1000 },
+  { "Mib/s", 1048576 }, { "Mibps", 1048576 },
+  { "Mb/s", 1000000 }, { "Mbps", 1000000 },
+  { "Gib/s", 1073741824 }, { "Gibps", 1073741824 },
+  { "Gb/s", 1000000000 }, { "Gbps", 1000000000 },
+  { "B/s", 8 }, { "Bps", 8 },
+  { "KiB/s", 8 * 1024 }, { "KiBps", 8 * 1024 },
+  { "kB/s", 8 * 1000 }, { "kBps", 8 * 1000 },
+  { "MiB/s", 8 * 1048576 }, { "MiBps", 8 * 1048576 },
+  { "MB/s", 8 * 1000000 }, { "MBps", 8 * 1000000 },
+  { "GiB/s", 8 * (int64_t) 1073741824 }, { "GiBps", 8 * (int64_t) 1073741824 },
+  { "GB/s", 8 * (int64_t) 1000000000 }, { "GBps", 8 * (int64_t) 1000000000 },
+  { NULL, 0 }
+};
+
+static const struct unit unittab_bandwidth_Bps[] = {
+  { "B/s", 1 },
+  { "KiB/s", 1024 },
+  { "kB/s", 1000 },
+  { "MiB/s", 1048576 },
+  { "MB/s", 1000000 },
+  { "GiB/s", 1073741824 },
+  { "GB/s", 1000000000 },
+  { NULL, 0 }
+};
+
 static void free_configured_elements (struct ddsi_cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem);
 static void free_configured_element (struct ddsi_cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem);
 static const struct cfgelem *lookup_element (const char *target, bool *isattr);
@@ -1149,6 +1182,26 @@ static void pf_memsize16 (struct ddsi_cfgst *cfgst, void *parent, struct cfgelem
   pf_int64_unit (cfgst, (int64_t) *elem, sources, unittab_memsize, "B");
 }
 
+static enum update_result uf_bandwidth (struct ddsi_cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
+{
+  int64_t bandwidth_bps = 0;
+  if (uf_int64_unit (cfgst, &bandwidth_bps, value, unittab_bandwidth_bps, 0, 0, INT64_MAX) != URES_SUCCESS)
+    return URES_ERROR;
+  else if (bandwidth_bps / 8 > UINT32_MAX)
+    return cfg_error (cfgst, "%s: value out of range", value);
+  else {
+    uint32_t * const elem = cfg_address (cfgst, parent, cfgelem);
+    *elem = (uint32_t) (bandwidth_bps / 8);
+    return URES_SUCCESS;
+  }
+}
+
+static void pf_bandwidth (struct ddsi_cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, uint32_t sources)
+{
+  uint32_t const * const elem = cfg_address (cfgst, parent, cfgelem);
+  pf_int64_unit (cfgst, (int64_t) *elem, sources, unittab_bandwidth_Bps, "B/s");
+}
+
 static enum update_result uf_tracingOutputFileName (struct ddsi_cfgst *cfgst, UNUSED_ARG (void *parent), UNUSED_ARG (struct cfgelem const * const cfgelem), UNUSED_ARG (int first), const char *value)
 {
   struct ddsi_config * const cfg = cfgst->cfg;
@@ -2352,6 +2405,7 @@ static struct ddsi_config_network_interface * network_interface_find_or_append(s
   iface->cfg.presence_required = true;
   iface->cfg.priority.isdefault = 1;
   iface->cfg.multicast = DDSI_BOOLDEF_DEFAULT;
+  iface->cfg.max_rate = 0;
 
   *prev_iface = iface;
 
@@ -2754,6 +2808,20 @@ void ddsi_config_free_source_info (struct ddsi_cfgst *cfgst)
   ddsrt_avl_free (&cfgst_found_treedef, &cfgst->found, ddsrt_free);
 }
 
+static void config_fini_tracing (struct ddsi_config *cfg)
+{
+  dds_set_log_file (stderr);
+  dds_set_trace_file (stderr);
+  if (cfg->tracefp && cfg->tracingAsyncWrite)
+    dds_log_async_stop ();
+  if (cfg->tracefp && cfg->tracefp != stdout && cfg->tracefp != stderr) {
+    /* other domains may still be writing asynchronously, and then records
+       for this file can still be in the shared buffer */
+    dds_log_async_flush ();
+    fclose(cfg->tracefp);
+  }
+}
+
 void ddsi_config_fini (struct ddsi_cfgst *cfgst)
 {
   assert (cfgst);
@@ -2761,12 +2829,147 @@ void ddsi_config_fini (struct ddsi_cfgst *cfgst)
   assert (cfgst->cfg->valid);
 
   free_all_elements (cfgst, cfgst->cfg, root_cfgelems);
-  dds_set_log_file (stderr);
-  dds_set_trace_file (stderr);
-  if (cfgst->cfg->tracefp && cfgst->cfg->tracefp != stdout && cfgst->cfg->tracefp != stderr) {
-    fclose(cfgst->cfg->tracefp);
-  }
+  config_fini_tracing (cfgst->cfg);
   memset (cfgst->cfg, 0, sizeof (*cfgst->cfg));
   ddsrt_avl_free (&cfgst_found_treedef, &cfgst->found, ddsrt_free);
   ddsrt_free (cfgst);
 }
+
+struct ddsi_config_compiled {
+  ddsrt_atomic_uint32_t refc;
+  struct ddsi_cfgst *cfgst;
+  /* owned by cfgst, copied by value into each domain that uses it, so that the domain
+     can freely update its copy; the strings &c. it references are shared, and so are
+     the lists except for those the domain modifies (see instantiate) */
+  struct ddsi_config cfg;
+};
+
+struct ddsi_config_compiled *ddsi_config_compile (const char *config, uint32_t domid)
+{
+  struct ddsi_config_compiled *cc = ddsrt_malloc (sizeof (*cc));
+  if ((cc->cfgst = ddsi_config_init (config, &cc->cfg, domid)) == NULL)
+  {
+    ddsrt_free (cc);
+    return NULL;
+  }
+  /* The source information is keyed on the addresses of the configuration objects and
+     therefore useless for the copies in the domains */
+  ddsi_config_free_source_info (cc->cfgst);
+  ddsrt_atomic_st32 (&cc->refc, 1);
+  return cc;
+}
+
+static void config_compiled_unref (struct ddsi_config_compiled *cc)
+{
+  if (ddsrt_atomic_dec32_nv (&cc->refc) == 0)
+  {
+    /* the configuration itself never opens the trace file, the domains do, and so
+       there is no need to touch the log configuration here */
+    assert (cc->cfg.tracefp == NULL);
+    free_all_elements (cc->cfgst, &cc->cfg, root_cfgelems);
+    ddsrt_avl_free (&cfgst_found_treedef, &cc->cfgst->found, ddsrt_free);
+    ddsrt_free (cc->cfgst);
+    ddsrt_free (cc);
+  }
+}
+
+void ddsi_config_compiled_free (struct ddsi_config_compiled *cc)
+{
+  if (cc != NULL)
+    config_compiled_unref (cc);
+}
+
+const struct ddsi_config *ddsi_config_compiled_get (const struct ddsi_config_compiled *cc)
+{
+  return &cc->cfg;
+}
+
+struct ddsi_config_compiled_instance {
+  struct ddsi_config_compiled *cc;
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+  /* the addresses of the network partitions are resolved and stored in the partitions
+     when the domain starts, and so each domain needs its own copy of the partitions
+     and of the mappings that point to them; the strings in them remain shared */
+  struct ddsi_config_networkpartition_listelem *networkPartitions;
+  struct ddsi_config_partitionmapping_listelem *partitionMappings;
+#endif
+};
+
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+static void config_compiled_copy_nwparts (struct ddsi_config_compiled_instance *inst, struct ddsi_config *cfg)
+{
+  struct ddsi_config_networkpartition_listelem **np_tail = &inst->networkPartitions;
+  for (const struct ddsi_config_networkpartition_listelem *np = inst->cc->cfg.networkPartitions; np; np = np->next)
+  {
+    struct ddsi_config_networkpartition_listelem *x = ddsrt_malloc (sizeof (*x));
+    *x = *np;
+    x->next = NULL;
+    assert (np->uc_addresses == NULL && np->asm_addresses == NULL);
+    *np_tail = x;
+    np_tail = &x->next;
+  }
+  struct ddsi_config_partitionmapping_listelem **pm_tail = &inst->partitionMappings;
+  for (const struct ddsi_config_partitionmapping_listelem *pm = inst->cc->cfg.partitionMappings; pm; pm = pm->next)
+  {
+    struct ddsi_config_partitionmapping_listelem *x = ddsrt_malloc (sizeof (*x));
+    *x = *pm;
+    x->next = NULL;
+    /* same position in the copied list as in the original */
+    const struct ddsi_config_networkpartition_listelem *np = inst->cc->cfg.networkPartitions;
+    struct ddsi_config_networkpartition_listelem *npc = inst->networkPartitions;
+    while (np != pm->partition)
+    {
+      np = np->next;
+      npc = npc->next;
+    }
+    x->partition = npc;
+    *pm_tail = x;
+    pm_tail = &x->next;
+  }
+  cfg->networkPartitions = inst->networkPartitions;
+  cfg->partitionMappings = inst->partitionMappings;
+}
+
+static void config_compiled_free_nwparts (struct ddsi_config_compiled_instance *inst)
+{
+  while (inst->partitionMappings)
+  {
+    struct ddsi_config_partitionmapping_listelem *x = inst->partitionMappings;
+    inst->partitionMappings = x->next;
+    ddsrt_free (x);
+  }
+  while (inst->networkPartitions)
+  {
+    struct ddsi_config_networkpartition_listelem *x = inst->networkPartitions;
+    inst->networkPartitions = x->next;
+    /* the addresses are freed when the domain is shut down */
+    assert (x->uc_addresses == NULL && x->asm_addresses == NULL);
+    ddsrt_free (x);
+  }
+}
+#endif
+
+struct ddsi_config_compiled_instance *ddsi_config_compiled_instantiate (struct ddsi_config_compiled *cc, struct ddsi_config *cfg)
+{
+  struct ddsi_config_compiled_instance *inst = ddsrt_malloc (sizeof (*inst));
+  ddsrt_atomic_inc32 (&cc->refc);
+  inst->cc = cc;
+  memcpy (cfg, &cc->cfg, sizeof (*cfg));
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+  inst->networkPartitions = NULL;
+  inst->partitionMappings = NULL;
+  config_compiled_copy_nwparts (inst, cfg);
+#endif
+  return inst;
+}
+
+void ddsi_config_compiled_fini_instance (struct ddsi_config_compiled_instance *inst, struct ddsi_config *cfg)
+{
+  config_fini_tracing (cfg);
+  memset (cfg, 0, sizeof (*cfg));
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+  config_compiled_free_nwparts (inst);
+#endif
+  config_compiled_unref (inst->cc);
+  ddsrt_free (inst);
+}
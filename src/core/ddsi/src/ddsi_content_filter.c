@@ -0,0 +1,1415 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include "dds/features.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/bswap.h"
+#include "dds/ddsrt/strtol.h"
+#include "dds/ddsrt/strtod.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_protocol.h"
+#include "dds/ddsi/ddsi_content_filter.h"
+#include "dds/ddsc/dds_opcodes.h"
+#include "dds/cdr/dds_cdrstream.h"
+#include "ddsi__xt_impl.h"
+#include "ddsi__typewrap.h"
+
+/* A filter expression is compiled into:
+
+   - a table of fields, each with a "path" for XCDR1 and one for XCDR2 that
+     locates the member in the serialized data, relative to the start of the
+     payload (i.e., following the 4-byte encoding header).  The path of a
+     member at a fixed position is a single step, those of members following
+     strings, sequences and the like skip over these at run-time;
+   - a table of terms, each comparing a field with a constant;
+   - a program for a machine with a single boolean register, where AND and OR
+     are conditional jumps, so that evaluation stops as soon as the outcome is
+     known.
+
+   Evaluation therefore only touches the parts of the CDR it needs and never
+   deserializes the sample.
+
+   A filter can also be bound to the memory layout of the samples, as given by
+   the instructions of the (de)serializer.  That way, data in a representation
+   that the CDR paths can't handle can be evaluated after deserializing it,
+   rather than converting it to another representation. */
+
+#define XCDR1_MAX_ALIGN 8
+#define XCDR2_MAX_ALIGN 4
+
+#define CF_XCDR1 0
+#define CF_XCDR2 1
+
+/* Number of field offsets cached during an evaluation, fields beyond this are
+   located anew for each term referencing them */
+#define CF_FIELD_CACHE_SIZE 16
+
+enum cf_step_kind {
+  CF_STEP_ADVANCE,      /* advance by arg bytes */
+  CF_STEP_ALIGN,        /* align to a multiple of arg bytes */
+  CF_STEP_SKIP_STRING,  /* skip a string */
+  CF_STEP_SKIP_SEQ,     /* skip a sequence of primitives of size arg, alignment align */
+  CF_STEP_SKIP_DHEADER  /* skip an object preceded by an XCDR2 DHEADER */
+};
+
+struct cf_step {
+  enum cf_step_kind kind;
+  uint32_t arg;
+  uint32_t align;
+};
+
+struct cf_path {
+  bool supported;   /* false if the member can't be located in this representation */
+  uint32_t nsteps;
+  struct cf_step *steps;
+};
+
+enum cf_field_class {
+  CF_FIELD_SIGNED,
+  CF_FIELD_UNSIGNED,
+  CF_FIELD_FLOAT,
+  CF_FIELD_STRING
+};
+
+struct cf_mstep {
+  uint32_t offset;
+  bool deref;       /* member is stored as a pointer (@external) */
+};
+
+struct cf_mpath {
+  uint32_t nsteps;
+  struct cf_mstep *steps;
+  uint32_t size;    /* size in memory, 0 for strings */
+  bool inline_string; /* bounded string stored as an array of chars */
+};
+
+struct cf_field {
+  char *name;       /* for merging references to the same member */
+  uint32_t size;    /* size of the value, for strings that of the length */
+  enum cf_field_class fclass;
+  struct cf_path path[2];
+  uint32_t nmembers; /* index of the member at each level, a base type is member 0 */
+  uint32_t *members;
+  struct cf_mpath mpath; /* location in a sample in memory, if bound */
+};
+
+enum cf_cmp {
+  CF_CMP_INT,     /* signed field, int64 constant */
+  CF_CMP_UINT,    /* unsigned field, uint64 constant */
+  CF_CMP_DOUBLE,  /* any numerical field, double constant */
+  CF_CMP_STRING,  /* string field, string constant */
+  CF_CMP_LIKE,    /* string field, pattern */
+  CF_CMP_TRUE,    /* outcome is known at compile time */
+  CF_CMP_FALSE
+};
+
+enum cf_op { CF_OP_EQ, CF_OP_NE, CF_OP_LT, CF_OP_LE, CF_OP_GT, CF_OP_GE };
+
+struct cf_term {
+  uint32_t field;
+  enum cf_cmp cmp;
+  enum cf_op op;
+  union { int64_t i; uint64_t u; double d; } value;
+  char *str;        /* for CF_CMP_STRING and CF_CMP_LIKE */
+  uint32_t strlen;
+};
+
+enum cf_opcode {
+  CF_INSN_TERM,     /* reg := term[arg] */
+  CF_INSN_NOT,      /* reg := !reg */
+  CF_INSN_JF,       /* if !reg goto arg */
+  CF_INSN_JT        /* if reg goto arg */
+};
+
+struct cf_insn {
+  enum cf_opcode opcode;
+  uint32_t arg;
+};
+
+struct ddsi_content_filter {
+  uint8_t extensibility; /* DDS_XTypes_IS_FINAL or DDS_XTypes_IS_APPENDABLE */
+  bool supported[2];     /* all fields can be located in XCDR1 resp. XCDR2 */
+  bool bound;            /* all fields can be located in a sample in memory */
+  uint32_t nfields, nterms, ninsns;
+  struct cf_field *fields;
+  struct cf_term *terms;
+  struct cf_insn *insns;
+};
+
+enum cf_literal_kind { CF_LIT_INT, CF_LIT_BIGUINT, CF_LIT_FLOAT, CF_LIT_BOOL, CF_LIT_IDENT, CF_LIT_STRING };
+
+struct cf_literal {
+  enum cf_literal_kind kind;
+  union { int64_t i; uint64_t u; double d; } v;
+  const char *ident;  /* identifier or contents of a string */
+  size_t identlen;
+};
+
+struct cf_parser {
+  const char *p;
+  const struct ddsi_type *type;
+  struct ddsi_content_filter *cf;
+  uint32_t maxfields, maxterms, maxinsns;
+};
+
+struct cf_member_chain {
+  uint32_t n, max;
+  uint32_t *idx;
+};
+
+struct cf_path_builder {
+  uint32_t maxalign;
+  bool fixed;       /* true until a variable-size object has been skipped */
+  uint32_t pos;     /* offset while fixed */
+  uint32_t maxsteps;
+  struct cf_path path;
+};
+
+static const struct ddsi_type *resolve_alias (const struct ddsi_type *t)
+{
+  while (t != NULL && t->xt._d == DDS_XTypes_TK_ALIAS)
+    t = t->xt._u.alias.related_type;
+  return t;
+}
+
+static uint32_t primitive_size (uint8_t kind)
+{
+  switch (kind)
+  {
+    case DDS_XTypes_TK_BOOLEAN: case DDS_XTypes_TK_BYTE: case DDS_XTypes_TK_INT8:
+    case DDS_XTypes_TK_UINT8: case DDS_XTypes_TK_CHAR8:
+      return 1;
+    case DDS_XTypes_TK_INT16: case DDS_XTypes_TK_UINT16: case DDS_XTypes_TK_CHAR16:
+      return 2;
+    case DDS_XTypes_TK_INT32: case DDS_XTypes_TK_UINT32: case DDS_XTypes_TK_FLOAT32:
+      return 4;
+    case DDS_XTypes_TK_INT64: case DDS_XTypes_TK_UINT64: case DDS_XTypes_TK_FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+/* Size of primitives, enums and bitmasks, 0 for anything else */
+static uint32_t scalar_size (const struct ddsi_type *t)
+{
+  switch (t->xt._d)
+  {
+    case DDS_XTypes_TK_ENUM:
+      return (t->xt._u.enum_type.bit_bound > 16) ? 4 : (t->xt._u.enum_type.bit_bound > 8) ? 2 : 1;
+    case DDS_XTypes_TK_BITMASK:
+      return (t->xt._u.bitmask.bit_bound > 32) ? 8 : (t->xt._u.bitmask.bit_bound > 16) ? 4 : (t->xt._u.bitmask.bit_bound > 8) ? 2 : 1;
+    default:
+      return primitive_size (t->xt._d);
+  }
+}
+
+static uint32_t align_offset (uint32_t pos, uint32_t a)
+{
+  return (pos + a - 1) & ~(a - 1);
+}
+
+static void pb_init (struct cf_path_builder *pb, int xcdrv)
+{
+  pb->maxalign = (xcdrv == CF_XCDR1) ? XCDR1_MAX_ALIGN : XCDR2_MAX_ALIGN;
+  pb->fixed = true;
+  pb->pos = 0;
+  pb->maxsteps = 0;
+  pb->path.supported = true;
+  pb->path.nsteps = 0;
+  pb->path.steps = NULL;
+}
+
+static void pb_add (struct cf_path_builder *pb, enum cf_step_kind kind, uint32_t arg, uint32_t align)
+{
+  if (pb->path.nsteps == pb->maxsteps)
+  {
+    pb->maxsteps = pb->maxsteps ? 2 * pb->maxsteps : 4;
+    pb->path.steps = ddsrt_realloc (pb->path.steps, pb->maxsteps * sizeof (*pb->path.steps));
+  }
+  pb->path.steps[pb->path.nsteps++] = (struct cf_step) { .kind = kind, .arg = arg, .align = align };
+}
+
+static void pb_align (struct cf_path_builder *pb, uint32_t size)
+{
+  const uint32_t a = (size < pb->maxalign) ? size : pb->maxalign;
+  if (a <= 1)
+    return;
+  else if (pb->fixed)
+    pb->pos = align_offset (pb->pos, a);
+  else
+    pb_add (pb, CF_STEP_ALIGN, a, 0);
+}
+
+static void pb_advance (struct cf_path_builder *pb, uint32_t n)
+{
+  struct cf_step *last = (pb->path.nsteps > 0) ? &pb->path.steps[pb->path.nsteps - 1] : NULL;
+  if (pb->fixed)
+  {
+    if (n > UINT32_MAX - pb->pos)
+      pb->path.supported = false;
+    else
+      pb->pos += n;
+  }
+  else if (last != NULL && last->kind == CF_STEP_ADVANCE && n <= UINT32_MAX - last->arg)
+    last->arg += n;
+  else
+    pb_add (pb, CF_STEP_ADVANCE, n, 0);
+}
+
+static void pb_skip_variable (struct cf_path_builder *pb, enum cf_step_kind kind, uint32_t arg, uint32_t align)
+{
+  /* Strings, sequences and DHEADERs all start with a 4-byte length */
+  pb_align (pb, 4);
+  if (pb->fixed)
+  {
+    if (pb->pos > 0)
+      pb_add (pb, CF_STEP_ADVANCE, pb->pos, 0);
+    pb->fixed = false;
+  }
+  pb_add (pb, kind, arg, align);
+}
+
+static struct cf_path pb_fini (struct cf_path_builder *pb)
+{
+  /* Fixed offsets are represented as a single ADVANCE */
+  if (pb->fixed && pb->pos > 0)
+    pb_add (pb, CF_STEP_ADVANCE, pb->pos, 0);
+  if (!pb->path.supported)
+  {
+    ddsrt_free (pb->path.steps);
+    pb->path.steps = NULL;
+    pb->path.nsteps = 0;
+  }
+  return pb->path;
+}
+
+static void free_paths (struct cf_path path[2])
+{
+  for (int v = 0; v < 2; v++)
+    ddsrt_free (path[v].steps);
+}
+
+static void push_member (struct cf_member_chain *mc, uint32_t idx)
+{
+  if (mc->n == mc->max)
+  {
+    mc->max = mc->max ? 2 * mc->max : 4;
+    mc->idx = ddsrt_realloc (mc->idx, mc->max * sizeof (*mc->idx));
+  }
+  mc->idx[mc->n++] = idx;
+}
+
+static bool is_struct (const struct ddsi_type *t)
+{
+  return t->xt._d == DDS_XTypes_TK_STRUCTURE && (t->xt._u.structure.flags & (DDS_XTypes_IS_FINAL | DDS_XTypes_IS_APPENDABLE));
+}
+
+static bool has_dheader (const struct ddsi_type *t)
+{
+  /* Types that in XCDR2 are preceded by a DHEADER giving their size */
+  const struct ddsi_type *et;
+  switch (t->xt._d)
+  {
+    case DDS_XTypes_TK_STRUCTURE:
+      return !(t->xt._u.structure.flags & DDS_XTypes_IS_FINAL);
+    case DDS_XTypes_TK_UNION:
+      return !(t->xt._u.union_type.flags & DDS_XTypes_IS_FINAL);
+    case DDS_XTypes_TK_SEQUENCE:
+      et = resolve_alias (t->xt._u.seq.c.element_type);
+      return et != NULL && primitive_size (et->xt._d) == 0;
+    case DDS_XTypes_TK_ARRAY:
+      et = resolve_alias (t->xt._u.array.c.element_type);
+      return et != NULL && primitive_size (et->xt._d) == 0;
+    default:
+      return false;
+  }
+}
+
+static void enter_struct (const struct ddsi_type *t, struct cf_path_builder *pb, int xcdrv)
+{
+  /* XCDR2 appendable types are preceded by a DHEADER, XCDR1 ones aren't */
+  if (xcdrv == CF_XCDR2 && (t->xt._u.structure.flags & DDS_XTypes_IS_APPENDABLE))
+  {
+    pb_align (pb, 4);
+    pb_advance (pb, 4);
+  }
+}
+
+static void skip_member (const struct ddsi_type *t, struct cf_path_builder *pb, int xcdrv);
+
+static void skip_own_members (const struct ddsi_type *t, uint32_t n, struct cf_path_builder *pb, int xcdrv)
+{
+  for (uint32_t i = 0; i < n && pb->path.supported; i++)
+  {
+    const struct xt_struct_member *m = &t->xt._u.structure.members.seq[i];
+    if (m->flags & DDS_XTypes_IS_OPTIONAL)
+      pb->path.supported = false;
+    else
+      skip_member (m->type, pb, xcdrv);
+  }
+}
+
+static void skip_struct_members (const struct ddsi_type *t, struct cf_path_builder *pb, int xcdrv)
+{
+  /* Members of a base type precede those of the derived type, without a DHEADER */
+  const struct ddsi_type *base = resolve_alias (t->xt._u.structure.base_type);
+  if (base != NULL)
+  {
+    if (base->xt._d != DDS_XTypes_TK_STRUCTURE)
+      pb->path.supported = false;
+    else
+      skip_struct_members (base, pb, xcdrv);
+  }
+  skip_own_members (t, t->xt._u.structure.members.length, pb, xcdrv);
+}
+
+/* Advances the path past a member of type t, marking the path as unsupported if
+   it doesn't know how to skip it */
+static void skip_member (const struct ddsi_type *t, struct cf_path_builder *pb, int xcdrv)
+{
+  uint32_t sz;
+  if ((t = resolve_alias (t)) == NULL)
+  {
+    pb->path.supported = false;
+  }
+  else if ((sz = scalar_size (t)) > 0)
+  {
+    pb_align (pb, sz);
+    pb_advance (pb, sz);
+  }
+  else if (xcdrv == CF_XCDR2 && has_dheader (t))
+  {
+    pb_skip_variable (pb, CF_STEP_SKIP_DHEADER, 0, 0);
+  }
+  else if (t->xt._d == DDS_XTypes_TK_STRING8)
+  {
+    pb_skip_variable (pb, CF_STEP_SKIP_STRING, 0, 0);
+  }
+  else if (t->xt._d == DDS_XTypes_TK_SEQUENCE)
+  {
+    const struct ddsi_type *et = resolve_alias (t->xt._u.seq.c.element_type);
+    if (et == NULL || (sz = primitive_size (et->xt._d)) == 0)
+      pb->path.supported = false;
+    else
+      pb_skip_variable (pb, CF_STEP_SKIP_SEQ, sz, (sz < pb->maxalign) ? sz : pb->maxalign);
+  }
+  else if (t->xt._d == DDS_XTypes_TK_ARRAY)
+  {
+    const struct ddsi_type *et = resolve_alias (t->xt._u.array.c.element_type);
+    uint32_t n = 1;
+    if (et == NULL || (sz = primitive_size (et->xt._d)) == 0)
+    {
+      pb->path.supported = false;
+      return;
+    }
+    for (uint32_t i = 0; i < t->xt._u.array.bounds._length; i++)
+    {
+      if (t->xt._u.array.bounds._buffer[i] > UINT32_MAX / n)
+      {
+        pb->path.supported = false;
+        return;
+      }
+      n *= t->xt._u.array.bounds._buffer[i];
+    }
+    if (n > UINT32_MAX / sz)
+    {
+      pb->path.supported = false;
+      return;
+    }
+    pb_align (pb, sz);
+    pb_advance (pb, n * sz);
+  }
+  else if (is_struct (t))
+  {
+    enter_struct (t, pb, xcdrv);
+    skip_struct_members (t, pb, xcdrv);
+  }
+  else
+  {
+    pb->path.supported = false;
+  }
+}
+
+static bool name_matches (const struct ddsi_type *t, const struct xt_member_detail *detail, const char *name)
+{
+  if (t->xt.kind == DDSI_TYPEID_KIND_COMPLETE)
+    return strcmp (detail->name, name) == 0;
+  else
+  {
+    DDS_XTypes_NameHash h;
+    ddsi_xt_get_namehash (h, name);
+    return memcmp (h, detail->name_hash, sizeof (h)) == 0;
+  }
+}
+
+/* Looks up a member by name, including those of base types, and advances the
+   paths to the start of that member and appends its index to the chain; if it
+   is not found, the paths have been advanced past all members of t */
+static const struct xt_struct_member *find_member (const struct ddsi_type *t, const char *name, struct cf_path_builder pb[2], struct cf_member_chain *mc)
+{
+  const struct ddsi_type *base = resolve_alias (t->xt._u.structure.base_type);
+  const struct xt_struct_member_seq *ms = &t->xt._u.structure.members;
+  const struct xt_struct_member *m;
+  if (base != NULL)
+  {
+    if (base->xt._d != DDS_XTypes_TK_STRUCTURE)
+      return NULL;
+    push_member (mc, 0);
+    if ((m = find_member (base, name, pb, mc)) != NULL)
+      return m;
+    mc->n--;
+  }
+  uint32_t i;
+  for (i = 0; i < ms->length; i++)
+    if (name_matches (t, &ms->seq[i].detail, name))
+      break;
+  for (int v = 0; v < 2; v++)
+    skip_own_members (t, i, &pb[v], v);
+  if (i == ms->length)
+    return NULL;
+  push_member (mc, (base != NULL) ? i + 1 : i);
+  return &ms->seq[i];
+}
+
+static const char *skip_ws (const char *p)
+{
+  while (isspace ((unsigned char) *p))
+    p++;
+  return p;
+}
+
+static size_t ident_len (const char *p)
+{
+  size_t n = 0;
+  if (isalpha ((unsigned char) p[0]) || p[0] == '_')
+    while (isalnum ((unsigned char) p[n]) || p[n] == '_')
+      n++;
+  return n;
+}
+
+static bool keyword_matches (const char *p, size_t n, const char *kw)
+{
+  return strlen (kw) == n && ddsrt_strncasecmp (p, kw, n) == 0;
+}
+
+static bool is_keyword (const char *p, size_t n)
+{
+  static const char *kws[] = { "AND", "OR", "NOT", "BETWEEN", "LIKE", "TRUE", "FALSE" };
+  for (size_t i = 0; i < sizeof (kws) / sizeof (kws[0]); i++)
+    if (keyword_matches (p, n, kws[i]))
+      return true;
+  return false;
+}
+
+static bool accept_keyword (struct cf_parser *ps, const char *kw)
+{
+  const size_t n = ident_len (ps->p);
+  if (!keyword_matches (ps->p, n, kw))
+    return false;
+  ps->p = skip_ws (ps->p + n);
+  return true;
+}
+
+static dds_return_t classify_field (struct cf_field *f, const struct ddsi_type *t)
+{
+  if (t->xt._d == DDS_XTypes_TK_STRING8)
+  {
+    f->size = 4;
+    f->fclass = CF_FIELD_STRING;
+    return DDS_RETCODE_OK;
+  }
+  if ((f->size = scalar_size (t)) == 0 || t->xt._d == DDS_XTypes_TK_CHAR16)
+    return DDS_RETCODE_BAD_PARAMETER;
+  switch (t->xt._d)
+  {
+    case DDS_XTypes_TK_INT8: case DDS_XTypes_TK_INT16: case DDS_XTypes_TK_INT32: case DDS_XTypes_TK_INT64:
+      f->fclass = CF_FIELD_SIGNED;
+      break;
+    case DDS_XTypes_TK_ENUM:
+      f->fclass = (f->size == 4) ? CF_FIELD_SIGNED : CF_FIELD_UNSIGNED;
+      break;
+    case DDS_XTypes_TK_FLOAT32: case DDS_XTypes_TK_FLOAT64:
+      f->fclass = CF_FIELD_FLOAT;
+      break;
+    default:
+      f->fclass = CF_FIELD_UNSIGNED;
+      break;
+  }
+  return DDS_RETCODE_OK;
+}
+
+static uint32_t intern_field (struct cf_parser *ps, const char *name, size_t namelen, struct cf_field *f)
+{
+  /* Multiple references to the same member share the field, and hence the cached
+     offset during evaluation */
+  struct ddsi_content_filter * const cf = ps->cf;
+  for (uint32_t i = 0; i < cf->nfields; i++)
+  {
+    if (strlen (cf->fields[i].name) == namelen && memcmp (cf->fields[i].name, name, namelen) == 0)
+    {
+      free_paths (f->path);
+      ddsrt_free (f->members);
+      return i;
+    }
+  }
+  if (cf->nfields == ps->maxfields)
+  {
+    ps->maxfields = ps->maxfields ? 2 * ps->maxfields : 4;
+    cf->fields = ddsrt_realloc (cf->fields, ps->maxfields * sizeof (*cf->fields));
+  }
+  f->name = ddsrt_strndup (name, namelen);
+  cf->fields[cf->nfields] = *f;
+  return cf->nfields++;
+}
+
+static dds_return_t parse_field (struct cf_parser *ps, uint32_t *field, const struct ddsi_type **ftype)
+{
+  const char *p = ps->p;
+  const struct ddsi_type *t = ps->type;
+  struct cf_path_builder pb[2];
+  struct cf_member_chain mc = { 0, 0, NULL };
+  struct cf_field f;
+  for (int v = 0; v < 2; v++)
+  {
+    pb_init (&pb[v], v);
+    enter_struct (t, &pb[v], v);
+  }
+  while (true)
+  {
+    char name[sizeof (DDS_XTypes_MemberName)];
+    const struct xt_struct_member *m;
+    const size_t n = ident_len (p);
+    if (n == 0 || n >= sizeof (name) || is_keyword (p, n))
+      goto err;
+    memcpy (name, p, n);
+    name[n] = 0;
+    p += n;
+    if ((m = find_member (t, name, pb, &mc)) == NULL || (m->flags & DDS_XTypes_IS_OPTIONAL))
+      goto err;
+    if ((t = resolve_alias (m->type)) == NULL)
+      goto err;
+    if (*p != '.')
+      break;
+    p++;
+    if (!is_struct (t))
+      goto err;
+    for (int v = 0; v < 2; v++)
+      enter_struct (t, &pb[v], v);
+  }
+  if (classify_field (&f, t) != DDS_RETCODE_OK)
+    goto err;
+  for (int v = 0; v < 2; v++)
+  {
+    pb_align (&pb[v], f.size);
+    f.path[v] = pb_fini (&pb[v]);
+  }
+  if (!f.path[CF_XCDR1].supported && !f.path[CF_XCDR2].supported)
+  {
+    free_paths (f.path);
+    ddsrt_free (mc.idx);
+    return DDS_RETCODE_BAD_PARAMETER;
+  }
+  f.nmembers = mc.n;
+  f.members = mc.idx;
+  f.mpath = (struct cf_mpath) { 0, NULL, 0, false };
+  *field = intern_field (ps, ps->p, (size_t) (p - ps->p), &f);
+  *ftype = t;
+  ps->p = skip_ws (p);
+  return DDS_RETCODE_OK;
+
+err:
+  for (int v = 0; v < 2; v++)
+    ddsrt_free (pb[v].path.steps);
+  ddsrt_free (mc.idx);
+  return DDS_RETCODE_BAD_PARAMETER;
+}
+
+static dds_return_t parse_op (struct cf_parser *ps, enum cf_op *op)
+{
+  static const struct { const char *s; enum cf_op op; } ops[] = {
+    { "<>", CF_OP_NE }, { "!=", CF_OP_NE }, { "<=", CF_OP_LE }, { ">=", CF_OP_GE },
+    { "=", CF_OP_EQ }, { "<", CF_OP_LT }, { ">", CF_OP_GT }
+  };
+  for (size_t i = 0; i < sizeof (ops) / sizeof (ops[0]); i++)
+  {
+    const size_t n = strlen (ops[i].s);
+    if (strncmp (ps->p, ops[i].s, n) == 0)
+    {
+      *op = ops[i].op;
+      ps->p = skip_ws (ps->p + n);
+      return DDS_RETCODE_OK;
+    }
+  }
+  return DDS_RETCODE_BAD_PARAMETER;
+}
+
+static dds_return_t parse_literal (struct cf_parser *ps, struct cf_literal *lit)
+{
+  const char *p = ps->p;
+  size_t n;
+  if (*p == '\'')
+  {
+    /* Strings are enclosed in single quotes and can't contain a single quote */
+    const char *e = strchr (p + 1, '\'');
+    if (e == NULL)
+      return DDS_RETCODE_BAD_PARAMETER;
+    lit->kind = CF_LIT_STRING;
+    lit->ident = p + 1;
+    lit->identlen = (size_t) (e - (p + 1));
+    ps->p = skip_ws (e + 1);
+    return DDS_RETCODE_OK;
+  }
+  else if ((n = ident_len (p)) > 0)
+  {
+    if (keyword_matches (p, n, "TRUE") || keyword_matches (p, n, "FALSE"))
+    {
+      lit->kind = CF_LIT_BOOL;
+      lit->v.u = (n == 4);
+    }
+    else if (is_keyword (p, n))
+    {
+      return DDS_RETCODE_BAD_PARAMETER;
+    }
+    else
+    {
+      lit->kind = CF_LIT_IDENT;
+      lit->ident = p;
+      lit->identlen = n;
+    }
+    ps->p = skip_ws (p + n);
+    return DDS_RETCODE_OK;
+  }
+
+  /* Numbers: decimal or hexadecimal integers, or floating-point numbers (never octal) */
+  const char *q = p;
+  if (*q == '-' || *q == '+')
+    q++;
+  const bool hex = (q[0] == '0' && (q[1] == 'x' || q[1] == 'X'));
+  const char *e = q + (hex ? 2 : 0);
+  while (hex ? isxdigit ((unsigned char) *e) : isdigit ((unsigned char) *e))
+    e++;
+  if (e == q)
+    return DDS_RETCODE_BAD_PARAMETER;
+  char *end;
+  if (!hex && (*e == '.' || *e == 'e' || *e == 'E'))
+  {
+    lit->kind = CF_LIT_FLOAT;
+    if (ddsrt_strtod (p, &end, &lit->v.d) != DDS_RETCODE_OK)
+      return DDS_RETCODE_BAD_PARAMETER;
+  }
+  else
+  {
+    long long ll;
+    unsigned long long ull;
+    const int32_t base = hex ? 16 : 10;
+    if (ddsrt_strtoll (p, &end, base, &ll) == DDS_RETCODE_OK)
+    {
+      lit->kind = CF_LIT_INT;
+      lit->v.i = ll;
+    }
+    else if (*p != '-' && ddsrt_strtoull (p, &end, base, &ull) == DDS_RETCODE_OK)
+    {
+      lit->kind = CF_LIT_BIGUINT;
+      lit->v.u = ull;
+    }
+    else
+    {
+      return DDS_RETCODE_BAD_PARAMETER;
+    }
+  }
+  if (isalnum ((unsigned char) *end) || *end == '_' || *end == '.')
+    return DDS_RETCODE_BAD_PARAMETER;
+  ps->p = skip_ws (end);
+  return DDS_RETCODE_OK;
+}
+
+static bool apply_op (enum cf_op op, int c)
+{
+  switch (op)
+  {
+    case CF_OP_EQ: return c == 0;
+    case CF_OP_NE: return c != 0;
+    case CF_OP_LT: return c < 0;
+    case CF_OP_LE: return c <= 0;
+    case CF_OP_GT: return c > 0;
+    case CF_OP_GE: return c >= 0;
+  }
+  return false;
+}
+
+static void fold_term (struct cf_term *term, int c)
+{
+  term->cmp = apply_op (term->op, c) ? CF_CMP_TRUE : CF_CMP_FALSE;
+}
+
+static dds_return_t bind_literal (struct cf_term *term, const struct cf_field *field, const struct ddsi_type *ftype, struct cf_literal *lit)
+{
+  if (field->fclass == CF_FIELD_STRING)
+  {
+    if (lit->kind != CF_LIT_STRING)
+      return DDS_RETCODE_BAD_PARAMETER;
+    term->cmp = CF_CMP_STRING;
+    term->str = ddsrt_strndup (lit->ident, lit->identlen);
+    term->strlen = (uint32_t) lit->identlen;
+    return DDS_RETCODE_OK;
+  }
+
+  if (lit->kind == CF_LIT_IDENT || (lit->kind == CF_LIT_STRING && ftype->xt._d == DDS_XTypes_TK_ENUM))
+  {
+    /* Enumerators only make sense for enum-typed members */
+    char name[sizeof (DDS_XTypes_MemberName)];
+    if (ftype->xt._d != DDS_XTypes_TK_ENUM || lit->identlen >= sizeof (name))
+      return DDS_RETCODE_BAD_PARAMETER;
+    memcpy (name, lit->ident, lit->identlen);
+    name[lit->identlen] = 0;
+    const struct xt_enum_literal_seq *ls = &ftype->xt._u.enum_type.literals;
+    uint32_t i;
+    for (i = 0; i < ls->length; i++)
+      if (name_matches (ftype, &ls->seq[i].detail, name))
+        break;
+    if (i == ls->length)
+      return DDS_RETCODE_BAD_PARAMETER;
+    lit->kind = CF_LIT_INT;
+    lit->v.i = ls->seq[i].value;
+  }
+  else if (lit->kind == CF_LIT_STRING)
+  {
+    /* A single character can be compared with a char */
+    if (ftype->xt._d != DDS_XTypes_TK_CHAR8 || lit->identlen != 1)
+      return DDS_RETCODE_BAD_PARAMETER;
+    lit->kind = CF_LIT_INT;
+    lit->v.i = (unsigned char) lit->ident[0];
+  }
+  else if (lit->kind == CF_LIT_BOOL && ftype->xt._d != DDS_XTypes_TK_BOOLEAN)
+  {
+    return DDS_RETCODE_BAD_PARAMETER;
+  }
+
+  switch (lit->kind)
+  {
+    case CF_LIT_FLOAT:
+      term->cmp = CF_CMP_DOUBLE;
+      term->value.d = lit->v.d;
+      break;
+    case CF_LIT_BOOL:
+      term->cmp = CF_CMP_UINT;
+      term->value.u = lit->v.u;
+      break;
+    case CF_LIT_INT:
+      if (field->fclass == CF_FIELD_FLOAT) {
+        term->cmp = CF_CMP_DOUBLE;
+        term->value.d = (double) lit->v.i;
+      } else if (field->fclass == CF_FIELD_SIGNED) {
+        term->cmp = CF_CMP_INT;
+        term->value.i = lit->v.i;
+      } else if (lit->v.i < 0) {
+        fold_term (term, 1);
+      } else {
+        term->cmp = CF_CMP_UINT;
+        term->value.u = (uint64_t) lit->v.i;
+      }
+      break;
+    case CF_LIT_BIGUINT:
+      if (field->fclass == CF_FIELD_FLOAT) {
+        term->cmp = CF_CMP_DOUBLE;
+        term->value.d = (double) lit->v.u;
+      } else if (field->fclass == CF_FIELD_SIGNED) {
+        fold_term (term, -1);
+      } else {
+        term->cmp = CF_CMP_UINT;
+        term->value.u = lit->v.u;
+      }
+      break;
+    case CF_LIT_IDENT:
+    case CF_LIT_STRING:
+      assert (0);
+      return DDS_RETCODE_BAD_PARAMETER;
+  }
+  return DDS_RETCODE_OK;
+}
+
+static uint32_t emit (struct cf_parser *ps, enum cf_opcode opcode, uint32_t arg)
+{
+  struct ddsi_content_filter * const cf = ps->cf;
+  if (cf->ninsns == ps->maxinsns)
+  {
+    ps->maxinsns = ps->maxinsns ? 2 * ps->maxinsns : 8;
+    cf->insns = ddsrt_realloc (cf->insns, ps->maxinsns * sizeof (*cf->insns));
+  }
+  cf->insns[cf->ninsns] = (struct cf_insn) { .opcode = opcode, .arg = arg };
+  return cf->ninsns++;
+}
+
+static void emit_term (struct cf_parser *ps, const struct cf_term *term)
+{
+  struct ddsi_content_filter * const cf = ps->cf;
+  if (cf->nterms == ps->maxterms)
+  {
+    ps->maxterms = ps->maxterms ? 2 * ps->maxterms : 4;
+    cf->terms = ddsrt_realloc (cf->terms, ps->maxterms * sizeof (*cf->terms));
+  }
+  cf->terms[cf->nterms] = *term;
+  emit (ps, CF_INSN_TERM, cf->nterms++);
+}
+
+static dds_return_t parse_comparison_rhs (struct cf_parser *ps, uint32_t field, const struct ddsi_type *ftype, enum cf_op op)
+{
+  struct cf_term term;
+  struct cf_literal lit;
+  dds_return_t ret;
+  memset (&term, 0, sizeof (term));
+  term.field = field;
+  term.op = op;
+  if ((ret = parse_literal (ps, &lit)) != DDS_RETCODE_OK)
+    return ret;
+  if ((ret = bind_literal (&term, &ps->cf->fields[field], ftype, &lit)) != DDS_RETCODE_OK)
+    return ret;
+  emit_term (ps, &term);
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t parse_like_rhs (struct cf_parser *ps, uint32_t field)
+{
+  struct cf_term term;
+  struct cf_literal lit;
+  dds_return_t ret;
+  if (ps->cf->fields[field].fclass != CF_FIELD_STRING)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if ((ret = parse_literal (ps, &lit)) != DDS_RETCODE_OK)
+    return ret;
+  if (lit.kind != CF_LIT_STRING)
+    return DDS_RETCODE_BAD_PARAMETER;
+  memset (&term, 0, sizeof (term));
+  term.field = field;
+  term.cmp = CF_CMP_LIKE;
+  term.str = ddsrt_strndup (lit.ident, lit.identlen);
+  term.strlen = (uint32_t) lit.identlen;
+  emit_term (ps, &term);
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t parse_or (struct cf_parser *ps);
+
+static dds_return_t parse_predicate (struct cf_parser *ps)
+{
+  uint32_t field;
+  const struct ddsi_type *ftype;
+  enum cf_op op;
+  dds_return_t ret;
+  if ((ret = parse_field (ps, &field, &ftype)) != DDS_RETCODE_OK)
+    return ret;
+  const bool negate = accept_keyword (ps, "NOT");
+  if (accept_keyword (ps, "BETWEEN"))
+  {
+    /* x BETWEEN a AND b is x >= a AND x <= b */
+    if ((ret = parse_comparison_rhs (ps, field, ftype, CF_OP_GE)) != DDS_RETCODE_OK)
+      return ret;
+    if (!accept_keyword (ps, "AND"))
+      return DDS_RETCODE_BAD_PARAMETER;
+    const uint32_t jf = emit (ps, CF_INSN_JF, 0);
+    if ((ret = parse_comparison_rhs (ps, field, ftype, CF_OP_LE)) != DDS_RETCODE_OK)
+      return ret;
+    ps->cf->insns[jf].arg = ps->cf->ninsns;
+  }
+  else if (accept_keyword (ps, "LIKE"))
+  {
+    if ((ret = parse_like_rhs (ps, field)) != DDS_RETCODE_OK)
+      return ret;
+  }
+  else if (negate)
+  {
+    return DDS_RETCODE_BAD_PARAMETER;
+  }
+  else
+  {
+    if ((ret = parse_op (ps, &op)) != DDS_RETCODE_OK)
+      return ret;
+    return parse_comparison_rhs (ps, field, ftype, op);
+  }
+  if (negate)
+    emit (ps, CF_INSN_NOT, 0);
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t parse_unary (struct cf_parser *ps)
+{
+  dds_return_t ret;
+  if (accept_keyword (ps, "NOT"))
+  {
+    if ((ret = parse_unary (ps)) != DDS_RETCODE_OK)
+      return ret;
+    emit (ps, CF_INSN_NOT, 0);
+    return DDS_RETCODE_OK;
+  }
+  else if (*ps->p == '(')
+  {
+    ps->p = skip_ws (ps->p + 1);
+    if ((ret = parse_or (ps)) != DDS_RETCODE_OK)
+      return ret;
+    if (*ps->p != ')')
+      return DDS_RETCODE_BAD_PARAMETER;
+    ps->p = skip_ws (ps->p + 1);
+    return DDS_RETCODE_OK;
+  }
+  else
+  {
+    return parse_predicate (ps);
+  }
+}
+
+static dds_return_t parse_and (struct cf_parser *ps)
+{
+  dds_return_t ret;
+  if ((ret = parse_unary (ps)) != DDS_RETCODE_OK)
+    return ret;
+  while (accept_keyword (ps, "AND"))
+  {
+    const uint32_t jf = emit (ps, CF_INSN_JF, 0);
+    if ((ret = parse_unary (ps)) != DDS_RETCODE_OK)
+      return ret;
+    ps->cf->insns[jf].arg = ps->cf->ninsns;
+  }
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t parse_or (struct cf_parser *ps)
+{
+  dds_return_t ret;
+  if ((ret = parse_and (ps)) != DDS_RETCODE_OK)
+    return ret;
+  while (accept_keyword (ps, "OR"))
+  {
+    const uint32_t jt = emit (ps, CF_INSN_JT, 0);
+    if ((ret = parse_and (ps)) != DDS_RETCODE_OK)
+      return ret;
+    ps->cf->insns[jt].arg = ps->cf->ninsns;
+  }
+  return DDS_RETCODE_OK;
+}
+
+static dds_return_t compile_locked (struct ddsi_content_filter *cf, const struct ddsi_type *type, const char *expression)
+{
+  struct cf_parser ps = { .p = skip_ws (expression), .cf = cf };
+  dds_return_t ret;
+
+  if ((type = resolve_alias (type)) == NULL || !is_struct (type))
+    return DDS_RETCODE_BAD_PARAMETER;
+  ps.type = type;
+  cf->extensibility = (type->xt._u.structure.flags & DDS_XTypes_IS_FINAL) ? DDS_XTypes_IS_FINAL : DDS_XTypes_IS_APPENDABLE;
+  if ((ret = parse_or (&ps)) != DDS_RETCODE_OK)
+    return ret;
+  if (*ps.p != 0)
+    return DDS_RETCODE_BAD_PARAMETER;
+  for (int v = 0; v < 2; v++)
+  {
+    cf->supported[v] = true;
+    for (uint32_t i = 0; i < cf->nfields; i++)
+      cf->supported[v] = cf->supported[v] && cf->fields[i].path[v].supported;
+  }
+  /* Fields that can only be located in one representation combined with
+     fields that can only be located in the other make it impossible to
+     evaluate the filter */
+  return (cf->supported[CF_XCDR1] || cf->supported[CF_XCDR2]) ? DDS_RETCODE_OK : DDS_RETCODE_BAD_PARAMETER;
+}
+
+dds_return_t ddsi_content_filter_compile (struct ddsi_content_filter **cf, struct ddsi_domaingv *gv, const struct ddsi_type *type, const char *expression)
+{
+  struct ddsi_content_filter *f = ddsrt_calloc (1, sizeof (*f));
+  dds_return_t ret;
+  ddsrt_mutex_lock (&gv->typelib_lock);
+  ret = compile_locked (f, type, expression);
+  ddsrt_mutex_unlock (&gv->typelib_lock);
+  if (ret != DDS_RETCODE_OK)
+  {
+    ddsi_content_filter_free (f);
+    return ret;
+  }
+  *cf = f;
+  return DDS_RETCODE_OK;
+}
+
+void ddsi_content_filter_free (struct ddsi_content_filter *cf)
+{
+  if (cf == NULL)
+    return;
+  for (uint32_t i = 0; i < cf->nfields; i++)
+  {
+    ddsrt_free (cf->fields[i].name);
+    free_paths (cf->fields[i].path);
+    ddsrt_free (cf->fields[i].members);
+    ddsrt_free (cf->fields[i].mpath.steps);
+  }
+  for (uint32_t i = 0; i < cf->nterms; i++)
+    ddsrt_free (cf->terms[i].str);
+  ddsrt_free (cf->fields);
+  ddsrt_free (cf->terms);
+  ddsrt_free (cf->insns);
+  ddsrt_free (cf);
+}
+
+static bool bind_field (struct cf_field *f, const uint32_t *ops)
+{
+  struct cf_mpath * const mp = &f->mpath;
+  const uint32_t *adr = NULL;
+  mp->steps = ddsrt_malloc (f->nmembers * sizeof (*mp->steps));
+  for (mp->nsteps = 0; mp->nsteps < f->nmembers; mp->nsteps++)
+  {
+    if (adr != NULL)
+    {
+      /* only nested structs (and base types) get here */
+      if (DDS_OP_TYPE (adr[0]) != DDS_OP_VAL_EXT)
+        return false;
+      ops = adr + DDS_OP_ADR_JSR (adr[2]);
+    }
+    if ((adr = dds_stream_member_op (ops, f->members[mp->nsteps])) == NULL || (DDS_OP_FLAGS (adr[0]) & DDS_OP_FLAG_OPT))
+      return false;
+    mp->steps[mp->nsteps] = (struct cf_mstep) { .offset = adr[1], .deref = (DDS_OP_TYPE_FLAGS (adr[0]) & DDS_OP_FLAG_EXT) != 0 };
+  }
+  if (adr == NULL)
+    return false;
+  switch (DDS_OP_TYPE (adr[0]))
+  {
+    case DDS_OP_VAL_STR: case DDS_OP_VAL_BST:
+      mp->size = 0;
+      mp->inline_string = (DDS_OP_TYPE (adr[0]) == DDS_OP_VAL_BST);
+      return f->fclass == CF_FIELD_STRING;
+    case DDS_OP_VAL_BLN: case DDS_OP_VAL_1BY: mp->size = 1; break;
+    case DDS_OP_VAL_2BY: mp->size = 2; break;
+    case DDS_OP_VAL_4BY: mp->size = 4; break;
+    case DDS_OP_VAL_8BY: mp->size = 8; break;
+    case DDS_OP_VAL_BMK: mp->size = DDS_OP_TYPE_SZ (adr[0]); break;
+    case DDS_OP_VAL_ENU:
+      /* enums are stored as 32-bit integers regardless of their bit bound */
+      mp->size = 4;
+      return f->fclass != CF_FIELD_STRING;
+    default:
+      return false;
+  }
+  return f->fclass != CF_FIELD_STRING && mp->size == f->size;
+}
+
+bool ddsi_content_filter_bind_sample_layout (struct ddsi_content_filter *cf, const uint32_t *ops)
+{
+  assert (!cf->bound);
+  cf->bound = true;
+  for (uint32_t i = 0; i < cf->nfields && cf->bound; i++)
+    cf->bound = bind_field (&cf->fields[i], ops);
+  return cf->bound;
+}
+
+struct cf_payload {
+  const unsigned char *data;
+  uint32_t size;
+  bool bswap;
+  const char *sample; /* sample in memory instead of serialized data, if not NULL */
+};
+
+static bool read_u32 (const struct cf_payload *pl, uint32_t pos, uint32_t *v)
+{
+  if (pl->size - pos < 4)
+    return false;
+  memcpy (v, pl->data + pos, 4);
+  if (pl->bswap)
+    *v = ddsrt_bswap4u (*v);
+  return true;
+}
+
+/* Computes the offset of a field in the payload, false if it lies outside it;
+   the position never exceeds the size of the payload */
+static bool locate_field (const struct cf_field *field, const struct cf_payload *pl, int xcdrv, uint32_t *off)
+{
+  const struct cf_path *path = &field->path[xcdrv];
+  uint32_t pos = 0, n;
+  for (uint32_t i = 0; i < path->nsteps; i++)
+  {
+    const struct cf_step *s = &path->steps[i];
+    switch (s->kind)
+    {
+      case CF_STEP_ADVANCE:
+        if (s->arg > pl->size - pos)
+          return false;
+        pos += s->arg;
+        break;
+      case CF_STEP_ALIGN:
+        if ((pos = align_offset (pos, s->arg)) > pl->size)
+          return false;
+        break;
+      case CF_STEP_SKIP_STRING:
+      case CF_STEP_SKIP_DHEADER:
+        if (!read_u32 (pl, pos, &n) || n > pl->size - pos - 4)
+          return false;
+        pos += 4 + n;
+        break;
+      case CF_STEP_SKIP_SEQ:
+        if (!read_u32 (pl, pos, &n))
+          return false;
+        pos += 4;
+        if (n > 0)
+        {
+          /* empty sequences are not followed by padding */
+          if ((pos = align_offset (pos, s->align)) > pl->size || n > (pl->size - pos) / s->arg)
+            return false;
+          pos += n * s->arg;
+        }
+        break;
+    }
+  }
+  if (field->size > pl->size - pos)
+    return false;
+  *off = pos;
+  return true;
+}
+
+static bool like (const char *s, const char *s_end, const char *p, const char *p_end)
+{
+  /* "%" matches any sequence of characters, "_" any single character; on a
+     mismatch, retry from the most recent "%" consuming one more character */
+  const char *star_p = NULL, *star_s = NULL;
+  while (s < s_end)
+  {
+    if (p < p_end && *p == '%')
+    {
+      star_p = ++p;
+      star_s = s;
+    }
+    else if (p < p_end && (*p == '_' || *p == *s))
+    {
+      p++;
+      s++;
+    }
+    else if (star_p != NULL)
+    {
+      p = star_p;
+      s = ++star_s;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  while (p < p_end && *p == '%')
+    p++;
+  return p == p_end;
+}
+
+enum cf_term_result { CF_TERM_FALSE, CF_TERM_TRUE, CF_TERM_UNKNOWN };
+
+static bool compare_string (const struct cf_term *term, const char *s, uint32_t len)
+{
+  if (term->cmp == CF_CMP_LIKE)
+    return like (s, s + len, term->str, term->str + term->strlen);
+  const int c = memcmp (s, term->str, (len < term->strlen) ? len : term->strlen);
+  return apply_op (term->op, (c != 0) ? c : (len < term->strlen) ? -1 : (len > term->strlen));
+}
+
+/* Compares a scalar of the given size in native byte order with the constant */
+static bool compare_scalar (const struct cf_term *term, enum cf_field_class fclass, const void *value, uint32_t size)
+{
+  union { uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64; float f32; double f64; } raw;
+  int64_t i = 0;
+  uint64_t u = 0;
+  double d = 0.0;
+  memcpy (&raw, value, size);
+  switch (size)
+  {
+    case 1: u = raw.u8; i = (int8_t) raw.u8; break;
+    case 2: u = raw.u16; i = (int16_t) raw.u16; break;
+    case 4: u = raw.u32; i = (int32_t) raw.u32; d = raw.f32; break;
+    case 8: u = raw.u64; i = (int64_t) raw.u64; d = raw.f64; break;
+  }
+
+  bool r = false;
+  switch (term->cmp)
+  {
+    case CF_CMP_INT:
+      r = apply_op (term->op, (i < term->value.i) ? -1 : (i > term->value.i));
+      break;
+    case CF_CMP_UINT:
+      r = apply_op (term->op, (u < term->value.u) ? -1 : (u > term->value.u));
+      break;
+    case CF_CMP_DOUBLE:
+      if (fclass == CF_FIELD_SIGNED)
+        d = (double) i;
+      else if (fclass == CF_FIELD_UNSIGNED)
+        d = (double) u;
+      if (d != d) /* NaN is unordered: only "not equal" holds */
+        r = (term->op == CF_OP_NE);
+      else
+        r = apply_op (term->op, (d < term->value.d) ? -1 : (d > term->value.d));
+      break;
+    case CF_CMP_STRING: case CF_CMP_LIKE: case CF_CMP_TRUE: case CF_CMP_FALSE:
+      assert (0);
+      break;
+  }
+  return r;
+}
+
+static enum cf_term_result eval_sample_term (const struct cf_term *term, const struct cf_field *field, const char *sample)
+{
+  const struct cf_mpath *mp = &field->mpath;
+  const char *addr = sample;
+  for (uint32_t i = 0; i < mp->nsteps; i++)
+  {
+    addr += mp->steps[i].offset;
+    if (mp->steps[i].deref && (addr = *(const char * const *) addr) == NULL)
+      return CF_TERM_UNKNOWN;
+  }
+  if (field->fclass != CF_FIELD_STRING)
+    return compare_scalar (term, field->fclass, addr, mp->size) ? CF_TERM_TRUE : CF_TERM_FALSE;
+
+  /* a null pointer is serialized as an empty string */
+  const char *s = mp->inline_string ? addr : *(const char * const *) addr;
+  const size_t len = (s != NULL) ? strlen (s) : 0;
+  if (len >= UINT32_MAX)
+    return CF_TERM_UNKNOWN;
+  return compare_string (term, (s != NULL) ? s : "", (uint32_t) len) ? CF_TERM_TRUE : CF_TERM_FALSE;
+}
+
+static enum cf_term_result eval_string_term (const struct cf_term *term, const struct cf_payload *pl, uint32_t off)
+{
+  uint32_t n;
+  if (!read_u32 (pl, off, &n) || n == 0 || n > pl->size - off - 4)
+    return CF_TERM_UNKNOWN;
+  const char *s = (const char *) pl->data + off + 4;
+  /* length includes the terminating 0 */
+  return compare_string (term, s, n - 1) ? CF_TERM_TRUE : CF_TERM_FALSE;
+}
+
+static enum cf_term_result eval_term (const struct ddsi_content_filter *cf, const struct cf_term *term, const struct cf_payload *pl, int xcdrv, uint32_t *offcache)
+{
+  if (term->cmp == CF_CMP_TRUE)
+    return CF_TERM_TRUE;
+  else if (term->cmp == CF_CMP_FALSE)
+    return CF_TERM_FALSE;
+
+  const struct cf_field *field = &cf->fields[term->field];
+  if (pl->sample != NULL)
+    return eval_sample_term (term, field, pl->sample);
+
+  uint32_t off;
+  if (term->field < CF_FIELD_CACHE_SIZE && offcache[term->field] != UINT32_MAX)
+    off = offcache[term->field];
+  else if (!locate_field (field, pl, xcdrv, &off))
+    return CF_TERM_UNKNOWN;
+  else if (term->field < CF_FIELD_CACHE_SIZE)
+    offcache[term->field] = off;
+
+  if (field->fclass == CF_FIELD_STRING)
+    return eval_string_term (term, pl, off);
+
+  union { uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64; } raw;
+  memcpy (&raw, pl->data + off, field->size);
+  if (pl->bswap)
+  {
+    switch (field->size)
+    {
+      case 2: raw.u16 = ddsrt_bswap2u (raw.u16); break;
+      case 4: raw.u32 = ddsrt_bswap4u (raw.u32); break;
+      case 8: raw.u64 = ddsrt_bswap8u (raw.u64); break;
+    }
+  }
+  return compare_scalar (term, field->fclass, &raw, field->size) ? CF_TERM_TRUE : CF_TERM_FALSE;
+}
+
+static enum ddsi_content_filter_result run (const struct ddsi_content_filter *cf, const struct cf_payload *pl, int xcdrv)
+{
+  uint32_t offcache[CF_FIELD_CACHE_SIZE];
+  bool reg = true;
+  memset (offcache, 0xff, sizeof (offcache));
+  for (uint32_t pc = 0; pc < cf->ninsns; )
+  {
+    const struct cf_insn *insn = &cf->insns[pc];
+    switch (insn->opcode)
+    {
+      case CF_INSN_TERM:
+        switch (eval_term (cf, &cf->terms[insn->arg], pl, xcdrv, offcache))
+        {
+          case CF_TERM_FALSE: reg = false; break;
+          case CF_TERM_TRUE: reg = true; break;
+          case CF_TERM_UNKNOWN: return DDSI_CONTENT_FILTER_UNKNOWN;
+        }
+        pc++;
+        break;
+      case CF_INSN_NOT:
+        reg = !reg;
+        pc++;
+        break;
+      case CF_INSN_JF:
+        pc = reg ? pc + 1 : insn->arg;
+        break;
+      case CF_INSN_JT:
+        pc = reg ? insn->arg : pc + 1;
+        break;
+    }
+  }
+  return reg ? DDSI_CONTENT_FILTER_ACCEPT : DDSI_CONTENT_FILTER_REJECT;
+}
+
+enum ddsi_content_filter_result ddsi_content_filter_eval (const struct ddsi_content_filter *cf, const struct ddsi_serdata *sd)
+{
+  struct { uint16_t identifier, options; } hdr;
+  int xcdrv;
+
+  if (sd->kind != SDK_DATA)
+    return DDSI_CONTENT_FILTER_ACCEPT;
+  const uint32_t size = ddsi_serdata_size (sd);
+  if (size < 4)
+    return DDSI_CONTENT_FILTER_UNKNOWN;
+  ddsi_serdata_to_ser (sd, 0, 4, &hdr);
+  switch (hdr.identifier)
+  {
+    case DDSI_RTPS_CDR_LE: case DDSI_RTPS_CDR_BE:
+      xcdrv = CF_XCDR1;
+      break;
+    case DDSI_RTPS_CDR2_LE: case DDSI_RTPS_CDR2_BE:
+      if (cf->extensibility != DDS_XTypes_IS_FINAL)
+        return DDSI_CONTENT_FILTER_UNKNOWN;
+      xcdrv = CF_XCDR2;
+      break;
+    case DDSI_RTPS_D_CDR2_LE: case DDSI_RTPS_D_CDR2_BE:
+      if (cf->extensibility != DDS_XTypes_IS_APPENDABLE)
+        return DDSI_CONTENT_FILTER_UNKNOWN;
+      xcdrv = CF_XCDR2;
+      break;
+    default:
+      return DDSI_CONTENT_FILTER_UNKNOWN;
+  }
+  if (!cf->supported[xcdrv])
+    return DDSI_CONTENT_FILTER_UNKNOWN;
+
+  ddsrt_iovec_t ref;
+  struct ddsi_serdata *sdref = ddsi_serdata_to_ser_ref (sd, 4, size - 4, &ref);
+  const struct cf_payload pl = {
+    .data = ref.iov_base, .size = (uint32_t) ref.iov_len,
+    .bswap = !DDSI_RTPS_CDR_ENC_IS_NATIVE (hdr.identifier), .sample = NULL
+  };
+  const enum ddsi_content_filter_result res = run (cf, &pl, xcdrv);
+  ddsi_serdata_to_ser_unref (sdref, &ref);
+  return res;
+}
+
+bool ddsi_content_filter_supports_representation (const struct ddsi_content_filter *cf, dds_data_representation_id_t data_representation)
+{
+  return cf->supported[(data_representation == DDS_DATA_REPRESENTATION_XCDR1) ? CF_XCDR1 : CF_XCDR2];
+}
+
+enum ddsi_content_filter_result ddsi_content_filter_eval_sample (const struct ddsi_content_filter *cf, const void *sample)
+{
+  if (!cf->bound)
+    return DDSI_CONTENT_FILTER_UNKNOWN;
+  const struct cf_payload pl = { .data = NULL, .size = 0, .bswap = false, .sample = sample };
+  return run (cf, &pl, CF_XCDR2);
+}
@@ -17,12 +17,15 @@
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsi/ddsi_proxy_participant.h"
 #include "dds/ddsi/ddsi_log.h"
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_unused.h"
 #include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_statistics.h"
 #include "ddsi__entity.h"
 #include "ddsi__endpoint_match.h"
 #include "ddsi__participant.h"
@@ -37,6 +40,7 @@
 #include "ddsi__tcp.h"
 #include "ddsi__endpoint.h"
 #include "ddsi__proxy_endpoint.h"
+#include "ddsi__thread.h"
 
 #include "dds__whc.h"
 
@@ -545,11 +549,13 @@ static void print_proxy_writer (struct st *st, void *varg)
   cpfkseqno (st, "last_seq", w->last_seq);
   cpfku32 (st, "last_fragnum", w->last_fragnum);
   cpfkseq (st, "local_readers", print_proxy_writer_rdseq, w);
-  uint64_t disc_frags, disc_samples;
-  ddsi_defrag_stats (w->defrag, &disc_frags);
-  ddsi_reorder_stats (w->reorder, &disc_samples);
+  uint64_t disc_frags, disc_samples, disc_frag_samples, disc_sample_count;
+  ddsi_defrag_stats (w->defrag, &disc_frags, &disc_frag_samples);
+  ddsi_reorder_stats (w->reorder, &disc_samples, &disc_sample_count);
   cpfku64 (st, "discarded_fragment_bytes", disc_frags);
   cpfku64 (st, "discarded_sample_bytes", disc_samples);
+  cpfku64 (st, "discarded_incomplete_samples", disc_frag_samples);
+  cpfku64 (st, "discarded_samples", disc_sample_count);
   ddsrt_mutex_unlock (&w->e.lock);
 }
 
@@ -631,10 +637,441 @@ static void print_domain (struct st *st, void *varg)
   print_proxy_participants (st);
 }
 
+/* OpenMetrics exposition, served in response to "GET /metrics".  Everything is
+   first copied out of the entities, holding each entity's lock only for as long as
+   it takes to copy a handful of counters, and only then written to the socket, so
+   that a slow scraper has no effect on the rest of the system. */
+
+struct om_writer {
+  char *labels;
+  uint64_t rexmit_bytes;
+  uint32_t throttle_count;
+  uint64_t time_throttled;
+  uint64_t time_retransmit;
+  uint64_t unacked_bytes;
+};
+
+struct om_reader {
+  char *labels;
+  uint64_t discarded_bytes;
+  uint64_t discarded_samples;
+  uint64_t latency_count;
+  uint64_t latency[5]; // 50%, 90%, 99%, 99.9%, maximum
+};
+
+struct om_conn {
+  char labels[64 + DDSI_LOCSTRLEN];
+  struct ddsi_conn_stats st;
+};
+
+struct om_thread {
+  char labels[64 + sizeof (((struct ddsi_thread_state *) 0)->name)];
+  ddsi_vtime_t vtime;
+  bool profiled;
+  struct ddsi_thread_stats st;
+};
+
+struct om_snapshot {
+  char labels[32];
+  struct ddsi_domain_stats dst;
+  uint64_t pcap_packets, pcap_dropped;
+  uint32_t n_participants, n_proxy_participants, n_proxy_readers, n_proxy_writers;
+  uint32_t nwr, szwr, nrd, szrd, nconn, szconn, nthr, szthr;
+  struct om_writer *wr;
+  struct om_reader *rd;
+  struct om_conn *conn;
+  struct om_thread *thr;
+};
+
+static void *om_grow (void *ary, uint32_t *sz, uint32_t n, size_t elemsz)
+{
+  if (n < *sz)
+    return ary;
+  *sz = (*sz == 0) ? 8 : 2 * *sz;
+  return ddsrt_realloc (ary, *sz * elemsz);
+}
+
+static size_t om_escape (char *dst, size_t size, const char *src)
+{
+  // label values must have backslash, double quote and line feed escaped
+  size_t pos = 0;
+  for (; *src && pos + 3 <= size; src++)
+  {
+    if (*src == '\\' || *src == '"')
+      dst[pos++] = '\\';
+    else if (*src == '\n')
+    {
+      dst[pos++] = '\\';
+      dst[pos++] = 'n';
+      continue;
+    }
+    dst[pos++] = *src;
+  }
+  dst[pos] = 0;
+  return pos;
+}
+
+static char *om_endpoint_labels (const struct om_snapshot *snap, const ddsi_guid_t *guid, const dds_qos_t *xqos)
+{
+  const char *topic = (xqos->present & DDSI_QP_TOPIC_NAME) ? xqos->topic_name : "";
+  const size_t size = 96 + 2 * strlen (topic);
+  char *labels = ddsrt_malloc (size);
+  int pos = snprintf (labels, size, "%s,guid=\""PGUIDFMT"\",topic=\"", snap->labels, PGUID (*guid));
+  assert (pos > 0 && (size_t) pos < size);
+  pos += (int) om_escape (labels + pos, size - (size_t) pos - 1, topic);
+  (void) snprintf (labels + pos, size - (size_t) pos, "\"");
+  return labels;
+}
+
+static void om_add_conn (const ddsi_locator_t *loc, const struct ddsi_conn_stats *cst, void *varg)
+{
+  struct om_snapshot * const snap = varg;
+  char locstr[DDSI_LOCSTRLEN];
+  snap->conn = om_grow (snap->conn, &snap->szconn, snap->nconn, sizeof (*snap->conn));
+  struct om_conn * const c = &snap->conn[snap->nconn++];
+  int pos = snprintf (c->labels, sizeof (c->labels), "%s,socket=\"", snap->labels);
+  pos += (int) om_escape (c->labels + pos, sizeof (c->labels) - (size_t) pos - 1, ddsi_locator_to_string (locstr, sizeof (locstr), loc));
+  (void) snprintf (c->labels + pos, sizeof (c->labels) - (size_t) pos, "\"");
+  c->st = *cst;
+}
+
+static void om_add_thread (const struct ddsi_thread_state *thrst, void *varg)
+{
+  struct om_snapshot * const snap = varg;
+  snap->thr = om_grow (snap->thr, &snap->szthr, snap->nthr, sizeof (*snap->thr));
+  struct om_thread * const t = &snap->thr[snap->nthr++];
+  int pos = snprintf (t->labels, sizeof (t->labels), "%s,thread=\"", snap->labels);
+  pos += (int) om_escape (t->labels + pos, sizeof (t->labels) - (size_t) pos - 1, thrst->name);
+  (void) snprintf (t->labels + pos, sizeof (t->labels) - (size_t) pos, "\"");
+  t->vtime = ddsrt_atomic_ld32 (&thrst->vtime);
+  t->profiled = ddsi_get_thread_stats (thrst, &t->st);
+}
+
+static void om_snapshot_endpoints (struct om_snapshot *snap, struct ddsi_domaingv *gv, struct ddsi_thread_state *thrst)
+{
+  ddsi_thread_state_awake_fixed_domain (thrst);
+  {
+    struct ddsi_entity_enum_writer ew;
+    struct ddsi_writer *w;
+    ddsi_entidx_enum_writer_init (&ew, gv->entity_index);
+    while ((w = ddsi_entidx_enum_writer_next (&ew)) != NULL)
+    {
+      struct ddsi_whc_state whcst;
+      snap->wr = om_grow (snap->wr, &snap->szwr, snap->nwr, sizeof (*snap->wr));
+      struct om_writer * const x = &snap->wr[snap->nwr++];
+      x->labels = om_endpoint_labels (snap, &w->e.guid, w->xqos);
+      ddsi_get_writer_stats (w, &x->rexmit_bytes, &x->throttle_count, &x->time_throttled, &x->time_retransmit);
+      ddsi_whc_get_state (w->whc, &whcst);
+      x->unacked_bytes = whcst.unacked_bytes;
+    }
+    ddsi_entidx_enum_writer_fini (&ew);
+  }
+  {
+    struct ddsi_entity_enum_reader er;
+    struct ddsi_reader *r;
+    ddsi_entidx_enum_reader_init (&er, gv->entity_index);
+    while ((r = ddsi_entidx_enum_reader_next (&er)) != NULL)
+    {
+      uint64_t lat_min;
+      snap->rd = om_grow (snap->rd, &snap->szrd, snap->nrd, sizeof (*snap->rd));
+      struct om_reader * const x = &snap->rd[snap->nrd++];
+      x->labels = om_endpoint_labels (snap, &r->e.guid, r->xqos);
+      ddsi_get_reader_stats (r, &x->discarded_bytes, &x->discarded_samples);
+      ddsi_get_reader_latency_stats (r, &x->latency_count, &lat_min, &x->latency[0], &x->latency[1], &x->latency[2], &x->latency[3], &x->latency[4]);
+    }
+    ddsi_entidx_enum_reader_fini (&er);
+  }
+  {
+    struct ddsi_entity_enum_participant e;
+    ddsi_entidx_enum_participant_init (&e, gv->entity_index);
+    while (ddsi_entidx_enum_participant_next (&e))
+      snap->n_participants++;
+    ddsi_entidx_enum_participant_fini (&e);
+  }
+  {
+    struct ddsi_entity_enum_proxy_participant e;
+    ddsi_entidx_enum_proxy_participant_init (&e, gv->entity_index);
+    while (ddsi_entidx_enum_proxy_participant_next (&e))
+      snap->n_proxy_participants++;
+    ddsi_entidx_enum_proxy_participant_fini (&e);
+  }
+  {
+    struct ddsi_entity_enum_proxy_reader e;
+    ddsi_entidx_enum_proxy_reader_init (&e, gv->entity_index);
+    while (ddsi_entidx_enum_proxy_reader_next (&e))
+      snap->n_proxy_readers++;
+    ddsi_entidx_enum_proxy_reader_fini (&e);
+  }
+  {
+    struct ddsi_entity_enum_proxy_writer e;
+    ddsi_entidx_enum_proxy_writer_init (&e, gv->entity_index);
+    while (ddsi_entidx_enum_proxy_writer_next (&e))
+      snap->n_proxy_writers++;
+    ddsi_entidx_enum_proxy_writer_fini (&e);
+  }
+  ddsi_thread_state_asleep (thrst);
+}
+
+static void om_snapshot_init (struct om_snapshot *snap, struct ddsi_domaingv *gv, struct ddsi_thread_state *thrst)
+{
+  memset (snap, 0, sizeof (*snap));
+  (void) snprintf (snap->labels, sizeof (snap->labels), "domain=\"%"PRIu32"\"", gv->config.domainId);
+  ddsi_get_domain_stats (gv, &snap->dst);
+  ddsi_get_pcap_stats (gv, &snap->pcap_packets, &snap->pcap_dropped);
+  ddsi_enum_conn_stats (gv, om_add_conn, snap);
+  ddsi_enum_thread_states (gv, om_add_thread, snap);
+  om_snapshot_endpoints (snap, gv, thrst);
+}
+
+static void om_snapshot_fini (struct om_snapshot *snap)
+{
+  for (uint32_t i = 0; i < snap->nwr; i++)
+    ddsrt_free (snap->wr[i].labels);
+  for (uint32_t i = 0; i < snap->nrd; i++)
+    ddsrt_free (snap->rd[i].labels);
+  ddsrt_free (snap->wr);
+  ddsrt_free (snap->rd);
+  ddsrt_free (snap->conn);
+  ddsrt_free (snap->thr);
+}
+
+static void om_family (struct st *st, const char *name, const char *type, const char *help)
+{
+  cpf (st, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+static void om_sample (struct st *st, const char *name, const char *type, const char *labels, uint64_t value)
+{
+  // counters get a "_total" suffix, values in nanoseconds are reported in seconds
+  const char *suffix = (strcmp (type, "counter") == 0) ? "_total" : "";
+  const size_t len = strlen (name);
+  if (len > 8 && strcmp (name + len - 8, "_seconds") == 0)
+    cpf (st, "%s%s{%s} %"PRIu64".%09"PRIu64"\n", name, suffix, labels, value / DDS_NSECS_IN_SEC, value % DDS_NSECS_IN_SEC);
+  else
+    cpf (st, "%s%s{%s} %"PRIu64"\n", name, suffix, labels, value);
+}
+
+struct om_metric {
+  const char *name;
+  const char *type;
+  size_t off;
+  const char *help;
+};
+
+#define OM_DOMAIN(name_, type_, field_, help_) { "cyclonedds_" name_, type_, offsetof (struct ddsi_domain_stats, field_), help_ }
+static const struct om_metric om_domain_metrics[] = {
+  OM_DOMAIN ("dqueue_length", "gauge", dqueue_length, "Samples in the delivery queues"),
+  OM_DOMAIN ("dqueue_delivered", "counter", dqueue_delivered, "Samples delivered by the delivery queues"),
+  OM_DOMAIN ("dqueue_wait_seconds", "counter", dqueue_wait_time, "Time samples waited for a delivery thread"),
+  OM_DOMAIN ("dqueue_max_wait_seconds", "gauge", dqueue_max_wait_time, "Longest time a sample waited for a delivery thread"),
+  OM_DOMAIN ("dqueue_full_waits", "counter", dqueue_full_waits, "Times a receive thread blocked on a full delivery queue"),
+  OM_DOMAIN ("xevq_length", "gauge", xevq_length, "Non-timed events queued for the transmit thread"),
+  OM_DOMAIN ("xevq_nontimed_handled", "counter", xevq_nontimed_handled, "Non-timed events handled"),
+  OM_DOMAIN ("xevq_timed_handled", "counter", xevq_timed_handled, "Timed events handled"),
+  OM_DOMAIN ("xevq_timed_lateness_seconds", "counter", xevq_timed_lateness, "Delay between scheduled and actual time of timed events"),
+  OM_DOMAIN ("xevq_max_timed_lateness_seconds", "gauge", xevq_max_timed_lateness, "Longest delay of a timed event"),
+  OM_DOMAIN ("sendq_length", "gauge", sendq_length, "Packets in the asynchronous send queue"),
+  OM_DOMAIN ("sendq_packets", "counter", sendq_packets, "Packets that went through the send queue"),
+  OM_DOMAIN ("sendq_blocked", "counter", sendq_blocked, "Times a writer blocked on a full send queue"),
+  OM_DOMAIN ("rbuf_count", "gauge", rbuf_count, "Receive buffers in use"),
+  OM_DOMAIN ("rbuf_bytes", "gauge", rbuf_bytes, "Memory occupied by receive buffers in use")
+};
+#undef OM_DOMAIN
+
+#define OM_CONN(name_, field_, help_) { "cyclonedds_socket_" name_, "counter", offsetof (struct ddsi_conn_stats, field_), help_ }
+static const struct om_metric om_conn_metrics[] = {
+  OM_CONN ("rx_packets", rx_packets, "Packets received"),
+  OM_CONN ("rx_bytes", rx_bytes, "Bytes received"),
+  OM_CONN ("tx_packets", tx_packets, "Packets sent"),
+  OM_CONN ("tx_bytes", tx_bytes, "Bytes sent")
+};
+#undef OM_CONN
+
+#define OM_WRITER(name_, type_, field_, help_) { "cyclonedds_writer_" name_, type_, offsetof (struct om_writer, field_), help_ }
+static const struct om_metric om_writer_metrics[] = {
+  OM_WRITER ("rexmit_bytes", "counter", rexmit_bytes, "Bytes retransmitted"),
+  OM_WRITER ("throttled_seconds", "counter", time_throttled, "Time spent blocked on a full writer history cache"),
+  OM_WRITER ("retransmit_seconds", "counter", time_retransmit, "Time spent retransmitting"),
+  OM_WRITER ("unacked_bytes", "gauge", unacked_bytes, "Bytes in the writer history cache not yet acknowledged")
+};
+#undef OM_WRITER
+
+#define OM_READER(name_, field_, help_) { "cyclonedds_reader_" name_, "counter", offsetof (struct om_reader, field_), help_ }
+static const struct om_metric om_reader_metrics[] = {
+  OM_READER ("discarded_bytes", discarded_bytes, "Bytes discarded by defragmenting and reordering"),
+  OM_READER ("discarded_samples", discarded_samples, "Samples discarded by defragmenting and reordering")
+};
+#undef OM_READER
+
+static uint64_t om_field (const void *base, size_t off)
+{
+  uint64_t v;
+  memcpy (&v, (const char *) base + off, sizeof (v));
+  return v;
+}
+
+static void om_print (struct st *st, const struct om_snapshot *snap)
+{
+  for (size_t i = 0; i < sizeof (om_domain_metrics) / sizeof (om_domain_metrics[0]); i++)
+  {
+    const struct om_metric *m = &om_domain_metrics[i];
+    om_family (st, m->name, m->type, m->help);
+    om_sample (st, m->name, m->type, snap->labels, om_field (&snap->dst, m->off));
+  }
+  om_family (st, "cyclonedds_pcap_packets", "counter", "Packets written to the packet capture file");
+  om_sample (st, "cyclonedds_pcap_packets", "counter", snap->labels, snap->pcap_packets);
+  om_family (st, "cyclonedds_pcap_dropped", "counter", "Packets dropped by packet capturing");
+  om_sample (st, "cyclonedds_pcap_dropped", "counter", snap->labels, snap->pcap_dropped);
+
+  om_family (st, "cyclonedds_entities", "gauge", "Number of DDSI entities");
+  const struct { const char *kind; uint32_t n; } counts[] = {
+    { "participant", snap->n_participants }, { "writer", snap->nwr }, { "reader", snap->nrd },
+    { "proxy_participant", snap->n_proxy_participants }, { "proxy_writer", snap->n_proxy_writers }, { "proxy_reader", snap->n_proxy_readers }
+  };
+  for (size_t i = 0; i < sizeof (counts) / sizeof (counts[0]); i++)
+    cpf (st, "cyclonedds_entities{%s,kind=\"%s\"} %"PRIu32"\n", snap->labels, counts[i].kind, counts[i].n);
+
+  for (size_t i = 0; i < sizeof (om_conn_metrics) / sizeof (om_conn_metrics[0]); i++)
+  {
+    const struct om_metric *m = &om_conn_metrics[i];
+    om_family (st, m->name, m->type, m->help);
+    for (uint32_t j = 0; j < snap->nconn; j++)
+      om_sample (st, m->name, m->type, snap->conn[j].labels, om_field (&snap->conn[j].st, m->off));
+  }
+
+  om_family (st, "cyclonedds_thread_awake", "gauge", "Whether the thread is currently doing work");
+  for (uint32_t j = 0; j < snap->nthr; j++)
+    om_sample (st, "cyclonedds_thread_awake", "gauge", snap->thr[j].labels, ddsi_vtime_awake_p (snap->thr[j].vtime));
+  om_family (st, "cyclonedds_thread_progress", "counter", "Times the thread completed a unit of work, not increasing while awake indicates a stuck thread");
+  for (uint32_t j = 0; j < snap->nthr; j++)
+    om_sample (st, "cyclonedds_thread_progress", "counter", snap->thr[j].labels, snap->thr[j].vtime >> DDSI_VTIME_TIME_SHIFT);
+
+  // CPU time and awake intervals are only available if thread profiling is enabled
+  om_family (st, "cyclonedds_thread_cpu_seconds", "counter", "CPU time used by the thread");
+  for (uint32_t j = 0; j < snap->nthr; j++)
+  {
+    const struct om_thread *t = &snap->thr[j];
+    if (!t->profiled)
+      continue;
+    cpf (st, "cyclonedds_thread_cpu_seconds_total{%s,mode=\"user\"} %"PRIu64".%09"PRIu64"\n", t->labels, t->st.utime / DDS_NSECS_IN_SEC, t->st.utime % DDS_NSECS_IN_SEC);
+    cpf (st, "cyclonedds_thread_cpu_seconds_total{%s,mode=\"system\"} %"PRIu64".%09"PRIu64"\n", t->labels, t->st.stime / DDS_NSECS_IN_SEC, t->st.stime % DDS_NSECS_IN_SEC);
+  }
+  om_family (st, "cyclonedds_thread_awake_seconds", "summary", "Durations of the intervals the thread spent doing work");
+  for (uint32_t j = 0; j < snap->nthr; j++)
+  {
+    const struct om_thread *t = &snap->thr[j];
+    if (!t->profiled)
+      continue;
+    const uint64_t q[] = { t->st.awake_p50, t->st.awake_p90, t->st.awake_p99, t->st.awake_max };
+    static const char *qs[] = { "0.5", "0.9", "0.99", "1" };
+    for (size_t k = 0; k < sizeof (q) / sizeof (q[0]); k++)
+      cpf (st, "cyclonedds_thread_awake_seconds{%s,quantile=\"%s\"} %"PRIu64".%09"PRIu64"\n", t->labels, qs[k], q[k] / DDS_NSECS_IN_SEC, q[k] % DDS_NSECS_IN_SEC);
+    cpf (st, "cyclonedds_thread_awake_seconds_sum{%s} %"PRIu64".%09"PRIu64"\n", t->labels, t->st.awake_time / DDS_NSECS_IN_SEC, t->st.awake_time % DDS_NSECS_IN_SEC);
+    cpf (st, "cyclonedds_thread_awake_seconds_count{%s} %"PRIu64"\n", t->labels, t->st.awake_count);
+  }
+
+  for (size_t i = 0; i < sizeof (om_writer_metrics) / sizeof (om_writer_metrics[0]); i++)
+  {
+    const struct om_metric *m = &om_writer_metrics[i];
+    om_family (st, m->name, m->type, m->help);
+    for (uint32_t j = 0; j < snap->nwr; j++)
+      om_sample (st, m->name, m->type, snap->wr[j].labels, om_field (&snap->wr[j], m->off));
+  }
+  om_family (st, "cyclonedds_writer_throttles", "counter", "Times the writer blocked on a full writer history cache");
+  for (uint32_t j = 0; j < snap->nwr; j++)
+    om_sample (st, "cyclonedds_writer_throttles", "counter", snap->wr[j].labels, snap->wr[j].throttle_count);
+
+  for (size_t i = 0; i < sizeof (om_reader_metrics) / sizeof (om_reader_metrics[0]); i++)
+  {
+    const struct om_metric *m = &om_reader_metrics[i];
+    om_family (st, m->name, m->type, m->help);
+    for (uint32_t j = 0; j < snap->nrd; j++)
+      om_sample (st, m->name, m->type, snap->rd[j].labels, om_field (&snap->rd[j], m->off));
+  }
+  // latencies are only available for readers for which latency statistics were enabled
+  static const char *quantiles[] = { "0.5", "0.9", "0.99", "0.999", "1" };
+  om_family (st, "cyclonedds_reader_latency_seconds", "summary", "Time from source timestamp to storing the sample in the reader history cache");
+  for (uint32_t j = 0; j < snap->nrd; j++)
+  {
+    const struct om_reader *x = &snap->rd[j];
+    if (x->latency_count == 0)
+      continue;
+    for (size_t k = 0; k < sizeof (quantiles) / sizeof (quantiles[0]); k++)
+      cpf (st, "cyclonedds_reader_latency_seconds{%s,quantile=\"%s\"} %"PRIu64".%09"PRIu64"\n", x->labels, quantiles[k], x->latency[k] / DDS_NSECS_IN_SEC, x->latency[k] % DDS_NSECS_IN_SEC);
+    cpf (st, "cyclonedds_reader_latency_seconds_count{%s} %"PRIu64"\n", x->labels, x->latency_count);
+  }
+
+  cpf (st, "# EOF\n");
+}
+
+static bool debmon_read_request (struct ddsi_tran_conn *conn, char *line, size_t size)
+{
+  // Read the request line and skip the headers.  Clients that simply connect and
+  // wait for the data (the original protocol) send nothing and get the JSON dump
+  // immediately, an HTTP client that has started sending its request gets a little
+  // time to complete it.  The socket is non-blocking.
+  const ddsrt_socket_t sock = ddsi_conn_handle (conn);
+  const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (ddsrt_time_monotonic (), DDS_MSECS (100));
+  size_t pos = 0, linelen = 0;
+  bool have_line = false, received = false;
+  while (true)
+  {
+    unsigned char c;
+    const ssize_t n = ddsi_conn_read (conn, &c, 1, true, NULL);
+    if (n < 0)
+      return false;
+    else if (n > 0)
+    {
+      received = true;
+      if (c == '\n')
+      {
+        if (linelen == 0)
+          break;
+        have_line = true;
+        linelen = 0;
+      }
+      else if (c != '\r')
+      {
+        linelen++;
+        if (!have_line && pos + 1 < size)
+          line[pos++] = (char) c;
+      }
+    }
+    else
+    {
+      const dds_duration_t left = tend.v - ddsrt_time_monotonic ().v;
+      fd_set fds;
+      if (!received || left <= 0)
+        break;
+      FD_ZERO (&fds);
+#if LWIP_SOCKET == 1
+      DDSRT_WARNING_GNUC_OFF(sign-conversion)
+#endif
+      FD_SET (sock, &fds);
+#if LWIP_SOCKET == 1
+      DDSRT_WARNING_GNUC_ON(sign-conversion)
+#endif
+      if (ddsrt_select (sock + 1, &fds, NULL, NULL, left) < 0)
+        break;
+    }
+  }
+  line[pos] = 0;
+  return true;
+}
+
+static bool debmon_is_metrics_request (const char *line)
+{
+  const char *req = "GET /metrics";
+  const size_t len = strlen (req);
+  return strncmp (line, req, len) == 0 && (line[len] == ' ' || line[len] == '?' || line[len] == 0);
+}
+
 static void debmon_handle_connection (struct ddsi_debug_monitor *dm, struct ddsi_tran_conn * conn)
 {
   ddsi_locator_t loc;
   const char *http_header = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n";
+  const char *om_http_header = "HTTP/1.1 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\nTransfer-Encoding: chunked\r\n";
+  char request[64];
 
   struct ddsi_thread_state * const thrst = ddsi_lookup_thread_state ();
   struct st st = {
@@ -649,6 +1086,17 @@ static void debmon_handle_connection (struct ddsi_debug_monitor *dm, struct ddsi
   if (!ddsi_conn_peer_locator(st.conn, &loc)) {
     return;
   }
+  if (!debmon_read_request (st.conn, request, sizeof (request))) {
+    return;
+  }
+
+  // Collect the metrics before sending anything, no point in sending headers if it fails
+  const bool metrics = debmon_is_metrics_request (request);
+  struct om_snapshot snap;
+  if (metrics) {
+    om_snapshot_init (&snap, dm->gv, thrst);
+    http_header = om_http_header;
+  }
 
   DDSI_DECL_CONST_TRAN_WRITE_MSGFRAGS_PTR(msgfrags, ((ddsrt_iovec_t){
     .iov_base = (void *) http_header,
@@ -656,11 +1104,21 @@ static void debmon_handle_connection (struct ddsi_debug_monitor *dm, struct ddsi
   }));
   if (ddsi_conn_write (st.conn, &loc, msgfrags, 0) < 0) {
     // If we cant even send headers dont bother with encoding the rest
+    if (metrics)
+      om_snapshot_fini (&snap);
     return;
   }
 
   // Encode data
-  cpfobj (&st, print_domain, NULL);
+  if (!metrics)
+    cpfobj (&st, print_domain, NULL);
+  else
+  {
+    om_print (&st, &snap);
+    om_snapshot_fini (&snap);
+  }
+  if (st.error)
+    return;
 
   // Last content chunk
   if (st.pos > 8)
@@ -14,6 +14,7 @@
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/hdrhist.h"
 #include "dds/ddsi/ddsi_sertype.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_tkmap.h"
@@ -132,6 +133,19 @@ static void type_sample_cache_store (struct type_sample_cache * __restrict tsc,
   tsc->n++;
 }
 
+static void record_latency (struct ddsi_reader *rd, const struct ddsi_serdata *payload, ddsrt_wctime_t *tnow)
+{
+  /* Only gathered once requested; the clock is read at most once per sample
+     delivered, and only the source timestamp of data is meaningful */
+  struct ddsrt_hdrhist * const hist = ddsrt_atomic_ldvoidp (&rd->latency_hist);
+  if (hist == NULL || payload->kind != SDK_DATA || payload->timestamp.v <= 0)
+    return;
+  if (tnow->v == 0)
+    *tnow = ddsrt_time_wallclock ();
+  if (tnow->v >= payload->timestamp.v)
+    ddsrt_hdrhist_record (hist, (uint64_t) (tnow->v - payload->timestamp.v));
+}
+
 dds_return_t ddsi_deliver_locally_one (struct ddsi_domaingv *gv, struct ddsi_entity_common *source_entity, bool source_entity_locked, const ddsi_guid_t *rdguid, const struct ddsi_writer_info *wrinfo, const struct ddsi_deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   struct ddsi_reader *rd = ddsi_entidx_lookup_reader_guid (gv->entity_index, rdguid);
@@ -146,7 +160,8 @@ dds_return_t ddsi_deliver_locally_one (struct ddsi_domaingv *gv, struct ddsi_ent
     /* FIXME: why look up rd,pwr again? Their states remains valid while the thread stays
        "awake" (although a delete can be initiated), and blocking like this is a stopgap
        anyway -- quite possibly to abort once either is deleted */
-    while (!ddsi_rhc_store (rd->rhc, wrinfo, payload, tk))
+    bool stored;
+    while (!(stored = ddsi_rhc_store (rd->rhc, wrinfo, payload, tk)))
     {
       if (source_entity_locked)
         ddsrt_mutex_unlock (&source_entity->lock);
@@ -160,6 +175,11 @@ dds_return_t ddsi_deliver_locally_one (struct ddsi_domaingv *gv, struct ddsi_ent
         break;
       }
     }
+    if (stored)
+    {
+      ddsrt_wctime_t tnow = { 0 };
+      record_latency (rd, payload, &tnow);
+    }
     free_sample_after_store (gv, payload, tk);
   }
   return DDS_RETCODE_OK;
@@ -183,6 +203,7 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct d
   /* Local delivery from a PSMX writer to a PSMX reader is handled
      by PSMX and we must skip them here */
   bool trace_is_first = true;
+  ddsrt_wctime_t tnow = { 0 };
   for (struct ddsi_reader *rd = ops->first_reader (gv->entity_index, source_entity, &it);
        rd != NULL;
        rd = ops->next_reader (gv->entity_index, &it))
@@ -199,7 +220,8 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct d
     {
       EETRACE (source_entity, "%s "PGUIDFMT, trace_is_first ? " =>" : "", PGUID (rd->e.guid));
       trace_is_first = false;
-      (void) ddsi_rhc_store (rd->rhc, wrinfo, payload, tk);
+      if (ddsi_rhc_store (rd->rhc, wrinfo, payload, tk))
+        record_latency (rd, payload, &tnow);
     }
   }
   EETRACE (source_entity, "\n");
@@ -212,6 +234,7 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct d
 static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct ddsi_entity_common *source_entity, bool source_entity_locked, struct ddsi_local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct ddsi_deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   struct ddsi_reader ** const rdary = fastpath_rdary->rdary;
+  ddsrt_wctime_t tnow = { 0 };
   uint32_t i = 0;
   while (rdary[i])
   {
@@ -236,6 +259,7 @@ static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct d
             return rc;
           }
         }
+        record_latency (rdary[i], payload, &tnow);
       } while (rdary[++i] && rdary[i]->type == type);
       free_sample_after_store (gv, payload, tk);
     }
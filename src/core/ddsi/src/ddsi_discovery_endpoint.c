@@ -182,6 +182,9 @@ static int sedp_write_endpoint_impl
         ps.present |= PP_CYCLONE_REQUESTS_KEYHASH;
         ps.cyclone_requests_keyhash = 1u;
       }
+      /* Reconstructing fragments from parity messages is always supported */
+      ps.present |= PP_CYCLONE_ACCEPTS_FEC;
+      ps.cyclone_accepts_fec = 1u;
     }
 
 #ifdef DDSRT_HAVE_SSM
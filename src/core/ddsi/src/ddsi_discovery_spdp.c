@@ -134,7 +134,7 @@ void ddsi_get_participant_builtin_topic_data (const struct ddsi_participant *pp,
 #ifndef NDEBUG
         kind = gv->loc_default_uc.kind;
 #endif
-        assert (kind == gv->loc_meta_uc.kind);
+        assert (!gv->config.publish_uc_locators || kind == gv->loc_meta_uc.kind);
         data_port = gv->loc_default_uc.port;
         meta_port = gv->loc_meta_uc.port;
       }
@@ -146,7 +146,8 @@ void ddsi_get_participant_builtin_topic_data (const struct ddsi_participant *pp,
         // FIXME: if the switches strip off VLAN tags on egress ports, then we using the packet's source address is probably wrong in cases where VLANs are being used
         data_port = meta_port = pp->m_locator.port;
       }
-      assert (kind == gv->interfaces[i].extloc.kind);
+      // TCP without a listener has no unicast locators (and doesn't publish any)
+      assert (!gv->config.publish_uc_locators || kind == gv->interfaces[i].extloc.kind);
       locators_add_one (&def_uni, &gv->interfaces[i].extloc, data_port);
       locators_add_one (&meta_uni, &gv->interfaces[i].extloc, meta_port);
     }
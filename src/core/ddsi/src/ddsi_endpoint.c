@@ -15,6 +15,7 @@
 
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hdrhist.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_builtin_topic_if.h"
@@ -46,6 +47,7 @@
 #include "ddsi__xqos.h"
 #include "ddsi__hbcontrol.h"
 #include "ddsi__lease.h"
+#include "ddsi__tokenbucket.h"
 #include "dds/dds.h"
 #include "dds__types.h"
 
@@ -799,6 +801,10 @@ static void ddsi_new_writer_guid_common_init (struct ddsi_writer *wr, const char
   wr->num_readers = 0;
   wr->num_reliable_readers = 0;
   wr->num_readers_requesting_keyhash = 0;
+  wr->num_readers_accepting_fec = 0;
+#ifdef DDS_HAS_TYPELIB
+  wr->num_readers_with_content_filter = 0;
+#endif
   wr->num_acks_received = 0;
   wr->num_nacks_received = 0;
   wr->throttle_count = 0;
@@ -867,6 +873,15 @@ static void ddsi_new_writer_guid_common_init (struct ddsi_writer *wr, const char
      point of view a wierd configuration. Here we chose the first one
      that we find */
   wr->network_partition = ddsi_get_nwpart_from_mapping (&gv->logconfig, &gv->config, wr->xqos, wr->xqos->topic_name);
+  if (wr->network_partition && wr->network_partition->max_rate > 0 && !ddsi_is_builtin_entityid (wr->e.guid.entityid, DDSI_VENDORID_ECLIPSE))
+  {
+    ELOGDISC (wr, "writer "PGUIDFMT": max rate %"PRIu32" B/s\n", PGUID (wr->e.guid), wr->network_partition->max_rate);
+    wr->tokenbucket = ddsi_tokenbucket_new (wr->network_partition->max_rate, gv->config.max_msg_size, ddsrt_time_monotonic ());
+  }
+  else
+  {
+    wr->tokenbucket = NULL;
+  }
 #endif /* DDS_HAS_NETWORK_PARTITIONS */
 
 #ifdef DDSRT_HAVE_SSM
@@ -1153,6 +1168,10 @@ static void gc_delete_writer (struct ddsi_gcreq *gcreq)
   ddsrt_free (wr->xqos);
   ddsi_local_reader_ary_fini (&wr->rdary);
   ddsrt_cond_destroy (&wr->throttle_cond);
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+  if (wr->tokenbucket)
+    ddsi_tokenbucket_free (wr->tokenbucket);
+#endif
 
   ddsi_sertype_unref ((struct ddsi_sertype *) wr->type);
   endpoint_common_fini (&wr->e, &wr->c);
@@ -1521,6 +1540,7 @@ dds_return_t ddsi_new_reader (struct ddsi_reader **rd_out, const struct ddsi_gui
   rd->request_keyhash = rd->type->request_keyhash;
   rd->init_acknack_count = 1;
   rd->num_writers = 0;
+  ddsrt_atomic_stvoidp (&rd->latency_hist, NULL);
 #ifdef DDSRT_HAVE_SSM
   rd->favours_ssm = 0;
 #endif
@@ -1610,6 +1630,7 @@ static void gc_delete_reader (struct ddsi_gcreq *gcreq)
     (rd->status_cb) (rd->status_cb_entity, NULL);
   }
   ddsi_sertype_unref ((struct ddsi_sertype *) rd->type);
+  ddsrt_hdrhist_free (ddsrt_atomic_ldvoidp (&rd->latency_hist));
 
   ddsi_xqos_fini (rd->xqos);
   ddsrt_free (rd->xqos);
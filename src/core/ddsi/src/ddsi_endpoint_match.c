@@ -30,6 +30,7 @@
 #include "ddsi__protocol.h"
 #include "ddsi__tran.h"
 #include "ddsi__typelib.h"
+#include "dds/ddsi/ddsi_content_filter.h"
 #include "ddsi__vendor.h"
 #include "ddsi__lat_estim.h"
 #include "ddsi__acknack.h"
@@ -614,6 +615,9 @@ void ddsi_free_wr_prd_match (const struct ddsi_domaingv *gv, const ddsi_guid_t *
     (void) wr_guid;
 #endif
     ddsi_lat_estim_fini (&m->hb_to_ack_latency);
+#ifdef DDS_HAS_TYPELIB
+    ddsi_content_filter_free (m->content_filter);
+#endif
     ddsrt_free (m);
   }
 }
@@ -745,6 +749,48 @@ static bool connected_via_psmx (const struct ddsi_entity_common *a, const struct
   return false;
 }
 
+#ifdef DDS_HAS_TYPELIB
+static struct ddsi_content_filter *writer_compile_content_filter (const struct ddsi_writer *wr, const struct ddsi_proxy_reader *prd, bool via_psmx)
+{
+  /* Data going via PSMX bypasses the writer's network path, so filtering it
+     there is pointless; and without type information we can't interpret the
+     expression.  In both cases the reader filters the data itself. */
+  struct ddsi_content_filter *cf;
+  if (!(prd->c.xqos->present & DDSI_QP_CYCLONE_CONTENT_FILTER) || via_psmx)
+    return NULL;
+  if (wr->c.type_pair == NULL || wr->c.type_pair->complete == NULL)
+    return NULL;
+  if (ddsi_content_filter_compile (&cf, wr->e.gv, wr->c.type_pair->complete, prd->c.xqos->content_filter) != DDS_RETCODE_OK)
+  {
+    ELOGDISC (wr, "  ddsi_writer_add_connection(wr "PGUIDFMT" prd "PGUIDFMT") - content filter \"%s\" not usable by writer\n",
+              PGUID (wr->e.guid), PGUID (prd->e.guid), prd->c.xqos->content_filter);
+    return NULL;
+  }
+  return cf;
+}
+#endif
+
+bool ddsi_writer_content_filter_rejects (const struct ddsi_wr_prd_match *m, const struct ddsi_serdata *serdata)
+{
+#ifdef DDS_HAS_TYPELIB
+  return m->content_filter != NULL && ddsi_content_filter_eval (m->content_filter, serdata) == DDSI_CONTENT_FILTER_REJECT;
+#else
+  (void) m;
+  (void) serdata;
+  return false;
+#endif
+}
+
+bool ddsi_wr_prd_match_has_content_filter (const struct ddsi_wr_prd_match *m)
+{
+#ifdef DDS_HAS_TYPELIB
+  return m->content_filter != NULL;
+#else
+  (void) m;
+  return false;
+#endif
+}
+
 void ddsi_writer_add_connection (struct ddsi_writer *wr, struct ddsi_proxy_reader *prd, int64_t crypto_handle)
 {
   struct ddsi_wr_prd_match *m = ddsrt_malloc (sizeof (*m));
@@ -763,6 +809,9 @@ void ddsi_writer_add_connection (struct ddsi_writer *wr, struct ddsi_proxy_reade
   m->crypto_handle = crypto_handle;
 #else
   DDSRT_UNUSED_ARG(crypto_handle);
+#endif
+#ifdef DDS_HAS_TYPELIB
+  m->content_filter = writer_compile_content_filter (wr, prd, m->via_psmx);
 #endif
   /* m->demoted: see below */
   ddsrt_mutex_lock (&prd->e.lock);
@@ -802,6 +851,9 @@ void ddsi_writer_add_connection (struct ddsi_writer *wr, struct ddsi_proxy_reade
               PGUID (wr->e.guid), PGUID (prd->e.guid));
     ddsrt_mutex_unlock (&wr->e.lock);
     ddsi_lat_estim_fini (&m->hb_to_ack_latency);
+#ifdef DDS_HAS_TYPELIB
+    ddsi_content_filter_free (m->content_filter);
+#endif
     ddsrt_free (m);
   }
   else
@@ -812,6 +864,10 @@ void ddsi_writer_add_connection (struct ddsi_writer *wr, struct ddsi_proxy_reade
     wr->num_readers++;
     wr->num_reliable_readers += m->is_reliable;
     wr->num_readers_requesting_keyhash += prd->requests_keyhash ? 1 : 0;
+    wr->num_readers_accepting_fec += prd->accepts_fec ? 1 : 0;
+#ifdef DDS_HAS_TYPELIB
+    wr->num_readers_with_content_filter += (m->content_filter != NULL) ? 1 : 0;
+#endif
     ddsi_rebuild_writer_addrset (wr);
     ddsrt_mutex_unlock (&wr->e.lock);
 
@@ -1222,6 +1278,10 @@ void ddsi_writer_drop_connection (const struct ddsi_guid *wr_guid, const struct
       wr->num_readers--;
       wr->num_reliable_readers -= m->is_reliable;
       wr->num_readers_requesting_keyhash -= prd->requests_keyhash ? 1 : 0;
+      wr->num_readers_accepting_fec -= prd->accepts_fec ? 1 : 0;
+#ifdef DDS_HAS_TYPELIB
+      wr->num_readers_with_content_filter -= (m->content_filter != NULL) ? 1 : 0;
+#endif
       ddsi_rebuild_writer_addrset (wr);
       ddsi_remove_acked_messages (wr, &whcst, &deferred_free_list);
     }
@@ -44,6 +44,7 @@
 #include "ddsi__nwinterfaces.h"
 #include "ddsi__xmsg.h"
 #include "ddsi__receive.h"
+#include "ddsi__partition_match.h"
 #include "ddsi__pcap.h"
 #include "ddsi__debmon.h"
 #include "ddsi__pmd.h"
@@ -487,7 +488,7 @@ static int set_ext_address_and_mask (struct ddsi_domaingv *gv)
 
 static int check_thread_properties (const struct ddsi_domaingv *gv)
 {
-  static const char *fixed[] = { "recv", "recvUC", "recvMC", "tev", "gc", "lease", "dq.builtins", "xmit.user", "dq.user", "debmon", "fsm", NULL };
+  static const char *fixed[] = { "recv", "recvUC", "recvMC", "tev", "gc", "lease", "dq.builtins", "xmit.user", "dq.user", "debmon", "fsm", "pcap", "tcpsend", NULL };
   const struct ddsi_config_thread_properties_listelem *e;
   int ok = 1, i;
   for (e = gv->config.thread_properties; e; e = e->next)
@@ -504,7 +505,7 @@ static int check_thread_properties (const struct ddsi_domaingv *gv)
   return ok;
 }
 
-static int ddsi_config_open_trace (struct ddsi_domaingv *gv)
+static int ddsi_config_open_trace (struct ddsi_domaingv *gv, const struct ddsi_cfgst *cfgst)
 {
   DDSRT_WARNING_MSVC_OFF(4996);
   int status;
@@ -535,6 +536,15 @@ static int ddsi_config_open_trace (struct ddsi_domaingv *gv)
     status = 1;
   }
 
+  /* asynchronous writing is stopped in ddsi_config_fini, so it requires a cfgst */
+  if (cfgst == NULL)
+    gv->config.tracingAsyncWrite = 0;
+  else if (gv->config.tracefp && gv->config.tracingAsyncWrite && dds_log_async_start () != DDS_RETCODE_OK)
+  {
+    DDS_ILOG (DDS_LC_WARNING, gv->config.domainId, "%s: cannot write asynchronously\n", gv->config.tracefile);
+    gv->config.tracingAsyncWrite = 0;
+  }
+
   dds_log_cfg_init (&gv->logconfig, gv->config.domainId, gv->config.tracemask, stderr, gv->config.tracefp);
   return status;
   DDSRT_WARNING_MSVC_ON(4996);
@@ -594,6 +604,12 @@ int ddsi_config_prep (struct ddsi_domaingv *gv, struct ddsi_cfgst *cfgst)
     goto err_config_late_error;
   }
 
+  if (gv->config.pcap_file && *gv->config.pcap_file && gv->config.pcap_bufsize < (uint64_t) gv->config.pcap_snaplen + 16)
+  {
+    DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "PacketCaptureBufferSize too small for PacketCaptureSnapLength\n");
+    goto err_config_late_error;
+  }
+
   if (gv->config.besmode == DDSI_BESMODE_MINIMAL && gv->config.many_sockets_mode == DDSI_MSM_MANY_UNICAST)
   {
     /* These two are incompatible because minimal bes mode can result
@@ -633,7 +649,7 @@ int ddsi_config_prep (struct ddsi_domaingv *gv, struct ddsi_cfgst *cfgst)
   }
 
   /* Open tracing file after all possible config errors have been printed */
-  if (!ddsi_config_open_trace (gv))
+  if (!ddsi_config_open_trace (gv, cfgst))
   {
     goto err_config_late_error;
   }
@@ -1137,6 +1153,7 @@ static int create_vnet_interface_for_psmx (struct ddsi_domaingv *gv, const char
   intf->point_to_point = false;
   intf->is_psmx = true;
   intf->allow_multicast = mc_capable ? DDSI_AMC_TRUE : DDSI_AMC_FALSE; // align with mc_capable
+  intf->max_rate = 0;
   intf->netmask.kind = DDSI_LOCATOR_KIND_INVALID;
   intf->netmask.port = DDSI_LOCATOR_PORT_INVALID;
   memset (intf->netmask.address, 0, sizeof (intf->netmask.address) - 6);
@@ -1434,6 +1451,7 @@ int ddsi_init (struct ddsi_domaingv *gv, struct ddsi_psmx_instance_locators *psm
   ddsrt_avl_init (&ddsi_typelib_treedef, &gv->typelib);
   ddsrt_avl_init (&ddsi_typedeps_treedef, &gv->typedeps);
   ddsrt_avl_init (&ddsi_typedeps_reverse_treedef, &gv->typedeps_reverse);
+  ddsi_assignability_memo_init (gv);
 #endif
   ddsrt_mutex_init (&gv->new_topic_lock);
   ddsrt_cond_init (&gv->new_topic_cond);
@@ -1497,6 +1515,7 @@ int ddsi_init (struct ddsi_domaingv *gv, struct ddsi_psmx_instance_locators *psm
   gv->spdp_reorder = ddsi_reorder_new (&gv->logconfig, DDSI_REORDER_MODE_ALWAYS_DELIVER, gv->config.primary_reorder_maxsamples, false);
 
   gv->m_tkmap = ddsi_tkmap_new (gv);
+  gv->partition_cache = ddsi_partition_cache_new ();
 
   if (gv->m_factory->m_connless)
   {
@@ -1560,17 +1579,9 @@ int ddsi_init (struct ddsi_domaingv *gv, struct ddsi_psmx_instance_locators *psm
   GVLOG (DDS_LC_CONFIG, "rtps_init: domainid %"PRIu32" participantid %d\n", gv->config.domainId, gv->config.participantIndex);
 
   if (gv->config.pcap_file && *gv->config.pcap_file)
-  {
-    gv->pcap_fp = ddsi_new_pcap_file (gv, gv->config.pcap_file);
-    if (gv->pcap_fp)
-    {
-      ddsrt_mutex_init (&gv->pcap_lock);
-    }
-  }
+    gv->pcap = ddsi_pcap_new (gv, gv->config.pcap_file);
   else
-  {
-    gv->pcap_fp = NULL;
-  }
+    gv->pcap = NULL;
 
   gv->mship = ddsi_new_mcgroup_membership();
   if (gv->m_factory->m_connless)
@@ -1665,6 +1676,7 @@ int ddsi_init (struct ddsi_domaingv *gv, struct ddsi_psmx_instance_locators *psm
     gv->intf_xlocators[i].conn = gv->xmit_conns[i];
     gv->intf_xlocators[i].c = gv->interfaces[i].loc;
   }
+  ddsi_xpack_shaping_init (gv);
 
   // Now that we know the interfaces and xmit_conns, we can convert the strings in the
   // network partition configuration to something useful.  Addresses must go first to
@@ -1734,14 +1746,16 @@ err_post_omg_security_init:
 err_joinleave_spdp:
   ddsi_free_config_nwpart_addresses (gv);
 err_network_partition_config:
+  ddsi_xpack_shaping_fini (gv);
 err_mc_conn:
   for (int i = 0; i < gv->n_interfaces; i++)
     gv->intf_xlocators[i].conn = NULL;
   free_conns (gv);
-  if (gv->pcap_fp)
-    ddsrt_mutex_destroy (&gv->pcap_lock);
+  if (gv->pcap)
+    ddsi_pcap_free (gv->pcap);
   ddsi_free_mcgroup_membership (gv->mship);
 err_unicast_sockets:
+  ddsi_partition_cache_free (gv->partition_cache);
   ddsi_tkmap_free (gv->m_tkmap);
   ddsi_reorder_free (gv->spdp_reorder);
   ddsi_defrag_free (gv->spdp_defrag);
@@ -1775,6 +1789,7 @@ err_unicast_sockets:
   ddsrt_avl_free (&ddsi_typelib_treedef, &gv->typelib, 0);
   ddsrt_avl_free (&ddsi_typedeps_treedef, &gv->typedeps, 0);
   ddsrt_avl_free (&ddsi_typedeps_reverse_treedef, &gv->typedeps_reverse, 0);
+  ddsi_assignability_memo_fini (gv);
   ddsrt_mutex_destroy (&gv->typelib_lock);
   ddsrt_cond_destroy (&gv->typelib_resolved_cond);
 #endif
@@ -1815,8 +1830,20 @@ int ddsi_start (struct ddsi_domaingv *gv)
 {
   ddsi_gcreq_queue_start (gv->gcreq_queue);
 
-  ddsi_dqueue_start (gv->builtins_dqueue);
-  ddsi_dqueue_start (gv->user_dqueue);
+  /* Without remote peers nothing ever goes through the delivery queues, so
+     their threads are created when the first sample (or gap) arrives */
+  ddsi_dqueue_start_on_demand (gv->builtins_dqueue);
+  ddsi_dqueue_start_on_demand (gv->user_dqueue);
+
+  /* Packets that have to wait because of traffic shaping are sent by the send
+     queue thread */
+  if (gv->xpack_shaping)
+  {
+    ddsrt_mutex_lock (&gv->sendq_running_lock);
+    ddsi_xpack_sendq_init (gv);
+    ddsi_xpack_sendq_start (gv);
+    ddsrt_mutex_unlock (&gv->sendq_running_lock);
+  }
 
   if (ddsi_xeventq_start (gv->xevents, NULL) < 0)
     return -1;
@@ -2046,14 +2073,12 @@ void ddsi_fini (struct ddsi_domaingv *gv)
   for (int i = 0; i < gv->n_interfaces; i++)
     gv->intf_xlocators[i].conn = NULL;
   free_conns (gv);
+  ddsi_xpack_shaping_fini (gv);
   ddsi_free_mcgroup_membership(gv->mship);
   ddsi_tran_factories_fini (gv);
 
-  if (gv->pcap_fp)
-  {
-    ddsrt_mutex_destroy (&gv->pcap_lock);
-    fclose (gv->pcap_fp);
-  }
+  if (gv->pcap)
+    ddsi_pcap_free (gv->pcap);
 
   ddsi_free_config_nwpart_addresses (gv);
   ddsi_unref_addrset (gv->as_disc);
@@ -2069,6 +2094,7 @@ void ddsi_fini (struct ddsi_domaingv *gv)
     ddsi_rbufpool_free (gv->recv_threads[i].arg.rbpool);
   }
 
+  ddsi_partition_cache_free (gv->partition_cache);
   ddsi_tkmap_free (gv->m_tkmap);
   ddsi_entity_index_free (gv->entity_index);
   gv->entity_index = NULL;
@@ -2100,6 +2126,7 @@ void ddsi_fini (struct ddsi_domaingv *gv)
   ddsrt_avl_free (&ddsi_typelib_treedef, &gv->typelib, 0);
   ddsrt_avl_free (&ddsi_typedeps_treedef, &gv->typedeps, 0);
   ddsrt_avl_free (&ddsi_typedeps_reverse_treedef, &gv->typedeps_reverse, 0);
+  ddsi_assignability_memo_fini (gv);
   ddsrt_mutex_destroy (&gv->typelib_lock);
 #endif /* DDS_HAS_TYPELIB */
 #ifndef NDEBUG
@@ -226,6 +226,7 @@ static enum maybe_add_interface_result maybe_add_interface (struct ddsi_domaingv
   dst->priority = loopback ? 2 : 0;
   dst->allow_multicast = DDSI_AMC_DEFAULT;
   dst->prefer_multicast = 0;
+  dst->max_rate = 0;
   *qout = q;
   return MAI_ADDED;
 }
@@ -371,6 +372,7 @@ static bool add_matching_interface (struct ddsi_domaingv *gv, struct interface_p
 
   act_iface->prefer_multicast = ((unsigned) cfg_iface->cfg.prefer_multicast) & 1;
   act_iface->allow_multicast = cfg_iface->cfg.allow_multicast;
+  act_iface->max_rate = cfg_iface->cfg.max_rate;
 
   if (!cfg_iface->cfg.priority.isdefault)
     act_iface->priority = cfg_iface->cfg.priority.value;
@@ -0,0 +1,307 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
+#include "ddsi__misc.h"
+#include "ddsi__partition_match.h"
+
+/* The cache is emptied when it exceeds these sizes, which keeps the memory
+   bounded without having to track the lifetime of the QoS objects */
+#define MAX_PARTITION_SETS 1024
+#define MAX_PARTITION_PAIRS 16384
+
+struct partition_name {
+  uint32_t hash;
+  const char *name;
+};
+
+enum partition_pattern_kind {
+  PPK_PREFIX,  /* literal prefix followed by only '*' (includes "*") */
+  PPK_GENERIC  /* anything else, uses ddsi_patmatch */
+};
+
+struct partition_pattern {
+  enum partition_pattern_kind kind;
+  size_t prefixlen;
+  const char *pat;
+};
+
+/* An interned partition QoS setting: the identity is the sequence of strings
+   as it occurs in the QoS, the names are split into those without wildcards
+   ("exact"), sorted on (hash, name), and wildcard patterns */
+struct partition_set {
+  uint32_t hash;
+  uint32_t n;
+  char **strs;
+  bool matches_default;
+  uint32_t nexact;
+  struct partition_name *exact;
+  uint32_t npats;
+  struct partition_pattern *pats;
+};
+
+struct partition_pair {
+  const struct partition_set *a, *b; /* a < b */
+  bool match;
+};
+
+struct ddsi_partition_cache {
+  ddsrt_mutex_t lock;
+  uint32_t nsets; /* [lock] */
+  uint32_t npairs; /* [lock] */
+  struct ddsrt_hh *sets; /* [lock] */
+  struct ddsrt_hh *pairs; /* [lock] */
+};
+
+static bool is_wildcard_partition (const char *str)
+{
+  return strchr (str, '*') || strchr (str, '?');
+}
+
+static uint32_t partition_name_hash (const char *name)
+{
+  return ddsrt_mh3 (name, strlen (name), 0);
+}
+
+static int partition_name_cmp (const void *va, const void *vb)
+{
+  const struct partition_name *a = va, *b = vb;
+  if (a->hash != b->hash)
+    return (a->hash < b->hash) ? -1 : 1;
+  return strcmp (a->name, b->name);
+}
+
+static bool partition_pattern_match (const struct partition_pattern *p, const char *name)
+{
+  switch (p->kind)
+  {
+    case PPK_PREFIX:
+      return strncmp (p->pat, name, p->prefixlen) == 0;
+    case PPK_GENERIC:
+      return ddsi_patmatch (p->pat, name);
+  }
+  return false;
+}
+
+static void partition_pattern_compile (struct partition_pattern *p, const char *pat)
+{
+  const size_t lit = strcspn (pat, "*?");
+  p->pat = pat;
+  p->prefixlen = lit;
+  p->kind = (pat[lit + strspn (pat + lit, "*")] == 0) ? PPK_PREFIX : PPK_GENERIC;
+}
+
+static uint32_t partition_set_hash_strs (uint32_t n, char * const *strs)
+{
+  uint32_t h = n;
+  for (uint32_t i = 0; i < n; i++)
+    h = ddsrt_mh3 (strs[i], strlen (strs[i]) + 1, h);
+  return h;
+}
+
+static uint32_t partition_set_hash (const void *vx)
+{
+  const struct partition_set *x = vx;
+  return x->hash;
+}
+
+static bool partition_set_equal (const void *va, const void *vb)
+{
+  const struct partition_set *a = va, *b = vb;
+  if (a->hash != b->hash || a->n != b->n)
+    return false;
+  for (uint32_t i = 0; i < a->n; i++)
+    if (strcmp (a->strs[i], b->strs[i]) != 0)
+      return false;
+  return true;
+}
+
+static uint32_t partition_pair_hash (const void *vx)
+{
+  const struct partition_pair *x = vx;
+  const uintptr_t k[2] = { (uintptr_t) x->a, (uintptr_t) x->b };
+  return ddsrt_mh3 (k, sizeof (k), 0);
+}
+
+static bool partition_pair_equal (const void *va, const void *vb)
+{
+  const struct partition_pair *a = va, *b = vb;
+  return a->a == b->a && a->b == b->b;
+}
+
+static struct partition_set *partition_set_new (uint32_t hash, uint32_t n, char * const *strs)
+{
+  struct partition_set *x = ddsrt_malloc (sizeof (*x));
+  x->hash = hash;
+  x->n = n;
+  x->strs = ddsrt_malloc ((n ? n : 1) * sizeof (*x->strs));
+  x->exact = ddsrt_malloc ((n ? n : 1) * sizeof (*x->exact));
+  x->pats = ddsrt_malloc ((n ? n : 1) * sizeof (*x->pats));
+  x->nexact = x->npats = 0;
+  x->matches_default = (n == 0);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    x->strs[i] = ddsrt_strdup (strs[i]);
+    if (!is_wildcard_partition (x->strs[i]))
+    {
+      x->exact[x->nexact].hash = partition_name_hash (x->strs[i]);
+      x->exact[x->nexact].name = x->strs[i];
+      x->nexact++;
+      if (x->strs[i][0] == 0)
+        x->matches_default = true;
+    }
+    else
+    {
+      partition_pattern_compile (&x->pats[x->npats], x->strs[i]);
+      if (partition_pattern_match (&x->pats[x->npats], ""))
+        x->matches_default = true;
+      x->npats++;
+    }
+  }
+  qsort (x->exact, x->nexact, sizeof (*x->exact), partition_name_cmp);
+  return x;
+}
+
+static void partition_set_free (void *vx, void *varg)
+{
+  struct partition_set *x = vx;
+  (void) varg;
+  for (uint32_t i = 0; i < x->n; i++)
+    ddsrt_free (x->strs[i]);
+  ddsrt_free (x->strs);
+  ddsrt_free (x->exact);
+  ddsrt_free (x->pats);
+  ddsrt_free (x);
+}
+
+static void partition_pair_free (void *vx, void *varg)
+{
+  (void) varg;
+  ddsrt_free (vx);
+}
+
+static bool partition_sets_exact_intersect (const struct partition_set *a, const struct partition_set *b)
+{
+  uint32_t i = 0, j = 0;
+  while (i < a->nexact && j < b->nexact)
+  {
+    const int c = partition_name_cmp (&a->exact[i], &b->exact[j]);
+    if (c == 0)
+      return true;
+    else if (c < 0)
+      i++;
+    else
+      j++;
+  }
+  return false;
+}
+
+static bool partition_patterns_match_exact (const struct partition_set *pats, const struct partition_set *names)
+{
+  for (uint32_t i = 0; i < pats->npats; i++)
+    for (uint32_t j = 0; j < names->nexact; j++)
+      if (partition_pattern_match (&pats->pats[i], names->exact[j].name))
+        return true;
+  return false;
+}
+
+static bool partition_sets_match (const struct partition_set *a, const struct partition_set *b)
+{
+  /* an empty partition QoS means the default partition; two patterns never match */
+  if (a->n == 0)
+    return b->matches_default;
+  else if (b->n == 0)
+    return a->matches_default;
+  else
+    return (partition_sets_exact_intersect (a, b) ||
+            partition_patterns_match_exact (a, b) ||
+            partition_patterns_match_exact (b, a));
+}
+
+static void partition_cache_free_contents (struct ddsi_partition_cache *pc)
+{
+  ddsrt_hh_enum (pc->pairs, partition_pair_free, NULL);
+  ddsrt_hh_free (pc->pairs);
+  ddsrt_hh_enum (pc->sets, partition_set_free, NULL);
+  ddsrt_hh_free (pc->sets);
+}
+
+static void partition_cache_init_contents (struct ddsi_partition_cache *pc)
+{
+  pc->sets = ddsrt_hh_new (32, partition_set_hash, partition_set_equal);
+  pc->pairs = ddsrt_hh_new (32, partition_pair_hash, partition_pair_equal);
+  pc->nsets = pc->npairs = 0;
+}
+
+static const struct partition_set *partition_cache_intern (struct ddsi_partition_cache *pc, const dds_qos_t *qos)
+{
+  const bool present = (qos->present & DDSI_QP_PARTITION) && qos->partition.n > 0;
+  const uint32_t n = present ? qos->partition.n : 0;
+  char * const *strs = present ? qos->partition.strs : NULL;
+  struct partition_set template = { .hash = partition_set_hash_strs (n, strs), .n = n, .strs = (char **) strs };
+  struct partition_set *x;
+  if ((x = ddsrt_hh_lookup (pc->sets, &template)) == NULL)
+  {
+    x = partition_set_new (template.hash, n, strs);
+    ddsrt_hh_add_absent (pc->sets, x);
+    pc->nsets++;
+  }
+  return x;
+}
+
+struct ddsi_partition_cache *ddsi_partition_cache_new (void)
+{
+  struct ddsi_partition_cache *pc = ddsrt_malloc (sizeof (*pc));
+  ddsrt_mutex_init (&pc->lock);
+  partition_cache_init_contents (pc);
+  return pc;
+}
+
+void ddsi_partition_cache_free (struct ddsi_partition_cache *pc)
+{
+  partition_cache_free_contents (pc);
+  ddsrt_mutex_destroy (&pc->lock);
+  ddsrt_free (pc);
+}
+
+bool ddsi_partition_cache_match (struct ddsi_partition_cache *pc, const dds_qos_t *a, const dds_qos_t *b)
+{
+  bool match;
+  ddsrt_mutex_lock (&pc->lock);
+  /* clearing before interning guarantees both sets survive until we're done */
+  if (pc->nsets + 2 > MAX_PARTITION_SETS || pc->npairs + 1 > MAX_PARTITION_PAIRS)
+  {
+    partition_cache_free_contents (pc);
+    partition_cache_init_contents (pc);
+  }
+  const struct partition_set *x = partition_cache_intern (pc, a);
+  const struct partition_set *y = partition_cache_intern (pc, b);
+  const bool swap = ((uintptr_t) x > (uintptr_t) y);
+  struct partition_pair template = { .a = swap ? y : x, .b = swap ? x : y };
+  struct partition_pair *p;
+  if ((p = ddsrt_hh_lookup (pc->pairs, &template)) == NULL)
+  {
+    p = ddsrt_malloc (sizeof (*p));
+    *p = template;
+    p->match = partition_sets_match (p->a, p->b);
+    ddsrt_hh_add_absent (pc->pairs, p);
+    pc->npairs++;
+  }
+  match = p->match;
+  ddsrt_mutex_unlock (&pc->lock);
+  return match;
+}
@@ -9,11 +9,19 @@
 // SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
 
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include "dds/ddsrt/endian.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
+#include "dds/ddsrt/static_assert.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
 #include "dds/ddsi/ddsi_log.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_statistics.h"
+#include "dds/ddsi/ddsi_thread.h"
 #include "ddsi__pcap.h"
 
 // pcap format info taken from http://wiki.wireshark.org/Development/LibpcapFileFormat
@@ -73,7 +81,33 @@ static const ipv4_hdr_t ipv4_hdr_template = {
 #define IPV4_HDR_SIZE 20
 #define UDP_HDR_SIZE 8
 
-FILE *ddsi_new_pcap_file (struct ddsi_domaingv *gv, const char *name)
+/* Packets are copied into a ring buffer, already formatted as pcap records,
+   by the sending and receiving threads and written to the file by a separate
+   thread.  If the buffer is full the packet is dropped from the capture so
+   as not to slow down the network processing. */
+struct ddsi_pcap {
+  struct ddsi_domaingv *gv;
+  struct ddsi_thread_state *thrst;
+  char *name;
+  uint32_t snaplen;
+  uint32_t max_file_size; /* 0 = unlimited */
+  uint32_t bufsize;
+  unsigned char *buf;
+
+  /* only accessed by the writer thread once it has been started */
+  FILE *fp;
+  uint32_t fileseq;
+  uint64_t filesize;
+
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  uint64_t wpos, rpos; /* [lock], in [rpos,wpos) is pending, rest is free */
+  bool terminate; /* [lock] */
+  uint64_t packets; /* [lock] */
+  uint64_t dropped; /* [lock] */
+};
+
+static FILE *open_pcap_file (struct ddsi_domaingv *gv, const char *name, uint32_t snaplen)
 {
   DDSRT_WARNING_MSVC_OFF(4996);
   FILE *fp;
@@ -90,7 +124,7 @@ FILE *ddsi_new_pcap_file (struct ddsi_domaingv *gv, const char *name)
   hdr.version_minor = 4;
   hdr.thiszone = 0;
   hdr.sigfigs = 0;
-  hdr.snaplen = 65535;
+  hdr.snaplen = snaplen;
   hdr.network = LINKTYPE_RAW;
   (void) fwrite (&hdr, sizeof (hdr), 1, fp);
 
@@ -98,17 +132,152 @@ FILE *ddsi_new_pcap_file (struct ddsi_domaingv *gv, const char *name)
   DDSRT_WARNING_MSVC_ON(4996);
 }
 
-static void write_data (FILE *fp, const ddsrt_msghdr_t *msghdr, size_t sz)
+static void copy_out (const struct ddsi_pcap *pc, uint64_t pos, void *dst, size_t n)
+{
+  const size_t off = (size_t) (pos % pc->bufsize);
+  const size_t n1 = (off + n <= pc->bufsize) ? n : pc->bufsize - off;
+  memcpy (dst, pc->buf + off, n1);
+  memcpy ((unsigned char *) dst + n1, pc->buf, n - n1);
+}
+
+static void write_range (struct ddsi_pcap *pc, uint64_t pos, size_t n)
+{
+  const size_t off = (size_t) (pos % pc->bufsize);
+  const size_t n1 = (off + n <= pc->bufsize) ? n : pc->bufsize - off;
+  if (pc->fp == NULL)
+    return;
+  (void) fwrite (pc->buf + off, 1, n1, pc->fp);
+  if (n1 < n)
+    (void) fwrite (pc->buf, 1, n - n1, pc->fp);
+  pc->filesize += n;
+}
+
+static void rotate (struct ddsi_pcap *pc)
+{
+  struct ddsi_domaingv * const gv = pc->gv;
+  char *name;
+  if (pc->fp)
+    fclose (pc->fp);
+  ddsrt_asprintf (&name, "%s.%"PRIu32, pc->name, ++pc->fileseq);
+  pc->fp = open_pcap_file (gv, name, pc->snaplen);
+  pc->filesize = sizeof (pcap_hdr_t);
+  ddsrt_free (name);
+}
+
+static uint64_t write_pending (struct ddsi_pcap *pc, uint64_t r, uint64_t w)
 {
-  size_t i, n = 0;
-  for (i = 0; i < (size_t) msghdr->msg_iovlen && n < sz; i++)
+  if (pc->max_file_size == 0)
   {
-    size_t m1 = msghdr->msg_iov[i].iov_len;
-    size_t m = (n + m1 <= sz) ? m1 : sz - n;
-    (void) fwrite (msghdr->msg_iov[i].iov_base, m, 1, fp);
-    n += m;
+    write_range (pc, r, (size_t) (w - r));
+    return w;
   }
-  assert (n == sz);
+  while (r < w)
+  {
+    pcaprec_hdr_t rec;
+    copy_out (pc, r, &rec, sizeof (rec));
+    const size_t n = sizeof (rec) + rec.incl_len;
+    if (pc->filesize + n > pc->max_file_size && pc->filesize > sizeof (pcap_hdr_t))
+      rotate (pc);
+    write_range (pc, r, n);
+    r += n;
+  }
+  return r;
+}
+
+static uint32_t pcap_writer_thread (void *vpc)
+{
+  struct ddsi_pcap * const pc = vpc;
+  ddsrt_mutex_lock (&pc->lock);
+  while (!pc->terminate || pc->rpos != pc->wpos)
+  {
+    if (pc->rpos == pc->wpos)
+    {
+      ddsrt_mutex_unlock (&pc->lock);
+      if (pc->fp)
+        fflush (pc->fp);
+      ddsrt_mutex_lock (&pc->lock);
+      if (!pc->terminate && pc->rpos == pc->wpos)
+        ddsrt_cond_wait (&pc->cond, &pc->lock);
+    }
+    else
+    {
+      /* the range between rpos and wpos is not touched by the producers, so
+         it can be written without holding the lock */
+      const uint64_t r = pc->rpos, w = pc->wpos;
+      ddsrt_mutex_unlock (&pc->lock);
+      const uint64_t r1 = write_pending (pc, r, w);
+      ddsrt_mutex_lock (&pc->lock);
+      pc->rpos = r1;
+    }
+  }
+  ddsrt_mutex_unlock (&pc->lock);
+  return 0;
+}
+
+struct ddsi_pcap *ddsi_pcap_new (struct ddsi_domaingv *gv, const char *name)
+{
+  const struct ddsi_config * const config = &gv->config;
+  FILE *fp;
+  if ((fp = open_pcap_file (gv, name, config->pcap_snaplen)) == NULL)
+    return NULL;
+
+  struct ddsi_pcap *pc = ddsrt_malloc (sizeof (*pc));
+  pc->gv = gv;
+  pc->name = ddsrt_strdup (name);
+  pc->snaplen = config->pcap_snaplen;
+  pc->max_file_size = config->pcap_max_file_size;
+  pc->bufsize = config->pcap_bufsize;
+  pc->buf = ddsrt_malloc (pc->bufsize);
+  pc->fp = fp;
+  pc->fileseq = 0;
+  pc->filesize = sizeof (pcap_hdr_t);
+  ddsrt_mutex_init (&pc->lock);
+  ddsrt_cond_init (&pc->cond);
+  pc->wpos = pc->rpos = 0;
+  pc->terminate = false;
+  pc->packets = pc->dropped = 0;
+  if (ddsi_create_thread (&pc->thrst, gv, "pcap", pcap_writer_thread, pc) != DDS_RETCODE_OK)
+  {
+    GVWARNING ("packet capture disabled: failed to create writer thread\n");
+    ddsrt_cond_destroy (&pc->cond);
+    ddsrt_mutex_destroy (&pc->lock);
+    fclose (fp);
+    ddsrt_free (pc->buf);
+    ddsrt_free (pc->name);
+    ddsrt_free (pc);
+    return NULL;
+  }
+  return pc;
+}
+
+void ddsi_pcap_free (struct ddsi_pcap *pc)
+{
+  ddsrt_mutex_lock (&pc->lock);
+  pc->terminate = true;
+  ddsrt_cond_broadcast (&pc->cond);
+  ddsrt_mutex_unlock (&pc->lock);
+  ddsi_join_thread (pc->thrst);
+  if (pc->fp)
+    fclose (pc->fp);
+  if (pc->dropped > 0)
+  {
+    struct ddsi_domaingv * const gv = pc->gv;
+    GVWARNING ("packet capture: %"PRIu64" of %"PRIu64" packets dropped\n", pc->dropped, pc->packets + pc->dropped);
+  }
+  ddsrt_cond_destroy (&pc->cond);
+  ddsrt_mutex_destroy (&pc->lock);
+  ddsrt_free (pc->buf);
+  ddsrt_free (pc->name);
+  ddsrt_free (pc);
+}
+
+static void copy_in (struct ddsi_pcap *pc, const void *src, size_t n)
+{
+  const size_t off = (size_t) (pc->wpos % pc->bufsize);
+  const size_t n1 = (off + n <= pc->bufsize) ? n : pc->bufsize - off;
+  memcpy (pc->buf + off, src, n1);
+  memcpy (pc->buf, (const unsigned char *) src + n1, n - n1);
+  pc->wpos += n;
 }
 
 static uint16_t calc_ipv4_checksum (const uint16_t *x)
@@ -123,36 +292,67 @@ static uint16_t calc_ipv4_checksum (const uint16_t *x)
   return (uint16_t) ~s;
 }
 
+static void append_packet (struct ddsi_pcap *pc, ddsrt_wctime_t tstamp, unsigned char ttl, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, const ddsrt_iovec_t *iov, size_t niov, size_t sz)
+{
+  union {
+    struct {
+      ipv4_hdr_t ipv4_hdr;
+      udp_hdr_t udp_hdr;
+    } h;
+    uint16_t x[10];
+  } u;
+  pcaprec_hdr_t pcap_hdr;
+  const size_t sz_ud = sz + UDP_HDR_SIZE;
+  const size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
+  DDSRT_STATIC_ASSERT (sizeof (u.h) == IPV4_HDR_SIZE + UDP_HDR_SIZE);
+
+  ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, tstamp);
+  pcap_hdr.orig_len = (uint32_t) sz_iud;
+  pcap_hdr.incl_len = (sz_iud < pc->snaplen) ? (uint32_t) sz_iud : pc->snaplen;
+  u.h.ipv4_hdr = ipv4_hdr_template;
+  u.h.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
+  u.h.ipv4_hdr.ttl = ttl;
+  u.h.ipv4_hdr.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
+  u.h.ipv4_hdr.dstip = ((struct sockaddr_in*) dst)->sin_addr.s_addr;
+  u.h.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
+  u.h.udp_hdr.srcport = ((struct sockaddr_in*) src)->sin_port;
+  u.h.udp_hdr.dstport = ((struct sockaddr_in*) dst)->sin_port;
+  u.h.udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
+  u.h.udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
+
+  ddsrt_mutex_lock (&pc->lock);
+  if (pc->bufsize - (pc->wpos - pc->rpos) < sizeof (pcap_hdr) + pcap_hdr.incl_len)
+  {
+    pc->dropped++;
+    ddsrt_mutex_unlock (&pc->lock);
+    return;
+  }
+  const bool was_empty = (pc->wpos == pc->rpos);
+  size_t rem = pcap_hdr.incl_len;
+  copy_in (pc, &pcap_hdr, sizeof (pcap_hdr));
+  copy_in (pc, &u.h, (rem < sizeof (u.h)) ? rem : sizeof (u.h));
+  rem = (rem < sizeof (u.h)) ? 0 : rem - sizeof (u.h);
+  for (size_t i = 0; i < niov && rem > 0; i++)
+  {
+    const size_t m = (iov[i].iov_len <= rem) ? iov[i].iov_len : rem;
+    copy_in (pc, iov[i].iov_base, m);
+    rem -= m;
+  }
+  assert (rem == 0);
+  pc->packets++;
+  if (was_empty)
+    ddsrt_cond_broadcast (&pc->cond);
+  ddsrt_mutex_unlock (&pc->lock);
+}
+
 void ddsi_write_pcap_received (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, unsigned char *buf, size_t sz)
 {
   if (gv->config.transport_selector == DDSI_TRANS_UDP)
   {
-    pcaprec_hdr_t pcap_hdr;
-    union {
-      ipv4_hdr_t ipv4_hdr;
-      uint16_t x[10];
-    } u;
-    udp_hdr_t udp_hdr;
-    size_t sz_ud = sz + UDP_HDR_SIZE;
-    size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
-    ddsrt_mutex_lock (&gv->pcap_lock);
-    ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, tstamp);
-    pcap_hdr.incl_len = pcap_hdr.orig_len = (uint32_t) sz_iud;
-    (void) fwrite (&pcap_hdr, sizeof (pcap_hdr), 1, gv->pcap_fp);
-    u.ipv4_hdr = ipv4_hdr_template;
-    u.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
-    u.ipv4_hdr.ttl = 128;
-    u.ipv4_hdr.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
-    u.ipv4_hdr.dstip = ((struct sockaddr_in*) dst)->sin_addr.s_addr;
-    u.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
-    (void) fwrite (&u.ipv4_hdr, sizeof (u.ipv4_hdr), 1, gv->pcap_fp);
-    udp_hdr.srcport = ((struct sockaddr_in*) src)->sin_port;
-    udp_hdr.dstport = ((struct sockaddr_in*) dst)->sin_port;
-    udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
-    udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
-    (void) fwrite (&udp_hdr, sizeof (udp_hdr), 1, gv->pcap_fp);
-    (void) fwrite (buf, sz, 1, gv->pcap_fp);
-    ddsrt_mutex_unlock (&gv->pcap_lock);
+    ddsrt_iovec_t iov;
+    iov.iov_base = buf;
+    iov.iov_len = (ddsrt_iov_len_t) sz;
+    append_packet (gv->pcap, tstamp, 128, src, dst, &iov, 1, sz);
   }
 }
 
@@ -160,31 +360,20 @@ void ddsi_write_pcap_sent (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, cons
 {
   if (gv->config.transport_selector == DDSI_TRANS_UDP)
   {
-    pcaprec_hdr_t pcap_hdr;
-    union {
-      ipv4_hdr_t ipv4_hdr;
-      uint16_t x[10];
-    } u;
-    udp_hdr_t udp_hdr;
-    size_t sz_ud = sz + UDP_HDR_SIZE;
-    size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
-    ddsrt_mutex_lock (&gv->pcap_lock);
-    ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, tstamp);
-    pcap_hdr.incl_len = pcap_hdr.orig_len = (uint32_t) sz_iud;
-    (void) fwrite (&pcap_hdr, sizeof (pcap_hdr), 1, gv->pcap_fp);
-    u.ipv4_hdr = ipv4_hdr_template;
-    u.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
-    u.ipv4_hdr.ttl = 255;
-    u.ipv4_hdr.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
-    u.ipv4_hdr.dstip = ((struct sockaddr_in*) hdr->msg_name)->sin_addr.s_addr;
-    u.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
-    (void) fwrite (&u.ipv4_hdr, sizeof (u.ipv4_hdr), 1, gv->pcap_fp);
-    udp_hdr.srcport = ((struct sockaddr_in*) src)->sin_port;
-    udp_hdr.dstport = ((struct sockaddr_in*) hdr->msg_name)->sin_port;
-    udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
-    udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
-    (void) fwrite (&udp_hdr, sizeof (udp_hdr), 1, gv->pcap_fp);
-    write_data (gv->pcap_fp, hdr, sz);
-    ddsrt_mutex_unlock (&gv->pcap_lock);
+    append_packet (gv->pcap, tstamp, 255, src, hdr->msg_name, hdr->msg_iov, (size_t) hdr->msg_iovlen, sz);
+  }
+}
+
+void ddsi_get_pcap_stats (struct ddsi_domaingv *gv, uint64_t * __restrict packets, uint64_t * __restrict dropped)
+{
+  struct ddsi_pcap * const pc = gv->pcap;
+  if (pc == NULL)
+  {
+    *packets = *dropped = 0;
+    return;
   }
+  ddsrt_mutex_lock (&pc->lock);
+  *packets = pc->packets;
+  *dropped = pc->dropped;
+  ddsrt_mutex_unlock (&pc->lock);
 }
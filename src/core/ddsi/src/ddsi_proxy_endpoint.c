@@ -368,6 +368,9 @@ int ddsi_new_proxy_writer (struct ddsi_proxy_writer **proxy_writer, struct ddsi_
     pwr->filtered = 1;
   }
 
+  /* The delivery thread can't be created when the first sample is enqueued,
+     because that happens with locks held */
+  (void) ddsi_dqueue_ensure_started (dqueue);
   pwr->dqueue = dqueue;
   pwr->evq = evq;
 
@@ -642,6 +645,7 @@ int ddsi_new_proxy_reader (struct ddsi_proxy_reader **proxy_reader, struct ddsi_
   prd->is_fict_trans_reader = 0;
   prd->receive_buffer_size = proxypp->receive_buffer_size;
   prd->requests_keyhash = (plist->present & PP_CYCLONE_REQUESTS_KEYHASH) && plist->cyclone_requests_keyhash;
+  prd->accepts_fec = (plist->present & PP_CYCLONE_ACCEPTS_FEC) && plist->cyclone_accepts_fec;
   if (plist->present & PP_CYCLONE_REDUNDANT_NETWORKING)
     prd->redundant_networking = (plist->cyclone_redundant_networking != 0);
   else
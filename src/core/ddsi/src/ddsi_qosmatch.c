@@ -18,56 +18,10 @@
 #include "dds/ddsi/ddsi_qosmatch.h"
 #include "ddsi__typelookup.h"
 #include "ddsi__misc.h"
+#include "ddsi__partition_match.h"
 #include "ddsi__typelib.h"
 #include "dds/dds.h"
 
-static int is_wildcard_partition (const char *str)
-{
-  return strchr (str, '*') || strchr (str, '?');
-}
-
-static int partition_patmatch_p (const char *pat, const char *name)
-{
-  /* pat may be a wildcard expression, name must not be */
-  if (!is_wildcard_partition (pat))
-    /* no wildcard in pat => must equal name */
-    return (strcmp (pat, name) == 0);
-  else if (is_wildcard_partition (name))
-    /* (we know: wildcard in pat) => wildcard in name => no match */
-    return 0;
-  else
-    return ddsi_patmatch (pat, name);
-}
-
-static int partitions_match_default (const dds_qos_t *x)
-{
-  if (!(x->present & DDSI_QP_PARTITION) || x->partition.n == 0)
-    return 1;
-  for (uint32_t i = 0; i < x->partition.n; i++)
-    if (partition_patmatch_p (x->partition.strs[i], ""))
-      return 1;
-  return 0;
-}
-
-static int partitions_match_p (const dds_qos_t *a, const dds_qos_t *b)
-{
-  if (!(a->present & DDSI_QP_PARTITION) || a->partition.n == 0)
-    return partitions_match_default (b);
-  else if (!(b->present & DDSI_QP_PARTITION) || b->partition.n == 0)
-    return partitions_match_default (a);
-  else
-  {
-    for (uint32_t i = 0; i < a->partition.n; i++)
-      for (uint32_t j = 0; j < b->partition.n; j++)
-      {
-        if (partition_patmatch_p (a->partition.strs[i], b->partition.strs[j]) ||
-            partition_patmatch_p (b->partition.strs[j], a->partition.strs[i]))
-          return 1;
-      }
-    return 0;
-  }
-}
-
 #ifdef DDS_HAS_TYPELIB
 
 static uint32_t is_endpoint_type_resolved (struct ddsi_domaingv *gv, char *type_name, const ddsi_type_pair_t *type_pair, bool *req_lookup, const char *entity)
@@ -144,7 +98,6 @@ bool ddsi_qos_match_mask_p (
 #endif
 )
 {
-  DDSRT_UNUSED_ARG (gv);
 #ifndef NDEBUG
   uint64_t musthave = (DDSI_QP_RXO_MASK | DDSI_QP_PARTITION | DDSI_QP_TOPIC_NAME | DDSI_QP_TYPE_NAME | DDSI_QP_DATA_REPRESENTATION) & mask;
   assert ((rd_qos->present & musthave) == musthave);
@@ -210,7 +163,7 @@ bool ddsi_qos_match_mask_p (
     *reason = DDS_DESTINATIONORDER_QOS_POLICY_ID;
     return false;
   }
-  if ((mask & DDSI_QP_PARTITION) && !partitions_match_p (rd_qos, wr_qos)) {
+  if ((mask & DDSI_QP_PARTITION) && !ddsi_partition_cache_match (gv->partition_cache, rd_qos, wr_qos)) {
     *reason = DDS_PARTITION_QOS_POLICY_ID;
     return false;
   }
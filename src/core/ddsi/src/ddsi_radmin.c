@@ -26,10 +26,12 @@
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_log.h"
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/ddsi_unused.h"
 #include "dds/ddsi/ddsi_domaingv.h" /* for mattr, cattr */
+#include "dds/ddsi/ddsi_proxy_endpoint.h" /* for pwr guid in probes */
 #include "ddsi__protocol.h"
 #include "ddsi__log.h"
 #include "ddsi__misc.h"
@@ -280,6 +282,7 @@ struct ddsi_rbufpool {
   uint32_t max_rmsg_size;
   const struct ddsrt_log_cfg *logcfg;
   bool trace;
+  ddsrt_atomic_uint32_t n_rbufs; /* number of rbufs allocated from this pool and not yet freed */
 #ifndef NDEBUG
   /* Thread that owns this pool, so we can check that no other thread
      is calling functions only the owner may use. */
@@ -355,6 +358,7 @@ struct ddsi_rbufpool *ddsi_rbufpool_new (const struct ddsrt_log_cfg *logcfg, uin
   rbp->max_rmsg_size = max_rmsg_size;
   rbp->logcfg = logcfg;
   rbp->trace = (logcfg->c.mask & DDS_LC_RADMIN) != 0;
+  ddsrt_atomic_st32 (&rbp->n_rbufs, 0);
 
 #if USE_VALGRIND
   VALGRIND_CREATE_MEMPOOL (rbp, 0, 0);
@@ -441,6 +445,7 @@ static struct ddsi_rbuf *ddsi_rbuf_alloc_new (struct ddsi_rbufpool *rbp)
   rb->max_rmsg_size = rbp->max_rmsg_size;
   rb->freeptr = rb->raw;
   rb->trace = rbp->trace;
+  ddsrt_atomic_inc32 (&rbp->n_rbufs);
   RBPTRACE ("rbuf_alloc_new(%p) = %p\n", (void *) rbp, (void *) rb);
   return rb;
 }
@@ -467,10 +472,17 @@ static void ddsi_rbuf_release (struct ddsi_rbuf *rbuf)
   if (ddsrt_atomic_dec32_ov (&rbuf->n_live_rmsg_chunks) == 1)
   {
     RBPTRACE ("rbuf_release(%p) free\n", (void *) rbuf);
+    ddsrt_atomic_dec32 (&rbp->n_rbufs);
     ddsrt_free (rbuf);
   }
 }
 
+void ddsi_rbufpool_stats (struct ddsi_rbufpool *rbp, uint32_t *nbufs, uint64_t *bytes)
+{
+  *nbufs = ddsrt_atomic_ld32 (&rbp->n_rbufs);
+  *bytes = *nbufs * (uint64_t) (sizeof (struct ddsi_rbuf) + rbp->rbuf_size);
+}
+
 /* RMSG ---------------------------------------------------------------- */
 
 /* There are at most 64kB / 32B = 2**11 rdatas in one rmsg, because an
@@ -858,6 +870,7 @@ struct ddsi_defrag {
   uint32_t max_samples;
   enum ddsi_defrag_drop_mode drop_mode;
   uint64_t discarded_bytes;
+  uint64_t discarded_samples; /* incomplete samples dropped because of max_samples */
   const struct ddsrt_log_cfg *logcfg;
   bool trace;
 };
@@ -894,14 +907,16 @@ struct ddsi_defrag *ddsi_defrag_new (const struct ddsrt_log_cfg *logcfg, enum dd
   d->n_samples = 0;
   d->max_sample = NULL;
   d->discarded_bytes = 0;
+  d->discarded_samples = 0;
   d->logcfg = logcfg;
   d->trace = (logcfg->c.mask & DDS_LC_RADMIN) != 0;
   return d;
 }
 
-void ddsi_defrag_stats (struct ddsi_defrag *defrag, uint64_t *discarded_bytes)
+void ddsi_defrag_stats (struct ddsi_defrag *defrag, uint64_t *discarded_bytes, uint64_t *discarded_samples)
 {
   *discarded_bytes = defrag->discarded_bytes;
+  *discarded_samples = defrag->discarded_samples;
 }
 
 void ddsi_fragchain_adjust_refcount (struct ddsi_rdata *frag, int adjust)
@@ -1294,6 +1309,7 @@ static int defrag_limit_samples (struct ddsi_defrag *defrag, ddsi_seqno_t seq, d
       if (seq > defrag->max_sample->u.defrag.seq)
       {
         TRACE (defrag, "  new sample is new latest => discarding it\n");
+        defrag->discarded_samples++;
         return 0;
       }
       sample_to_drop = defrag->max_sample;
@@ -1305,12 +1321,14 @@ static int defrag_limit_samples (struct ddsi_defrag *defrag, ddsi_seqno_t seq, d
       if (seq < sample_to_drop->u.defrag.seq)
       {
         TRACE (defrag, "  new sample is new oldest => discarding it\n");
+        defrag->discarded_samples++;
         return 0;
       }
       break;
   }
   assert (sample_to_drop != NULL);
   defrag_rsample_drop (defrag, sample_to_drop);
+  defrag->discarded_samples++;
   if (sample_to_drop == defrag->max_sample)
   {
     defrag->max_sample = ddsrt_avl_find_max (&defrag_sampletree_treedef, &defrag->sampletree);
@@ -1574,6 +1592,90 @@ void ddsi_defrag_prune (struct ddsi_defrag *defrag, ddsi_guid_prefix_t *dst, dds
   defrag->max_sample = ddsrt_avl_find_max (&defrag_sampletree_treedef, &defrag->sampletree);
 }
 
+static void defrag_xor_range (const struct ddsi_rsample_defrag *dfsample, uint32_t min, uint32_t maxp1, uint32_t gmin, uint32_t slotsize, unsigned char *parity)
+{
+  /* XORs bytes [min,maxp1) of the sample into parity, folding them by slot; the caller
+     guarantees all bytes in this range are present */
+  const struct ddsi_defrag_iv *iv = ddsrt_avl_lookup_pred_eq (&rsample_defrag_fragtree_treedef, &dfsample->fragtree, &min);
+  uint32_t off = min;
+  while (off < maxp1)
+  {
+    assert (iv != NULL && iv->min <= off && iv->maxp1 > off);
+    for (const struct ddsi_rdata *frag = iv->first; frag != NULL && off < maxp1 && off < iv->maxp1; frag = frag->nextfrag)
+    {
+      if (frag->maxp1 > off)
+      {
+        /* fragments in an interval are contiguous, so this one must contain off */
+        const unsigned char *payload = DDSI_RMSG_PAYLOADOFF (frag->rmsg, DDSI_RDATA_PAYLOAD_OFF (frag));
+        const uint32_t end = (frag->maxp1 < maxp1) ? frag->maxp1 : maxp1;
+        assert (frag->min <= off);
+        for (; off < end; off++)
+          parity[(off - gmin) % slotsize] ^= payload[off - frag->min];
+      }
+    }
+    iv = ddsrt_avl_find_succ (&rsample_defrag_fragtree_treedef, &dfsample->fragtree, iv);
+  }
+}
+
+bool ddsi_defrag_fec_recover (struct ddsi_defrag *defrag, ddsi_seqno_t seq, uint32_t size, uint32_t gmin, uint32_t gmaxp1, uint32_t slotsize, unsigned char *parity, uint32_t *slotmin, uint32_t *slotmaxp1)
+{
+  struct ddsi_rsample *s;
+  const struct ddsi_defrag_iv *iv;
+  uint32_t pos, miss_min = UINT32_MAX, miss_maxp1 = 0;
+  assert (gmin < gmaxp1 && slotsize > 0);
+
+  if (defrag->max_sample && defrag->max_sample->u.defrag.seq == seq)
+    s = defrag->max_sample;
+  else if ((s = ddsrt_avl_lookup (&defrag_sampletree_treedef, &defrag->sampletree, &seq)) == NULL)
+    return false;
+  const struct ddsi_rsample_defrag *dfsample = &s->u.defrag;
+  if (dfsample->sampleinfo->size != size || gmaxp1 > size)
+    return false;
+
+  /* Locate the bytes missing in [gmin,gmaxp1); there is always an interval starting at
+     0 (the sentinel), so there always is a predecessor-or-equal */
+  iv = ddsrt_avl_lookup_pred_eq (&rsample_defrag_fragtree_treedef, &dfsample->fragtree, &gmin);
+  assert (iv != NULL);
+  pos = gmin;
+  while (pos < gmaxp1)
+  {
+    if (iv && iv->min <= pos)
+    {
+      if (iv->maxp1 > pos)
+        pos = iv->maxp1;
+      iv = ddsrt_avl_find_succ (&rsample_defrag_fragtree_treedef, &dfsample->fragtree, iv);
+    }
+    else
+    {
+      const uint32_t end = (iv && iv->min < gmaxp1) ? iv->min : gmaxp1;
+      if (miss_min == UINT32_MAX)
+        miss_min = pos;
+      miss_maxp1 = end;
+      pos = end;
+    }
+  }
+  if (miss_min == UINT32_MAX)
+  {
+    TRACE (defrag, "defrag_fec_recover(%p seq %"PRIu64" [%"PRIu32"..%"PRIu32")) nothing missing\n", (void *) defrag, seq, gmin, gmaxp1);
+    return false;
+  }
+
+  /* Single parity: recoverable only if all missing bytes are in one slot */
+  const uint32_t smin = gmin + ((miss_min - gmin) / slotsize) * slotsize;
+  const uint32_t smaxp1 = (gmaxp1 - smin > slotsize) ? smin + slotsize : gmaxp1;
+  if (miss_maxp1 > smaxp1)
+  {
+    TRACE (defrag, "defrag_fec_recover(%p seq %"PRIu64" [%"PRIu32"..%"PRIu32")) missing [%"PRIu32"..%"PRIu32") spans slots\n", (void *) defrag, seq, gmin, gmaxp1, miss_min, miss_maxp1);
+    return false;
+  }
+  defrag_xor_range (dfsample, gmin, smin, gmin, slotsize, parity);
+  defrag_xor_range (dfsample, smaxp1, gmaxp1, gmin, slotsize, parity);
+  TRACE (defrag, "defrag_fec_recover(%p seq %"PRIu64" [%"PRIu32"..%"PRIu32")) recovered [%"PRIu32"..%"PRIu32")\n", (void *) defrag, seq, gmin, gmaxp1, smin, smaxp1);
+  *slotmin = smin;
+  *slotmaxp1 = smaxp1;
+  return true;
+}
+
 /* REORDER -------------------------------------------------------------
 
    The reorder index tracks out-of-order messages as non-overlapping,
@@ -1658,6 +1760,7 @@ struct ddsi_reorder {
   uint32_t max_samples;
   uint32_t n_samples;
   uint64_t discarded_bytes;
+  uint64_t discarded_samples;
   const struct ddsrt_log_cfg *logcfg;
   bool late_ack_mode;
   bool trace;
@@ -1678,15 +1781,23 @@ struct ddsi_reorder *ddsi_reorder_new (const struct ddsrt_log_cfg *logcfg, enum
   r->max_samples = max_samples;
   r->n_samples = 0;
   r->discarded_bytes = 0;
+  r->discarded_samples = 0;
   r->late_ack_mode = late_ack_mode;
   r->logcfg = logcfg;
   r->trace = (logcfg->c.mask & DDS_LC_RADMIN) != 0;
   return r;
 }
 
-void ddsi_reorder_stats (struct ddsi_reorder *reorder, uint64_t *discarded_bytes)
+void ddsi_reorder_stats (struct ddsi_reorder *reorder, uint64_t *discarded_bytes, uint64_t *discarded_samples)
 {
   *discarded_bytes = reorder->discarded_bytes;
+  *discarded_samples = reorder->discarded_samples;
+}
+
+static void reorder_discard (struct ddsi_reorder *reorder, const struct ddsi_rsample_info *sampleinfo)
+{
+  reorder->discarded_bytes += sampleinfo->size;
+  reorder->discarded_samples++;
 }
 
 void ddsi_fragchain_unref (struct ddsi_rdata *frag)
@@ -1855,7 +1966,7 @@ static void delete_last_sample (struct ddsi_reorder *reorder)
        recalc max_sampleiv. */
     TRACE (reorder, "  delete_last_sample: in singleton interval\n");
     if (last->sc.first->sampleinfo)
-      reorder->discarded_bytes += last->sc.first->sampleinfo->size;
+      reorder_discard (reorder, last->sc.first->sampleinfo);
     fragchain = last->sc.first->fragchain;
     ddsrt_avl_delete (&reorder_sampleivtree_treedef, &reorder->sampleivtree, reorder->max_sampleiv);
     reorder->max_sampleiv = ddsrt_avl_find_max (&reorder_sampleivtree_treedef, &reorder->sampleivtree);
@@ -1880,7 +1991,7 @@ static void delete_last_sample (struct ddsi_reorder *reorder)
       e = e->next;
     } while (e != last->sc.last);
     if (e->sampleinfo)
-      reorder->discarded_bytes += e->sampleinfo->size;
+      reorder_discard (reorder, e->sampleinfo);
     fragchain = e->fragchain;
     pe->next = NULL;
     assert (pe->sampleinfo == NULL || pe->sampleinfo->seq + 1 < last->maxp1);
@@ -1942,7 +2053,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     if (delivery_queue_full_p)
     {
       TRACE (reorder, "  discarding deliverable sample: delivery queue is full\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
 
@@ -1975,7 +2086,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     /* we've moved beyond this one: discard it; no need to adjust
        n_samples */
     TRACE (reorder, "  discard: too old\n");
-    reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+    reorder_discard (reorder, s->sc.first->sampleinfo);
     return DDSI_REORDER_TOO_OLD; /* don't want refcount increment */
   }
   else if (ddsrt_avl_is_empty (&reorder->sampleivtree))
@@ -1988,7 +2099,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     if (reorder->max_samples == 0)
     {
       TRACE (reorder, "  NOT - max_samples hit\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
     else
@@ -2005,7 +2116,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     {
       /* growing last inteval will not be accepted when this flag is set */
       TRACE (reorder, "  discarding sample: only accepting delayed samples due to backlog in delivery queue\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
 
@@ -2019,7 +2130,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     else
     {
       TRACE (reorder, "  discarding sample: max_samples reached and sample at end\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
   }
@@ -2029,7 +2140,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     {
       /* new interval at the end will not be accepted when this flag is set */
       TRACE (reorder, "  discarding sample: only accepting delayed samples due to backlog in delivery queue\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
     if (reorder->n_samples < reorder->max_samples)
@@ -2042,7 +2153,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     else
     {
       TRACE (reorder, "  discarding sample: max_samples reached and sample at end\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
   }
@@ -2061,7 +2172,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     if (reorder->late_ack_mode && delivery_queue_full_p)
     {
       TRACE (reorder, "  discarding sample: delivery queue full\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
 
@@ -2075,7 +2186,7 @@ ddsi_reorder_result_t ddsi_reorder_rsample (struct ddsi_rsample_chain *sc, struc
     {
       /* contained in predeq */
       TRACE (reorder, "  discard: contained in predeq\n");
-      reorder->discarded_bytes += s->sc.first->sampleinfo->size;
+      reorder_discard (reorder, s->sc.first->sampleinfo);
       return DDSI_REORDER_REJECT;
     }
 
@@ -2500,10 +2611,21 @@ struct ddsi_dqueue {
   struct ddsi_rsample_chain sc;
 
   struct ddsi_thread_state *thrst;
+  bool start_on_demand; /* [lock] create thread in ddsi_dqueue_ensure_started */
+  bool starting; /* [lock] thread being created by ddsi_dqueue_ensure_started */
   struct ddsi_domaingv *gv;
   char *name;
   uint32_t max_samples;
   ddsrt_atomic_uint32_t nof_samples;
+
+  /* Statistics, protected by lock; the wait time is the time from the
+     queue becoming non-empty to the delivery thread picking up its
+     contents and so bounds the queueing delay of the oldest sample */
+  ddsrt_mtime_t t_nonempty;
+  uint64_t delivered;
+  uint64_t wait_time;
+  uint64_t max_wait_time;
+  uint64_t full_waits;
 };
 
 enum dqueue_elem_kind {
@@ -2604,6 +2726,7 @@ static uint32_t dqueue_thread (struct ddsi_dqueue *q)
   int keepgoing = 1;
   ddsi_guid_t rdguid, *prdguid = NULL;
   uint32_t rdguid_count = 0;
+  uint32_t delivered = 0;
 
   ddsrt_mutex_lock (&q->lock);
   while (keepgoing)
@@ -2612,8 +2735,17 @@ static uint32_t dqueue_thread (struct ddsi_dqueue *q)
 
     LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
 
+    q->delivered += delivered;
+    delivered = 0;
     if (q->sc.first == NULL)
       ddsrt_cond_wait (&q->cond, &q->lock);
+    if (q->sc.first != NULL)
+    {
+      const int64_t wait_time = ddsrt_time_monotonic ().v - q->t_nonempty.v;
+      q->wait_time += (uint64_t) wait_time;
+      if ((uint64_t) wait_time > q->max_wait_time)
+        q->max_wait_time = (uint64_t) wait_time;
+    }
     sc = q->sc;
     q->sc.first = q->sc.last = NULL;
     ddsrt_mutex_unlock (&q->lock);
@@ -2634,6 +2766,7 @@ static uint32_t dqueue_thread (struct ddsi_dqueue *q)
           ret = q->handler (e->sampleinfo, e->fragchain, prdguid, q->handler_arg);
           (void) ret; /* eliminate set-but-not-used in NDEBUG case */
           assert (ret == 0); /* so every handler will return 0 */
+          delivered++;
           /* FALLS THROUGH */
         case DQEK_GAP:
           ddsi_fragchain_unref (e->fragchain);
@@ -2682,6 +2815,7 @@ static uint32_t dqueue_thread (struct ddsi_dqueue *q)
     ddsi_thread_state_asleep (thrst);
     ddsrt_mutex_lock (&q->lock);
   }
+  q->delivered += delivered;
   ddsrt_mutex_unlock (&q->lock);
   return 0;
 }
@@ -2701,6 +2835,13 @@ struct ddsi_dqueue *ddsi_dqueue_new (const char *name, const struct ddsi_domaing
   q->sc.first = q->sc.last = NULL;
   q->gv = (struct ddsi_domaingv *) gv;
   q->thrst = NULL;
+  q->start_on_demand = false;
+  q->starting = false;
+  q->t_nonempty = DDSRT_MTIME_NEVER;
+  q->delivered = 0;
+  q->wait_time = 0;
+  q->max_wait_time = 0;
+  q->full_waits = 0;
 
   ddsrt_mutex_init (&q->lock);
   ddsrt_cond_init (&q->cond);
@@ -2712,7 +2853,7 @@ struct ddsi_dqueue *ddsi_dqueue_new (const char *name, const struct ddsi_domaing
   return NULL;
 }
 
-bool ddsi_dqueue_start (struct ddsi_dqueue *q)
+static bool dqueue_create_thread (struct ddsi_dqueue *q, struct ddsi_thread_state **thrst)
 {
   char *thrname;
   size_t thrnamesz;
@@ -2720,18 +2861,92 @@ bool ddsi_dqueue_start (struct ddsi_dqueue *q)
   if ((thrname = ddsrt_malloc (thrnamesz)) == NULL)
     return false;
   (void) snprintf (thrname, thrnamesz, "dq.%s", q->name);
-  dds_return_t ret = ddsi_create_thread (&q->thrst, q->gv, thrname, (uint32_t (*) (void *)) dqueue_thread, q);
+  dds_return_t ret = ddsi_create_thread (thrst, q->gv, thrname, (uint32_t (*) (void *)) dqueue_thread, q);
   ddsrt_free (thrname);
   return ret == DDS_RETCODE_OK;
 }
 
+bool ddsi_dqueue_start (struct ddsi_dqueue *q)
+{
+  return dqueue_create_thread (q, &q->thrst);
+}
+
+void ddsi_dqueue_start_on_demand (struct ddsi_dqueue *q)
+{
+  ddsrt_mutex_lock (&q->lock);
+  q->start_on_demand = true;
+  ddsrt_mutex_unlock (&q->lock);
+}
+
+bool ddsi_dqueue_ensure_started (struct ddsi_dqueue *q)
+{
+  bool ok;
+  ddsrt_mutex_lock (&q->lock);
+  while (q->starting)
+    ddsrt_cond_wait (&q->cond, &q->lock);
+  if (q->thrst != NULL || !q->start_on_demand)
+    ok = true;
+  else
+  {
+    /* Creating a thread takes long enough that it shouldn't be done while holding
+       the lock, enqueueing (which may be done with the proxy writer locked) would
+       have to wait for it.  A failure is not remembered, so the next call retries. */
+    struct ddsi_thread_state *thrst;
+    q->starting = true;
+    ddsrt_mutex_unlock (&q->lock);
+    ok = dqueue_create_thread (q, &thrst);
+    ddsrt_mutex_lock (&q->lock);
+    if (ok)
+      q->thrst = thrst;
+    q->starting = false;
+    ddsrt_cond_broadcast (&q->cond);
+  }
+  ddsrt_mutex_unlock (&q->lock);
+  return ok;
+}
+
+static void dqueue_drop_chain (struct ddsi_dqueue *q, struct ddsi_rsample_chain_elem *first)
+{
+  while (first)
+  {
+    struct ddsi_rsample_chain_elem *e = first;
+    first = e->next;
+    ddsrt_atomic_dec32 (&q->nof_samples);
+    switch (dqueue_elem_kind (e))
+    {
+      case DQEK_DATA:
+      case DQEK_GAP:
+        ddsi_fragchain_unref (e->fragchain);
+        break;
+      case DQEK_BUBBLE: {
+        struct ddsi_dqueue_bubble *b = (struct ddsi_dqueue_bubble *) e->sampleinfo;
+        if (b->kind != DDSI_DQBK_STOP)
+          ddsrt_free (b);
+        break;
+      }
+    }
+  }
+}
+
 static int ddsi_dqueue_enqueue_locked (struct ddsi_dqueue *q, struct ddsi_rsample_chain *sc)
 {
   int must_signal;
+  /* A queue started on demand has a thread if ddsi_dqueue_ensure_started was
+     called and succeeded.  If it didn't, the samples are dropped: delivering
+     them here instead is not an option because this may be called with the
+     proxy writer locked, and callbacks never get here because they are invoked
+     directly until the thread exists. */
+  if (q->thrst == NULL && q->start_on_demand)
+  {
+    DDS_CERROR (&q->gv->logconfig, "dqueue %s: no delivery thread, dropping samples\n", q->name);
+    dqueue_drop_chain (q, sc->first);
+    return 1;
+  }
   if (q->sc.first == NULL)
   {
     must_signal = 1;
     q->sc = *sc;
+    q->t_nonempty = ddsrt_time_monotonic ();
   }
   else
   {
@@ -2742,12 +2957,18 @@ static int ddsi_dqueue_enqueue_locked (struct ddsi_dqueue *q, struct ddsi_rsampl
   return must_signal;
 }
 
+/* Gaps have no sampleinfo, but a chain with samples always starts with one */
+#define DQUEUE_ENQUEUE_PROBE(q, sc, rres) \
+  DDSRT_PROBE4 (dqueue_enqueue, (q), (sc)->first->sampleinfo ? &(sc)->first->sampleinfo->pwr->e.guid : NULL, \
+                (sc)->first->sampleinfo ? (sc)->first->sampleinfo->seq : 0, (rres))
+
 bool ddsi_dqueue_enqueue_deferred_wakeup (struct ddsi_dqueue *q, struct ddsi_rsample_chain *sc, ddsi_reorder_result_t rres)
 {
   bool signal;
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
+  DQUEUE_ENQUEUE_PROBE (q, sc, rres);
   ddsrt_mutex_lock (&q->lock);
   ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
   signal = ddsi_dqueue_enqueue_locked (q, sc);
@@ -2767,6 +2988,7 @@ void ddsi_dqueue_enqueue (struct ddsi_dqueue *q, struct ddsi_rsample_chain *sc,
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
+  DQUEUE_ENQUEUE_PROBE (q, sc, rres);
   ddsrt_mutex_lock (&q->lock);
   ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
   if (ddsi_dqueue_enqueue_locked (q, sc))
@@ -2796,6 +3018,17 @@ static void ddsi_dqueue_enqueue_bubble (struct ddsi_dqueue *q, struct ddsi_dqueu
 void ddsi_dqueue_enqueue_callback (struct ddsi_dqueue *q, ddsi_dqueue_callback_t cb, void *arg)
 {
   struct ddsi_dqueue_bubble *b;
+  ddsrt_mutex_lock (&q->lock);
+  if (q->thrst == NULL && q->start_on_demand)
+  {
+    /* Nothing was ever enqueued, so there is nothing to wait for and no
+       point in starting the thread just to invoke the callback */
+    assert (q->sc.first == NULL);
+    ddsrt_mutex_unlock (&q->lock);
+    cb (arg);
+    return;
+  }
+  ddsrt_mutex_unlock (&q->lock);
   b = ddsrt_malloc (sizeof (*b));
   b->kind = DDSI_DQBK_CALLBACK;
   b->u.cb.cb = cb;
@@ -2816,6 +3049,7 @@ void ddsi_dqueue_enqueue1 (struct ddsi_dqueue *q, const ddsi_guid_t *rdguid, str
   assert (rdguid != NULL);
   assert (sc->first);
   assert (sc->last->next == NULL);
+  DQUEUE_ENQUEUE_PROBE (q, sc, rres);
   ddsrt_mutex_lock (&q->lock);
   ddsrt_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
   if (ddsi_dqueue_enqueue_bubble_locked (q, b))
@@ -2843,6 +3077,7 @@ void ddsi_dqueue_wait_until_empty_if_full (struct ddsi_dqueue *q)
   if (count >= q->max_samples)
   {
     ddsrt_mutex_lock (&q->lock);
+    q->full_waits++;
     /* In case the wakeups are were all deferred */
     ddsrt_cond_broadcast (&q->cond);
     while (ddsrt_atomic_ld32 (&q->nof_samples) > 0)
@@ -2851,27 +3086,15 @@ void ddsi_dqueue_wait_until_empty_if_full (struct ddsi_dqueue *q)
   }
 }
 
-static void dqueue_free_remaining_elements (struct ddsi_dqueue *q)
+void ddsi_dqueue_stats (struct ddsi_dqueue *q, uint32_t *length, uint64_t *delivered, uint64_t *wait_time, uint64_t *max_wait_time, uint64_t *full_waits)
 {
-  assert (q->thrst == NULL);
-  while (q->sc.first)
-  {
-    struct ddsi_rsample_chain_elem *e = q->sc.first;
-    q->sc.first = e->next;
-    switch (dqueue_elem_kind (e))
-    {
-      case DQEK_DATA:
-      case DQEK_GAP:
-        ddsi_fragchain_unref (e->fragchain);
-        break;
-      case DQEK_BUBBLE: {
-        struct ddsi_dqueue_bubble *b = (struct ddsi_dqueue_bubble *) e->sampleinfo;
-        if (b->kind != DDSI_DQBK_STOP)
-          ddsrt_free (b);
-        break;
-      }
-    }
-  }
+  ddsrt_mutex_lock (&q->lock);
+  *length = ddsrt_atomic_ld32 (&q->nof_samples);
+  *delivered = q->delivered;
+  *wait_time = q->wait_time;
+  *max_wait_time = q->max_wait_time;
+  *full_waits = q->full_waits;
+  ddsrt_mutex_unlock (&q->lock);
 }
 
 void ddsi_dqueue_free (struct ddsi_dqueue *q)
@@ -2892,7 +3115,8 @@ void ddsi_dqueue_free (struct ddsi_dqueue *q)
   }
   else
   {
-    dqueue_free_remaining_elements (q);
+    dqueue_drop_chain (q, q->sc.first);
+    q->sc.first = q->sc.last = NULL;
   }
   ddsrt_cond_destroy (&q->cond);
   ddsrt_mutex_destroy (&q->lock);
@@ -20,6 +20,7 @@
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_unused.h"
 #include "dds/ddsi/ddsi_gc.h"
 #include "dds/ddsi/ddsi_proxy_participant.h"
@@ -1018,7 +1019,7 @@ static int handle_AckNack (struct ddsi_receiver_state *rst, ddsrt_etime_t tnow,
         if (!wr->retransmitting && sample.unacked)
           ddsi_writer_set_retransmitting (wr);
 
-        if (rst->gv->config.retransmit_merging != DDSI_REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter)
+        if (rst->gv->config.retransmit_merging != DDSI_REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter && !ddsi_wr_prd_match_has_content_filter (rn))
         {
           /* send retransmit to all receivers, but skip if recently done */
           ddsrt_mtime_t tstamp = ddsrt_time_monotonic ();
@@ -1048,9 +1049,9 @@ static int handle_AckNack (struct ddsi_receiver_state *rst, ddsrt_etime_t tnow,
         }
         else
         {
-          /* Is this a volatile reader with a filter?
+          /* Is this a volatile reader with a filter, or a reader with a content filter?
            * If so, call the filter to see if we should re-arrange the sequence gap when needed. */
-          if (prd->filter && !prd->filter (wr, prd, sample.serdata))
+          if ((prd->filter && !prd->filter (wr, prd, sample.serdata)) || ddsi_writer_content_filter_rejects (rn, sample.serdata))
             ddsi_gap_info_update (rst->gv, &gi, seqbase + i);
           else
           {
@@ -2323,6 +2324,7 @@ static void handle_regular (struct ddsi_receiver_state *rst, ddsrt_etime_t tnow,
     RSTTRACE (" "PGUIDFMT"? -> "PGUIDFMT, PGUID (src), PGUID (dst));
     return;
   }
+  DDSRT_PROBE3 (handle_regular, &pwr->e.guid, sampleinfo->seq, sampleinfo->timestamp.v);
 
   /* Proxy participant's "automatic" lease has to be renewed always, manual-by-participant one only
      for data published by the application.  If pwr->lease exists, it is in some manual lease mode,
@@ -2541,6 +2543,7 @@ static int handle_SPDP (const struct ddsi_rsample_info *sampleinfo, struct ddsi_
   struct ddsi_rdata *fragchain;
   ddsi_reorder_result_t rres;
   int refc_adjust = 0;
+  (void) ddsi_dqueue_ensure_started (gv->builtins_dqueue);
   ddsrt_mutex_lock (&gv->spdp_lock);
   rsample = ddsi_defrag_rsample (gv->spdp_defrag, rdata, sampleinfo);
   fragchain = ddsi_rsample_fragchain (rsample);
@@ -2765,6 +2768,69 @@ static int handle_DataFrag (struct ddsi_receiver_state *rst, ddsrt_etime_t tnow,
   return 1;
 }
 
+static int handle_FecParity (struct ddsi_receiver_state *rst, ddsrt_etime_t tnow, struct ddsi_rmsg *rmsg, ddsi_rtps_fecparity_t *msg, struct ddsi_rsample_info *sampleinfo, const ddsi_keyhash_t *keyhash, unsigned char *datap, uint32_t datasz, struct ddsi_dqueue **deferred_wakeup, ddsi_rtps_submessage_kind_t prev_smid)
+{
+  struct ddsi_proxy_writer * const pwr = sampleinfo->pwr;
+  const uint32_t nslots = msg->x.extraFlags;
+  RSTTRACE ("FEC_PARITY("PGUIDFMT" -> "PGUIDFMT" #%"PRIu64"/[%"PRIu32"..%"PRIu32"]x%"PRIu32,
+            PGUIDPREFIX (rst->src_guid_prefix), msg->x.writerId.u,
+            PGUIDPREFIX (rst->dst_guid_prefix), msg->x.readerId.u,
+            ddsi_from_seqno (msg->x.writerSN),
+            msg->fragmentStartingNum, (ddsi_fragment_number_t) (msg->fragmentStartingNum + msg->fragmentsInSubmessage - 1), nslots);
+  if (!rst->forme)
+  {
+    RSTTRACE (" not-for-me)");
+    return 1;
+  }
+  if (pwr == NULL || nslots == 0 || sampleinfo->size > rst->gv->config.max_sample_size)
+  {
+    RSTTRACE (" ignored)");
+    return 1;
+  }
+  if (!ddsi_security_validate_msg_decoding (&pwr->e, &pwr->c, pwr->c.proxypp, rst, prev_smid))
+  {
+    RSTTRACE (" clear submsg from protected src "PGUIDFMT")", PGUID (pwr->e.guid));
+    return 1;
+  }
+
+  /* Validation as a DataFrag guarantees the first slot starts inside the sample and
+     that the payload covers the first slot (or the remainder of the sample) */
+  const uint32_t slotsize = (uint32_t) msg->fragmentsInSubmessage * msg->fragmentSize;
+  const uint32_t gmin = (msg->fragmentStartingNum - 1) * msg->fragmentSize;
+  const uint64_t gend = (uint64_t) gmin + (uint64_t) nslots * slotsize;
+  const uint32_t gmaxp1 = (gend < sampleinfo->size) ? (uint32_t) gend : sampleinfo->size;
+  const uint32_t plen = (gmaxp1 - gmin > slotsize) ? slotsize : gmaxp1 - gmin;
+  uint32_t smin, smaxp1;
+  bool recovered;
+  if (datasz < plen)
+  {
+    RSTTRACE (" short)");
+    return 1;
+  }
+  ddsrt_mutex_lock (&pwr->e.lock);
+  recovered = ddsi_defrag_fec_recover (pwr->defrag, sampleinfo->seq, sampleinfo->size, gmin, gmaxp1, slotsize, datap, &smin, &smaxp1);
+  ddsrt_mutex_unlock (&pwr->e.lock);
+  if (!recovered)
+  {
+    RSTTRACE (" not-needed)");
+    return 1;
+  }
+
+  /* The payload now holds the reconstructed slot: rewrite the header in-place so that it
+     is indistinguishable from the DataFrag that got lost and process it as such */
+  size_t size = (size_t) (datap - (unsigned char *) msg) + (smaxp1 - smin);
+  msg->x.smhdr.submessageId = DDSI_RTPS_SMID_DATA_FRAG;
+  msg->x.extraFlags = 0;
+  msg->fragmentStartingNum = smin / msg->fragmentSize + 1;
+  msg->fragmentsInSubmessage = (uint16_t) ((smaxp1 - smin + msg->fragmentSize - 1) / msg->fragmentSize);
+  RSTTRACE (" recovered [%"PRIu32"..%"PRIu32"))", smin, smaxp1);
+  if (!ddsi_security_decode_datafrag (rst->gv, sampleinfo, datap, smaxp1 - smin, &size))
+    return 1;
+  if (smin == 0 && !set_sampleinfo_bswap (sampleinfo, (struct dds_cdr_header *) datap))
+    return 1;
+  return handle_DataFrag (rst, tnow, rmsg, msg, size, sampleinfo, keyhash, datap, deferred_wakeup, prev_smid);
+}
+
 struct submsg_name {
   char x[32];
 };
@@ -2788,6 +2854,7 @@ static const char *submsg_name (ddsi_rtps_submessage_kind_t id, struct submsg_na
     case DDSI_RTPS_SMID_DATA: return "DATA";
     case DDSI_RTPS_SMID_ADLINK_MSG_LEN: return "ADLINK_MSG_LEN";
     case DDSI_RTPS_SMID_ADLINK_ENTITY_ID: return "ADLINK_ENTITY_ID";
+    case DDSI_RTPS_SMID_CYCLONE_FEC_PARITY: return "CYCLONE_FEC_PARITY";
     case DDSI_RTPS_SMID_SEC_PREFIX: return "SEC_PREFIX";
     case DDSI_RTPS_SMID_SEC_BODY: return "SEC_BODY";
     case DDSI_RTPS_SMID_SEC_POSTFIX: return "SEC_POSTFIX";
@@ -3175,6 +3242,23 @@ static int handle_submsg_sequence
         ts_for_latmeas = 0;
         break;
       }
+      case DDSI_RTPS_SMID_CYCLONE_FEC_PARITY: {
+        struct ddsi_rsample_info sampleinfo;
+        uint32_t datasz = 0;
+        unsigned char *datap;
+        const ddsi_keyhash_t *keyhash;
+        if (!ddsi_vendor_is_eclipse (rst->vendor)) {
+          // vendor-specific submessage ids are only meaningful for our own vendor id
+          GVTRACE ("UNDEFINED(%x)", sm->smhdr.submessageId);
+        } else if ((vr = validate_DataFrag (rst, &sm->datafrag, submsg_size, byteswap, &sampleinfo, &keyhash, &datap, &datasz)) == VR_ACCEPT) {
+          sampleinfo.timestamp = timestamp;
+          sampleinfo.reception_timestamp = tnowWC;
+          handle_FecParity (rst, tnowE, rmsg, &sm->datafrag, &sampleinfo, keyhash, datap, datasz, &deferred_wakeup, prev_smid);
+          rst_live = 1;
+        }
+        ts_for_latmeas = 0;
+        break;
+      }
       case DDSI_RTPS_SMID_SEC_PREFIX: {
         GVTRACE ("SEC_PREFIX ");
         if (!ddsi_security_decode_sec_prefix(rst, submsg, submsg_size, end, &rst->src_guid_prefix, &rst->dst_guid_prefix, byteswap))
@@ -3366,8 +3450,11 @@ static bool do_packet (struct ddsi_thread_state * const thrst, struct ddsi_domai
     sz = ddsi_conn_read (conn, buff, buff_len, true, &pktinfo);
   }
 
+  if (sz > 0)
+    ddsi_conn_count_rx (conn, (size_t) sz);
   if (sz > 0 && !gv->deaf)
   {
+    DDSRT_PROBE2 (packet, conn, sz);
     ddsi_rmsg_setsize (rmsg, (uint32_t) sz);
     handle_rtps_message(thrst, gv, conn, guidprefix, rbpool, rmsg, (size_t) sz, buff, &pktinfo);
   }
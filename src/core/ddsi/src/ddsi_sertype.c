@@ -23,6 +23,7 @@
 #include "dds/ddsi/ddsi_sertype.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_typelib.h"
 #include "ddsi__plist_generic.h"
 #include "ddsi__serdata_pserop.h"
 #include "dds/cdr/dds_cdrstream.h"
@@ -184,6 +185,7 @@ void ddsi_sertype_init_props (struct ddsi_sertype *tp, const char *type_name, co
   tp->sizeof_type = (uint32_t) sizeof_type;
   tp->data_type_props = data_type_props;
   ddsrt_atomic_stvoidp (&tp->gv, NULL);
+  ddsrt_atomic_stvoidp (&tp->type_info_cache, NULL);
 }
 
 void ddsi_sertype_init_flags (struct ddsi_sertype *tp, const char *type_name, const struct ddsi_sertype_ops *sertype_ops, const struct ddsi_serdata_ops *serdata_ops, uint32_t flags)
@@ -204,6 +206,11 @@ void ddsi_sertype_init (struct ddsi_sertype *tp, const char *type_name, const st
 void ddsi_sertype_fini (struct ddsi_sertype *tp)
 {
   assert ((ddsrt_atomic_ld32 (&tp->flags_refc) & DDSI_SERTYPE_REFC_MASK) == 0);
+#ifdef DDS_HAS_TYPELIB
+  ddsi_typeinfo_t *type_info = ddsrt_atomic_ldvoidp (&tp->type_info_cache);
+  if (type_info != NULL)
+    ddsi_typeinfo_free (type_info);
+#endif
   ddsrt_free (tp->type_name);
 }
 
@@ -10,6 +10,7 @@
 
 #include <string.h>
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/hdrhist.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsi/ddsi_endpoint.h"
@@ -17,7 +18,11 @@
 #include "ddsi__entity.h"
 #include "ddsi__endpoint_match.h"
 #include "ddsi__radmin.h"
+#include "ddsi__thread.h"
 #include "ddsi__proxy_endpoint.h"
+#include "ddsi__tran.h"
+#include "ddsi__xevent.h"
+#include "ddsi__xmsg.h"
 
 void ddsi_get_writer_stats (struct ddsi_writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit)
 {
@@ -29,7 +34,7 @@ void ddsi_get_writer_stats (struct ddsi_writer *wr, uint64_t * __restrict rexmit
   ddsrt_mutex_unlock (&wr->e.lock);
 }
 
-void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discarded_bytes)
+void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discarded_bytes, uint64_t * __restrict discarded_samples)
 {
   struct ddsi_rd_pwr_match *m;
   ddsi_guid_t pwrguid;
@@ -37,6 +42,7 @@ void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discar
   assert (ddsi_thread_is_awake ());
 
   *discarded_bytes = 0;
+  *discarded_samples = 0;
 
   // collect for all matched proxy writers
   ddsrt_mutex_lock (&rd->e.lock);
@@ -47,17 +53,18 @@ void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discar
     ddsrt_mutex_unlock (&rd->e.lock);
     if ((pwr = ddsi_entidx_lookup_proxy_writer_guid (rd->e.gv->entity_index, &pwrguid)) != NULL)
     {
-      uint64_t disc_frags, disc_samples;
+      uint64_t disc_frags, disc_samples, ndisc_frag_samples, ndisc_samples;
       ddsrt_mutex_lock (&pwr->e.lock);
       struct ddsi_pwr_rd_match *x = ddsrt_avl_lookup (&ddsi_pwr_readers_treedef, &pwr->readers, &rd->e.guid);
       if (x != NULL)
       {
-        ddsi_defrag_stats (pwr->defrag, &disc_frags);
+        ddsi_defrag_stats (pwr->defrag, &disc_frags, &ndisc_frag_samples);
         if (x->in_sync != PRMSS_OUT_OF_SYNC && !x->filtered)
-          ddsi_reorder_stats (pwr->reorder, &disc_samples);
+          ddsi_reorder_stats (pwr->reorder, &disc_samples, &ndisc_samples);
         else
-          ddsi_reorder_stats (x->u.not_in_sync.reorder, &disc_samples);
+          ddsi_reorder_stats (x->u.not_in_sync.reorder, &disc_samples, &ndisc_samples);
         *discarded_bytes += disc_frags + disc_samples;
+        *discarded_samples += ndisc_frag_samples + ndisc_samples;
       }
       ddsrt_mutex_unlock (&pwr->e.lock);
     }
@@ -65,3 +72,151 @@ void ddsi_get_reader_stats (struct ddsi_reader *rd, uint64_t * __restrict discar
   }
   ddsrt_mutex_unlock (&rd->e.lock);
 }
+
+void ddsi_reader_enable_latency_stats (struct ddsi_reader *rd)
+{
+  /* 1.6% resolution, separate buckets up to ~18 minutes */
+  if (ddsrt_atomic_ldvoidp (&rd->latency_hist) == NULL)
+  {
+    struct ddsrt_hdrhist *hist = ddsrt_hdrhist_new (6, 40);
+    if (!ddsrt_atomic_casvoidp (&rd->latency_hist, NULL, hist))
+      ddsrt_hdrhist_free (hist);
+  }
+}
+
+void ddsi_get_reader_latency_stats (struct ddsi_reader *rd, uint64_t * __restrict count, uint64_t * __restrict min, uint64_t * __restrict p50, uint64_t * __restrict p90, uint64_t * __restrict p99, uint64_t * __restrict p999, uint64_t * __restrict max)
+{
+  const struct ddsrt_hdrhist *hist = ddsrt_atomic_ldvoidp (&rd->latency_hist);
+  if (hist == NULL || (*count = ddsrt_hdrhist_count (hist)) == 0)
+  {
+    *count = *min = *p50 = *p90 = *p99 = *p999 = *max = 0;
+    return;
+  }
+  *min = ddsrt_hdrhist_min (hist);
+  *p50 = ddsrt_hdrhist_percentile (hist, 50.0);
+  *p90 = ddsrt_hdrhist_percentile (hist, 90.0);
+  *p99 = ddsrt_hdrhist_percentile (hist, 99.0);
+  *p999 = ddsrt_hdrhist_percentile (hist, 99.9);
+  *max = ddsrt_hdrhist_max (hist);
+}
+
+void ddsi_enum_conn_stats (struct ddsi_domaingv *gv, ddsi_conn_stats_cb_t cb, void *arg)
+{
+  /* the same connection can serve multiple purposes, e.g., data and discovery, or
+     unicast reception and transmission, so eliminate the duplicates */
+  struct ddsi_tran_conn *conns[4 + MAX_XMIT_CONNS];
+  struct ddsi_tran_conn * const cands[] = { gv->disc_conn_uc, gv->data_conn_uc, gv->disc_conn_mc, gv->data_conn_mc };
+  size_t n = 0;
+  for (size_t i = 0; i < 4 + MAX_XMIT_CONNS; i++)
+  {
+    struct ddsi_tran_conn * const c = (i < 4) ? cands[i] : gv->xmit_conns[i - 4];
+    size_t j;
+    for (j = 0; j < n && conns[j] != c; j++)
+      ;
+    if (c != NULL && j == n)
+      conns[n++] = c;
+  }
+  for (size_t i = 0; i < n; i++)
+  {
+    struct ddsi_conn_stats st;
+    ddsi_locator_t loc;
+    if (ddsi_conn_locator (conns[i], &loc) != 0)
+      continue;
+    if (conns[i]->m_interf != NULL)
+      memcpy (loc.address, conns[i]->m_interf->loc.address, sizeof (loc.address));
+    ddsi_conn_stats (conns[i], &st.rx_packets, &st.rx_bytes, &st.tx_packets, &st.tx_bytes);
+    cb (&loc, &st, arg);
+  }
+}
+
+static void add_conn_stats (const ddsi_locator_t *loc, const struct ddsi_conn_stats *cst, void *varg)
+{
+  struct ddsi_domain_stats * const st = varg;
+  (void) loc;
+  st->rx_packets += cst->rx_packets;
+  st->rx_bytes += cst->rx_bytes;
+  st->tx_packets += cst->tx_packets;
+  st->tx_bytes += cst->tx_bytes;
+}
+
+void ddsi_get_domain_stats (struct ddsi_domaingv *gv, struct ddsi_domain_stats * __restrict st)
+{
+  memset (st, 0, sizeof (*st));
+
+  struct ddsi_dqueue * const dqs[] = { gv->builtins_dqueue, gv->user_dqueue };
+  for (size_t i = 0; i < sizeof (dqs) / sizeof (dqs[0]); i++)
+  {
+    uint32_t length;
+    uint64_t delivered, wait_time, max_wait_time, full_waits;
+    if (dqs[i] == NULL)
+      continue;
+    ddsi_dqueue_stats (dqs[i], &length, &delivered, &wait_time, &max_wait_time, &full_waits);
+    st->dqueue_length += length;
+    st->dqueue_delivered += delivered;
+    st->dqueue_wait_time += wait_time;
+    if (max_wait_time > st->dqueue_max_wait_time)
+      st->dqueue_max_wait_time = max_wait_time;
+    st->dqueue_full_waits += full_waits;
+  }
+
+  if (gv->xevents)
+  {
+    uint32_t length;
+    ddsi_xeventq_stats (gv->xevents, &length, &st->xevq_nontimed_handled, &st->xevq_timed_handled, &st->xevq_timed_lateness, &st->xevq_max_timed_lateness);
+    st->xevq_length = length;
+  }
+
+  {
+    uint32_t length;
+    ddsi_xpack_sendq_stats (gv, &length, &st->sendq_packets, &st->sendq_blocked);
+    st->sendq_length = length;
+  }
+
+  for (uint32_t i = 0; i < gv->n_recv_threads; i++)
+  {
+    uint32_t nbufs;
+    uint64_t bytes;
+    if (gv->recv_threads[i].arg.rbpool == NULL)
+      continue;
+    ddsi_rbufpool_stats (gv->recv_threads[i].arg.rbpool, &nbufs, &bytes);
+    st->rbuf_count += nbufs;
+    st->rbuf_bytes += bytes;
+  }
+
+  ddsi_enum_conn_stats (gv, add_conn_stats, st);
+}
+
+bool ddsi_get_thread_stats (const struct ddsi_thread_state *thrst, struct ddsi_thread_stats * __restrict st)
+{
+  const struct ddsi_thread_profile *profile = thrst->profile;
+  if (profile == NULL)
+    return false;
+  st->name = thrst->name;
+  st->utime = ddsrt_atomic_ld64 (&profile->utime);
+  st->stime = ddsrt_atomic_ld64 (&profile->stime);
+  st->awake_time = ddsrt_atomic_ld64 (&profile->awake_time);
+  st->awake_count = ddsrt_hdrhist_count (profile->awake_hist);
+  st->awake_p50 = ddsrt_hdrhist_percentile (profile->awake_hist, 50.0);
+  st->awake_p90 = ddsrt_hdrhist_percentile (profile->awake_hist, 90.0);
+  st->awake_p99 = ddsrt_hdrhist_percentile (profile->awake_hist, 99.0);
+  st->awake_max = ddsrt_hdrhist_max (profile->awake_hist);
+  return true;
+}
+
+struct enum_thread_stats_arg {
+  ddsi_thread_stats_cb_t cb;
+  void *arg;
+};
+
+static void enum_thread_stats_helper (const struct ddsi_thread_state *thrst, void *varg)
+{
+  struct enum_thread_stats_arg const * const arg = varg;
+  struct ddsi_thread_stats st;
+  if (ddsi_get_thread_stats (thrst, &st))
+    arg->cb (&st, arg->arg);
+}
+
+void ddsi_enum_thread_stats (const struct ddsi_domaingv *gv, ddsi_thread_stats_cb_t cb, void *arg)
+{
+  ddsi_enum_thread_states (gv, enum_thread_stats_helper, &(struct enum_thread_stats_arg){ .cb = cb, .arg = arg });
+}
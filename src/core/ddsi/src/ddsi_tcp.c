@@ -16,7 +16,9 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/sockets.h"
-#include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsi/ddsi_log.h"
 #include "dds/ddsi/ddsi_endpoint.h"
 #include "dds/ddsi/ddsi_domaingv.h"
@@ -28,6 +30,7 @@
 #include "ddsi__ssl.h"
 #include "ddsi__proxy_participant.h"
 #include "ddsi__sockwaitset.h"
+#include "ddsi__thread.h"
 
 #define INVALID_PORT (~0u)
 
@@ -35,13 +38,32 @@
   ddsi_tcp_conn: TCP connection for reading and writing. Mutex prevents concurrent
   writes to socket. Is reference counted. Peer port is actually contained in peer
   address but is extracted for convenience and for faster cache lookup
-  (see ddsi_tcp_cmp_entry). Where connection is server side socket (for bi-dir)
+  (see ddsi_tcp_cmp_conn). Where connection is server side socket (for bi-dir)
   is flagged as such to avoid connection attempts and for same reason, on failure,
   is not removed from cache but simply flagged as failed (may be subsequently
   replaced). Similarly server side sockets are not closed as are also used in socket
   wait set that manages their lifecycle.
+
+  With a send queue configured (TCP/SendQueueSize), writes never wait for the socket:
+  whatever can't be written immediately is copied into the connection's send queue
+  and written by the "tcpsend" thread once the socket becomes writable. While the
+  queue is non-empty, new messages are appended to it, or dropped in their entirety
+  if that would exceed the configured size, so the byte stream remains a sequence
+  of complete RTPS messages. Dropped messages are no different from lost UDP packets
+  to the protocol: reliable data is retransmitted and the writer is throttled by the
+  unacknowledged data in its history cache.
+
+  The connection cache maps peer addresses to connections. It is consulted for every
+  message sent, so it is split into shards, each a hash table with its own lock, to
+  keep threads sending to different peers from contending. The most significant bits
+  of the hash select the shard, the hash tables use the least significant ones. Only
+  the lookup and the allocation of a new, unconnected connection object happen while
+  holding the shard lock, connecting is done under the connection's own mutex.
 */
 
+#define DDSI_TCP_CACHE_SHARD_BITS 4
+#define DDSI_TCP_CACHE_SHARDS (1u << DDSI_TCP_CACHE_SHARD_BITS)
+
 union addr {
   struct sockaddr a;
   struct sockaddr_in a4;
@@ -50,6 +72,13 @@ union addr {
 #endif
 };
 
+struct ddsi_tcp_sendq_elem {
+  struct ddsi_tcp_sendq_elem *next;
+  size_t len;
+  size_t off; /* bytes already written */
+  unsigned char data[];
+};
+
 typedef struct ddsi_tcp_conn {
   struct ddsi_tran_conn m_base;
   union addr m_peer_addr;
@@ -59,6 +88,13 @@ typedef struct ddsi_tcp_conn {
 #ifdef DDS_HAS_TCP_TLS
   SSL * m_ssl;
 #endif
+  /* Send queue, protected by m_mutex; m_sendq_pending is protected by the
+     factory's sendq_lock and set iff the connection is in its list */
+  struct ddsi_tcp_sendq_elem *m_sendq_head;
+  struct ddsi_tcp_sendq_elem *m_sendq_tail;
+  size_t m_sendq_bytes;
+  ddsrt_mtime_t m_sendq_tprogress;
+  bool m_sendq_pending;
 } *ddsi_tcp_conn_t;
 
 typedef struct ddsi_tcp_listener {
@@ -69,15 +105,28 @@ typedef struct ddsi_tcp_listener {
 #endif
 } *ddsi_tcp_listener_t;
 
+struct ddsi_tcp_cache_shard {
+  ddsrt_mutex_t lock;
+  struct ddsrt_hh *conns; /* ddsi_tcp_conn_t, each holding a reference */
+};
+
 struct ddsi_tran_factory_tcp {
   struct ddsi_tran_factory fact;
   int32_t m_kind;
-  ddsrt_mutex_t ddsi_tcp_cache_lock_g;
-  ddsrt_avl_tree_t ddsi_tcp_cache_g;
+  struct ddsi_tcp_cache_shard ddsi_tcp_cache[DDSI_TCP_CACHE_SHARDS];
   struct ddsi_tcp_conn ddsi_tcp_conn_client;
 #ifdef DDS_HAS_TCP_TLS
   struct ddsi_ssl_plugins ddsi_tcp_ssl_plugin;
 #endif
+
+  /* Connections with a non-empty send queue, each holding a reference, and the
+     thread flushing them, started when the first connection gets queued data */
+  ddsrt_mutex_t sendq_lock;
+  ddsrt_cond_t sendq_cond;
+  bool sendq_stop;
+  struct ddsi_thread_state *sendq_ts;
+  uint32_t sendq_n, sendq_size;
+  ddsi_tcp_conn_t *sendq_conns;
 };
 
 static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_tcp_conn *c2)
@@ -91,23 +140,37 @@ static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_
   return ddsi_ipaddr_compare (a1s, a2s);
 }
 
-static int ddsi_tcp_cmp_conn_wrap (const void *a, const void *b)
+static bool ddsi_tcp_equal_conn_wrap (const void *a, const void *b)
 {
-  return ddsi_tcp_cmp_conn (a, b);
+  return ddsi_tcp_cmp_conn (a, b) == 0;
 }
 
-typedef struct ddsi_tcp_node {
-  ddsrt_avl_node_t m_avlnode;
-  ddsi_tcp_conn_t m_conn;
-} * ddsi_tcp_node_t;
+static uint32_t ddsi_tcp_hash_conn (const struct ddsi_tcp_conn *c)
+{
+  const uint32_t seed = ((uint32_t) c->m_peer_addr.a.sa_family << 16) ^ c->m_peer_port;
+  switch (c->m_peer_addr.a.sa_family)
+  {
+#if DDSRT_HAVE_IPV6
+    case AF_INET6:
+      return ddsrt_mh3 (&c->m_peer_addr.a6.sin6_addr, sizeof (c->m_peer_addr.a6.sin6_addr), seed);
+#endif
+    case AF_INET:
+      return ddsrt_mh3 (&c->m_peer_addr.a4.sin_addr, sizeof (c->m_peer_addr.a4.sin_addr), seed);
+    default:
+      assert (0);
+      return seed;
+  }
+}
 
-static const ddsrt_avl_treedef_t ddsi_tcp_treedef = DDSRT_AVL_TREEDEF_INITIALIZER_INDKEY
-(
-  offsetof (struct ddsi_tcp_node, m_avlnode),
-  offsetof (struct ddsi_tcp_node, m_conn),
-  ddsi_tcp_cmp_conn_wrap,
-  0
-);
+static uint32_t ddsi_tcp_hash_conn_wrap (const void *a)
+{
+  return ddsi_tcp_hash_conn (a);
+}
+
+static struct ddsi_tcp_cache_shard *ddsi_tcp_cache_shard (struct ddsi_tran_factory_tcp *fact, const struct ddsi_tcp_conn *key)
+{
+  return &fact->ddsi_tcp_cache[ddsi_tcp_hash_conn (key) >> (32 - DDSI_TCP_CACHE_SHARD_BITS)];
+}
 
 static ddsi_tcp_conn_t ddsi_tcp_new_conn (struct ddsi_tran_factory_tcp *fact, const struct ddsi_network_interface *interf, ddsrt_socket_t, bool, struct sockaddr *);
 
@@ -119,31 +182,6 @@ static char *sockaddr_to_string_with_port (char *dst, size_t sizeof_dst, const s
   return dst;
 }
 
-/* Connection cache dump routine for debugging
-
-static void ddsi_tcp_cache_dump (void)
-{
-  char buff[64];
-  ddsrt_avl_iter_t iter;
-  ddsi_tcp_node_t n;
-  unsigned i = 0;
-
-  n = ddsrt_avl_iter_first (&ddsi_tcp_treedef, &ddsi_tcp_cache_g, &iter);
-  while (n)
-  {
-    os_sockaddrAddressPortToString ((const os_sockaddr *) &n->m_conn->m_peer_addr, buff, sizeof (buff));
-    DDS_TRACE
-    (
-      DDS_LC_TCP,
-      "%s cache #%d: %s sock %d port %u peer %s\n",
-      ddsi_name, i++, n->m_conn->m_base.m_server ? "server" : "client",
-      n->m_conn->m_sock, n->m_conn->m_base.m_base.m_port, buff
-    );
-    n = ddsrt_avl_iter_next (&iter);
-  }
-}
-*/
-
 static uint16_t get_socket_port (struct ddsi_domaingv const * const gv, ddsrt_socket_t socket)
 {
   union addr addr;
@@ -251,11 +289,10 @@ fail:
   return rc;
 }
 
-static void ddsi_tcp_node_free (void * ptr)
+static void ddsi_tcp_cache_free_conn (void *vconn, void *varg)
 {
-  ddsi_tcp_node_t node = (ddsi_tcp_node_t) ptr;
-  ddsi_conn_free ((struct ddsi_tran_conn *) node->m_conn);
-  ddsrt_free (node);
+  (void) varg;
+  ddsi_conn_free ((struct ddsi_tran_conn *) vconn);
 }
 
 static void ddsi_tcp_conn_connect (ddsi_tcp_conn_t conn, const ddsrt_msghdr_t * msg)
@@ -309,40 +346,25 @@ fail_w_socket:
   ddsi_tcp_sock_free (gv, sock, NULL);
 }
 
-static void ddsi_tcp_cache_add (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, ddsrt_avl_ipath_t * path)
+static void ddsi_tcp_cache_add (struct ddsi_tran_factory_tcp *fact, struct ddsi_tcp_cache_shard *shard, ddsi_tcp_conn_t conn)
 {
+  /* Caller holds shard->lock */
   struct ddsi_domaingv * const gv = fact->fact.gv;
   const char * action = "added";
-  ddsi_tcp_node_t node;
+  ddsi_tcp_conn_t old;
   char buff[DDSI_LOCSTRLEN];
 
   ddsrt_atomic_inc32 (&conn->m_base.m_count);
 
-  /* If path set, then cache does not contain connection */
-  if (path)
-  {
-    node = ddsrt_malloc (sizeof (*node));
-    node->m_conn = conn;
-    ddsrt_avl_insert_ipath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node, path);
-  }
-  else
+  if ((old = ddsrt_hh_lookup (shard->conns, conn)) != NULL)
   {
-    node = ddsrt_avl_lookup (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, conn);
-    if (node)
-    {
-      /* Replace connection in cache */
+    /* Replace connection in cache */
 
-      ddsi_conn_free ((struct ddsi_tran_conn *) node->m_conn);
-      node->m_conn = conn;
-      action = "updated";
-    }
-    else
-    {
-      node = ddsrt_malloc (sizeof (*node));
-      node->m_conn = conn;
-      ddsrt_avl_insert (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node);
-    }
+    ddsrt_hh_remove_present (shard->conns, old);
+    ddsi_conn_free ((struct ddsi_tran_conn *) old);
+    action = "updated";
   }
+  ddsrt_hh_add_absent (shard->conns, conn);
 
   sockaddr_to_string_with_port(buff, sizeof(buff), &conn->m_peer_addr.a);
   GVLOG (DDS_LC_TCP, "tcp cache %s %s socket %"PRIdSOCK" to %s\n", action, conn->m_base.m_server ? "server" : "client", conn->m_sock, buff);
@@ -352,20 +374,19 @@ static void ddsi_tcp_cache_remove (ddsi_tcp_conn_t conn)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) conn->m_base.m_factory;
   struct ddsi_domaingv * const gv = fact->fact.gv;
+  struct ddsi_tcp_cache_shard * const shard = ddsi_tcp_cache_shard (fact, conn);
   char buff[DDSI_LOCSTRLEN];
-  ddsi_tcp_node_t node;
-  ddsrt_avl_dpath_t path;
+  ddsi_tcp_conn_t c;
 
-  ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-  node = ddsrt_avl_lookup_dpath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, conn, &path);
-  if (node)
+  ddsrt_mutex_lock (&shard->lock);
+  if ((c = ddsrt_hh_lookup (shard->conns, conn)) != NULL)
   {
     sockaddr_to_string_with_port(buff, sizeof(buff), &conn->m_peer_addr.a);
     GVLOG (DDS_LC_TCP, "tcp cache removed socket %"PRIdSOCK" to %s\n", conn->m_sock, buff);
-    ddsrt_avl_delete_dpath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node, &path);
-    ddsi_tcp_node_free (node);
+    ddsrt_hh_remove_present (shard->conns, c);
+    ddsi_conn_free ((struct ddsi_tran_conn *) c);
   }
-  ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
+  ddsrt_mutex_unlock (&shard->lock);
 }
 
 /*
@@ -375,37 +396,30 @@ static void ddsi_tcp_cache_remove (ddsi_tcp_conn_t conn)
 
 static ddsi_tcp_conn_t ddsi_tcp_cache_find (struct ddsi_tran_factory_tcp *fact, const ddsrt_msghdr_t * msg)
 {
-  ddsrt_avl_ipath_t path;
-  ddsi_tcp_node_t node;
+  struct ddsi_tcp_cache_shard *shard;
   struct ddsi_tcp_conn key;
-  ddsi_tcp_conn_t ret = NULL;
+  ddsi_tcp_conn_t ret;
 
   memset (&key, 0, sizeof (key));
   key.m_peer_port = ddsrt_sockaddr_get_port (msg->msg_name);
   memcpy (&key.m_peer_addr, msg->msg_name, (size_t)msg->msg_namelen);
+  shard = ddsi_tcp_cache_shard (fact, &key);
 
   /* Check cache for existing connection to target */
 
-  ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-  node = ddsrt_avl_lookup_ipath (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, &key, &path);
-  if (node)
+  ddsrt_mutex_lock (&shard->lock);
+  if ((ret = ddsrt_hh_lookup (shard->conns, &key)) != NULL && ret->m_base.m_closed)
   {
-    if (node->m_conn->m_base.m_closed)
-    {
-      ddsrt_avl_delete (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, node);
-      ddsi_tcp_node_free (node);
-    }
-    else
-    {
-      ret = node->m_conn;
-    }
+    ddsrt_hh_remove_present (shard->conns, ret);
+    ddsi_conn_free ((struct ddsi_tran_conn *) ret);
+    ret = NULL;
   }
   if (ret == NULL)
   {
     ret = ddsi_tcp_new_conn (fact, NULL, DDSRT_INVALID_SOCKET, false, &key.m_peer_addr.a);
-    ddsi_tcp_cache_add (fact, ret, &path);
+    ddsi_tcp_cache_add (fact, shard, ret);
   }
-  ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
+  ddsrt_mutex_unlock (&shard->lock);
 
   return ret;
 }
@@ -604,6 +618,283 @@ static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, ddsrt_iovec_t *iov, size_t iov
   mhdr->msg_iovlen = (ddsrt_msg_iovlen_t)iovlen;
 }
 
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn)
+{
+  /* ddsi_conn_free also closes the connection, this only drops a reference */
+  if (ddsrt_atomic_dec32_ov (&conn->m_base.m_count) == 1)
+    (conn->m_base.m_factory->m_release_conn_fn) (&conn->m_base);
+}
+
+static void ddsi_tcp_sendq_discard (ddsi_tcp_conn_t conn)
+{
+  struct ddsi_tcp_sendq_elem *e;
+  while ((e = conn->m_sendq_head) != NULL)
+  {
+    conn->m_sendq_head = e->next;
+    ddsrt_free (e);
+  }
+  conn->m_sendq_tail = NULL;
+  conn->m_sendq_bytes = 0;
+}
+
+#define DDSI_TCP_SENDQ_MAX_IOV 64
+
+static bool ddsi_tcp_sendq_write (ddsi_tcp_conn_t conn)
+{
+  /* Writes as much of the queue as the socket accepts, returns false on error */
+  struct ddsi_domaingv const * const gv = conn->m_base.m_base.gv;
+  ddsrt_iovec_t iov[DDSI_TCP_SENDQ_MAX_IOV];
+  ddsrt_msghdr_t msg;
+  int sendflags = 0;
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  memset (&msg, 0, sizeof (msg));
+  while (conn->m_sendq_head)
+  {
+    size_t niov = 0, len = 0;
+    for (struct ddsi_tcp_sendq_elem *e = conn->m_sendq_head; e && niov < DDSI_TCP_SENDQ_MAX_IOV; e = e->next)
+    {
+      iov[niov].iov_base = e->data + e->off;
+      iov[niov].iov_len = (ddsrt_iov_len_t) (e->len - e->off);
+      len += e->len - e->off;
+      niov++;
+    }
+    set_msghdr_iov (&msg, iov, niov);
+    dds_return_t rc;
+    ssize_t n;
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, &msg, sendflags, &n);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc == DDS_RETCODE_TRY_AGAIN)
+      return true;
+    else if (rc != DDS_RETCODE_OK)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      return false;
+    }
+    const size_t written = (size_t) n;
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+    conn->m_sendq_bytes -= written;
+    while (n > 0)
+    {
+      struct ddsi_tcp_sendq_elem * const e = conn->m_sendq_head;
+      const size_t m = ((size_t) n < e->len - e->off) ? (size_t) n : e->len - e->off;
+      e->off += m;
+      n -= (ssize_t) m;
+      if (e->off == e->len)
+      {
+        if ((conn->m_sendq_head = e->next) == NULL)
+          conn->m_sendq_tail = NULL;
+        ddsrt_free (e);
+      }
+    }
+    if (written < len)
+      return true;
+  }
+  return true;
+}
+
+static uint32_t ddsi_tcp_sendq_thread (void *vfact);
+
+static bool ddsi_tcp_sendq_add (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn)
+{
+  /* Returns false if the connection can't be serviced because the send thread
+     can't be started, in which case the connection is left as it was */
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  bool ok = true;
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  if (fact->sendq_ts == NULL && !fact->sendq_stop && ddsi_create_thread (&fact->sendq_ts, gv, "tcpsend", ddsi_tcp_sendq_thread, fact) != DDS_RETCODE_OK)
+  {
+    GVERROR ("tcp: can't create send queue thread\n");
+    ok = false;
+  }
+  else if (!conn->m_sendq_pending && !fact->sendq_stop)
+  {
+    if (fact->sendq_n == fact->sendq_size)
+    {
+      fact->sendq_size = (fact->sendq_size == 0) ? 8 : 2 * fact->sendq_size;
+      fact->sendq_conns = ddsrt_realloc (fact->sendq_conns, fact->sendq_size * sizeof (*fact->sendq_conns));
+    }
+    ddsi_conn_add_ref (&conn->m_base);
+    conn->m_sendq_pending = true;
+    fact->sendq_conns[fact->sendq_n++] = conn;
+    ddsrt_cond_signal (&fact->sendq_cond);
+  }
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  return ok;
+}
+
+static void ddsi_tcp_sendq_flush (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, bool writable, ddsrt_mtime_t tnow)
+{
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  bool ok = true;
+  ddsrt_mutex_lock (&conn->m_mutex);
+  if (writable)
+    ok = ddsi_tcp_sendq_write (conn);
+  if (ok && conn->m_sendq_head && tnow.v - conn->m_sendq_tprogress.v > gv->config.tcp_write_timeout)
+  {
+    GVWARNING ("tcp abandoning write on socket %"PRIdSOCK" with %"PRIuSIZE" bytes queued\n", conn->m_sock, conn->m_sendq_bytes);
+    ok = false;
+  }
+  if (!ok)
+    ddsi_tcp_sendq_discard (conn);
+  if (conn->m_sendq_head == NULL)
+  {
+    ddsrt_mutex_lock (&fact->sendq_lock);
+    conn->m_sendq_pending = false;
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+  }
+  ddsrt_mutex_unlock (&conn->m_mutex);
+  if (!ok)
+    ddsi_tcp_cache_remove (conn);
+}
+
+static uint32_t ddsi_tcp_sendq_thread (void *vfact)
+{
+  struct ddsi_tran_factory_tcp * const fact = vfact;
+  ddsi_tcp_conn_t *conns = NULL;
+  uint32_t size = 0;
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  while (!fact->sendq_stop)
+  {
+    if (fact->sendq_n == 0)
+    {
+      ddsrt_cond_wait (&fact->sendq_cond, &fact->sendq_lock);
+      continue;
+    }
+
+    /* Only this thread removes connections from the list, and they can't be freed
+       while in it, so a copy of the list can be used without holding the lock.
+       Connections added while waiting get picked up in the next round, so the
+       timeout is also the maximum delay before a connection is first serviced. */
+    const uint32_t n = fact->sendq_n;
+    if (n > size)
+    {
+      size = n;
+      conns = ddsrt_realloc (conns, size * sizeof (*conns));
+    }
+    memcpy (conns, fact->sendq_conns, n * sizeof (*conns));
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+
+    fd_set wrset;
+    ddsrt_socket_t maxsock = 0;
+    dds_return_t rc;
+    FD_ZERO (&wrset);
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_OFF(sign-conversion)
+#endif
+    for (uint32_t i = 0; i < n; i++)
+    {
+      FD_SET (conns[i]->m_sock, &wrset);
+      if (conns[i]->m_sock > maxsock)
+        maxsock = conns[i]->m_sock;
+    }
+    rc = ddsrt_select (maxsock + 1, NULL, &wrset, NULL, DDS_MSECS (10));
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    for (uint32_t i = 0; i < n; i++)
+      ddsi_tcp_sendq_flush (fact, conns[i], rc > 0 && FD_ISSET (conns[i]->m_sock, &wrset), tnow);
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_ON(sign-conversion)
+#endif
+
+    ddsrt_mutex_lock (&fact->sendq_lock);
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < fact->sendq_n; i++)
+    {
+      if (fact->sendq_conns[i]->m_sendq_pending)
+        fact->sendq_conns[j++] = fact->sendq_conns[i];
+      else
+        ddsi_tcp_conn_unref (fact->sendq_conns[i]);
+    }
+    fact->sendq_n = j;
+  }
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  ddsrt_free (conns);
+  return 0;
+}
+
+static ssize_t ddsi_tcp_conn_write_queued (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t len)
+{
+  /* Returns len if the message was written or queued, 0 if it was dropped because
+     the queue is full and -1 on error */
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  size_t pos = 0;
+  if (conn->m_sendq_head == NULL)
+  {
+    int sendflags = 0;
+    dds_return_t rc;
+    ssize_t n;
+#ifdef MSG_NOSIGNAL
+    sendflags |= MSG_NOSIGNAL;
+#endif
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, msg, sendflags, &n);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc == DDS_RETCODE_OK)
+    {
+      if ((size_t) n == len)
+        return (ssize_t) len;
+      pos = (size_t) n;
+    }
+    else if (rc != DDS_RETCODE_TRY_AGAIN)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      return -1;
+    }
+    if (!ddsi_tcp_sendq_add (fact, conn))
+    {
+      /* without a send thread nothing would ever write the queue: write the
+         remainder like a connection without a send queue does */
+      size_t off = 0;
+      for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++)
+      {
+        const size_t ilen = msg->msg_iov[i].iov_len;
+        if (pos < off + ilen)
+        {
+          const size_t skip = (pos > off) ? pos - off : 0;
+          if (ddsi_tcp_block_write (ddsi_tcp_conn_write_plain, conn, (const char *) msg->msg_iov[i].iov_base + skip, ilen - skip) < 0)
+            return -1;
+          pos = off + ilen;
+        }
+        off += ilen;
+      }
+      return (ssize_t) len;
+    }
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+  }
+  else if (conn->m_sendq_bytes + len > gv->config.tcp_sendq_size)
+  {
+    /* nothing of this message has been written yet, so it can be dropped */
+    GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" send queue full, dropping %"PRIuSIZE" bytes\n", conn->m_sock, len);
+    return 0;
+  }
+
+  struct ddsi_tcp_sendq_elem *e = ddsrt_malloc (sizeof (*e) + len - pos);
+  e->next = NULL;
+  e->len = len - pos;
+  e->off = 0;
+  size_t off = 0;
+  for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++)
+  {
+    const size_t ilen = msg->msg_iov[i].iov_len;
+    if (pos < off + ilen)
+    {
+      const size_t skip = (pos > off) ? pos - off : 0;
+      memcpy (e->data + (off + skip - pos), (const char *) msg->msg_iov[i].iov_base + skip, ilen - skip);
+    }
+    off += ilen;
+  }
+  if (conn->m_sendq_tail)
+    conn->m_sendq_tail->next = e;
+  else
+    conn->m_sendq_head = e;
+  conn->m_sendq_tail = e;
+  conn->m_sendq_bytes += e->len;
+  GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" queued %"PRIuSIZE" bytes (%"PRIuSIZE" total)\n", conn->m_sock, e->len, conn->m_sendq_bytes);
+  return (ssize_t) len;
+}
+
 static ssize_t ddsi_tcp_conn_write (struct ddsi_tran_conn * base, const ddsi_locator_t *dst, const ddsi_tran_write_msgfrags_t *msgfrags, uint32_t flags)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) base->m_factory;
@@ -665,6 +956,21 @@ static ssize_t ddsi_tcp_conn_write (struct ddsi_tran_conn * base, const ddsi_loc
     return (ssize_t) len;
   }
 
+  if (gv->config.tcp_sendq_size > 0
+#ifdef DDS_HAS_TCP_TLS
+      && !gv->config.ssl_enable
+#endif
+      )
+  {
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    ret = ddsi_tcp_conn_write_queued (fact, conn, &msg, len);
+    ddsrt_mutex_unlock (&conn->m_mutex);
+    if (ret == -1)
+      ddsi_tcp_cache_remove (conn);
+    return (ret > 0) ? ret : -1;
+  }
+
 #ifdef DDS_HAS_TCP_TLS
   if (gv->config.ssl_enable)
   {
@@ -905,9 +1211,10 @@ static struct ddsi_tran_conn * ddsi_tcp_accept (struct ddsi_tran_listener * list
 
     /* Add connection to cache for bi-dir */
 
-    ddsrt_mutex_lock (&fact->ddsi_tcp_cache_lock_g);
-    ddsi_tcp_cache_add (fact, tcp, NULL);
-    ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
+    struct ddsi_tcp_cache_shard * const shard = ddsi_tcp_cache_shard (fact, tcp);
+    ddsrt_mutex_lock (&shard->lock);
+    ddsi_tcp_cache_add (fact, shard, tcp);
+    ddsrt_mutex_unlock (&shard->lock);
   }
   return tcp ? &tcp->m_base : NULL;
 }
@@ -1027,6 +1334,7 @@ static void ddsi_tcp_conn_delete (ddsi_tcp_conn_t conn)
   {
     ddsi_tcp_sock_free (gv, conn->m_sock, "connection");
   }
+  ddsi_tcp_sendq_discard (conn);
   ddsrt_mutex_destroy (&conn->m_mutex);
   ddsrt_free (conn);
 }
@@ -1127,8 +1435,24 @@ static void ddsi_tcp_release_factory (struct ddsi_tran_factory *fact_cmn)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) fact_cmn;
   struct ddsi_domaingv const * const gv = fact->fact.gv;
-  ddsrt_avl_free (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, ddsi_tcp_node_free);
-  ddsrt_mutex_destroy (&fact->ddsi_tcp_cache_lock_g);
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  fact->sendq_stop = true;
+  ddsrt_cond_broadcast (&fact->sendq_cond);
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  if (fact->sendq_ts)
+    ddsi_join_thread (fact->sendq_ts);
+  for (uint32_t i = 0; i < fact->sendq_n; i++)
+    ddsi_tcp_conn_unref (fact->sendq_conns[i]);
+  ddsrt_free (fact->sendq_conns);
+  ddsrt_cond_destroy (&fact->sendq_cond);
+  ddsrt_mutex_destroy (&fact->sendq_lock);
+  for (uint32_t i = 0; i < DDSI_TCP_CACHE_SHARDS; i++)
+  {
+    struct ddsi_tcp_cache_shard * const shard = &fact->ddsi_tcp_cache[i];
+    ddsrt_hh_enum (shard->conns, ddsi_tcp_cache_free_conn, NULL);
+    ddsrt_hh_free (shard->conns);
+    ddsrt_mutex_destroy (&shard->lock);
+  }
 #ifdef DDS_HAS_TCP_TLS
   if (fact->ddsi_tcp_ssl_plugin.fini)
   {
@@ -1225,6 +1549,14 @@ int ddsi_tcp_init (struct ddsi_domaingv *gv)
   struct ddsi_tran_factory_tcp *fact = ddsrt_malloc (sizeof (*fact));
 
   memset (fact, 0, sizeof (*fact));
+  ddsrt_mutex_init (&fact->sendq_lock);
+  ddsrt_cond_init (&fact->sendq_cond);
+  for (uint32_t i = 0; i < DDSI_TCP_CACHE_SHARDS; i++)
+  {
+    struct ddsi_tcp_cache_shard * const shard = &fact->ddsi_tcp_cache[i];
+    ddsrt_mutex_init (&shard->lock);
+    shard->conns = ddsrt_hh_new (1, ddsi_tcp_hash_conn_wrap, ddsi_tcp_equal_conn_wrap);
+  }
   fact->m_kind = DDSI_LOCATOR_KIND_TCPv4;
   fact->fact.gv = gv;
   fact->fact.m_typename = "tcp";
@@ -1276,9 +1608,6 @@ int ddsi_tcp_init (struct ddsi_domaingv *gv)
   }
 #endif
 
-  ddsrt_avl_init (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g);
-  ddsrt_mutex_init (&fact->ddsi_tcp_cache_lock_g);
-
   GVLOG (DDS_LC_CONFIG, "tcp initialized\n");
   return 0;
 }
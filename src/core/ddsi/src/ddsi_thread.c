@@ -14,6 +14,7 @@
 
 #include "dds/ddsrt/cdtors.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hdrhist.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
@@ -246,6 +247,55 @@ struct ddsi_thread_state *ddsi_lookup_thread_state_real (void)
   return thrst;
 }
 
+void ddsi_thread_profile_awake (struct ddsi_thread_state *thrst)
+{
+  thrst->profile->t_awake = ddsrt_time_monotonic ();
+}
+
+static void thread_profile_record (struct ddsi_thread_profile *profile, ddsrt_mtime_t tnow)
+{
+  const uint64_t dt = (tnow.v > profile->t_awake.v) ? (uint64_t) (tnow.v - profile->t_awake.v) : 0;
+  ddsrt_atomic_add64 (&profile->awake_time, dt);
+  ddsrt_hdrhist_record (profile->awake_hist, dt);
+}
+
+void ddsi_thread_profile_asleep (struct ddsi_thread_state *thrst)
+{
+  thread_profile_record (thrst->profile, ddsrt_time_monotonic ());
+}
+
+void ddsi_thread_profile_awake_to_awake (struct ddsi_thread_state *thrst)
+{
+  const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  thread_profile_record (thrst->profile, tnow);
+  thrst->profile->t_awake = tnow;
+}
+
+static struct ddsi_thread_profile *new_thread_profile (void)
+{
+  struct ddsi_thread_profile *profile = ddsrt_malloc (sizeof (*profile));
+  profile->t_awake = ddsrt_time_monotonic ();
+  ddsrt_atomic_st64 (&profile->awake_time, 0);
+  /* 1.6% resolution, separate buckets up to ~18 minutes */
+  profile->awake_hist = ddsrt_hdrhist_new (6, 40);
+#if DDSRT_HAVE_THREAD_LIST
+  ddsrt_atomic_st32 (&profile->have_list_id, 0);
+#endif
+  ddsrt_atomic_st64 (&profile->utime, 0);
+  ddsrt_atomic_st64 (&profile->stime, 0);
+  profile->t_sample = profile->t_awake;
+  profile->awake_time_sample = 0;
+  return profile;
+}
+
+static void free_thread_profile (struct ddsi_thread_profile *profile)
+{
+  if (profile == NULL)
+    return;
+  ddsrt_hdrhist_free (profile->awake_hist);
+  ddsrt_free (profile);
+}
+
 static uint32_t create_thread_wrapper (void *ptr)
 {
   struct ddsi_thread_state * const thrst = ptr;
@@ -253,6 +303,13 @@ static uint32_t create_thread_wrapper (void *ptr)
   if (gv)
     GVTRACE ("started new thread %"PRIdTID": %s\n", ddsrt_gettid (), thrst->name);
   assert (thrst->state == DDSI_THREAD_STATE_INIT);
+#if DDSRT_HAVE_THREAD_LIST
+  if (thrst->profile)
+  {
+    thrst->profile->list_id = ddsrt_thread_list_id_self ();
+    ddsrt_atomic_st32 (&thrst->profile->have_list_id, 1);
+  }
+#endif
   tsd_thread_state = thrst;
   ddsrt_mutex_lock (&thread_states.lock);
   thrst->state = DDSI_THREAD_STATE_ALIVE;
@@ -310,6 +367,7 @@ static struct ddsi_thread_state *init_thread_state (const char *tname, const str
   ddsrt_atomic_stvoidp (&thrst->nested_gv, NULL);
 #endif
   (void) ddsrt_strlcpy (thrst->name, tname, sizeof (thrst->name));
+  thrst->profile = NULL;
   thrst->state = state;
   return thrst;
 }
@@ -326,6 +384,8 @@ static dds_return_t create_thread_int (struct ddsi_thread_state **ts1_out, const
 
   thrst->f = f;
   thrst->f_arg = arg;
+  if (gv && gv->config.liveliness_monitoring && gv->config.thread_profiling)
+    thrst->profile = new_thread_profile ();
   ddsrt_threadattr_init (&tattr);
   if (tprops != NULL)
   {
@@ -344,6 +404,8 @@ static dds_return_t create_thread_int (struct ddsi_thread_state **ts1_out, const
 
   if (ddsrt_thread_create (&thrst->tid, name, &tattr, &create_thread_wrapper, thrst) != DDS_RETCODE_OK)
   {
+    free_thread_profile (thrst->profile);
+    thrst->profile = NULL;
     thrst->state = DDSI_THREAD_STATE_ZERO;
     DDS_FATAL ("create_thread: %s: ddsrt_thread_create failed\n", name);
     goto fatal;
@@ -376,6 +438,8 @@ static void reap_thread_state (struct ddsi_thread_state *thrst, bool in_ddsi_thr
     case DDSI_THREAD_STATE_INIT:
     case DDSI_THREAD_STATE_STOPPED:
     case DDSI_THREAD_STATE_LAZILY_CREATED:
+      free_thread_profile (thrst->profile);
+      thrst->profile = NULL;
       thrst->state = DDSI_THREAD_STATE_ZERO;
       break;
     case DDSI_THREAD_STATE_ZERO:
@@ -443,3 +507,18 @@ void ddsi_log_stack_traces (const struct ddsrt_log_cfg *logcfg, const struct dds
   }
 }
 
+void ddsi_enum_thread_states (const struct ddsi_domaingv *gv, void (*cb) (const struct ddsi_thread_state *thrst, void *arg), void *arg)
+{
+  ddsrt_mutex_lock (&thread_states.lock);
+  for (struct ddsi_thread_states_list *cur = ddsrt_atomic_ldvoidp (&thread_states.thread_states_head); cur; cur = cur->next)
+  {
+    for (uint32_t i = 0; i < DDSI_THREAD_STATE_BATCH; i++)
+    {
+      struct ddsi_thread_state * const thrst = &cur->thrst[i];
+      if (thrst->state == DDSI_THREAD_STATE_ALIVE && ddsrt_atomic_ldvoidp (&thrst->gv) == gv)
+        cb (thrst, arg);
+    }
+  }
+  ddsrt_mutex_unlock (&thread_states.lock);
+}
+
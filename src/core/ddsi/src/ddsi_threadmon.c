@@ -15,7 +15,9 @@
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/time.h"
 #include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/rusage.h"
 #include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/hdrhist.h"
 #include "dds/ddsi/ddsi_threadmon.h"
 #include "dds/ddsi/ddsi_unused.h"
 #include "dds/ddsi/ddsi_domaingv.h" /* for mattr, cattr */
@@ -78,6 +80,43 @@ static void update_av_ary (struct ddsi_threadmon *sl, uint32_t nthreads)
   }
 }
 
+#if DDSRT_HAVE_RUSAGE && DDSRT_HAVE_THREAD_LIST
+struct sample_thread_profile_arg {
+  const struct ddsi_domaingv *gv;
+  ddsrt_mtime_t tnow;
+};
+
+static void sample_thread_profile (const struct ddsi_thread_state *thrst, void *varg)
+{
+  struct sample_thread_profile_arg const * const arg = varg;
+  struct ddsi_thread_profile * const profile = thrst->profile;
+  ddsrt_rusage_t u;
+  if (profile == NULL || !ddsrt_atomic_ld32 (&profile->have_list_id))
+    return;
+  if (ddsrt_getrusage_anythread (profile->list_id, &u) != DDS_RETCODE_OK)
+    return;
+
+  /* Report the fractions of the interval since the previous sample spent in user
+     mode, system mode and awake: a thread that is awake almost all the time is
+     the one that limits throughput */
+  const uint64_t awake_time = ddsrt_atomic_ld64 (&profile->awake_time);
+  const double dt = (double) (arg->tnow.v - profile->t_sample.v);
+  if (dt > 0 && (arg->gv->logconfig.c.mask & DDS_LC_TIMING))
+  {
+    const double usr = (double) ((uint64_t) u.utime - ddsrt_atomic_ld64 (&profile->utime));
+    const double sys = (double) ((uint64_t) u.stime - ddsrt_atomic_ld64 (&profile->stime));
+    const double awake = (double) (awake_time - profile->awake_time_sample);
+    DDS_CLOG (DDS_LC_TIMING, &arg->gv->logconfig, "thread %s: usr %.0f%% sys %.0f%% awake %.0f%% max-awake %"PRIu64"us\n",
+              thrst->name, 100.0 * usr / dt, 100.0 * sys / dt, 100.0 * awake / dt,
+              ddsrt_hdrhist_max (profile->awake_hist) / 1000);
+  }
+  ddsrt_atomic_st64 (&profile->utime, (uint64_t) u.utime);
+  ddsrt_atomic_st64 (&profile->stime, (uint64_t) u.stime);
+  profile->t_sample = arg->tnow;
+  profile->awake_time_sample = awake_time;
+}
+#endif
+
 static uint32_t threadmon_thread (struct ddsi_threadmon *sl)
 {
   /* Do not check more often than once every 100ms (no particular
@@ -182,6 +221,11 @@ static uint32_t threadmon_thread (struct ddsi_threadmon *sl)
       tmdom->msgpos = 0;
       tmdom->msg[0] = 0;
 
+#if DDSRT_HAVE_RUSAGE && DDSRT_HAVE_THREAD_LIST
+      if (tmdom->gv->config.thread_profiling)
+        ddsi_enum_thread_states (tmdom->gv, sample_thread_profile, &(struct sample_thread_profile_arg){ .gv = tmdom->gv, .tnow = tnow });
+#endif
+
 #if DDSRT_HAVE_RUSAGE
       if (tmdom->gv->logconfig.c.mask & DDS_LC_TIMING)
       {
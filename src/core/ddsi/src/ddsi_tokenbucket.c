@@ -0,0 +1,90 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <assert.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "ddsi__tokenbucket.h"
+
+struct ddsi_tokenbucket {
+  ddsrt_mutex_t lock;
+  uint32_t rate;     /* bytes/s */
+  int64_t burst;     /* maximum number of tokens */
+  int64_t tokens;    /* current number of tokens, negative means in debt */
+  ddsrt_mtime_t tlast;
+};
+
+struct ddsi_tokenbucket *ddsi_tokenbucket_new (uint32_t rate, uint32_t burst, ddsrt_mtime_t tnow)
+{
+  assert (rate > 0);
+  struct ddsi_tokenbucket *tb = ddsrt_malloc (sizeof (*tb));
+  ddsrt_mutex_init (&tb->lock);
+  tb->rate = rate;
+  tb->burst = burst;
+  tb->tokens = burst;
+  tb->tlast = tnow;
+  return tb;
+}
+
+void ddsi_tokenbucket_free (struct ddsi_tokenbucket *tb)
+{
+  ddsrt_mutex_destroy (&tb->lock);
+  ddsrt_free (tb);
+}
+
+static void refill (struct ddsi_tokenbucket *tb, ddsrt_mtime_t tnow)
+{
+  if (tnow.v <= tb->tlast.v)
+    return;
+  const int64_t dt = tnow.v - tb->tlast.v;
+  /* Only advance tlast by the time actually converted into tokens, so that
+     frequent calls don't lose fractional tokens to rounding */
+  const int64_t room = tb->burst - tb->tokens;
+  if (room <= 0 || dt >= (room * DDS_NSECS_IN_SEC) / tb->rate)
+  {
+    tb->tokens = tb->burst;
+    tb->tlast = tnow;
+  }
+  else
+  {
+    const int64_t add = (dt * (int64_t) tb->rate) / DDS_NSECS_IN_SEC;
+    tb->tokens += add;
+    tb->tlast.v += (add * DDS_NSECS_IN_SEC) / tb->rate;
+  }
+}
+
+static dds_duration_t delay_locked (const struct ddsi_tokenbucket *tb)
+{
+  if (tb->tokens >= 0)
+    return 0;
+  return (dds_duration_t) ((-tb->tokens * DDS_NSECS_IN_SEC + tb->rate - 1) / tb->rate);
+}
+
+dds_duration_t ddsi_tokenbucket_delay (struct ddsi_tokenbucket *tb, ddsrt_mtime_t tnow)
+{
+  dds_duration_t d;
+  ddsrt_mutex_lock (&tb->lock);
+  refill (tb, tnow);
+  d = delay_locked (tb);
+  ddsrt_mutex_unlock (&tb->lock);
+  return d;
+}
+
+dds_duration_t ddsi_tokenbucket_charge (struct ddsi_tokenbucket *tb, ddsrt_mtime_t tnow, uint32_t nbytes)
+{
+  dds_duration_t d;
+  ddsrt_mutex_lock (&tb->lock);
+  refill (tb, tnow);
+  d = delay_locked (tb);
+  tb->tokens -= nbytes;
+  ddsrt_mutex_unlock (&tb->lock);
+  return d;
+}
@@ -30,6 +30,8 @@ extern inline int ddsi_is_valid_port (const struct ddsi_tran_factory *factory, u
 extern inline uint32_t ddsi_receive_buffer_size (const struct ddsi_tran_factory *factory);
 extern inline ddsrt_socket_t ddsi_conn_handle (struct ddsi_tran_conn * conn);
 extern inline int ddsi_conn_locator (struct ddsi_tran_conn * conn, ddsi_locator_t * loc);
+extern inline void ddsi_conn_counters_add (struct ddsi_conn_counters *cs, size_t sz);
+extern inline void ddsi_conn_count_rx (struct ddsi_tran_conn * conn, size_t sz);
 extern inline ddsrt_socket_t ddsi_tran_handle (struct ddsi_tran_base * base);
 extern inline dds_return_t ddsi_factory_create_conn (struct ddsi_tran_conn **conn, struct ddsi_tran_factory * factory, uint32_t port, const struct ddsi_tran_qos *qos);
 extern inline int ddsi_listener_locator (struct ddsi_tran_listener * listener, ddsi_locator_t * loc);
@@ -173,6 +175,13 @@ void ddsi_conn_add_ref (struct ddsi_tran_conn * conn)
 void ddsi_factory_conn_init (const struct ddsi_tran_factory *factory, const struct ddsi_network_interface *interf, struct ddsi_tran_conn * conn)
 {
   ddsrt_atomic_st32 (&conn->m_count, 1);
+  for (int i = 0; i < DDSI_CONN_COUNTER_STRIPES; i++)
+  {
+    ddsrt_atomic_st64 (&conn->m_rx[i].packets, 0);
+    ddsrt_atomic_st64 (&conn->m_rx[i].bytes, 0);
+    ddsrt_atomic_st64 (&conn->m_tx[i].packets, 0);
+    ddsrt_atomic_st64 (&conn->m_tx[i].bytes, 0);
+  }
   conn->m_connless = factory->m_connless;
   conn->m_stream = factory->m_stream;
   conn->m_factory = (struct ddsi_tran_factory *) factory;
@@ -180,6 +189,18 @@ void ddsi_factory_conn_init (const struct ddsi_tran_factory *factory, const stru
   conn->m_base.gv = factory->gv;
 }
 
+void ddsi_conn_stats (const struct ddsi_tran_conn * conn, uint64_t *rx_packets, uint64_t *rx_bytes, uint64_t *tx_packets, uint64_t *tx_bytes)
+{
+  *rx_packets = *rx_bytes = *tx_packets = *tx_bytes = 0;
+  for (int i = 0; i < DDSI_CONN_COUNTER_STRIPES; i++)
+  {
+    *rx_packets += ddsrt_atomic_ld64 (&conn->m_rx[i].packets);
+    *rx_bytes += ddsrt_atomic_ld64 (&conn->m_rx[i].bytes);
+    *tx_packets += ddsrt_atomic_ld64 (&conn->m_tx[i].packets);
+    *tx_bytes += ddsrt_atomic_ld64 (&conn->m_tx[i].bytes);
+  }
+}
+
 void ddsi_conn_disable_multiplexing (struct ddsi_tran_conn * conn)
 {
   if (conn->m_disable_multiplexing_fn)
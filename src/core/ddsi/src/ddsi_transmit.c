@@ -16,6 +16,7 @@
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_unused.h"
 #include "dds/ddsi/ddsi_tkmap.h"
@@ -39,6 +40,7 @@
 #include "ddsi__endpoint_match.h"
 #include "ddsi__protocol.h"
 #include "ddsi__vendor.h"
+#include "ddsi__tokenbucket.h"
 #include "dds__whc.h"
 
 static const struct ddsi_wr_prd_match *root_rdmatch (const struct ddsi_writer *wr)
@@ -288,6 +290,93 @@ dds_return_t ddsi_create_fragment_message (struct ddsi_writer *wr, ddsi_seqno_t
   return ret;
 }
 
+static uint32_t fec_group_size (const struct ddsi_writer *wr, const struct ddsi_proxy_reader *prd, int isnew)
+{
+  /* Parity only makes sense for new data sent to all readers: retransmits are requested
+     for specific fragments by specific readers.  Security plugins transform the payload
+     and/or submessages in ways that the XOR parity doesn't survive. */
+  if (!isnew || prd != NULL || wr->e.gv->config.fec_group_size <= 0 || wr->num_readers_accepting_fec == 0)
+    return 0;
+  if (ddsi_omg_writer_is_submessage_protected (wr) || ddsi_omg_writer_is_payload_protected (wr))
+    return 0;
+  return (uint32_t) wr->e.gv->config.fec_group_size;
+}
+
+static dds_return_t create_fec_parity_message (struct ddsi_writer *wr, ddsi_seqno_t seq, struct ddsi_serdata *serdata, uint32_t fragnum, uint32_t nfrags_in_slot, uint32_t nslots, struct ddsi_xmsg **pmsg)
+{
+  /* Parity over nslots consecutive slots of nfrags_in_slot fragments each (the final slot
+     possibly shorter because the sample ends), starting at fragnum (0-based).  The header
+     is that of the DataFrag for the first slot, so that the receiver can turn it into a
+     DataFrag for whichever slot it reconstructs with a few modifications.  That includes
+     the timestamp and inline QoS if the first slot starts at fragment 0. */
+  const size_t expected_inline_qos_size = /* statusinfo */ 8 + /* keyhash */ 20 + /* sentinel */ 4;
+  struct ddsi_domaingv const * const gv = wr->e.gv;
+  const uint32_t size = ddsi_serdata_size (serdata);
+  const uint32_t fragsize = gv->config.fragment_size;
+  const uint32_t slotsize = nfrags_in_slot * fragsize;
+  const uint32_t gmin = fragnum * fragsize;
+  const uint32_t gmaxp1 = (size - gmin) / slotsize >= nslots ? gmin + nslots * slotsize : size;
+  const uint32_t plen = (gmaxp1 - gmin > slotsize) ? slotsize : gmaxp1 - gmin;
+  const uint32_t plen4 = (plen + 3u) & ~3u;
+  struct ddsi_xmsg_marker sm_marker;
+  ddsi_rtps_fecparity_t *fp;
+  unsigned char *parity;
+
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  assert (gmin < size && nslots > 0 && nslots <= UINT16_MAX && nfrags_in_slot <= UINT16_MAX);
+  assert (serdata->kind != SDK_EMPTY);
+
+  if ((*pmsg = ddsi_xmsg_new (gv->xmsgpool, &wr->e.guid, wr->c.pp, sizeof (ddsi_rtps_info_ts_t) + sizeof (ddsi_rtps_fecparity_t) + expected_inline_qos_size + plen4, DDSI_XMSG_KIND_DATA)) == NULL)
+    return DDS_RETCODE_OUT_OF_RESOURCES;
+  ddsi_xmsg_setdst_addrset (*pmsg, wr->as);
+  ddsi_xmsg_setmaxdelay (*pmsg, wr->xqos->latency_budget.duration);
+  if (fragnum == 0)
+    ddsi_xmsg_add_timestamp (*pmsg, serdata->timestamp);
+
+  fp = ddsi_xmsg_append (*pmsg, &sm_marker, sizeof (*fp));
+  ddsi_xmsg_submsg_init (*pmsg, sm_marker, DDSI_RTPS_SMID_CYCLONE_FEC_PARITY);
+  fp->x.smhdr.flags = (unsigned char) (fp->x.smhdr.flags | (serdata->kind == SDK_KEY ? DDSI_DATAFRAG_FLAG_KEYFLAG : 0));
+  fp->x.extraFlags = (uint16_t) nslots;
+  fp->x.octetsToInlineQos = (unsigned short) ((char*) (fp+1) - ((char*) &fp->x.octetsToInlineQos + 2));
+  fp->x.readerId = ddsi_hton_entityid (ddsi_to_entityid (DDSI_ENTITYID_UNKNOWN));
+  fp->x.writerId = ddsi_hton_entityid (wr->e.guid.entityid);
+  fp->x.writerSN = ddsi_to_seqno (seq);
+  fp->fragmentStartingNum = fragnum + 1;
+  fp->fragmentsInSubmessage = (uint16_t) ((plen + fragsize - 1) / fragsize);
+  fp->fragmentSize = (uint16_t) fragsize;
+  fp->sampleSize = size;
+
+  if (fragnum == 0)
+  {
+    /* Adding parameters means potential reallocing, so fp now likely becomes invalid */
+    if (wr->num_readers_requesting_keyhash > 0)
+      ddsi_xmsg_addpar_keyhash (*pmsg, serdata, wr->force_md5_keyhash);
+    if (serdata->statusinfo)
+      ddsi_xmsg_addpar_statusinfo (*pmsg, serdata->statusinfo);
+    if (ddsi_xmsg_addpar_sentinel_ifparam (*pmsg) > 0)
+    {
+      fp = ddsi_xmsg_submsg_from_marker (*pmsg, sm_marker);
+      fp->x.smhdr.flags |= DDSI_DATAFRAG_FLAG_INLINE_QOS;
+    }
+  }
+
+  parity = ddsi_xmsg_append (*pmsg, NULL, plen4);
+  memset (parity, 0, plen4);
+  for (uint32_t off = gmin; off < gmaxp1; off += slotsize)
+  {
+    const uint32_t len = (gmaxp1 - off > slotsize) ? slotsize : gmaxp1 - off;
+    ddsrt_iovec_t iov;
+    struct ddsi_serdata *ref = ddsi_serdata_to_ser_ref (serdata, off, len, &iov);
+    const unsigned char *src = iov.iov_base;
+    assert (iov.iov_len >= len);
+    for (uint32_t i = 0; i < len; i++)
+      parity[i] ^= src[i];
+    ddsi_serdata_to_ser_unref (ref, &iov);
+  }
+  ddsi_xmsg_submsg_setnext (*pmsg, sm_marker);
+  return 0;
+}
+
 static void create_HeartbeatFrag (struct ddsi_writer *wr, ddsi_seqno_t seq, unsigned fragnum, struct ddsi_proxy_reader *prd, struct ddsi_xmsg **pmsg)
 {
   struct ddsi_domaingv const * const gv = wr->e.gv;
@@ -389,10 +478,14 @@ static void transmit_sample_lgmsg_unlocks_wr (struct ddsi_xpack *xp, struct ddsi
     nf_in_submsg = 1;
   else if (nf_in_submsg > UINT16_MAX)
     nf_in_submsg = UINT16_MAX;
+  const uint32_t nf_in_slot = nf_in_submsg;
+  const uint32_t fec_nslots = fec_group_size (wr, prd, isnew);
+  uint32_t fec_fragnum = 0, fec_n = 0;
   for (uint32_t i = 0; i < nfrags_lim; i += nf_in_submsg)
   {
     struct ddsi_xmsg *fmsg = NULL;
     struct ddsi_xmsg *hmsg = NULL;
+    struct ddsi_xmsg *pmsg = NULL;
     int ret;
 #if 0
     if (must_skip_frag (frags_to_skip, i))
@@ -412,10 +505,29 @@ static void transmit_sample_lgmsg_unlocks_wr (struct ddsi_xpack *xp, struct ddsi
       // more fragment messages to come
       create_HeartbeatFrag (wr, seq, i + nf_in_submsg - 1, prd, &hmsg);
     }
+    if (fec_nslots > 0)
+    {
+      /* Every slot but the one at the end of the sample must be a full fragment message
+         for the receiver to know the layout, so a group cut short by the burst limit
+         doesn't get a parity message */
+      if (nf_in_submsg < nf_in_slot && i + nf_in_submsg < nfrags)
+        fec_n = 0;
+      else
+      {
+        if (fec_n++ == 0)
+          fec_fragnum = i;
+        if (fec_n == fec_nslots || i + nf_in_submsg == nfrags)
+        {
+          (void) create_fec_parity_message (wr, seq, serdata, fec_fragnum, nf_in_slot, fec_n, &pmsg);
+          fec_n = 0;
+        }
+      }
+    }
     ddsrt_mutex_unlock (&wr->e.lock);
 
     if(fmsg) ddsi_xpack_addmsg (xp, fmsg, 0);
     if(hmsg) ddsi_xpack_addmsg (xp, hmsg, 0);
+    if(pmsg) ddsi_xpack_addmsg (xp, pmsg, 0);
 
     ddsrt_mutex_lock (&wr->e.lock);
   }
@@ -726,6 +838,47 @@ static dds_return_t throttle_writer (struct ddsi_thread_state * const thrst, str
   return result;
 }
 
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+static dds_return_t pace_writer (struct ddsi_thread_state * const thrst, struct ddsi_writer *wr, uint32_t sz)
+{
+  /* Waits until the writer's token bucket is no longer in debt, then charges
+     it for this sample.  Like throttle_writer, this sleeps on the throttle
+     condition variable without updating the thread's vtime and with
+     "throttling" incremented so that the writer can't be freed. */
+  struct ddsi_domaingv const * const gv = wr->e.gv;
+  dds_return_t result = DDS_RETCODE_OK;
+  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  const dds_duration_t delay = ddsi_tokenbucket_delay (wr->tokenbucket, tnow);
+
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  if (delay > 0)
+  {
+    if (delay > wr->xqos->reliability.max_blocking_time)
+      return DDS_RETCODE_TIMEOUT;
+    GVLOG (DDS_LC_THROTTLE, "writer "PGUIDFMT" pacing for %"PRId64"ns\n", PGUID (wr->e.guid), delay);
+    const ddsrt_mtime_t abstimeout = ddsrt_mtime_add_duration (tnow, delay);
+    wr->throttling++;
+    while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing) && wr->state == WRST_OPERATIONAL && tnow.v < abstimeout.v)
+    {
+      ddsi_thread_state_asleep (thrst);
+      (void) ddsrt_cond_waitfor (&wr->throttle_cond, &wr->e.lock, abstimeout.v - tnow.v);
+      ddsi_thread_state_awake_domain_ok (thrst);
+      tnow = ddsrt_time_monotonic ();
+    }
+    wr->throttling--;
+    wr->time_throttled += (uint64_t) delay;
+    if (wr->state != WRST_OPERATIONAL)
+    {
+      /* gc_delete_writer may be waiting */
+      ddsrt_cond_broadcast (&wr->throttle_cond);
+      result = DDS_RETCODE_PRECONDITION_NOT_MET;
+    }
+  }
+  (void) ddsi_tokenbucket_charge (wr->tokenbucket, tnow, sz);
+  return result;
+}
+#endif
+
 static int maybe_grow_whc (struct ddsi_writer *wr)
 {
   struct ddsi_domaingv const * const gv = wr->e.gv;
@@ -812,6 +965,44 @@ prd_is_deleting:
   return r;
 }
 
+#ifdef DDS_HAS_TYPELIB
+static bool content_filters_reject (const struct ddsi_writer *wr, const struct ddsi_serdata *serdata)
+{
+  /* A sample is sent to all matching proxy readers or to none (it is addressed
+     to the writer's address set), so skipping it is only possible if every one
+     of them has a content filter that rejects it */
+  if (wr->num_readers == 0 || wr->num_readers_with_content_filter < wr->num_readers)
+    return false;
+  ddsrt_avl_iter_t it;
+  for (const struct ddsi_wr_prd_match *m = ddsrt_avl_iter_first (&ddsi_wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    if (!ddsi_writer_content_filter_rejects (m, serdata))
+      return false;
+  }
+  return true;
+}
+
+static void gap_filtered_sample (struct ddsi_writer *wr, ddsi_seqno_t seq)
+{
+  /* Tell reliable readers straightaway the sample isn't coming, rather than
+     having them discover it is missing from a heartbeat and NACK it */
+  struct ddsi_domaingv * const gv = wr->e.gv;
+  ddsrt_avl_iter_t it;
+  for (struct ddsi_wr_prd_match *m = ddsrt_avl_iter_first (&ddsi_wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    struct ddsi_proxy_reader *prd;
+    struct ddsi_gap_info gi;
+    struct ddsi_xmsg *gap;
+    if (!m->is_reliable || (prd = ddsi_entidx_lookup_proxy_reader_guid (gv->entity_index, &m->prd_guid)) == NULL)
+      continue;
+    ddsi_gap_info_init (&gi);
+    ddsi_gap_info_update (gv, &gi, seq);
+    if ((gap = ddsi_gap_info_create_gap (wr, prd, &gi)) != NULL)
+      ddsi_qxev_msg (wr->evq, gap);
+  }
+}
+#endif
+
 static int write_sample (struct ddsi_thread_state * const thrst, struct ddsi_xpack *xp, struct ddsi_writer *wr, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk, int gc_allowed)
 {
   struct ddsi_domaingv const * const gv = wr->e.gv;
@@ -875,6 +1066,19 @@ static int write_sample (struct ddsi_thread_state * const thrst, struct ddsi_xpa
     }
   }
 
+#ifdef DDS_HAS_NETWORK_PARTITIONS
+  /* Rate limit configured for the network partition: pace the writer */
+  if (wr->tokenbucket && wr->state == WRST_OPERATIONAL)
+  {
+    assert(gc_allowed); /* builtin writers are never rate limited */
+    if ((r = pace_writer (thrst, wr, ddsi_serdata_size (serdata))) == DDS_RETCODE_TIMEOUT)
+    {
+      ddsrt_mutex_unlock (&wr->e.lock);
+      goto drop;
+    }
+  }
+#endif
+
   if (wr->state != WRST_OPERATIONAL)
   {
     r = DDS_RETCODE_PRECONDITION_NOT_MET;
@@ -887,6 +1091,7 @@ static int write_sample (struct ddsi_thread_state * const thrst, struct ddsi_xpa
   serdata->twrite = tnow;
 
   seq = ++wr->seq;
+  DDSRT_PROBE4 (write_sample, &wr->e.guid, seq, serdata->timestamp.v, xp);
   if ((r = insert_sample_in_whc (wr, seq, serdata, tk)) < 0)
   {
     /* Failure of some kind */
@@ -909,6 +1114,19 @@ static int write_sample (struct ddsi_thread_state * const thrst, struct ddsi_xpa
     ddsi_writer_update_seq_xmit (wr, seq);
     ddsrt_mutex_unlock (&wr->e.lock);
   }
+#ifdef DDS_HAS_TYPELIB
+  else if (wr->num_readers_with_content_filter > 0 && content_filters_reject (wr, serdata))
+  {
+    /* All remote readers would drop it, so only send GAPs; it is still in the
+       WHC in case a retransmit is requested and remains subject to the filter */
+    ETRACE (wr, "write_sample "PGUIDFMT" #%"PRIu64": rejected by all content filters\n", PGUID (wr->e.guid), seq);
+    gap_filtered_sample (wr, seq);
+    ddsi_writer_update_seq_xmit (wr, seq);
+    if (wr->heartbeat_xevent)
+      ddsi_writer_hbcontrol_note_asyncwrite (wr, tnow);
+    ddsrt_mutex_unlock (&wr->e.lock);
+  }
+#endif
   else
   {
     /* Note the subtlety of enqueueing with the lock held but
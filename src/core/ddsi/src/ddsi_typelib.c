@@ -14,6 +14,8 @@
 #include <stdlib.h>
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/string.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_sertype.h"
 #include "dds/ddsi/ddsi_xt_typemap.h"
@@ -367,10 +369,14 @@ static void type_dep_trace (struct ddsi_domaingv *gv, const char *prefix, struct
   GVTRACE ("%sdep <%s, %s>\n", prefix, ddsi_make_typeid_str (&tistr, &dep->src_type_id), ddsi_make_typeid_str (&tistrdep, &dep->dep_type_id));
 }
 
+static void assignability_memo_purge (struct ddsi_domaingv *gv, const struct ddsi_type *type);
+
 void ddsi_type_free (struct ddsi_type *type)
 {
   struct ddsi_domaingv *gv = type->gv;
   struct ddsi_type_dep key;
+  if (type->assignability_memo_refc > 0)
+    assignability_memo_purge (gv, type);
   memset (&key, 0, sizeof (key));
   ddsi_typeid_copy (&key.src_type_id, &type->xt.id);
   ddsi_xt_type_fini (gv, &type->xt, true);
@@ -742,17 +748,73 @@ dds_return_t ddsi_type_add (struct ddsi_domaingv *gv, struct ddsi_type **type_mi
   return ret;
 }
 
+static bool type_ref_local_resolved (struct ddsi_domaingv *gv, struct ddsi_type **type, const ddsi_typeinfo_t *type_info, ddsi_typeid_kind_t kind)
+{
+  /* A local type that is already known and resolved, including its dependencies, only
+     needs to be referenced and have the dependencies from the type information recorded:
+     the type map (which contains all type objects) need not be deserialized for that.
+     Every reader, writer and topic of a type references it, so this is the common case.
+
+     This only helps references after the first: the first reference of a type in a
+     domain, and any reference while the type or one of its dependencies is unresolved
+     (e.g., because it was learnt from a remote type information), take the general
+     path that deserializes the type map. That cost is per type and per domain; what
+     is avoided is repeating it for every entity. Dependencies already in the type
+     library are shared with the types that use them in either case. */
+  const struct DDS_XTypes_TypeIdentifier *type_id = (kind == DDSI_TYPEID_KIND_MINIMAL) ? &type_info->x.minimal.typeid_with_size.type_id : &type_info->x.complete.typeid_with_size.type_id;
+  bool done = false;
+  ddsrt_mutex_lock (&gv->typelib_lock);
+  struct ddsi_type *t = ddsi_type_lookup_locked_impl (gv, type_id);
+  if (t != NULL && valid_top_level_type (t) && ddsi_type_resolved_locked (gv, t, DDSI_TYPE_IGNORE_DEPS))
+  {
+    t->refc++;
+    if (type_add_deps (gv, t, type_info, NULL, kind, NULL, NULL) == DDS_RETCODE_OK && ddsi_type_resolved_locked (gv, t, DDSI_TYPE_INCLUDE_DEPS))
+    {
+      GVTRACE ("ref ddsi_type local resolved %p refc %"PRIu32"\n", (void *) t, t->refc);
+      if (type)
+        *type = t;
+      done = true;
+    }
+    else
+    {
+      /* leave it to the general case, which has the type objects to resolve it */
+      t->refc--;
+    }
+  }
+  ddsrt_mutex_unlock (&gv->typelib_lock);
+  return done;
+}
+
+const ddsi_typeinfo_t *ddsi_sertype_typeinfo_cached (const struct ddsi_sertype *sertype)
+{
+  /* Both kinds of type id are looked up for every topic, reader and writer, keeping the
+     deserialized type information saves deserializing it twice for every one of them.
+     It is immutable once published, so there is no need for a lock: if two threads race,
+     one of them discards its copy. */
+  ddsrt_atomic_voidp_t *cache = (ddsrt_atomic_voidp_t *) &sertype->type_info_cache;
+  ddsi_typeinfo_t *type_info;
+  if ((type_info = ddsrt_atomic_ldvoidp (cache)) == NULL && (type_info = ddsi_sertype_typeinfo (sertype)) != NULL)
+  {
+    if (!ddsrt_atomic_casvoidp (cache, NULL, type_info))
+    {
+      ddsi_typeinfo_free (type_info);
+      type_info = ddsrt_atomic_ldvoidp (cache);
+    }
+  }
+  return type_info;
+}
+
 dds_return_t ddsi_type_ref_local (struct ddsi_domaingv *gv, struct ddsi_type **type, const struct ddsi_sertype *sertype, ddsi_typeid_kind_t kind)
 {
   dds_return_t ret = DDS_RETCODE_OK;
   assert (sertype);
-  ddsi_typeinfo_t *type_info = ddsi_sertype_typeinfo (sertype);
+  const ddsi_typeinfo_t *type_info = ddsi_sertype_typeinfo_cached (sertype);
   if (!type_info)
   {
     if (type)
       *type = NULL;
   }
-  else
+  else if (!type_ref_local_resolved (gv, type, type_info, kind))
   {
     struct ddsi_typeid_str tistr;
     ddsi_typemap_t *type_map = ddsi_sertype_typemap (sertype);
@@ -761,8 +823,6 @@ dds_return_t ddsi_type_ref_local (struct ddsi_domaingv *gv, struct ddsi_type **t
     ret = type_add_ref_impl (gv, type, type_info, type_map, kind);
     ddsi_typemap_fini (type_map);
     ddsrt_free (type_map);
-    ddsi_typeinfo_fini (type_info);
-    ddsrt_free (type_info);
   }
   return ret;
 }
@@ -1408,17 +1468,118 @@ static const char *ddsi_non_assignability_code_str (enum ddsi_non_assignability_
   return "(invalid code)";
 };
 
+/* Assignability memo: the outcome of the assignability check for a (reader type, writer type,
+   type consistency enforcement) triplet, so that the many endpoint matches that involve the
+   same types don't each do a full comparison of the type graphs. Types are immutable once
+   resolved and keep their dependencies alive, so an entry remains valid until one of the two
+   types is freed. Failures because of unresolved types are not stored, as those may change.
+   The type identifiers in the reason for a failure are shallow copies that may refer to
+   temporary (key-erased) types, they are only used for printing the hash. */
+struct assignability_memo {
+  const struct ddsi_type *rd_type;
+  const struct ddsi_type *wr_type;
+  uint32_t tce;
+  bool assignable;
+  struct ddsi_non_assignability_reason reason;
+};
+
+static uint32_t assignability_memo_tce (const dds_type_consistency_enforcement_qospolicy_t *tce)
+{
+  return ((uint32_t) tce->kind << 8) |
+    (tce->ignore_sequence_bounds ? 1u : 0u) | (tce->ignore_string_bounds ? 2u : 0u) |
+    (tce->ignore_member_names ? 4u : 0u) | (tce->prevent_type_widening ? 8u : 0u) |
+    (tce->force_type_validation ? 16u : 0u);
+}
+
+static uint32_t assignability_memo_hash (const void *va)
+{
+  const struct assignability_memo *a = va;
+  const uint32_t h = ddsrt_mh3 (&a->rd_type, sizeof (a->rd_type), a->tce);
+  return ddsrt_mh3 (&a->wr_type, sizeof (a->wr_type), h);
+}
+
+static bool assignability_memo_equal (const void *va, const void *vb)
+{
+  const struct assignability_memo *a = va, *b = vb;
+  return a->rd_type == b->rd_type && a->wr_type == b->wr_type && a->tce == b->tce;
+}
+
+static void assignability_memo_free_wrap (void *vm, void *varg)
+{
+  (void) varg;
+  ddsrt_free (vm);
+}
+
+void ddsi_assignability_memo_init (struct ddsi_domaingv *gv)
+{
+  gv->assignability_memo = ddsrt_hh_new (1, assignability_memo_hash, assignability_memo_equal);
+}
+
+void ddsi_assignability_memo_fini (struct ddsi_domaingv *gv)
+{
+  ddsrt_hh_enum (gv->assignability_memo, assignability_memo_free_wrap, NULL);
+  ddsrt_hh_free (gv->assignability_memo);
+}
+
+static void assignability_memo_purge (struct ddsi_domaingv *gv, const struct ddsi_type *type)
+{
+  /* Removing entries doesn't move other entries in the hash table, nor does it shrink it,
+     so it is safe to do while iterating */
+  struct ddsrt_hh_iter it;
+  for (struct assignability_memo *m = ddsrt_hh_iter_first (gv->assignability_memo, &it); m; m = ddsrt_hh_iter_next (&it))
+  {
+    if (m->rd_type != type && m->wr_type != type)
+      continue;
+    ddsrt_hh_remove_present (gv->assignability_memo, m);
+    ((struct ddsi_type *) m->rd_type)->assignability_memo_refc--;
+    ((struct ddsi_type *) m->wr_type)->assignability_memo_refc--;
+    ddsrt_free (m);
+  }
+  assert (type->assignability_memo_refc == 0);
+}
+
+static bool assignability_memo_lookup (struct ddsi_domaingv *gv, const struct ddsi_type *rd_type, const struct ddsi_type *wr_type, const dds_type_consistency_enforcement_qospolicy_t *tce, struct ddsi_non_assignability_reason *reason, bool *assignable)
+{
+  const struct assignability_memo template = { .rd_type = rd_type, .wr_type = wr_type, .tce = assignability_memo_tce (tce) };
+  const struct assignability_memo *m;
+  if ((m = ddsrt_hh_lookup (gv->assignability_memo, &template)) == NULL)
+    return false;
+  *assignable = m->assignable;
+  *reason = m->reason;
+  return true;
+}
+
+static void assignability_memo_add (struct ddsi_domaingv *gv, struct ddsi_type *rd_type, struct ddsi_type *wr_type, const dds_type_consistency_enforcement_qospolicy_t *tce, const struct ddsi_non_assignability_reason *reason, bool assignable)
+{
+  if (!assignable && reason->code == DDSI_NONASSIGN_TYPE_UNRESOLVED)
+    return;
+  struct assignability_memo *m = ddsrt_malloc (sizeof (*m));
+  m->rd_type = rd_type;
+  m->wr_type = wr_type;
+  m->tce = assignability_memo_tce (tce);
+  m->assignable = assignable;
+  m->reason = *reason;
+  ddsrt_hh_add_absent (gv->assignability_memo, m);
+  rd_type->assignability_memo_refc++;
+  wr_type->assignability_memo_refc++;
+}
 
 bool ddsi_is_assignable_from (struct ddsi_domaingv *gv, const struct ddsi_type_pair *rd_type_pair, uint32_t rd_resolved, const struct ddsi_type_pair *wr_type_pair, uint32_t wr_resolved, const dds_type_consistency_enforcement_qospolicy_t *tce)
 {
   if (!rd_type_pair || !wr_type_pair)
     return false;
   ddsrt_mutex_lock (&gv->typelib_lock);
-  const struct xt_type
-    *rd_xt = (rd_resolved == DDS_XTypes_EK_BOTH || rd_resolved == DDS_XTypes_EK_MINIMAL) ? &rd_type_pair->minimal->xt : &rd_type_pair->complete->xt,
-    *wr_xt = (wr_resolved == DDS_XTypes_EK_BOTH || wr_resolved == DDS_XTypes_EK_MINIMAL) ? &wr_type_pair->minimal->xt : &wr_type_pair->complete->xt;
+  struct ddsi_type
+    *rd_type = (rd_resolved == DDS_XTypes_EK_BOTH || rd_resolved == DDS_XTypes_EK_MINIMAL) ? rd_type_pair->minimal : rd_type_pair->complete,
+    *wr_type = (wr_resolved == DDS_XTypes_EK_BOTH || wr_resolved == DDS_XTypes_EK_MINIMAL) ? wr_type_pair->minimal : wr_type_pair->complete;
+  const struct xt_type *rd_xt = &rd_type->xt, *wr_xt = &wr_type->xt;
   struct ddsi_non_assignability_reason reason;
-  bool assignable = ddsi_xt_is_assignable_from (gv, rd_xt, wr_xt, tce, &reason);
+  bool assignable;
+  if (!assignability_memo_lookup (gv, rd_type, wr_type, tce, &reason, &assignable))
+  {
+    assignable = ddsi_xt_is_assignable_from (gv, rd_xt, wr_xt, tce, &reason);
+    assignability_memo_add (gv, rd_type, wr_type, tce, &reason, assignable);
+  }
   ddsrt_mutex_unlock (&gv->typelib_lock);
 
   if (!assignable)
@@ -107,6 +107,14 @@ struct ddsi_xeventq {
   ddsrt_cond_t cond;
 
   size_t cum_rexmit_bytes;
+
+  /* statistics: number of timed events executed, and the sum and maximum
+     of the delays (in ns) between their scheduled and actual execution */
+  uint64_t timed_handled;
+  uint64_t timed_lateness;
+  uint64_t max_timed_lateness;
+  uint64_t nontimed_handled;
+  ddsrt_mtime_t t_last_check; /* events scheduled before this can't have been due before this */
 };
 
 static uint32_t xevent_thread (struct ddsi_xeventq *xevq);
@@ -434,6 +442,11 @@ struct ddsi_xeventq * ddsi_xeventq_new (struct ddsi_domaingv *gv, size_t max_que
   ddsrt_cond_init (&evq->cond);
 
   evq->cum_rexmit_bytes = 0;
+  evq->timed_handled = 0;
+  evq->timed_lateness = 0;
+  evq->max_timed_lateness = 0;
+  evq->nontimed_handled = 0;
+  evq->t_last_check = ddsrt_time_monotonic ();
   return evq;
 }
 
@@ -584,15 +597,23 @@ static void handle_xevents (struct ddsi_thread_state * const thrst, struct ddsi_
         free_xevent (xev);
       else
       {
+        // events scheduled in the past only became due when they were scheduled
+        const uint64_t lateness = (uint64_t) (tnow.v - ((xev->tsched.v > xevq->t_last_check.v) ? xev->tsched.v : xevq->t_last_check.v));
+        xevq->timed_handled++;
+        xevq->timed_lateness += lateness;
+        if (lateness > xevq->max_timed_lateness)
+          xevq->max_timed_lateness = lateness;
         ddsi_thread_state_awake_to_awake_no_nest (thrst);
         handle_timed_xevent (xevq, xev, xp, tnow);
         cont = true;
       }
     }
+    xevq->t_last_check = tnow;
 
     if (!non_timed_xmit_list_is_empty (xevq))
     {
       struct ddsi_xevent_nt *xev = getnext_from_non_timed_xmit_list (xevq);
+      xevq->nontimed_handled++;
       ddsi_thread_state_awake_to_awake_no_nest (thrst);
       handle_nontimed_xevent (xevq, xev, xp);
       cont = true;
@@ -603,6 +624,17 @@ static void handle_xevents (struct ddsi_thread_state * const thrst, struct ddsi_
   ASSERT_MUTEX_HELD (&xevq->lock);
 }
 
+void ddsi_xeventq_stats (struct ddsi_xeventq *evq, uint32_t *nontimed_length, uint64_t *nontimed_handled, uint64_t *timed_handled, uint64_t *timed_lateness, uint64_t *max_timed_lateness)
+{
+  ddsrt_mutex_lock (&evq->lock);
+  *nontimed_length = (uint32_t) evq->non_timed_xmit_list_length;
+  *nontimed_handled = evq->nontimed_handled;
+  *timed_handled = evq->timed_handled;
+  *timed_lateness = evq->timed_lateness;
+  *max_timed_lateness = evq->max_timed_lateness;
+  ddsrt_mutex_unlock (&evq->lock);
+}
+
 void ddsi_xeventq_step (struct ddsi_xeventq *evq)
 {
   struct ddsi_thread_state * const thrst = ddsi_lookup_thread_state ();
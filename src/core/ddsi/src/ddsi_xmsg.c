@@ -22,6 +22,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/random.h"
 #include "dds/ddsrt/avl.h"
+#include "dds/ddsrt/probes.h"
 #include "dds/ddsi/ddsi_xqos.h"
 #include "dds/ddsi/ddsi_log.h"
 #include "dds/ddsi/ddsi_unused.h"
@@ -39,6 +40,7 @@
 #include "ddsi__plist.h"
 #include "ddsi__tran.h"
 #include "ddsi__vendor.h"
+#include "ddsi__tokenbucket.h"
 
 #define DDSI_XMSG_MAX_ALIGN 8
 #define DDSI_XMSG_CHUNK_SIZE 128
@@ -140,6 +142,12 @@ struct ddsi_xpack
 {
   struct ddsi_xpack *sendq_next;
   bool async_mode;
+  int32_t priority; /* position in send queue, higher goes first */
+  uint64_t sendq_finish; /* virtual finish time of the last packet queued from this xpack */
+  uint64_t sendq_vfinish; /* virtual finish time of this packet in the send queue */
+  dds_duration_t max_blocking_time; /* max wait for space in send queue for paced packets */
+  bool paced; /* in send queue, token buckets charged, not to be sent before tsend */
+  ddsrt_mtime_t tsend;
   ddsi_rtps_header_t hdr;
   ddsi_rtps_msg_len_t msg_len;
   ddsi_guid_prefix_t *last_src;
@@ -363,6 +371,7 @@ static int submsg_is_compatible (const struct ddsi_xmsg *msg, ddsi_rtps_submessa
           /* normal control stuff is ok */
           return 1;
         case DDSI_RTPS_SMID_DATA: case DDSI_RTPS_SMID_DATA_FRAG:
+        case DDSI_RTPS_SMID_CYCLONE_FEC_PARITY:
           /* but data is strictly verboten */
           return 0;
         case DDSI_RTPS_SMID_SEC_BODY:
@@ -388,6 +397,7 @@ static int submsg_is_compatible (const struct ddsi_xmsg *msg, ddsi_rtps_submessa
           /* we never generate these directly */
           return 0;
         case DDSI_RTPS_SMID_INFO_TS: case DDSI_RTPS_SMID_DATA: case DDSI_RTPS_SMID_DATA_FRAG:
+        case DDSI_RTPS_SMID_CYCLONE_FEC_PARITY:
           /* Timestamp only preceding data; data may be present just
              once for rexmits.  The readerId offset can be used to
              ensure rexmits have only one data submessages -- the test
@@ -1086,6 +1096,16 @@ struct ddsi_xpack * ddsi_xpack_new (struct ddsi_domaingv *gv, bool async_mode)
   return xp;
 }
 
+void ddsi_xpack_set_priority (struct ddsi_xpack *xp, int32_t priority)
+{
+  xp->priority = priority;
+}
+
+void ddsi_xpack_set_max_blocking_time (struct ddsi_xpack *xp, dds_duration_t max_blocking_time)
+{
+  xp->max_blocking_time = max_blocking_time;
+}
+
 void ddsi_xpack_free (struct ddsi_xpack *xp)
 {
   assert (xp->msgfrags == NULL || xp->msgfrags->niov == 0);
@@ -1123,6 +1143,58 @@ static ssize_t ddsi_xpack_send_rtps(struct ddsi_xpack * xp, const ddsi_xlocator_
   return ret;
 }
 
+struct ddsi_xpack_charge_arg {
+  const struct ddsi_xpack *xp;
+  ddsrt_mtime_t tnow;
+  dds_duration_t delay;
+};
+
+static void ddsi_xpack_charge_intf (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct ddsi_xpack_charge_arg * const arg = varg;
+  struct ddsi_domaingv const * const gv = arg->xp->gv;
+  const struct ddsi_network_interface *intf = loc->conn->m_interf;
+  if (intf == NULL || intf < gv->interfaces || intf >= gv->interfaces + gv->n_interfaces)
+    return;
+  struct ddsi_tokenbucket * const tb = gv->intf_tokenbuckets[intf - gv->interfaces];
+  if (tb != NULL)
+  {
+    const dds_duration_t delay = ddsi_tokenbucket_charge (tb, arg->tnow, arg->xp->msg_len.length);
+    if (delay > arg->delay)
+      arg->delay = delay;
+  }
+}
+
+static dds_duration_t ddsi_xpack_charge (const struct ddsi_xpack *xp, ddsrt_mtime_t tnow)
+{
+  /* Charges the token buckets of the interfaces for each destination and returns
+     how long to wait before sending.  Retransmits have a budget of their own,
+     charged once per packet regardless of the number of destinations, on top of
+     the per-interface budget */
+  struct ddsi_domaingv const * const gv = xp->gv;
+  struct ddsi_xpack_charge_arg arg = { .xp = xp, .tnow = tnow, .delay = 0 };
+  if (xp->includes_rexmit && gv->rexmit_tokenbucket != NULL)
+    arg.delay = ddsi_tokenbucket_charge (gv->rexmit_tokenbucket, tnow, xp->msg_len.length);
+  switch (xp->dstmode)
+  {
+    case NN_XMSG_DST_UNSET:
+      assert (0);
+      break;
+    case NN_XMSG_DST_ONE:
+      ddsi_xpack_charge_intf (&xp->dstaddr.loc, &arg);
+      break;
+    case NN_XMSG_DST_ALL:
+      if (xp->dstaddr.all.as)
+        ddsi_addrset_forall (xp->dstaddr.all.as, ddsi_xpack_charge_intf, &arg);
+      break;
+    case NN_XMSG_DST_ALL_UC:
+      if (xp->dstaddr.all_uc.as)
+        (void) ddsi_addrset_forall_uc_count (xp->dstaddr.all_uc.as, ddsi_xpack_charge_intf, &arg);
+      break;
+  }
+  return arg.delay;
+}
+
 static ssize_t ddsi_xpack_send1 (const ddsi_xlocator_t *loc, void * varg)
 {
   struct ddsi_xpack *xp = varg;
@@ -1234,6 +1306,7 @@ static void ddsi_xpack_send_real (struct ddsi_xpack *xp)
       break;
   }
   GVTRACE (" ]\n");
+  DDSRT_PROBE3 (xpack_send, xp, xp->msg_len.length, calls);
   if (calls)
   {
     GVLOG (DDS_LC_TRAFFIC, "traffic-xmit (%lu) %"PRIu32"\n", (unsigned long) calls, xp->msg_len.length);
@@ -1243,6 +1316,47 @@ static void ddsi_xpack_send_real (struct ddsi_xpack *xp)
 }
 
 #define SENDQ_MAX 200
+/* Allowance for the UDP/IP headers in the cost of a packet in the send queue */
+#define SENDQ_PACKET_OVERHEAD 28
+
+struct ddsi_xpack *ddsi_xpack_sendq_dequeue_locked (struct ddsi_domaingv *gv)
+{
+  struct ddsi_xpack *xp;
+  if ((xp = gv->sendq_head) != NULL)
+  {
+    gv->sendq_head = xp->sendq_next;
+    gv->sendq_vtime = xp->sendq_vfinish;
+    if (--gv->sendq_length == 0)
+      ddsrt_cond_broadcast (&gv->sendq_cond);
+  }
+  return xp;
+}
+
+static void ddsi_xpack_sendq_pace_locked (struct ddsi_thread_state * const thrst, struct ddsi_xpack *xp)
+{
+  /* Packets from asynchronous writers are charged when they are about to be sent,
+     packets deferred by ddsi_xpack_send already have been.  This is the only place
+     where a thread waits because of traffic shaping, and it holds nothing but the
+     send queue lock while doing so.  Stopping the queue flushes it without delay. */
+  struct ddsi_domaingv * const gv = xp->gv;
+  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  if (!xp->paced && !gv->mute)
+  {
+    xp->tsend = ddsrt_mtime_add_duration (tnow, ddsi_xpack_charge (xp, tnow));
+    xp->paced = true;
+  }
+  if (tnow.v < xp->tsend.v)
+  {
+    GVTRACE ("sendq: paced %"PRId64"ns\n", xp->tsend.v - tnow.v);
+    ddsi_thread_state_asleep (thrst);
+    while (!gv->sendq_stop && tnow.v < xp->tsend.v)
+    {
+      (void) ddsrt_cond_waitfor (&gv->sendq_cond, &gv->sendq_lock, xp->tsend.v - tnow.v);
+      tnow = ddsrt_time_monotonic ();
+    }
+    ddsi_thread_state_awake_fixed_domain (thrst);
+  }
+}
 
 static uint32_t ddsi_xpack_sendq_thread (void *vgv)
 {
@@ -1253,7 +1367,7 @@ static uint32_t ddsi_xpack_sendq_thread (void *vgv)
   while (!(gv->sendq_stop && gv->sendq_head == NULL))
   {
     struct ddsi_xpack *xp;
-    if ((xp = gv->sendq_head) == NULL)
+    if ((xp = ddsi_xpack_sendq_dequeue_locked (gv)) == NULL)
     {
       ddsi_thread_state_asleep (thrst);
       (void) ddsrt_cond_wait (&gv->sendq_cond, &gv->sendq_lock);
@@ -1261,13 +1375,15 @@ static uint32_t ddsi_xpack_sendq_thread (void *vgv)
     }
     else
     {
-      gv->sendq_head = xp->sendq_next;
-      if (--gv->sendq_length == 0)
-        ddsrt_cond_broadcast (&gv->sendq_cond);
+      const bool paced = xp->paced;
+      if (gv->xpack_shaping)
+        ddsi_xpack_sendq_pace_locked (thrst, xp);
       ddsrt_mutex_unlock (&gv->sendq_lock);
       ddsi_xpack_send_real (xp);
       ddsi_xpack_free (xp);
       ddsrt_mutex_lock (&gv->sendq_lock);
+      if (paced && --gv->sendq_paced == 0)
+        ddsrt_cond_broadcast (&gv->sendq_cond);
     }
   }
   ddsrt_mutex_unlock (&gv->sendq_lock);
@@ -1275,12 +1391,60 @@ static uint32_t ddsi_xpack_sendq_thread (void *vgv)
   return 0;
 }
 
+void ddsi_xpack_shaping_init (struct ddsi_domaingv *gv)
+{
+  /* Bucket depth of one maximum-sized message: anything more than that gets
+     paced, allowing for full-sized packets without ever allowing large bursts */
+  const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  for (int i = 0; i < MAX_XMIT_CONNS; i++)
+  {
+    if (i < gv->n_interfaces && gv->interfaces[i].max_rate > 0)
+    {
+      GVLOG (DDS_LC_CONFIG, "interface %s: max rate %"PRIu32" B/s\n", gv->interfaces[i].name, gv->interfaces[i].max_rate);
+      gv->intf_tokenbuckets[i] = ddsi_tokenbucket_new (gv->interfaces[i].max_rate, gv->config.max_msg_size, tnow);
+    }
+    else
+    {
+      gv->intf_tokenbuckets[i] = NULL;
+    }
+  }
+  if (gv->config.max_rexmit_rate > 0)
+    gv->rexmit_tokenbucket = ddsi_tokenbucket_new (gv->config.max_rexmit_rate, gv->config.max_rexmit_msg_size, tnow);
+  else
+    gv->rexmit_tokenbucket = NULL;
+  gv->xpack_shaping = (gv->rexmit_tokenbucket != NULL);
+  for (int i = 0; i < MAX_XMIT_CONNS; i++)
+    if (gv->intf_tokenbuckets[i])
+      gv->xpack_shaping = true;
+}
+
+void ddsi_xpack_shaping_fini (struct ddsi_domaingv *gv)
+{
+  for (int i = 0; i < MAX_XMIT_CONNS; i++)
+  {
+    if (gv->intf_tokenbuckets[i])
+    {
+      ddsi_tokenbucket_free (gv->intf_tokenbuckets[i]);
+      gv->intf_tokenbuckets[i] = NULL;
+    }
+  }
+  if (gv->rexmit_tokenbucket)
+  {
+    ddsi_tokenbucket_free (gv->rexmit_tokenbucket);
+    gv->rexmit_tokenbucket = NULL;
+  }
+}
+
 void ddsi_xpack_sendq_init (struct ddsi_domaingv *gv)
 {
   gv->sendq_stop = 0;
   gv->sendq_head = NULL;
   gv->sendq_tail = NULL;
   gv->sendq_length = 0;
+  gv->sendq_packets = 0;
+  gv->sendq_blocked = 0;
+  gv->sendq_paced = 0;
+  gv->sendq_vtime = 0;
   ddsrt_mutex_init (&gv->sendq_lock);
   ddsrt_cond_init (&gv->sendq_cond);
 }
@@ -1308,36 +1472,140 @@ void ddsi_xpack_sendq_fini (struct ddsi_domaingv *gv)
   ddsrt_mutex_destroy (&gv->sendq_lock);
 }
 
+static struct ddsi_xpack *ddsi_xpack_copy_and_reinit (struct ddsi_xpack *xp)
+{
+  /* The copy takes over the contents, leaving xp ready for the next packet */
+  struct ddsi_xpack *xp1 = ddsrt_malloc (sizeof (*xp));
+  memcpy(xp1, xp, sizeof(*xp1));
+  if (xp->msgfrags != NULL) {
+    xp1->msgfrags = ddsrt_malloc (sizeof (*xp->msgfrags) + xp->msgfrags->niov * sizeof (ddsrt_iovec_t));
+    xp1->msgfrags->niov = xp->msgfrags->niov;
+    memcpy (xp1->msgfrags->iov, xp->msgfrags->iov, xp->msgfrags->niov * sizeof (*xp->msgfrags->iov));
+  }
+  ddsi_xpack_reinit (xp);
+  xp1->sendq_next = NULL;
+  return xp1;
+}
+
+static bool ddsi_xpack_sendq_goes_before (const struct ddsi_xpack *a, const struct ddsi_xpack *b)
+{
+  return a->priority > b->priority || (a->priority == b->priority && a->sendq_vfinish <= b->sendq_vfinish);
+}
+
+static void ddsi_xpack_sendq_insert_locked (struct ddsi_domaingv *gv, struct ddsi_xpack *xp, struct ddsi_xpack *xp1)
+{
+  /* Queue is ordered on priority and within a priority on virtual finish time
+     (self-clocked fair queueing): a packet finishes its size after the later of the
+     previous packet from the same xpack (i.e., writer) and the packet last taken
+     from the queue.  The fragments of a large sample that were queued in one go
+     therefore get interleaved with the packets of other writers queued later
+     instead of blocking them, while the packets of any one writer remain in order.
+     Inserting ahead of lower priority packets lets the samples of a high priority
+     writer overtake everything queued at a lower priority. */
+  const uint64_t vstart = (xp->sendq_finish > gv->sendq_vtime) ? xp->sendq_finish : gv->sendq_vtime;
+  xp1->sendq_vfinish = xp->sendq_finish = vstart + xp1->msg_len.length + SENDQ_PACKET_OVERHEAD;
+  if (gv->sendq_head == NULL)
+    gv->sendq_head = gv->sendq_tail = xp1;
+  else if (ddsi_xpack_sendq_goes_before (gv->sendq_tail, xp1))
+  {
+    gv->sendq_tail->sendq_next = xp1;
+    gv->sendq_tail = xp1;
+  }
+  else
+  {
+    struct ddsi_xpack **pp = &gv->sendq_head;
+    while (ddsi_xpack_sendq_goes_before (*pp, xp1))
+      pp = &(*pp)->sendq_next;
+    xp1->sendq_next = *pp;
+    *pp = xp1;
+  }
+  gv->sendq_length++;
+  gv->sendq_packets++;
+}
+
+static bool ddsi_xpack_send_paced (struct ddsi_xpack *xp)
+{
+  /* Charges the token buckets for a synchronously sent packet and hands it to the
+     send queue if it has to wait, rather than sleeping in a thread that may well be
+     the timed-event thread or hold references to entities.  Once any packet has
+     been deferred, the following ones go through the send queue as well until it
+     has been sent, so that they can't overtake it.
+
+     A full send queue is waited for at most max_blocking_time, which is 0 except
+     for the writers that set it to their reliability QoS setting.  Control traffic
+     and retransmits therefore never wait, it is the writers' token buckets and
+     history caches that limit the amount of data. */
+  struct ddsi_domaingv * const gv = xp->gv;
+  if (xp->msgfrags == NULL || xp->msgfrags->niov == 0 || gv->mute || !gv->sendq_running)
+    return false;
+  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  const dds_duration_t delay = ddsi_xpack_charge (xp, tnow);
+  ddsrt_mutex_lock (&gv->sendq_lock);
+  if (delay <= 0 && gv->sendq_paced == 0)
+  {
+    ddsrt_mutex_unlock (&gv->sendq_lock);
+    return false;
+  }
+  if (gv->sendq_length >= SENDQ_MAX && xp->max_blocking_time > 0)
+  {
+    const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (tnow, xp->max_blocking_time);
+    gv->sendq_blocked++;
+    while (gv->sendq_length >= SENDQ_MAX && tnow.v < tend.v)
+    {
+      (void) ddsrt_cond_waitfor (&gv->sendq_cond, &gv->sendq_lock, tend.v - tnow.v);
+      tnow = ddsrt_time_monotonic ();
+    }
+  }
+  GVTRACE ("ddsi_xpack_send %"PRIu32": paced %"PRId64"ns\n", xp->msg_len.length, delay);
+  struct ddsi_xpack *xp1 = ddsi_xpack_copy_and_reinit (xp);
+  xp1->paced = true;
+  xp1->tsend = ddsrt_mtime_add_duration (tnow, delay);
+  gv->sendq_paced++;
+  ddsi_xpack_sendq_insert_locked (gv, xp, xp1);
+  ddsrt_cond_broadcast (&gv->sendq_cond);
+  ddsrt_mutex_unlock (&gv->sendq_lock);
+  return true;
+}
+
 void ddsi_xpack_send (struct ddsi_xpack *xp, bool immediately)
 {
   if (!xp->async_mode)
-    ddsi_xpack_send_real (xp);
+  {
+    if (!(xp->gv->xpack_shaping && ddsi_xpack_send_paced (xp)))
+      ddsi_xpack_send_real (xp);
+  }
   else
   {
     struct ddsi_domaingv * const gv = xp->gv;
-    // copy xp
-    struct ddsi_xpack *xp1 = ddsrt_malloc (sizeof (*xp));
-    memcpy(xp1, xp, sizeof(*xp1));
-    if (xp->msgfrags != NULL) {
-      xp1->msgfrags = ddsrt_malloc (sizeof (*xp->msgfrags) + xp->msgfrags->niov * sizeof (ddsrt_iovec_t));
-      xp1->msgfrags->niov = xp->msgfrags->niov;
-      memcpy (xp1->msgfrags->iov, xp->msgfrags->iov, xp->msgfrags->niov * sizeof (*xp->msgfrags->iov));
-    }
-    ddsi_xpack_reinit (xp);
-    xp1->sendq_next = NULL;
+    struct ddsi_xpack *xp1 = ddsi_xpack_copy_and_reinit (xp);
     ddsrt_mutex_lock (&gv->sendq_lock);
     if (immediately || gv->sendq_length == 0)
       ddsrt_cond_broadcast (&gv->sendq_cond);
     if (gv->sendq_length >= SENDQ_MAX)
+    {
+      gv->sendq_blocked++;
       ddsrt_cond_wait (&gv->sendq_cond, &gv->sendq_lock);
-    if (gv->sendq_head)
-      gv->sendq_tail->sendq_next = xp1;
-    else
-      gv->sendq_head = xp1;
-    gv->sendq_tail = xp1;
-    gv->sendq_length++;
+    }
+    ddsi_xpack_sendq_insert_locked (gv, xp, xp1);
+    ddsrt_mutex_unlock (&gv->sendq_lock);
+  }
+}
+
+void ddsi_xpack_sendq_stats (struct ddsi_domaingv *gv, uint32_t *length, uint64_t *packets, uint64_t *blocked)
+{
+  /* the send queue only gets created once the first asynchronous writer appears */
+  ddsrt_mutex_lock (&gv->sendq_running_lock);
+  if (!gv->sendq_running)
+    *length = 0, *packets = 0, *blocked = 0;
+  else
+  {
+    ddsrt_mutex_lock (&gv->sendq_lock);
+    *length = gv->sendq_length;
+    *packets = gv->sendq_packets;
+    *blocked = gv->sendq_blocked;
     ddsrt_mutex_unlock (&gv->sendq_lock);
   }
+  ddsrt_mutex_unlock (&gv->sendq_running_lock);
 }
 
 static void copy_addressing_info (struct ddsi_xpack *xp, const struct ddsi_xmsg *m)
@@ -1643,3 +1911,8 @@ unsigned ddsi_xpack_packetid (const struct ddsi_xpack *xp)
 {
   return xp->packetid;
 }
+
+int32_t ddsi_xpack_priority (const struct ddsi_xpack *xp)
+{
+  return xp->priority;
+}
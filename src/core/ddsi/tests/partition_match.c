@@ -0,0 +1,136 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <string.h>
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsi/ddsi_xqos.h"
+#include "ddsi__misc.h"
+#include "ddsi__partition_match.h"
+#include "CUnit/Test.h"
+
+static void set_partitions (dds_qos_t *qos, uint32_t n, const char **strs)
+{
+  memset (qos, 0, sizeof (*qos));
+  if (n == UINT32_MAX)
+    return;
+  qos->present = DDSI_QP_PARTITION;
+  qos->partition.n = n;
+  qos->partition.strs = (char **) strs;
+}
+
+/* Straightforward comparison of all pairs, the way it was done before the cache */
+static bool is_wildcard (const char *str)
+{
+  return strchr (str, '*') || strchr (str, '?');
+}
+
+static bool ref_patmatch (const char *pat, const char *name)
+{
+  if (!is_wildcard (pat))
+    return strcmp (pat, name) == 0;
+  else if (is_wildcard (name))
+    return false;
+  else
+    return ddsi_patmatch (pat, name);
+}
+
+static bool ref_match_default (const dds_qos_t *x)
+{
+  if (!(x->present & DDSI_QP_PARTITION) || x->partition.n == 0)
+    return true;
+  for (uint32_t i = 0; i < x->partition.n; i++)
+    if (ref_patmatch (x->partition.strs[i], ""))
+      return true;
+  return false;
+}
+
+static bool ref_match (const dds_qos_t *a, const dds_qos_t *b)
+{
+  if (!(a->present & DDSI_QP_PARTITION) || a->partition.n == 0)
+    return ref_match_default (b);
+  else if (!(b->present & DDSI_QP_PARTITION) || b->partition.n == 0)
+    return ref_match_default (a);
+  for (uint32_t i = 0; i < a->partition.n; i++)
+    for (uint32_t j = 0; j < b->partition.n; j++)
+      if (ref_patmatch (a->partition.strs[i], b->partition.strs[j]) || ref_patmatch (b->partition.strs[j], a->partition.strs[i]))
+        return true;
+  return false;
+}
+
+CU_Test (ddsi_partition_match, basic)
+{
+  static const struct {
+    const char *a[3]; uint32_t na;
+    const char *b[3]; uint32_t nb;
+    bool match;
+  } tests[] = {
+    { { NULL }, UINT32_MAX, { NULL }, UINT32_MAX, true },
+    { { NULL }, 0, { "" }, 1, true },
+    { { NULL }, 0, { "a" }, 1, false },
+    { { NULL }, UINT32_MAX, { "*" }, 1, true },
+    { { NULL }, 0, { "?" }, 1, false },
+    { { "a", "b" }, 2, { "c", "b" }, 2, true },
+    { { "a", "b" }, 2, { "c", "d" }, 2, false },
+    { { "ab*" }, 1, { "abc" }, 1, true },
+    { { "ab*" }, 1, { "ab" }, 1, true },
+    { { "ab*" }, 1, { "a" }, 1, false },
+    { { "a?c" }, 1, { "abc" }, 1, true },
+    { { "a*c" }, 1, { "abd" }, 1, false },
+    { { "a*" }, 1, { "a*" }, 1, false },
+    { { "*" }, 1, { "a*" }, 1, false },
+    { { "x", "a*" }, 2, { "y", "a*" }, 2, false },
+    { { "x", "*" }, 2, { "y" }, 1, true }
+  };
+  struct ddsi_partition_cache *pc = ddsi_partition_cache_new ();
+  for (size_t i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+  {
+    dds_qos_t a, b;
+    set_partitions (&a, tests[i].na, (const char **) tests[i].a);
+    set_partitions (&b, tests[i].nb, (const char **) tests[i].b);
+    // twice, so that the second time it comes from the cache
+    for (int k = 0; k < 2; k++)
+    {
+      CU_ASSERT_EQUAL (ddsi_partition_cache_match (pc, &a, &b), tests[i].match);
+      CU_ASSERT_EQUAL (ddsi_partition_cache_match (pc, &b, &a), tests[i].match);
+      CU_ASSERT_EQUAL (ref_match (&a, &b), tests[i].match);
+    }
+  }
+  ddsi_partition_cache_free (pc);
+}
+
+CU_Test (ddsi_partition_match, random)
+{
+  // small alphabet and short names, so that there are plenty of matches and non-matches,
+  // and enough distinct sets to overflow the cache a few times
+  static const char *names[] = {
+    "", "a", "b", "ab", "ba", "abc", "bca", "*", "a*", "b*", "ab*", "*a", "?", "a?", "?b", "a*c", "*b*", "a**", "??"
+  };
+  const uint32_t nnames = (uint32_t) (sizeof (names) / sizeof (names[0]));
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 0x5eed);
+  struct ddsi_partition_cache *pc = ddsi_partition_cache_new ();
+  const char *as[4], *bs[4];
+  int ok = 0;
+  for (int i = 0; i < 50000; i++)
+  {
+    dds_qos_t a, b;
+    const uint32_t na = ddsrt_prng_random (&prng) % 5, nb = ddsrt_prng_random (&prng) % 5;
+    for (uint32_t j = 0; j < na; j++)
+      as[j] = names[ddsrt_prng_random (&prng) % nnames];
+    for (uint32_t j = 0; j < nb; j++)
+      bs[j] = names[ddsrt_prng_random (&prng) % nnames];
+    set_partitions (&a, na, as);
+    set_partitions (&b, nb, bs);
+    ok += (ddsi_partition_cache_match (pc, &a, &b) == ref_match (&a, &b));
+  }
+  CU_ASSERT_EQUAL (ok, 50000);
+  ddsi_partition_cache_free (pc);
+}
@@ -81,10 +81,11 @@ static void check_reorder (struct ddsi_reorder *reorder, uint64_t ndiscard, ddsi
 {
   // expect to be waiting for the right sequence number
   CU_ASSERT_FATAL (ddsi_reorder_next_seq (reorder) == next_exp);
-  // expect the number of discarded bytes to match
-  uint64_t discarded_bytes;
-  ddsi_reorder_stats (reorder, &discarded_bytes);
+  // expect the number of discarded bytes to match, and samples to be discarded iff bytes are
+  uint64_t discarded_bytes, discarded_samples;
+  ddsi_reorder_stats (reorder, &discarded_bytes, &discarded_samples);
   CU_ASSERT_FATAL (discarded_bytes == ndiscard);
+  CU_ASSERT_FATAL ((discarded_samples == 0) == (ndiscard == 0));
   // expect the set of present sequence numbers to match
   int i = 0, err = 0;
   printf ("check:");
@@ -160,3 +161,160 @@ CU_Test (ddsi_radmin, drop_gap_at_end, .init = setup, .fini = teardown)
   ddsi_reorder_free (reorder);
   ddsi_defrag_free (defrag);
 }
+
+static void insert_fragment (struct ddsi_defrag *defrag, struct ddsi_rmsg *rmsg, struct ddsi_receiver_state *rst, ddsi_seqno_t seq, uint32_t size, uint32_t min, uint32_t maxp1)
+{
+  struct ddsi_rsample_info *si = ddsi_rmsg_alloc (rmsg, sizeof (*si));
+  CU_ASSERT_FATAL (si != NULL);
+  assert (si);
+  memset (si, 0, sizeof (*si));
+  si->rst = rst;
+  si->size = size;
+  si->fragsize = 8;
+  si->seq = seq;
+  // payload of the rmsg is the sample itself, so the payload offset equals the fragment offset
+  struct ddsi_rdata *rdata = ddsi_rdata_new (rmsg, min, maxp1, 0, min, 0);
+  struct ddsi_rsample *rsample = ddsi_defrag_rsample (defrag, rdata, si);
+  CU_ASSERT_FATAL (rsample == NULL);
+}
+
+CU_Test (ddsi_radmin, fec_recover, .init = setup, .fini = teardown)
+{
+  // 30 byte sample in slots of 8 bytes: [0,8) [8,16) [16,24) [24,30)
+  const uint32_t size = 30, slotsize = 8;
+  struct ddsi_defrag *defrag = ddsi_defrag_new (&gv.logconfig, DDSI_DEFRAG_DROP_OLDEST, 4);
+  struct ddsi_rmsg *rmsg = ddsi_rmsg_new (rbpool);
+  unsigned char *data = (unsigned char *) DDSI_RMSG_PAYLOAD (rmsg);
+  for (uint32_t i = 0; i < size; i++)
+    data[i] = (unsigned char) (7 * i + 3);
+  ddsi_rmsg_setsize (rmsg, 32);
+  struct ddsi_receiver_state *rst = ddsi_rmsg_alloc (rmsg, sizeof (*rst));
+  memset (rst, 0, sizeof (*rst));
+
+  unsigned char parity[8], expected[8];
+  memset (parity, 0, sizeof (parity));
+  for (uint32_t i = 0; i < size; i++)
+    parity[i % slotsize] ^= data[i];
+  memcpy (expected, data + 16, sizeof (expected));
+
+  uint32_t smin, smaxp1;
+  // nothing known about the sample: nothing to recover
+  CU_ASSERT_FATAL (!ddsi_defrag_fec_recover (defrag, 1, size, 0, size, slotsize, parity, &smin, &smaxp1));
+  insert_fragment (defrag, rmsg, rst, 1, size, 0, 8);
+  insert_fragment (defrag, rmsg, rst, 1, size, 24, 30);
+  // two slots missing: can't recover with a single parity
+  CU_ASSERT_FATAL (!ddsi_defrag_fec_recover (defrag, 1, size, 0, size, slotsize, parity, &smin, &smaxp1));
+  // partial overlap of the one remaining missing slot with a received fragment is fine
+  insert_fragment (defrag, rmsg, rst, 1, size, 8, 18);
+  CU_ASSERT_FATAL (ddsi_defrag_fec_recover (defrag, 1, size, 0, size, slotsize, parity, &smin, &smaxp1));
+  CU_ASSERT_FATAL (smin == 16 && smaxp1 == 24);
+  CU_ASSERT_FATAL (memcmp (parity, expected, sizeof (expected)) == 0);
+
+  ddsi_rmsg_commit (rmsg);
+  ddsi_defrag_free (defrag);
+}
+
+static ddsi_reorder_result_t make_dqueue_chain (struct ddsi_rsample_chain *sc, struct ddsi_defrag *defrag, struct ddsi_reorder *reorder, struct ddsi_rmsg *rmsg)
+{
+  // sample 2 gets stored in the reorder buffer, the gap for 1 then releases it
+  struct ddsi_receiver_state *rst = ddsi_rmsg_alloc (rmsg, sizeof (*rst));
+  memset (rst, 0, sizeof (*rst));
+  insert_sample (defrag, reorder, rmsg, rst, 2);
+  struct ddsi_rdata *gap = ddsi_rdata_newgap (rmsg);
+  int refc_adjust = 0;
+  ddsi_reorder_result_t res = ddsi_reorder_gap (sc, reorder, gap, 1, 2, &refc_adjust);
+  CU_ASSERT_FATAL (res == 1);
+  ddsi_fragchain_adjust_refcount (gap, refc_adjust);
+  return res;
+}
+
+struct dqueue_cb_arg {
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  int called;
+  struct ddsi_thread_state *thrst;
+};
+
+static void dqueue_cb (void *varg)
+{
+  struct dqueue_cb_arg * const arg = varg;
+  ddsrt_mutex_lock (&arg->lock);
+  arg->called++;
+  arg->thrst = ddsi_lookup_thread_state ();
+  ddsrt_cond_broadcast (&arg->cond);
+  ddsrt_mutex_unlock (&arg->lock);
+}
+
+static int dqueue_handler (const struct ddsi_rsample_info *sampleinfo, const struct ddsi_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg)
+{
+  // counts the delivered samples, the callback bubble orders it before the callback
+  (void) sampleinfo; (void) fragchain; (void) rdguid;
+  if (qarg)
+    (*(int *) qarg)++;
+  return 0;
+}
+
+CU_Test (ddsi_radmin, dqueue_start_on_demand, .init = setup, .fini = teardown)
+{
+  struct dqueue_cb_arg arg = { .called = 0, .thrst = NULL };
+  ddsrt_mutex_init (&arg.lock);
+  ddsrt_cond_init (&arg.cond);
+  int ndelivered = 0;
+  struct ddsi_dqueue *q = ddsi_dqueue_new ("lazy", &gv, 10, dqueue_handler, &ndelivered);
+  ddsi_dqueue_start_on_demand (q);
+
+  // nothing was ever enqueued, so the callback is invoked directly
+  ddsi_dqueue_enqueue_callback (q, dqueue_cb, &arg);
+  CU_ASSERT_FATAL (arg.called == 1);
+  CU_ASSERT_FATAL (arg.thrst == thrst);
+
+  // once started, the thread also handles the callbacks
+  CU_ASSERT_FATAL (ddsi_dqueue_ensure_started (q));
+  struct ddsi_defrag *defrag = ddsi_defrag_new (&gv.logconfig, DDSI_DEFRAG_DROP_LATEST, 1);
+  struct ddsi_reorder *reorder = ddsi_reorder_new (&gv.logconfig, DDSI_REORDER_MODE_NORMAL, 3, false);
+  struct ddsi_rmsg *rmsg = ddsi_rmsg_new (rbpool);
+  ddsi_rmsg_setsize (rmsg, 0);
+  struct ddsi_rsample_chain sc;
+  const ddsi_reorder_result_t res = make_dqueue_chain (&sc, defrag, reorder, rmsg);
+  ddsi_dqueue_enqueue (q, &sc, res);
+  ddsi_rmsg_commit (rmsg);
+
+  ddsi_dqueue_enqueue_callback (q, dqueue_cb, &arg);
+  ddsrt_mutex_lock (&arg.lock);
+  while (arg.called < 2)
+    ddsrt_cond_wait (&arg.cond, &arg.lock);
+  ddsrt_mutex_unlock (&arg.lock);
+  CU_ASSERT_FATAL (arg.thrst != thrst);
+  CU_ASSERT_FATAL (strcmp (arg.thrst->name, "dq.lazy") == 0);
+  CU_ASSERT_FATAL (ndelivered == 1);
+
+  uint32_t length;
+  uint64_t delivered, wait_time, max_wait_time, full_waits;
+  ddsi_dqueue_stats (q, &length, &delivered, &wait_time, &max_wait_time, &full_waits);
+  CU_ASSERT_FATAL (length == 0);
+
+  ddsi_dqueue_free (q);
+  ddsi_reorder_free (reorder);
+  ddsi_defrag_free (defrag);
+  ddsrt_cond_destroy (&arg.cond);
+  ddsrt_mutex_destroy (&arg.lock);
+}
+
+CU_Test (ddsi_radmin, dqueue_never_started, .init = setup, .fini = teardown)
+{
+  // a queue that is never started must still be freed cleanly, including the
+  // samples that were enqueued
+  struct ddsi_dqueue *q = ddsi_dqueue_new ("never", &gv, 10, dqueue_handler, NULL);
+  struct ddsi_defrag *defrag = ddsi_defrag_new (&gv.logconfig, DDSI_DEFRAG_DROP_LATEST, 1);
+  struct ddsi_reorder *reorder = ddsi_reorder_new (&gv.logconfig, DDSI_REORDER_MODE_NORMAL, 3, false);
+  struct ddsi_rmsg *rmsg = ddsi_rmsg_new (rbpool);
+  ddsi_rmsg_setsize (rmsg, 0);
+  struct ddsi_rsample_chain sc;
+  const ddsi_reorder_result_t res = make_dqueue_chain (&sc, defrag, reorder, rmsg);
+  ddsi_dqueue_enqueue (q, &sc, res);
+  ddsi_rmsg_commit (rmsg);
+  CU_ASSERT_FATAL (ddsi_dqueue_is_full (q) == 0);
+  ddsi_dqueue_free (q);
+  ddsi_reorder_free (reorder);
+  ddsi_defrag_free (defrag);
+}
@@ -0,0 +1,107 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_xmsg.h"
+#include "ddsi__xmsg.h"
+#include "CUnit/Test.h"
+
+static struct ddsi_domaingv gv;
+
+CU_Test (ddsi_sendq, priority_order)
+{
+  // packets are queued without a send thread, so they stay in the queue and the order
+  // in which the send thread would pick them up can be checked by dequeueing them
+  static const int32_t prios[] = { 0, 0, 5, 0, 5, 10, -1, 0, 10 };
+  const size_t n = sizeof (prios) / sizeof (prios[0]);
+  unsigned packetid[sizeof (prios) / sizeof (prios[0])];
+  ddsi_xpack_sendq_init (&gv);
+  struct ddsi_xpack *xp = ddsi_xpack_new (&gv, true);
+  for (size_t i = 0; i < n; i++)
+  {
+    // packet id increments with each send, so it identifies the queued copies
+    packetid[i] = ddsi_xpack_packetid (xp);
+    ddsi_xpack_set_priority (xp, prios[i]);
+    ddsi_xpack_send (xp, false);
+  }
+  ddsi_xpack_free (xp);
+
+  static const size_t expected[] = { 5, 8, 2, 4, 0, 1, 3, 7, 6 };
+  ddsrt_mutex_lock (&gv.sendq_lock);
+  for (size_t i = 0; i < n; i++)
+  {
+    struct ddsi_xpack *xq = ddsi_xpack_sendq_dequeue_locked (&gv);
+    CU_ASSERT_FATAL (xq != NULL);
+    CU_ASSERT_EQUAL (ddsi_xpack_priority (xq), prios[expected[i]]);
+    CU_ASSERT_EQUAL (ddsi_xpack_packetid (xq), packetid[expected[i]]);
+    ddsi_xpack_free (xq);
+  }
+  CU_ASSERT (ddsi_xpack_sendq_dequeue_locked (&gv) == NULL);
+  CU_ASSERT_EQUAL (gv.sendq_length, 0);
+  ddsrt_mutex_unlock (&gv.sendq_lock);
+  CU_ASSERT_EQUAL (gv.sendq_packets, n);
+  ddsrt_cond_destroy (&gv.sendq_cond);
+  ddsrt_mutex_destroy (&gv.sendq_lock);
+}
+
+CU_Test (ddsi_sendq, interleave)
+{
+  // packets of one xpack queued in one go (like the fragments of a large sample) are
+  // interleaved with those queued later from other xpacks at the same priority
+  enum { NA = 5, NB = 2 };
+  unsigned packetid_a[NA], packetid_b[NB];
+  ddsi_xpack_sendq_init (&gv);
+  struct ddsi_xpack *xpa = ddsi_xpack_new (&gv, true);
+  struct ddsi_xpack *xpb = ddsi_xpack_new (&gv, true);
+  for (int i = 0; i < NA; i++)
+  {
+    packetid_a[i] = ddsi_xpack_packetid (xpa);
+    ddsi_xpack_send (xpa, false);
+  }
+  for (int i = 0; i < NB; i++)
+  {
+    packetid_b[i] = ddsi_xpack_packetid (xpb);
+    ddsi_xpack_send (xpb, false);
+  }
+
+  // all packets have the same size, so they alternate while both have packets queued
+  const unsigned expected[] = { packetid_a[0], packetid_b[0], packetid_a[1], packetid_b[1], packetid_a[2], packetid_a[3], packetid_a[4] };
+  ddsrt_mutex_lock (&gv.sendq_lock);
+  for (size_t i = 0; i < sizeof (expected) / sizeof (expected[0]); i++)
+  {
+    struct ddsi_xpack *xq = ddsi_xpack_sendq_dequeue_locked (&gv);
+    CU_ASSERT_FATAL (xq != NULL);
+    CU_ASSERT_EQUAL (ddsi_xpack_packetid (xq), expected[i]);
+    ddsi_xpack_free (xq);
+  }
+  CU_ASSERT (ddsi_xpack_sendq_dequeue_locked (&gv) == NULL);
+  ddsrt_mutex_unlock (&gv.sendq_lock);
+
+  // an xpack gets no credit for having been idle: "b" starts from the packet sent last,
+  // just like "a", and so doesn't get to send its packet before those of "a"
+  const unsigned expected2[] = { ddsi_xpack_packetid (xpa), ddsi_xpack_packetid (xpb), ddsi_xpack_packetid (xpa) + 1 };
+  ddsi_xpack_send (xpa, false);
+  ddsi_xpack_send (xpa, false);
+  ddsi_xpack_send (xpb, false);
+  ddsrt_mutex_lock (&gv.sendq_lock);
+  for (size_t i = 0; i < sizeof (expected2) / sizeof (expected2[0]); i++)
+  {
+    struct ddsi_xpack *xq = ddsi_xpack_sendq_dequeue_locked (&gv);
+    CU_ASSERT_FATAL (xq != NULL);
+    CU_ASSERT_EQUAL (ddsi_xpack_packetid (xq), expected2[i]);
+    ddsi_xpack_free (xq);
+  }
+  ddsrt_mutex_unlock (&gv.sendq_lock);
+  ddsi_xpack_free (xpa);
+  ddsi_xpack_free (xpb);
+  ddsrt_cond_destroy (&gv.sendq_cond);
+  ddsrt_mutex_destroy (&gv.sendq_lock);
+}
@@ -0,0 +1,58 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include "dds/ddsrt/time.h"
+#include "ddsi__tokenbucket.h"
+#include "CUnit/Test.h"
+
+CU_Test (ddsi_tokenbucket, burst_then_pace)
+{
+  const ddsrt_mtime_t t0 = { DDS_SECS (1) };
+  struct ddsi_tokenbucket *tb = ddsi_tokenbucket_new (1000, 1500, t0);
+
+  // a full bucket allows sending 1500 bytes immediately, but the next byte
+  // must wait for the debt to be paid off: 1ms per byte
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_charge (tb, t0, 1000), 0);
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_charge (tb, t0, 1000), 0);
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_delay (tb, t0), DDS_MSECS (500));
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_charge (tb, t0, 100), DDS_MSECS (500));
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_delay (tb, t0), DDS_MSECS (600));
+
+  // time passing refills the bucket
+  const ddsrt_mtime_t t1 = ddsrt_mtime_add_duration (t0, DDS_MSECS (600));
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_delay (tb, t1), 0);
+
+  // but never beyond its depth
+  const ddsrt_mtime_t t2 = ddsrt_mtime_add_duration (t1, DDS_SECS (3600));
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_charge (tb, t2, 1500), 0);
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_charge (tb, t2, 1), 0);
+  CU_ASSERT_EQUAL (ddsi_tokenbucket_delay (tb, t2), DDS_MSECS (1));
+  ddsi_tokenbucket_free (tb);
+}
+
+CU_Test (ddsi_tokenbucket, long_term_rate)
+{
+  // many small increments in time must not lose tokens to rounding
+  const uint32_t rate = 3000;
+  ddsrt_mtime_t t = { 0 };
+  struct ddsi_tokenbucket *tb = ddsi_tokenbucket_new (rate, 0, t);
+  uint64_t sent = 0;
+  while (t.v < DDS_SECS (10))
+  {
+    if (ddsi_tokenbucket_delay (tb, t) == 0)
+    {
+      (void) ddsi_tokenbucket_charge (tb, t, 100);
+      sent += 100;
+    }
+    t.v += DDS_USECS (77);
+  }
+  CU_ASSERT (sent >= 10 * rate && sent <= 10 * rate + 100);
+  ddsi_tokenbucket_free (tb);
+}
@@ -165,6 +165,7 @@ int main (int argc, char **argv)
   dds_create_participant_guid (1, ptr, ptr2, 0, ptr3);
   dds_create_domain (0, ptr);
   dds_create_domain_with_rawconfig (0, ptr);
+  dds_create_domain_with_compiled_config (0, ptr, 0, ptr2);
   dds_get_parent (1);
   dds_get_participant (1);
   dds_get_children (1, ptr, 0);
@@ -399,6 +400,7 @@ int main (int argc, char **argv)
   dds_qset_type_consistency (ptr, 0, 0, 0, 0, 0, 0);
   dds_qset_data_representation (ptr, 0, ptr2);
   dds_qset_entity_name (ptr, ptr2);
+  dds_qset_content_filter (ptr, ptr2);
   dds_qset_psmx_instances (ptr, 0, ptr2);
   dds_qget_userdata (ptr, ptr2, ptr);
   dds_qget_topicdata (ptr, ptr2, ptr);
@@ -430,6 +432,7 @@ int main (int argc, char **argv)
   dds_qget_type_consistency (ptr, 0, ptr, ptr, ptr, ptr, ptr);
   dds_qget_data_representation (ptr, ptr, ptr);
   dds_qget_entity_name (ptr, ptr);
+  dds_qget_content_filter (ptr, ptr);
   dds_qget_psmx_instances (ptr, ptr2, ptr3);
 
   // dds_public_status.h
@@ -519,6 +522,7 @@ int main (int argc, char **argv)
   dds_stream_read_sample (ptr, ptr2, ptr3, ptr4);
   dds_stream_free_sample (ptr, ptr2, ptr3);
   dds_stream_countops (ptr, 0, ptr2);
+  dds_stream_member_op (ptr, 0);
   dds_stream_print_key (ptr, ptr2, ptr3, 0);
   dds_stream_print_sample (ptr, ptr2, ptr3, 0);
 
@@ -647,6 +651,7 @@ int main (int argc, char **argv)
 #ifdef DDS_HAS_QOS_PROVIDER
   dds_create_qos_provider(ptr,ptr);
   dds_create_qos_provider_scope(ptr,ptr,ptr);
+  dds_create_qos_provider_indexed(ptr,ptr,ptr);
   dds_qos_provider_get_qos(ptr,0,ptr,ptr);
   dds_delete_qos_provider(ptr);
 #endif
@@ -743,6 +748,9 @@ int main (int argc, char **argv)
 
   // ddsi_config.h
   ddsi_config_init_default (ptr);
+  ddsi_config_compile (ptr, 0);
+  ddsi_config_compiled_free (ptr);
+  ddsi_config_compiled_get (ptr);
 
   // ddsi_config_impl.h
   ddsi_config_fini (ptr);
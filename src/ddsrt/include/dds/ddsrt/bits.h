@@ -52,6 +52,34 @@ DDS_INLINE_EXPORT inline uint32_t ddsrt_ffs32u (uint32_t x)
 #endif
 }
 
+/** \brief Find last set: returns index of most significant bit set in input
+
+    @param[in] x input, may be 0
+    @return position of most significant bit set in x (LSB is 1, MSB is 64), returns 0 if x == 0
+ */
+DDS_INLINE_EXPORT inline uint32_t ddsrt_fls64u (uint64_t x)
+{
+  if (x == 0)
+    return 0;
+#if defined __clang__ || (defined __GNUC__ && (__GNUC__ > 3 || __GNUC__ == 3 && __GNUC_MINOR__ >= 4))
+  DDSRT_STATIC_ASSERT (sizeof (unsigned long long) == sizeof (uint64_t));
+  return 64 - (uint32_t) __builtin_clzll ((unsigned long long) x);
+#elif defined _MSC_VER && _MSC_VER >= 1400 && (defined _M_X64 || defined _M_ARM64)
+  unsigned long index;
+  (void) _BitScanReverse64 (&index, x);
+  return (uint32_t) index + 1;
+#else
+  uint32_t n = 64;
+  if ((x & UINT64_C (0xFFFFFFFF00000000)) == 0) { n -= 32; x <<= 32; };
+  if ((x & UINT64_C (0xFFFF000000000000)) == 0) { n -= 16; x <<= 16; };
+  if ((x & UINT64_C (0xFF00000000000000)) == 0) { n -=  8; x <<=  8; };
+  if ((x & UINT64_C (0xF000000000000000)) == 0) { n -=  4; x <<=  4; };
+  if ((x & UINT64_C (0xC000000000000000)) == 0) { n -=  2; x <<=  2; };
+  if ((x & UINT64_C (0x8000000000000000)) == 0) { n -=  1; };
+  return n;
+#endif
+}
+
 #if defined (__cplusplus)
 }
 #endif
@@ -0,0 +1,162 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef DDSRT_HDRHIST_H
+#define DDSRT_HDRHIST_H
+
+/**
+ * @file hdrhist.h
+ *
+ * Log-linear ("HDR") histogram of 64-bit unsigned values.
+ *
+ * Values below 2^S, with S the number of sub-bucket bits, are counted exactly; above
+ * that every power-of-two range is split into 2^S equal-sized buckets, so the relative
+ * error of any value read back from the histogram is at most 2^-S.  Values of 2^V or
+ * more, with V the number of value bits, are counted in the last bucket.  The exact
+ * minimum, maximum and sum of all recorded values are tracked as well.
+ *
+ * Recording uses atomic operations only and may be done concurrently from any number
+ * of threads.  Histograms with the same parameters can be merged, and the contents of
+ * one can be moved into another while recording continues, which allows reporting
+ * per-interval statistics without losing or double-counting any values.
+ */
+
+#include <stdint.h>
+#include "dds/export.h"
+#include "dds/ddsrt/attributes.h"
+#include "dds/ddsrt/retcode.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** @brief The histogram, opaque type */
+struct ddsrt_hdrhist;
+
+/**
+ * @brief Create a new, empty histogram
+ *
+ * @param[in] sub_bucket_bits  number of bits of precision, must be in [1,16]
+ * @param[in] value_bits       number of bits in the largest value that gets its own
+ *                             bucket, must be in [sub_bucket_bits+1,64]
+ * @returns the new histogram, or NULL if the parameters are invalid
+ */
+DDS_EXPORT struct ddsrt_hdrhist *ddsrt_hdrhist_new (uint32_t sub_bucket_bits, uint32_t value_bits)
+  ddsrt_attribute_warn_unused_result;
+
+/**
+ * @brief Free a histogram
+ *
+ * @param[in] h  histogram to free, may be NULL
+ */
+DDS_EXPORT void ddsrt_hdrhist_free (struct ddsrt_hdrhist *h);
+
+/**
+ * @brief Reset a histogram to empty
+ *
+ * Not atomic with respect to concurrent calls to @ref ddsrt_hdrhist_record.
+ *
+ * @param[in,out] h  histogram to reset
+ */
+DDS_EXPORT void ddsrt_hdrhist_reset (struct ddsrt_hdrhist *h)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Record a value, safe to call concurrently
+ *
+ * @param[in,out] h  histogram to record the value in
+ * @param[in] value  value to record
+ */
+DDS_EXPORT void ddsrt_hdrhist_record (struct ddsrt_hdrhist *h, uint64_t value)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Add the contents of one histogram to another
+ *
+ * @param[in,out] dst  histogram to add to
+ * @param[in] src      histogram to add
+ * @returns a DDS return code
+ * @retval DDS_RETCODE_OK             success
+ * @retval DDS_RETCODE_BAD_PARAMETER  histograms have different parameters
+ */
+DDS_EXPORT dds_return_t ddsrt_hdrhist_merge (struct ddsrt_hdrhist *dst, const struct ddsrt_hdrhist *src)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Move the contents of one histogram to another
+ *
+ * Adds the contents of `src` to `dst` and removes them from `src`, taking each
+ * bucket atomically so that values concurrently recorded in `src` end up in
+ * exactly one of the two.
+ *
+ * @param[in,out] dst  histogram to add to
+ * @param[in,out] src  histogram to take the values from
+ * @returns a DDS return code
+ * @retval DDS_RETCODE_OK             success
+ * @retval DDS_RETCODE_BAD_PARAMETER  histograms have different parameters
+ */
+DDS_EXPORT dds_return_t ddsrt_hdrhist_drain (struct ddsrt_hdrhist *dst, struct ddsrt_hdrhist *src)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Number of values recorded
+ *
+ * @param[in] h  histogram
+ * @returns the number of values
+ */
+DDS_EXPORT uint64_t ddsrt_hdrhist_count (const struct ddsrt_hdrhist *h)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Smallest value recorded
+ *
+ * @param[in] h  histogram
+ * @returns the smallest value, or UINT64_MAX if the histogram is empty
+ */
+DDS_EXPORT uint64_t ddsrt_hdrhist_min (const struct ddsrt_hdrhist *h)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Largest value recorded
+ *
+ * @param[in] h  histogram
+ * @returns the largest value, or 0 if the histogram is empty
+ */
+DDS_EXPORT uint64_t ddsrt_hdrhist_max (const struct ddsrt_hdrhist *h)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Mean of the values recorded
+ *
+ * @param[in] h  histogram
+ * @returns the mean value, or 0 if the histogram is empty
+ */
+DDS_EXPORT double ddsrt_hdrhist_mean (const struct ddsrt_hdrhist *h)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Value at a percentile
+ *
+ * The returned value is the highest value that is equivalent to the values in the
+ * bucket containing the requested percentile, limited to the range between the
+ * smallest and the largest recorded value.
+ *
+ * @param[in] h    histogram
+ * @param[in] pct  percentile, in [0,100]
+ * @returns the value at the percentile, or 0 if the histogram is empty
+ */
+DDS_EXPORT uint64_t ddsrt_hdrhist_percentile (const struct ddsrt_hdrhist *h, double pct)
+  ddsrt_nonnull_all;
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSRT_HDRHIST_H */
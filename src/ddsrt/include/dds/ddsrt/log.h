@@ -25,6 +25,7 @@
 
 #include "dds/export.h"
 #include "dds/ddsrt/attributes.h"
+#include "dds/ddsrt/retcode.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -261,6 +262,45 @@ dds_log_cfg_init(
     FILE *log_fp,
     FILE *trace_fp);
 
+/**
+ * @brief Start writing to files asynchronously
+ *
+ * Messages for the default sinks are no longer written to the file by the
+ * thread producing them, but appended to a shared buffer that a background
+ * thread writes out.  Messages are still formatted by the producing thread,
+ * and the order in which they appear in the files is unchanged.  Messages
+ * for callback sinks are not affected.
+ *
+ * Calls are reference counted, every successful call must be matched with a
+ * call to #dds_log_async_stop.
+ *
+ * @returns a DDS return code
+ */
+dds_return_t
+dds_log_async_start(void);
+
+/**
+ * @brief Stop writing to files asynchronously
+ *
+ * Waits until all buffered messages have been written and flushed, so that
+ * on return files that are no longer set as log or trace file may be closed.
+ * The background thread is stopped when the last reference is dropped.
+ */
+void
+dds_log_async_stop(void);
+
+/**
+ * @brief Wait until all buffered messages have been written and flushed
+ *
+ * Asynchronous writing is process-wide, so messages for a file may still be
+ * buffered even if the domain that wrote them did not request asynchronous
+ * writing, or if another domain keeps it active.  A file that has been used
+ * as a log or trace file must therefore not be closed before calling this.
+ * It is a no-op when asynchronous writing is not active.
+ */
+void
+dds_log_async_flush(void);
+
 /**
  * @brief Write a log or trace message for a specific logging configuraiton
  * (categories, id, sinks).
@@ -0,0 +1,46 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef DDSRT_PROBES_H
+#define DDSRT_PROBES_H
+
+/**
+ * @file probes.h
+ *
+ * Static tracepoints ("USDT probes") in the "cyclonedds" provider.
+ *
+ * When built with ENABLE_USDT and sys/sdt.h is available, each probe compiles to a
+ * single nop instruction plus an ELF note describing its location and the locations
+ * of its arguments.  Tools such as bpftrace, perf and systemtap use that note to
+ * attach to the probe at run-time, so the cost while nothing is attached is that of
+ * the nop and of keeping the arguments in registers.  Without it, the probes expand
+ * to nothing and the arguments are not evaluated.
+ *
+ * Arguments should be integers or pointers and should be cheap to compute, because
+ * they are evaluated even if no tool is attached.
+ */
+
+#include "dds/config.h"
+
+#ifdef DDSRT_HAVE_USDT
+#include <sys/sdt.h>
+
+#define DDSRT_PROBE1(name, a1) DTRACE_PROBE1 (cyclonedds, name, a1)
+#define DDSRT_PROBE2(name, a1, a2) DTRACE_PROBE2 (cyclonedds, name, a1, a2)
+#define DDSRT_PROBE3(name, a1, a2, a3) DTRACE_PROBE3 (cyclonedds, name, a1, a2, a3)
+#define DDSRT_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4 (cyclonedds, name, a1, a2, a3, a4)
+#else
+#define DDSRT_PROBE1(name, a1) ((void) 0)
+#define DDSRT_PROBE2(name, a1, a2) ((void) 0)
+#define DDSRT_PROBE3(name, a1, a2, a3) ((void) 0)
+#define DDSRT_PROBE4(name, a1, a2, a3, a4) ((void) 0)
+#endif
+
+#endif /* DDSRT_PROBES_H */
@@ -246,6 +246,18 @@ DDS_EXPORT dds_return_t ddsrt_thread_list (ddsrt_thread_list_id_t * __restrict t
  *             Not supported on the platform
  */
 DDS_EXPORT dds_return_t ddsrt_thread_getname_anythread (ddsrt_thread_list_id_t tid, char *__restrict name, size_t size);
+
+/**
+ * @brief Get the identifier of the calling thread as used by ddsrt_thread_list
+ *
+ * The identifier can be passed to @ref ddsrt_thread_getname_anythread and to
+ * @ref ddsrt_getrusage_anythread from any thread in the process for as long as the
+ * calling thread exists.  On Windows it is a new handle that remains open, just like
+ * those returned by @ref ddsrt_thread_list.
+ *
+ * @returns The thread identifier of the calling thread
+ */
+DDS_EXPORT ddsrt_thread_list_id_t ddsrt_thread_list_id_self (void);
 #endif
 
 /**
@@ -13,3 +13,4 @@
 #include "dds/ddsrt/static_assert.h"
 
 DDS_EXPORT extern inline uint32_t ddsrt_ffs32u (uint32_t x);
+DDS_EXPORT extern inline uint32_t ddsrt_fls64u (uint64_t x);
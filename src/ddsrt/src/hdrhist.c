@@ -0,0 +1,205 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "dds/ddsrt/hdrhist.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/bits.h"
+#include "dds/ddsrt/heap.h"
+
+struct ddsrt_hdrhist {
+  uint32_t sub_bucket_bits;
+  uint32_t value_bits;
+  uint32_t nbuckets;
+  ddsrt_atomic_uint64_t sum;
+  ddsrt_atomic_uint64_t min;
+  ddsrt_atomic_uint64_t max;
+  ddsrt_atomic_uint64_t buckets[];
+};
+
+/* Bucket index for a value: values < 2^S map to themselves, for larger values
+   with the most significant bit at position m (counting from 0), the "group"
+   is m-S+1 and the position within the group is given by the S bits following
+   the most significant one.  That makes the index simply the concatenation of
+   the group and those S bits. */
+static uint32_t bucket_index (const struct ddsrt_hdrhist *h, uint64_t v)
+{
+  const uint32_t s = h->sub_bucket_bits;
+  if (v < ((uint64_t) 1 << s))
+    return (uint32_t) v;
+  else if (h->value_bits < 64 && (v >> h->value_bits) != 0)
+    return h->nbuckets - 1;
+  else
+  {
+    const uint32_t msb = ddsrt_fls64u (v) - 1;
+    const uint32_t group = msb - s + 1;
+    const uint32_t sub = (uint32_t) (v >> (msb - s)) & ((1u << s) - 1);
+    return (group << s) | sub;
+  }
+}
+
+static uint64_t bucket_highest_value (const struct ddsrt_hdrhist *h, uint32_t idx)
+{
+  const uint32_t s = h->sub_bucket_bits;
+  const uint32_t group = idx >> s;
+  const uint64_t sub = idx & ((1u << s) - 1);
+  if (group == 0)
+    return sub;
+  else if (idx == h->nbuckets - 1)
+    return UINT64_MAX;
+  else
+  {
+    const uint64_t lowest = (((uint64_t) 1 << s) + sub) << (group - 1);
+    return lowest + ((uint64_t) 1 << (group - 1)) - 1;
+  }
+}
+
+struct ddsrt_hdrhist *ddsrt_hdrhist_new (uint32_t sub_bucket_bits, uint32_t value_bits)
+{
+  if (sub_bucket_bits < 1 || sub_bucket_bits > 16 || value_bits <= sub_bucket_bits || value_bits > 64)
+    return NULL;
+  const uint32_t nbuckets = (value_bits - sub_bucket_bits + 1) << sub_bucket_bits;
+  struct ddsrt_hdrhist *h = ddsrt_malloc (offsetof (struct ddsrt_hdrhist, buckets) + nbuckets * sizeof (h->buckets[0]));
+  h->sub_bucket_bits = sub_bucket_bits;
+  h->value_bits = value_bits;
+  h->nbuckets = nbuckets;
+  ddsrt_hdrhist_reset (h);
+  return h;
+}
+
+void ddsrt_hdrhist_free (struct ddsrt_hdrhist *h)
+{
+  ddsrt_free (h);
+}
+
+void ddsrt_hdrhist_reset (struct ddsrt_hdrhist *h)
+{
+  ddsrt_atomic_st64 (&h->sum, 0);
+  ddsrt_atomic_st64 (&h->min, UINT64_MAX);
+  ddsrt_atomic_st64 (&h->max, 0);
+  for (uint32_t i = 0; i < h->nbuckets; i++)
+    ddsrt_atomic_st64 (&h->buckets[i], 0);
+}
+
+static void update_min (ddsrt_atomic_uint64_t *min, uint64_t v)
+{
+  uint64_t old;
+  while ((old = ddsrt_atomic_ld64 (min)) > v && !ddsrt_atomic_cas64 (min, old, v))
+    ;
+}
+
+static void update_max (ddsrt_atomic_uint64_t *max, uint64_t v)
+{
+  uint64_t old;
+  while ((old = ddsrt_atomic_ld64 (max)) < v && !ddsrt_atomic_cas64 (max, old, v))
+    ;
+}
+
+static uint64_t take (ddsrt_atomic_uint64_t *x, uint64_t empty)
+{
+  uint64_t old;
+  while ((old = ddsrt_atomic_ld64 (x)) != empty && !ddsrt_atomic_cas64 (x, old, empty))
+    ;
+  return old;
+}
+
+void ddsrt_hdrhist_record (struct ddsrt_hdrhist *h, uint64_t value)
+{
+  ddsrt_atomic_inc64 (&h->buckets[bucket_index (h, value)]);
+  ddsrt_atomic_add64 (&h->sum, value);
+  update_min (&h->min, value);
+  update_max (&h->max, value);
+}
+
+dds_return_t ddsrt_hdrhist_merge (struct ddsrt_hdrhist *dst, const struct ddsrt_hdrhist *src)
+{
+  if (dst->sub_bucket_bits != src->sub_bucket_bits || dst->value_bits != src->value_bits)
+    return DDS_RETCODE_BAD_PARAMETER;
+  for (uint32_t i = 0; i < src->nbuckets; i++)
+  {
+    const uint64_t n = ddsrt_atomic_ld64 (&src->buckets[i]);
+    if (n)
+      ddsrt_atomic_add64 (&dst->buckets[i], n);
+  }
+  ddsrt_atomic_add64 (&dst->sum, ddsrt_atomic_ld64 (&src->sum));
+  update_min (&dst->min, ddsrt_atomic_ld64 (&src->min));
+  update_max (&dst->max, ddsrt_atomic_ld64 (&src->max));
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t ddsrt_hdrhist_drain (struct ddsrt_hdrhist *dst, struct ddsrt_hdrhist *src)
+{
+  if (dst->sub_bucket_bits != src->sub_bucket_bits || dst->value_bits != src->value_bits)
+    return DDS_RETCODE_BAD_PARAMETER;
+  for (uint32_t i = 0; i < src->nbuckets; i++)
+  {
+    const uint64_t n = take (&src->buckets[i], 0);
+    if (n)
+      ddsrt_atomic_add64 (&dst->buckets[i], n);
+  }
+  ddsrt_atomic_add64 (&dst->sum, take (&src->sum, 0));
+  update_min (&dst->min, take (&src->min, UINT64_MAX));
+  update_max (&dst->max, take (&src->max, 0));
+  return DDS_RETCODE_OK;
+}
+
+uint64_t ddsrt_hdrhist_count (const struct ddsrt_hdrhist *h)
+{
+  uint64_t n = 0;
+  for (uint32_t i = 0; i < h->nbuckets; i++)
+    n += ddsrt_atomic_ld64 (&h->buckets[i]);
+  return n;
+}
+
+uint64_t ddsrt_hdrhist_min (const struct ddsrt_hdrhist *h)
+{
+  return ddsrt_atomic_ld64 (&h->min);
+}
+
+uint64_t ddsrt_hdrhist_max (const struct ddsrt_hdrhist *h)
+{
+  return ddsrt_atomic_ld64 (&h->max);
+}
+
+double ddsrt_hdrhist_mean (const struct ddsrt_hdrhist *h)
+{
+  const uint64_t n = ddsrt_hdrhist_count (h);
+  return (n == 0) ? 0.0 : (double) ddsrt_atomic_ld64 (&h->sum) / (double) n;
+}
+
+uint64_t ddsrt_hdrhist_percentile (const struct ddsrt_hdrhist *h, double pct)
+{
+  const uint64_t n = ddsrt_hdrhist_count (h);
+  if (n == 0)
+    return 0;
+  if (pct < 0.0)
+    pct = 0.0;
+  else if (pct > 100.0)
+    pct = 100.0;
+  // rank of the value we're looking for, 1-based so that 0% gives the smallest value
+  uint64_t rank = (uint64_t) ((pct / 100.0) * (double) n + 0.5);
+  if (rank == 0)
+    rank = 1;
+  else if (rank > n)
+    rank = n;
+  uint64_t cum = 0;
+  uint32_t i;
+  for (i = 0; i < h->nbuckets - 1; i++)
+  {
+    cum += ddsrt_atomic_ld64 (&h->buckets[i]);
+    if (cum >= rank)
+      break;
+  }
+  const uint64_t min = ddsrt_atomic_ld64 (&h->min), max = ddsrt_atomic_ld64 (&h->max);
+  const uint64_t v = bucket_highest_value (h, i);
+  return (v < min) ? min : (v > max) ? max : v;
+}
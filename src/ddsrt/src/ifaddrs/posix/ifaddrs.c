@@ -32,15 +32,19 @@ extern const int *const os_supp_afs;
 #if defined __linux
 #include <stdio.h>
 
-static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
+/* Returns the names of the wireless interfaces as a sequence of null-terminated strings
+   followed by an empty string, or NULL if there are none.  Reading the file once per
+   enumeration rather than once per address matters because there are often several
+   addresses and opening a file in /proc is not cheap. */
+static char *wireless_interfaces (void)
 {
   FILE *fp;
   char ifnam[IFNAMSIZ + 1]; /* not sure whether IFNAMSIZ includes a terminating 0, can't be bothered */
   int c;
-  size_t np;
-  enum ddsrt_iftype type = DDSRT_IFTYPE_UNKNOWN;
+  size_t np, nwifs = 0, wifssz = 0;
+  char *wifs = NULL;
   if ((fp = fopen ("/proc/net/wireless", "r")) == NULL)
-    return type;
+    return NULL;
   /* expected format:
      :Inter-| sta-|   Quality        |   Discarded packets               | Missed | WE
      : face | tus | link level noise |  nwid  crypt   frag  retry   misc | beacon | 22
@@ -53,7 +57,7 @@ static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
    */
   enum { SKIP_HEADER_1, SKIP_WHITE, READ_NAME, SKIP_TO_EOL } state = SKIP_HEADER_1;
   np = 0;
-  while (type != DDSRT_IFTYPE_WIFI && (c = fgetc (fp)) != EOF) {
+  while ((c = fgetc (fp)) != EOF) {
     switch (state) {
       case SKIP_HEADER_1:
         if (c == '\n') {
@@ -68,9 +72,14 @@ static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
         break;
       case READ_NAME:
         if (c == ':') {
-          ifnam[np] = 0;
-          if (strcmp (ifnam, sys_ifa->ifa_name) == 0)
-            type = DDSRT_IFTYPE_WIFI;
+          ifnam[np++] = 0;
+          if (nwifs + np + 1 > wifssz) {
+            wifssz = 2 * wifssz + sizeof (ifnam) + 1;
+            wifs = ddsrt_realloc (wifs, wifssz);
+          }
+          memcpy (wifs + nwifs, ifnam, np);
+          nwifs += np;
+          wifs[nwifs] = 0;
           state = SKIP_TO_EOL;
           np = 0;
         } else if (np < sizeof (ifnam) - 1) {
@@ -85,7 +94,17 @@ static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
     }
   }
   fclose (fp);
-  return type;
+  return wifs;
+}
+
+static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa, const char *wifs)
+{
+  if (wifs == NULL)
+    return DDSRT_IFTYPE_UNKNOWN;
+  for (const char *n = wifs; *n; n += strlen (n) + 1)
+    if (strcmp (n, sys_ifa->ifa_name) == 0)
+      return DDSRT_IFTYPE_WIFI;
+  return DDSRT_IFTYPE_UNKNOWN;
 }
 #elif (defined(__APPLE__) && !TARGET_OS_IPHONE) || defined(__QNXNTO__) || defined(__FreeBSD__)  /* probably works for all BSDs */
 
@@ -94,9 +113,15 @@ static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
 #include <net/if.h>
 #include <net/if_media.h>
 
-static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
+static char *wireless_interfaces (void)
+{
+  return NULL;
+}
+
+static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa, const char *wifs)
 {
   int sock;
+  (void) wifs;
   if ((sock = socket (sys_ifa->ifa_addr->sa_family, SOCK_DGRAM, 0)) == -1)
     return DDSRT_IFTYPE_UNKNOWN;
 
@@ -131,8 +156,14 @@ static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
   return type;
 }
 #else
-static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa)
+static char *wireless_interfaces (void)
 {
+  return NULL;
+}
+
+static enum ddsrt_iftype guess_iftype (const struct ifaddrs *sys_ifa, const char *wifs)
+{
+  (void) sys_ifa; (void) wifs;
   return DDSRT_IFTYPE_UNKNOWN;
 }
 #endif
@@ -250,8 +281,16 @@ out:
   return multicast_works;
 }
 
+/* Bit i set in [0] for IPv4, [1] for IPv6 if multicast has been probed on the loopback
+   interface with index i during this enumeration, with the outcome in the same bit of
+   works */
+struct lo_mc_probes {
+  uint32_t probed[2];
+  uint32_t works[2];
+};
+
 static dds_return_t
-copyaddr(ddsrt_ifaddrs_t **ifap, const struct ifaddrs *sys_ifa, enum ddsrt_iftype type)
+copyaddr(ddsrt_ifaddrs_t **ifap, const struct ifaddrs *sys_ifa, enum ddsrt_iftype type, struct lo_mc_probes *lo_mc)
 {
   dds_return_t err = DDS_RETCODE_OK;
   ddsrt_ifaddrs_t *ifa;
@@ -290,8 +329,28 @@ copyaddr(ddsrt_ifaddrs_t **ifap, const struct ifaddrs *sys_ifa, enum ddsrt_iftyp
         (ifa->flags & IFF_LOOPBACK) && !(ifa->flags & IFF_MULTICAST) &&
         (ifa->addr->sa_family == AF_INET || ifa->addr->sa_family == AF_INET6))
     {
-      if (is_the_kernel_likely_lying_about_multicast (ifa))
-        ifa->flags |= IFF_MULTICAST;
+      /* Sending and receiving a multicast costs more than all the rest of the
+         enumeration put together, so probe only once per interface and address
+         family for all its addresses.  Not across enumerations, as the outcome
+         may be different next time. */
+      const int v6 = (ifa->addr->sa_family == AF_INET6);
+      const uint32_t bit = (ifa->index < 32) ? (uint32_t) 1 << ifa->index : 0;
+      if (bit == 0)
+      {
+        if (is_the_kernel_likely_lying_about_multicast (ifa))
+          ifa->flags |= IFF_MULTICAST;
+      }
+      else
+      {
+        if (!(lo_mc->probed[v6] & bit))
+        {
+          lo_mc->probed[v6] |= bit;
+          if (is_the_kernel_likely_lying_about_multicast (ifa))
+            lo_mc->works[v6] |= bit;
+        }
+        if (lo_mc->works[v6] & bit)
+          ifa->flags |= IFF_MULTICAST;
+      }
     }
   }
 
@@ -336,6 +395,8 @@ ddsrt_getifaddrs(
     }
   } else {
     ifa = ifa_root = NULL;
+    char *wifs = wireless_interfaces ();
+    struct lo_mc_probes lo_mc = { { 0, 0 }, { 0, 0 } };
 
     for (sys_ifa = sys_ifa_root;
          sys_ifa != NULL && err == 0;
@@ -349,8 +410,8 @@ ddsrt_getifaddrs(
         }
 
         if (use) {
-          enum ddsrt_iftype type = guess_iftype (sys_ifa);
-          err = copyaddr(&ifa_next, sys_ifa, type);
+          enum ddsrt_iftype type = guess_iftype (sys_ifa, wifs);
+          err = copyaddr(&ifa_next, sys_ifa, type, &lo_mc);
           if (err == DDS_RETCODE_OK) {
             if (ifa == NULL) {
               ifa = ifa_root = ifa_next;
@@ -363,6 +424,7 @@ ddsrt_getifaddrs(
       }
     }
 
+    ddsrt_free (wifs);
     freeifaddrs(sys_ifa_root);
 
     if (err == 0) {
@@ -15,8 +15,11 @@
 #include <string.h>
 
 #include "dds/ddsrt/log.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
 #include "dds/ddsrt/static_assert.h"
 
 #define MAX_ID_LEN (10)
@@ -42,6 +45,60 @@ static ddsrt_thread_local log_buffer_t log_buffer;
 static ddsrt_once_t lock_inited = DDSRT_ONCE_INIT;
 static ddsrt_rwlock_t lock;
 
+/* Asynchronous writing of messages for the default sinks uses a single ring
+   buffer shared by all threads.  Producers reserve space by advancing wpos
+   with a CAS, copy the message and then set the size in the record header to
+   commit it; the writer thread consumes the records in order, clears the
+   space and advances rpos.  Because consumed space is cleared, a header with
+   size 0 always means the record has been reserved but not yet committed.
+   A record never wraps around: if it doesn't fit, the remainder of the buffer
+   is skipped using a padding record.
+
+   Besides the position, wpos holds a flag indicating whether the buffer is
+   open for reservations and a generation number that is incremented each time
+   it is reopened.  The sink configuration only changes while the buffer is
+   closed and drained, so a producer can read it without taking the sink lock:
+   if it changed in the meantime, the CAS reserving the space fails.  It is
+   only open while both sinks are the default ones, so that messages for other
+   sinks are still passed to them synchronously, holding the sink lock.
+
+   Nobody polls: the writer thread sleeps on the condition variable when it
+   reaches a record that hasn't been committed yet, and producers that find it
+   sleeping or find the buffer full use the same condition variable. */
+#define ASYNC_BUFSIZE ((uint32_t) 1 << 20)
+#define ASYNC_PADDING 0x80000000u
+#define ASYNC_OPEN ((uint64_t) 1 << 63)
+#define ASYNC_GEN_SHIFT 48
+#define ASYNC_GEN_MASK (((uint64_t) 1 << 63) - ((uint64_t) 1 << ASYNC_GEN_SHIFT))
+#define ASYNC_POS_MASK (((uint64_t) 1 << ASYNC_GEN_SHIFT) - 1)
+
+struct async_rec {
+  ddsrt_atomic_uint32_t size; /* size including header, 0 if not committed */
+  uint32_t len; /* length of the message */
+  FILE *fp;
+};
+
+#define ASYNC_ALIGN(x) (((x) + 7) & ~(size_t) 7)
+#define ASYNC_HDRSIZE ASYNC_ALIGN (sizeof (struct async_rec))
+
+struct async_writer {
+  ddsrt_atomic_uint64_t wpos; /* open flag, generation and position */
+  ddsrt_atomic_uint64_t rpos;
+  ddsrt_atomic_uint32_t writer_idle; /* writer thread waits for a commit */
+  ddsrt_atomic_uint32_t nspacewait; /* number of producers waiting for space */
+  ddsrt_atomic_uint32_t nflushwait; /* number of threads waiting for a flush */
+  char *buf;
+  uint32_t refc; /* [lock] */
+  bool active; /* [lock] */
+  ddsrt_thread_t tid; /* [lock] */
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  bool terminate; /* [async.lock] */
+  uint64_t flushed; /* all data up to here written & flushed [async.lock] */
+};
+
+static struct async_writer async;
+
 struct ddsrt_log_cfg_impl {
   struct ddsrt_log_cfg_common c;
   FILE *sink_fps[2];
@@ -83,6 +140,8 @@ uint32_t * const dds_log_mask = &logconfig.c.mask;
 static void init_lock (void)
 {
   ddsrt_rwlock_init (&lock);
+  ddsrt_mutex_init (&async.lock);
+  ddsrt_cond_init (&async.cond);
   sinks[LOG].ptr = sinks[TRACE].ptr = stderr;
   sinks[LOG].out = sinks[TRACE].out = stderr;
   logconfig.sink_fps[LOG] = sinks[LOG].ptr;
@@ -106,6 +165,246 @@ static void unlock_sink (void)
   ddsrt_rwlock_unlock (&lock);
 }
 
+static uint32_t async_targets (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, FILE *fps[2])
+{
+  /* only called while the buffer is open, so both sinks are the default ones */
+  uint32_t n = 0;
+  FILE *log_fp = NULL;
+  if (cat & DDS_LOG_MASK)
+  {
+    log_fp = cfg->sink_fps[LOG];
+    if (log_fp)
+      fps[n++] = log_fp;
+  }
+  if (cfg->c.tracemask && (cat & cfg->c.mask) && cfg->sink_fps[TRACE] && cfg->sink_fps[TRACE] != log_fp)
+    fps[n++] = cfg->sink_fps[TRACE];
+  return n;
+}
+
+static void async_wait_for_space (uint64_t w, uint64_t need)
+{
+  ddsrt_mutex_lock (&async.lock);
+  ddsrt_atomic_inc32 (&async.nspacewait);
+  while (ddsrt_atomic_ld64 (&async.wpos) == w && need - ddsrt_atomic_ld64 (&async.rpos) > ASYNC_BUFSIZE)
+    ddsrt_cond_wait (&async.cond, &async.lock);
+  ddsrt_atomic_dec32 (&async.nspacewait);
+  ddsrt_mutex_unlock (&async.lock);
+}
+
+static void async_wakeup (void)
+{
+  ddsrt_mutex_lock (&async.lock);
+  ddsrt_cond_broadcast (&async.cond);
+  ddsrt_mutex_unlock (&async.lock);
+}
+
+static void async_commit (struct async_rec *r, uint32_t size)
+{
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&r->size, size);
+  ddsrt_atomic_fence ();
+  if (ddsrt_atomic_ld32 (&async.writer_idle))
+    async_wakeup ();
+}
+
+/* Returns false if the buffer is closed, without writing anything */
+static bool async_write (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, const dds_log_data_t *data)
+{
+  const char *msg = data->message - data->hdrsize;
+  const size_t len = data->hdrsize + data->size + 1;
+  const uint32_t recsize = (uint32_t) ASYNC_ALIGN (ASYNC_HDRSIZE + len);
+  FILE *fps[2];
+  uint32_t n;
+  uint64_t w, pos, pad;
+  assert (2 * recsize <= ASYNC_BUFSIZE / 2);
+  while (true)
+  {
+    w = ddsrt_atomic_ld64 (&async.wpos);
+    if (!(w & ASYNC_OPEN))
+      return false;
+    ddsrt_atomic_fence_acq ();
+    if ((n = async_targets (cfg, cat, fps)) == 0)
+      return true;
+    pos = w & ASYNC_POS_MASK;
+    const uint32_t rem = ASYNC_BUFSIZE - (uint32_t) (pos % ASYNC_BUFSIZE);
+    pad = (rem < n * recsize) ? rem : 0;
+    if (pos + pad + n * recsize - ddsrt_atomic_ld64 (&async.rpos) > ASYNC_BUFSIZE)
+      async_wait_for_space (w, pos + pad + n * recsize);
+    else if (ddsrt_atomic_cas64 (&async.wpos, w, w + pad + n * recsize))
+      break;
+  }
+  if (pad)
+  {
+    async_commit ((struct async_rec *) (async.buf + pos % ASYNC_BUFSIZE), (uint32_t) pad | ASYNC_PADDING);
+    pos += pad;
+  }
+  for (uint32_t i = 0; i < n; i++, pos += recsize)
+  {
+    struct async_rec *r = (struct async_rec *) (async.buf + pos % ASYNC_BUFSIZE);
+    r->len = (uint32_t) len;
+    r->fp = fps[i];
+    memcpy ((char *) r + ASYNC_HDRSIZE, msg, len);
+    async_commit (r, recsize);
+  }
+  return true;
+}
+
+static uint32_t async_writer_thread (void *varg)
+{
+  (void) varg;
+  FILE *dirty[4];
+  uint32_t ndirty = 0;
+  uint64_t r = ddsrt_atomic_ld64 (&async.rpos);
+  ddsrt_mutex_lock (&async.lock);
+  while (true)
+  {
+    ddsrt_mutex_unlock (&async.lock);
+    struct async_rec *p;
+    uint32_t size;
+    while ((size = ddsrt_atomic_ld32 (&(p = (struct async_rec *) (async.buf + r % ASYNC_BUFSIZE))->size)) != 0)
+    {
+      ddsrt_atomic_fence_acq ();
+      if (!(size & ASYNC_PADDING))
+      {
+        (void) fwrite ((char *) p + ASYNC_HDRSIZE, 1, p->len, p->fp);
+        uint32_t i;
+        for (i = 0; i < ndirty && dirty[i] != p->fp; i++)
+          ;
+        if (i == ndirty)
+        {
+          if (ndirty == sizeof (dirty) / sizeof (dirty[0]))
+          {
+            while (ndirty > 0)
+              fflush (dirty[--ndirty]);
+          }
+          dirty[ndirty++] = p->fp;
+        }
+      }
+      size &= ~ASYNC_PADDING;
+      memset (p, 0, size);
+      ddsrt_atomic_fence_rel ();
+      r += size;
+      ddsrt_atomic_st64 (&async.rpos, r);
+      ddsrt_atomic_fence ();
+      if (ddsrt_atomic_ld32 (&async.nspacewait))
+        async_wakeup ();
+      if (ddsrt_atomic_ld32 (&async.nflushwait))
+        break; /* don't let a flush wait for the writer to catch up */
+    }
+    while (ndirty > 0)
+      fflush (dirty[--ndirty]);
+    ddsrt_mutex_lock (&async.lock);
+    async.flushed = r;
+    ddsrt_cond_broadcast (&async.cond);
+    if (async.terminate && r == (ddsrt_atomic_ld64 (&async.wpos) & ASYNC_POS_MASK))
+      break;
+    /* sleep until the next record is committed, producers check writer_idle
+       after committing a record */
+    ddsrt_atomic_st32 (&async.writer_idle, 1);
+    ddsrt_atomic_fence ();
+    p = (struct async_rec *) (async.buf + r % ASYNC_BUFSIZE);
+    if (ddsrt_atomic_ld32 (&p->size) == 0)
+      ddsrt_cond_wait (&async.cond, &async.lock);
+    ddsrt_atomic_st32 (&async.writer_idle, 0);
+  }
+  ddsrt_mutex_unlock (&async.lock);
+  return 0;
+}
+
+static void async_flush (void)
+{
+  const uint64_t w = ddsrt_atomic_ld64 (&async.wpos) & ASYNC_POS_MASK;
+  ddsrt_mutex_lock (&async.lock);
+  ddsrt_atomic_inc32 (&async.nflushwait);
+  /* the writer thread updates flushed before going to sleep, and it is
+     woken up when the records that haven't been written yet are committed */
+  while (async.flushed < w)
+    ddsrt_cond_wait (&async.cond, &async.lock);
+  ddsrt_atomic_dec32 (&async.nflushwait);
+  ddsrt_mutex_unlock (&async.lock);
+}
+
+static void async_close (void)
+{
+  /* Stops new reservations and waits until everything reserved before has been
+     written, so the caller can change the sink configuration; requires the sink
+     lock to be held for writing */
+  uint64_t w;
+  do {
+    w = ddsrt_atomic_ld64 (&async.wpos);
+  } while ((w & ASYNC_OPEN) && !ddsrt_atomic_cas64 (&async.wpos, w, w & ~ASYNC_OPEN));
+  async_wakeup ();
+  async_flush ();
+}
+
+static void async_open (void)
+{
+  /* Requires the sink lock to be held for writing and the buffer to be closed */
+  if (sinks[LOG].func == default_sink && sinks[TRACE].func == default_sink)
+  {
+    const uint64_t w = ddsrt_atomic_ld64 (&async.wpos);
+    const uint64_t gen = ((w & ASYNC_GEN_MASK) + ((uint64_t) 1 << ASYNC_GEN_SHIFT)) & ASYNC_GEN_MASK;
+    ddsrt_atomic_fence ();
+    ddsrt_atomic_st64 (&async.wpos, ASYNC_OPEN | gen | (w & ASYNC_POS_MASK));
+  }
+}
+
+dds_return_t dds_log_async_start (void)
+{
+  dds_return_t rc = DDS_RETCODE_OK;
+  lock_sink (WRLOCK);
+  if (async.refc == 0)
+  {
+    ddsrt_threadattr_t tattr;
+    async.buf = ddsrt_calloc (1, ASYNC_BUFSIZE);
+    ddsrt_atomic_st64 (&async.wpos, 0);
+    ddsrt_atomic_st64 (&async.rpos, 0);
+    async.terminate = false;
+    async.flushed = 0;
+    ddsrt_threadattr_init (&tattr);
+    if ((rc = ddsrt_thread_create (&async.tid, "logwr", &tattr, async_writer_thread, NULL)) != DDS_RETCODE_OK)
+    {
+      ddsrt_free (async.buf);
+      unlock_sink ();
+      return rc;
+    }
+    async.active = true;
+    async_open ();
+  }
+  async.refc++;
+  unlock_sink ();
+  return rc;
+}
+
+void dds_log_async_stop (void)
+{
+  lock_sink (WRLOCK);
+  assert (async.refc > 0);
+  if (--async.refc > 0)
+    async_flush ();
+  else
+  {
+    async_close ();
+    async.active = false;
+    ddsrt_mutex_lock (&async.lock);
+    async.terminate = true;
+    ddsrt_cond_broadcast (&async.cond);
+    ddsrt_mutex_unlock (&async.lock);
+    (void) ddsrt_thread_join (async.tid, NULL);
+    ddsrt_free (async.buf);
+    async.buf = NULL;
+  }
+  unlock_sink ();
+}
+
+void dds_log_async_flush (void)
+{
+  lock_sink (RDLOCK);
+  if (async.active)
+    async_flush ();
+  unlock_sink ();
+}
+
 static void set_log_sink (log_sink_t *sink, dds_log_write_fn_t func, void *ptr)
 {
   assert (sink != NULL);
@@ -115,8 +414,12 @@ static void set_log_sink (log_sink_t *sink, dds_log_write_fn_t func, void *ptr)
      responsible for that. Ensure this operation is deterministic and that on
      return, no thread in the DDS stack still uses the deprecated sink. */
   lock_sink (WRLOCK);
+  if (async.active)
+    async_close ();
   sink->func = (func != NULL) ? func : default_sink;
   sink->ptr = ptr;
+  if (async.active)
+    async_open ();
   unlock_sink ();
 }
 
@@ -124,14 +427,22 @@ static void set_log_sink (log_sink_t *sink, dds_log_write_fn_t func, void *ptr)
 void dds_set_log_file (FILE *file)
 {
   lock_sink (WRLOCK);
+  if (async.active)
+    async_close ();
   logconfig.sink_fps[LOG] = (file == NULL ? stderr : file);
+  if (async.active)
+    async_open ();
   unlock_sink ();
 }
 
 void dds_set_trace_file (FILE *file)
 {
   lock_sink (WRLOCK);
+  if (async.active)
+    async_close ();
   logconfig.sink_fps[TRACE] = (file == NULL ? stderr : file);
+  if (async.active)
+    async_open ();
   unlock_sink ();
 }
 
@@ -201,20 +512,36 @@ static size_t print_header (char *str, uint32_t id)
   return (size_t) (cnt + 1);
 }
 
-static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t domid, const char *file, uint32_t line, const char *func, const char *fmt, va_list ap)
+static void write_sinks (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, const dds_log_data_t *data)
+{
+  dds_log_write_fn_t f = NULL;
+  void *f_arg = NULL;
+  if (cat & DDS_LOG_MASK)
+  {
+    f = sinks[LOG].func;
+    f_arg = (f == default_sink) ? cfg->sink_fps[LOG] : sinks[LOG].ptr;
+    assert (f != NULL);
+    f (f_arg, data);
+  }
+  /* if tracing is enabled, then print to trace if it matches the
+     trace flags or if it got written to the log
+     (mask == (tracemask | DDS_LOG_MASK)) */
+  if (cfg->c.tracemask && (cat & cfg->c.mask))
+  {
+    dds_log_write_fn_t const g = sinks[TRACE].func;
+    void * const g_arg = (g == default_sink) ? cfg->sink_fps[TRACE] : sinks[TRACE].ptr;
+    assert (g != NULL);
+    if (g != f || g_arg != f_arg)
+      g (g_arg, data);
+  }
+}
+
+/* Formats the message in the thread-local buffer, returns true if it is
+   complete and must be written */
+static bool vlog1 (log_buffer_t *lb, uint32_t domid, dds_log_data_t *data, const char *fmt, va_list ap)
 {
   int n, trunc = 0;
   size_t nrem;
-  log_buffer_t *lb;
-  dds_log_data_t data;
-
-  /* id can be used to override the id in logconfig, so that the global
-     logging configuration can be used for reporting errors while inlcuding
-     a domain id.  This simply verifies that the id override is only ever
-     used with the global one. */
-  assert (domid == cfg->c.domid || cfg == &logconfig);
-
-  lb = &log_buffer;
 
   /* Thread-local buffer is always initialized with all zeroes. The pos
      member must always be greater or equal to BUF_OFFSET. */
@@ -233,7 +560,7 @@ static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t
       fmt++;
   }
   if (*fmt == 0) {
-    return;
+    return false;
   }
 
   nrem = sizeof (lb->buf) - lb->pos;
@@ -254,52 +581,51 @@ static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t
     }
   }
 
-  if (fmt[strlen (fmt) - 1] == '\n' && lb->pos > BUF_OFFSET + 1) {
-    assert (lb->pos > BUF_OFFSET);
-    size_t hdrsize = print_header (lb->buf, domid);
-
-    data.priority = cat;
-    data.file = file;
-    data.domid = domid;
-    data.function = func;
-    data.line = line;
-    data.message = lb->buf + BUF_OFFSET;
-    data.size = lb->pos - BUF_OFFSET - 1;
-    data.hdrsize = hdrsize;
-
-    dds_log_write_fn_t f = NULL;
-    void *f_arg = NULL;
-    if (cat & DDS_LOG_MASK)
-    {
-      f = sinks[LOG].func;
-      f_arg = (f == default_sink) ? cfg->sink_fps[LOG] : sinks[LOG].ptr;
-      assert (f != NULL);
-      f (f_arg, &data);
-    }
-    /* if tracing is enabled, then print to trace if it matches the
-       trace flags or if it got written to the log
-       (mask == (tracemask | DDS_LOG_MASK)) */
-    if (cfg->c.tracemask && (cat & cfg->c.mask))
+  if (fmt[strlen (fmt) - 1] != '\n' || lb->pos <= BUF_OFFSET + 1)
+    return false;
+  data->message = lb->buf + BUF_OFFSET;
+  data->size = lb->pos - BUF_OFFSET - 1;
+  data->hdrsize = print_header (lb->buf, domid);
+  return true;
+}
+
+static void vlog (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t domid, const char *file, uint32_t line, const char *func, const char *fmt, va_list ap)
+{
+  log_buffer_t * const lb = &log_buffer;
+  dds_log_data_t data = {
+    .priority = cat, .file = file, .domid = domid, .function = func, .line = line
+  };
+
+  /* id can be used to override the id in logconfig, so that the global
+     logging configuration can be used for reporting errors while inlcuding
+     a domain id.  This simply verifies that the id override is only ever
+     used with the global one. */
+  assert (domid == cfg->c.domid || cfg == &logconfig);
+
+  /* Formatting only involves the thread-local buffer, and if asynchronous
+     writing is active and the sinks are the default ones, so does copying
+     the message into the shared buffer: the sink lock is only needed for
+     calling the sinks */
+  if (vlog1 (lb, domid, &data, fmt, ap))
+  {
+    if (!async_write (cfg, cat, &data))
     {
-      dds_log_write_fn_t const g = sinks[TRACE].func;
-      void * const g_arg = (g == default_sink) ? cfg->sink_fps[TRACE] : sinks[TRACE].ptr;
-      assert (g != NULL);
-      if (g != f || g_arg != f_arg)
-        g (g_arg, &data);
+      lock_sink (RDLOCK);
+      if (!async_write (cfg, cat, &data))
+        write_sinks (cfg, cat, &data);
+      unlock_sink ();
     }
-
     lb->pos = BUF_OFFSET;
     lb->buf[lb->pos] = 0;
   }
-}
-
-static void vlog (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t domid, const char *file, uint32_t line, const char *func, const char *fmt, va_list ap)
-{
-  lock_sink (RDLOCK);
-  vlog1 (cfg, cat, domid, file, line, func, fmt, ap);
-  unlock_sink ();
   if (cat & DDS_LC_FATAL)
+  {
+    lock_sink (RDLOCK);
+    if (async.active)
+      async_flush ();
+    unlock_sink ();
     abort();
+  }
 }
 
 void dds_log_cfg (const struct ddsrt_log_cfg *cfg, uint32_t cat, const char *file, uint32_t line, const char *func, const char *fmt, ...)
@@ -601,6 +601,12 @@ ddsrt_thread_getname_anythread (
     name[namelen] = 0;
   return DDS_RETCODE_OK;
 }
+
+ddsrt_thread_list_id_t
+ddsrt_thread_list_id_self (void)
+{
+  return (ddsrt_thread_list_id_t) syscall (SYS_gettid);
+}
 #elif defined __APPLE__
 DDSRT_STATIC_ASSERT (sizeof (ddsrt_thread_list_id_t) == sizeof (mach_port_t));
 
@@ -634,6 +640,12 @@ ddsrt_thread_getname_anythread (
   }
   return DDS_RETCODE_OK;
 }
+
+ddsrt_thread_list_id_t
+ddsrt_thread_list_id_self (void)
+{
+  return (ddsrt_thread_list_id_t) pthread_mach_thread_np (pthread_self ());
+}
 #endif
 
 
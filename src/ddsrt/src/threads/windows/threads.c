@@ -394,6 +394,12 @@ ddsrt_thread_getname_anythread (
   return DDS_RETCODE_OK;
 }
 
+ddsrt_thread_list_id_t
+ddsrt_thread_list_id_self (void)
+{
+  return OpenThread (THREAD_QUERY_INFORMATION, FALSE, GetCurrentThreadId ());
+}
+
 /* thread-local storage through use of __declspec(thread) use Windows native
    TLS when compiled with Visual Studio and Clang. GCC makes use of emutls
    which is destroyed before the destructor is invoked */
@@ -50,3 +50,22 @@ CU_Test(ddsrt_bits, ffs32u)
       junk_ok += ddsrt_ffs32u (((uint32_t)1 << i) | (ddsrt_random () << (i+1))) == i + 1;
   CU_ASSERT (junk_ok == 31 * 1000);
 }
+
+CU_Test(ddsrt_bits, fls64u)
+{
+  CU_ASSERT (ddsrt_fls64u (0) == 0);
+  int onebit_ok = 0;
+  for (uint32_t i = 0; i < 64; i++)
+    onebit_ok += ddsrt_fls64u ((uint64_t)1 << i) == i + 1;
+  CU_ASSERT (onebit_ok == 64);
+
+  // random junk below the most significant bit set
+  int junk_ok = 0;
+  for (uint32_t i = 1; i < 64; i++)
+    for (uint32_t j = 0; j < 1000; j++)
+    {
+      const uint64_t junk = (((uint64_t) ddsrt_random () << 32) | ddsrt_random ()) & (((uint64_t)1 << i) - 1);
+      junk_ok += ddsrt_fls64u (((uint64_t)1 << i) | junk) == i + 1;
+    }
+  CU_ASSERT (junk_ok == 63 * 1000);
+}
@@ -0,0 +1,166 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdint.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/hdrhist.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/threads.h"
+
+CU_Init(ddsrt_hdrhist)
+{
+  ddsrt_init();
+  return 0;
+}
+
+CU_Clean(ddsrt_hdrhist)
+{
+  ddsrt_fini();
+  return 0;
+}
+
+CU_Test(ddsrt_hdrhist, invalid_params)
+{
+  CU_ASSERT (ddsrt_hdrhist_new (0, 32) == NULL);
+  CU_ASSERT (ddsrt_hdrhist_new (17, 32) == NULL);
+  CU_ASSERT (ddsrt_hdrhist_new (8, 8) == NULL);
+  CU_ASSERT (ddsrt_hdrhist_new (8, 65) == NULL);
+  struct ddsrt_hdrhist *h = ddsrt_hdrhist_new (8, 64);
+  CU_ASSERT_FATAL (h != NULL);
+  ddsrt_hdrhist_free (h);
+}
+
+CU_Test(ddsrt_hdrhist, empty)
+{
+  struct ddsrt_hdrhist *h = ddsrt_hdrhist_new (4, 32);
+  CU_ASSERT_FATAL (h != NULL);
+  CU_ASSERT (ddsrt_hdrhist_count (h) == 0);
+  CU_ASSERT (ddsrt_hdrhist_min (h) == UINT64_MAX);
+  CU_ASSERT (ddsrt_hdrhist_max (h) == 0);
+  CU_ASSERT (ddsrt_hdrhist_mean (h) == 0.0);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 50.0) == 0);
+  ddsrt_hdrhist_free (h);
+}
+
+CU_Test(ddsrt_hdrhist, exact_small_values)
+{
+  // values below 2^sub_bucket_bits are exact
+  struct ddsrt_hdrhist *h = ddsrt_hdrhist_new (4, 32);
+  CU_ASSERT_FATAL (h != NULL);
+  for (uint64_t v = 1; v <= 10; v++)
+    ddsrt_hdrhist_record (h, v);
+  CU_ASSERT (ddsrt_hdrhist_count (h) == 10);
+  CU_ASSERT (ddsrt_hdrhist_min (h) == 1);
+  CU_ASSERT (ddsrt_hdrhist_max (h) == 10);
+  CU_ASSERT (ddsrt_hdrhist_mean (h) == 5.5);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 0.0) == 1);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 50.0) == 5);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 90.0) == 9);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 100.0) == 10);
+  ddsrt_hdrhist_reset (h);
+  CU_ASSERT (ddsrt_hdrhist_count (h) == 0);
+  ddsrt_hdrhist_free (h);
+}
+
+CU_Test(ddsrt_hdrhist, relative_error)
+{
+  // any single value must come back within 2^-S of the original, and never be below it
+  const uint32_t s = 7;
+  struct ddsrt_hdrhist *h = ddsrt_hdrhist_new (s, 64);
+  CU_ASSERT_FATAL (h != NULL);
+  int ok = 0;
+  for (int i = 0; i < 10000; i++)
+  {
+    const uint64_t v = (((uint64_t) ddsrt_random () << 32) | ddsrt_random ()) >> (ddsrt_random () % 64);
+    ddsrt_hdrhist_reset (h);
+    ddsrt_hdrhist_record (h, v);
+    ddsrt_hdrhist_record (h, UINT64_MAX);
+    const uint64_t p = ddsrt_hdrhist_percentile (h, 50.0);
+    ok += (p >= v && (double) (p - v) <= (double) v / (double) (1u << s));
+  }
+  CU_ASSERT (ok == 10000);
+  ddsrt_hdrhist_free (h);
+}
+
+CU_Test(ddsrt_hdrhist, overflow_bucket)
+{
+  struct ddsrt_hdrhist *h = ddsrt_hdrhist_new (4, 20);
+  CU_ASSERT_FATAL (h != NULL);
+  ddsrt_hdrhist_record (h, 100);
+  ddsrt_hdrhist_record (h, (uint64_t) 1 << 40);
+  CU_ASSERT (ddsrt_hdrhist_count (h) == 2);
+  CU_ASSERT (ddsrt_hdrhist_max (h) == (uint64_t) 1 << 40);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 100.0) == (uint64_t) 1 << 40);
+  CU_ASSERT (ddsrt_hdrhist_percentile (h, 50.0) <= 100 + 100 / 16);
+  ddsrt_hdrhist_free (h);
+}
+
+CU_Test(ddsrt_hdrhist, merge)
+{
+  struct ddsrt_hdrhist *a = ddsrt_hdrhist_new (6, 40);
+  struct ddsrt_hdrhist *b = ddsrt_hdrhist_new (6, 40);
+  struct ddsrt_hdrhist *c = ddsrt_hdrhist_new (5, 40);
+  CU_ASSERT_FATAL (a != NULL && b != NULL && c != NULL);
+  for (uint64_t v = 0; v < 1000; v++)
+    ddsrt_hdrhist_record ((v % 2) ? a : b, v * 1000);
+  CU_ASSERT (ddsrt_hdrhist_merge (c, a) == DDS_RETCODE_BAD_PARAMETER);
+  CU_ASSERT (ddsrt_hdrhist_merge (a, b) == DDS_RETCODE_OK);
+  CU_ASSERT (ddsrt_hdrhist_count (a) == 1000);
+  CU_ASSERT (ddsrt_hdrhist_count (b) == 500);
+  CU_ASSERT (ddsrt_hdrhist_min (a) == 0);
+  CU_ASSERT (ddsrt_hdrhist_max (a) == 999000);
+  CU_ASSERT (ddsrt_hdrhist_mean (a) == 499500.0);
+  const uint64_t p50 = ddsrt_hdrhist_percentile (a, 50.0);
+  CU_ASSERT (p50 >= 499000 && p50 <= 499000 + 499000 / 64);
+  ddsrt_hdrhist_free (a);
+  ddsrt_hdrhist_free (b);
+  ddsrt_hdrhist_free (c);
+}
+
+#define DRAIN_NTHREADS 4
+#define DRAIN_NVALUES 100000
+
+static uint32_t drain_recorder (void *varg)
+{
+  struct ddsrt_hdrhist * const h = varg;
+  for (uint32_t i = 0; i < DRAIN_NVALUES; i++)
+    ddsrt_hdrhist_record (h, i);
+  return 0;
+}
+
+CU_Test(ddsrt_hdrhist, drain_concurrent)
+{
+  // moving values out while other threads record may not lose or duplicate any
+  struct ddsrt_hdrhist *live = ddsrt_hdrhist_new (6, 40);
+  struct ddsrt_hdrhist *tot = ddsrt_hdrhist_new (6, 40);
+  CU_ASSERT_FATAL (live != NULL && tot != NULL);
+  ddsrt_thread_t tids[DRAIN_NTHREADS];
+  ddsrt_threadattr_t attr;
+  ddsrt_threadattr_init (&attr);
+  for (int i = 0; i < DRAIN_NTHREADS; i++)
+  {
+    dds_return_t rc = ddsrt_thread_create (&tids[i], "rec", &attr, drain_recorder, live);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  for (int i = 0; i < 100; i++)
+    CU_ASSERT (ddsrt_hdrhist_drain (tot, live) == DDS_RETCODE_OK);
+  for (int i = 0; i < DRAIN_NTHREADS; i++)
+    ddsrt_thread_join (tids[i], NULL);
+  CU_ASSERT (ddsrt_hdrhist_drain (tot, live) == DDS_RETCODE_OK);
+  CU_ASSERT (ddsrt_hdrhist_count (live) == 0);
+  CU_ASSERT (ddsrt_hdrhist_count (tot) == DRAIN_NTHREADS * DRAIN_NVALUES);
+  CU_ASSERT (ddsrt_hdrhist_min (tot) == 0);
+  CU_ASSERT (ddsrt_hdrhist_max (tot) == DRAIN_NVALUES - 1);
+  CU_ASSERT (ddsrt_hdrhist_mean (tot) == (DRAIN_NVALUES - 1) / 2.0);
+  ddsrt_hdrhist_free (live);
+  ddsrt_hdrhist_free (tot);
+}
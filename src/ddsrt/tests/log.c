@@ -406,6 +406,142 @@ CU_Test(dds_log, synchronous_sink_changes, .fini=reset)
 #endif
 }
 
+#if HAVE_FMEMOPEN
+#define ASYNC_NTHREADS 4
+#define ASYNC_NMSGS 5000
+
+static uint32_t async_run(void *ptr)
+{
+  const int id = *(int *)ptr;
+  for (int i = 0; i < ASYNC_NMSGS; i++)
+    DDS_WARNING("async %d %d\n", id, i);
+  return 0;
+}
+#endif
+
+/* With asynchronous writing enabled, all messages must end up in the file by
+   the time dds_log_async_stop returns, with the messages of each thread in
+   order. Enough is written to wrap around in the buffer. */
+CU_Test(dds_log, async_write, .fini=reset)
+{
+#if HAVE_FMEMOPEN
+  const size_t bufsz = 4 << 20;
+  char *buf = ddsrt_malloc(bufsz);
+  FILE *fp = fmemopen(NULL, bufsz, "wb+");
+  CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+  dds_set_log_file(fp);
+  CU_ASSERT_EQUAL_FATAL(dds_log_async_start(), DDS_RETCODE_OK);
+
+  ddsrt_thread_t tids[ASYNC_NTHREADS];
+  int ids[ASYNC_NTHREADS];
+  ddsrt_threadattr_t tattr;
+  ddsrt_threadattr_init(&tattr);
+  for (int i = 0; i < ASYNC_NTHREADS; i++)
+  {
+    ids[i] = i;
+    dds_return_t ret = ddsrt_thread_create(&tids[i], "async", &tattr, &async_run, &ids[i]);
+    CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+  }
+  for (int i = 0; i < ASYNC_NTHREADS; i++)
+    (void)ddsrt_thread_join(tids[i], NULL);
+  dds_log_async_stop();
+  dds_set_log_file(NULL);
+
+  (void)fseek(fp, 0L, SEEK_SET);
+  size_t nbytes = fread(buf, 1, bufsz - 1, fp);
+  buf[nbytes] = '\0';
+  int next[ASYNC_NTHREADS] = { 0 };
+  bool ok = true;
+  for (char *line = buf, *eol; ok && (eol = strchr(line, '\n')) != NULL; line = eol + 1)
+  {
+    *eol = '\0';
+    const char *msg = strstr(line, "async ");
+    int id, seq;
+    ok = (msg != NULL && sscanf(msg, "async %d %d", &id, &seq) == 2 &&
+          id >= 0 && id < ASYNC_NTHREADS && seq == next[id]);
+    if (ok)
+      next[id]++;
+  }
+  CU_ASSERT(ok);
+  for (int i = 0; i < ASYNC_NTHREADS; i++)
+    CU_ASSERT_EQUAL(next[i], ASYNC_NMSGS);
+  (void)fclose(fp);
+  ddsrt_free(buf);
+#endif
+}
+
+/* A domain without asynchronous writing still has its messages go through the
+   shared buffer while another domain keeps it active, so its trace file may only
+   be closed after a flush. */
+CU_Test(dds_log, async_flush_before_close, .fini=reset)
+{
+#if HAVE_FMEMOPEN
+  const size_t bufsz = 1 << 16;
+  char *buf = ddsrt_malloc(bufsz);
+  FILE *fp = fmemopen(NULL, bufsz, "wb+");
+  CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+  struct ddsrt_log_cfg cfg;
+  dds_log_cfg_init(&cfg, 0, DDS_LC_TRACE, stderr, fp);
+  CU_ASSERT_EQUAL_FATAL(dds_log_async_start(), DDS_RETCODE_OK);
+  for (int i = 0; i < 100; i++)
+    DDS_CLOG(DDS_LC_TRACE, &cfg, "flush %d\n", i);
+  dds_log_async_flush();
+
+  /* everything has been written out, with asynchronous writing still active */
+  (void)fseek(fp, 0L, SEEK_SET);
+  size_t nbytes = fread(buf, 1, bufsz - 1, fp);
+  buf[nbytes] = '\0';
+  (void)fclose(fp);
+  int n = 0;
+  for (const char *p = buf; (p = strstr(p, "flush ")) != NULL; p++)
+    n++;
+  CU_ASSERT_EQUAL(n, 100);
+  dds_log_async_stop();
+  ddsrt_free(buf);
+#endif
+}
+
+/* Installing a custom sink while asynchronous writing is active first drains
+   the buffer into the old file and then delivers to the sink synchronously;
+   restoring the default sink resumes asynchronous writing. */
+CU_Test(dds_log, async_sink_change, .fini=reset)
+{
+#if HAVE_FMEMOPEN
+  const size_t bufsz = 1 << 16;
+  char *buf = ddsrt_malloc(bufsz);
+  FILE *fp = fmemopen(NULL, bufsz, "wb+");
+  CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+  dds_set_log_file(fp);
+  CU_ASSERT_EQUAL_FATAL(dds_log_async_start(), DDS_RETCODE_OK);
+  for (int i = 0; i < 10; i++)
+    DDS_WARNING("change %d\n", i);
+
+  int cnt = 0;
+  dds_set_log_sink(&count, &cnt);
+  for (int i = 0; i < 5; i++)
+    DDS_WARNING("sink %d\n", i);
+  CU_ASSERT_EQUAL(cnt, 5);
+
+  dds_set_log_sink(NULL, NULL);
+  for (int i = 10; i < 20; i++)
+    DDS_WARNING("change %d\n", i);
+  dds_log_async_stop();
+  dds_set_log_file(NULL);
+
+  (void)fseek(fp, 0L, SEEK_SET);
+  size_t nbytes = fread(buf, 1, bufsz - 1, fp);
+  buf[nbytes] = '\0';
+  (void)fclose(fp);
+  int n = 0;
+  for (const char *p = buf; (p = strstr(p, "change ")) != NULL; p++)
+    n++;
+  CU_ASSERT_EQUAL(n, 20);
+  CU_ASSERT_PTR_NULL(strstr(buf, "sink "));
+  CU_ASSERT_EQUAL(cnt, 5);
+  ddsrt_free(buf);
+#endif
+}
+
 /* Sanity checks that FATAL calls abort() -- this is very much platform
    dependent code, so we only do it on Linux and macOS, assuming that
    the logging implementation doesn't make any distinction between different
@@ -21,6 +21,7 @@
 #include "CUnit/Theory.h"
 #include "dds/ddsrt/cdtors.h"
 #include "dds/ddsrt/retcode.h"
+#include "dds/ddsrt/rusage.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/threads.h"
 
@@ -189,6 +190,25 @@ CU_Test(ddsrt_thread, thread_id)
   CU_ASSERT_NOT_EQUAL(eq, 0);
 }
 
+#if DDSRT_HAVE_THREAD_LIST
+CU_Test(ddsrt_thread, thread_list_id_self)
+{
+  const ddsrt_thread_list_id_t self = ddsrt_thread_list_id_self ();
+  ddsrt_rusage_t usage;
+  CU_ASSERT_EQUAL (ddsrt_getrusage_anythread (self, &usage), DDS_RETCODE_OK);
+#if !defined(_WIN32)
+  /* on Windows the identifiers are handles, so they can't be compared */
+  ddsrt_thread_list_id_t tids[100];
+  const dds_return_t n = ddsrt_thread_list (tids, sizeof (tids) / sizeof (tids[0]));
+  CU_ASSERT_FATAL (n > 0);
+  int found = 0;
+  for (dds_return_t i = 0; i < n && i < (dds_return_t) (sizeof (tids) / sizeof (tids[0])); i++)
+    found += (tids[i] == self);
+  CU_ASSERT_EQUAL (found, 1);
+#endif
+}
+#endif
+
 
 static ddsrt_mutex_t locks[2];
 
@@ -0,0 +1,49 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef PSMX_SHM_IMPL_H
+#define PSMX_SHM_IMPL_H
+
+#include "dds/dds.h"
+#include "dds/ddsc/dds_loaned_sample.h"
+#include "dds/ddsc/dds_psmx.h"
+#include "psmx_shm_export.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Creates an instance of the POSIX shared memory PSMX plugin
+ *
+ * Recognized configuration options:
+ * - SERVICE_NAME: name space for the shared memory segments (default derived from the instance id)
+ * - LOCATOR: 32 hex digits overriding the node identifier (default derived from the machine id)
+ * - KEYED_TOPICS: "true" or "false" (default), whether to support topics with keys
+ * - CHUNK_SIZE: maximum size of a sample in bytes (default 16384)
+ * - CHUNK_COUNT: number of samples in each segment (default 256)
+ * - SEGMENT_MODE: octal access mode of the shared memory segments (default 0600), e.g.
+ *   0660 to share them with processes of other users in the same group
+ *
+ * The chunk size, count and mode only have effect when creating a segment: any other
+ * process attaching to an existing segment uses the values stored in it.
+ *
+ * @param[out] psmx         the new PSMX instance
+ * @param[in] instance_id   identifier of the instance
+ * @param[in] config        configuration string
+ * @return a DDS return code
+ */
+DDS_PSMX_SHM_EXPORT dds_return_t shm_create_psmx (struct dds_psmx **psmx, dds_psmx_instance_id_t instance_id, const char *config);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* PSMX_SHM_IMPL_H */
@@ -0,0 +1,1326 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+// PSMX plugin exchanging data through POSIX shared memory, without any external daemon.
+//
+// Every (service, type, partition, topic) combination maps to a shared memory segment
+// containing a fixed number of equally sized chunks, a lock-free queue of free chunks and
+// a fixed number of reader slots, each with a lock-free queue of chunks waiting to be
+// delivered to that reader.  Writers loan a chunk from the free queue and publish it by
+// pushing its index into the queues of all active readers.  Each chunk has a word with a
+// bit for every reader slot that references it and one for the writer that loaned it;
+// the chunk is returned to the free queue by whoever clears the last bit.
+//
+// Readers block on a futex in their slot, writers only issue a wake-up if the reader
+// indicated it may be blocked.  Writers waiting for space in the queue of a reader that
+// doesn't allow dropping samples block on a second futex in the same way.
+//
+// A process attaching a segment takes one of its attach entries and holds an open file
+// description lock on the byte of the segment file at the offset of that entry for as
+// long as it is attached.  The kernel drops the lock when the process dies, which,
+// unlike a pid, works across pid namespaces and can't be fooled by pid reuse.  The entry
+// contains a token made from a generation and the index, readers record this token in
+// their slot and writers in the chunks they loan.  If a process disappears without
+// cleaning up, any other process eventually notices and releases whatever was held by
+// the dead process.  Every claim of a reader slot starts a new generation of the slot,
+// and entries in its queue carry the generation for which they were delivered, so that
+// a delivery to a dead reader that arrives late is never mistaken for one to the next
+// reader using the slot.
+// Creating and removing the segment are protected by an advisory file lock.  If a
+// segment is found without any live process attached to it, it is reinitialized
+// because a crash in the middle of a queue operation could have left it in an
+// inconsistent state.
+
+#define _GNU_SOURCE // F_OFD_SETLK
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/md5.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/io.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/strtol.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsc/dds_loaned_sample.h"
+#include "dds/ddsc/dds_psmx.h"
+
+#include "psmx_shm_impl.h"
+
+#define ERROR_PREFIX "=== [SHM] "
+
+#define SHM_MAGIC 0x48534443u // "CDSH"
+#define SHM_MAGIC_UNLINKED 0x44454144u // "DEAD": segment is being removed, reopen
+#define SHM_VERSION 3u
+
+#define SHM_MAX_READERS 31u
+#define SHM_WRITER_HOLD (1u << 31)
+#define SHM_QUEUE_DEPTH 128u
+#define SHM_MAX_ATTACH 64u
+// An attach token is (generation << SHM_TOKEN_IDX_BITS) | (attach index + 1), 0 is none
+#define SHM_TOKEN_IDX_BITS 7u
+#define SHM_TOKEN_IDX_MASK ((1u << SHM_TOKEN_IDX_BITS) - 1)
+#define SHM_IDENTITY_SIZE 256u
+#define SHM_CACHELINE 64u
+
+#define SHM_DEFAULT_CHUNK_SIZE 16384u
+#define SHM_DEFAULT_CHUNK_COUNT 256u
+#define SHM_MAX_CHUNK_COUNT 65536u
+// Only the owner has access to the segments unless configured otherwise
+#define SHM_DEFAULT_SEGMENT_MODE 0600u
+
+// How long a reader (or a writer waiting for space) waits on a futex before checking for
+// termination and dead peers
+#define SHM_READER_POLL_INTERVAL DDS_MSECS (100)
+// Number of poll intervals between scans for dead peers
+#define SHM_RECLAIM_POLLS 10
+// Bound on the time spent waiting for writers to finish delivering to a closing slot
+#define SHM_CLOSE_MAX_WAIT DDS_SECS (1)
+
+enum shm_slot_state {
+  SLOT_FREE,
+  SLOT_CLAIMED,
+  SLOT_ACTIVE,
+  SLOT_CLOSING,
+  SLOT_RECLAIMING // owner died, being cleaned up by another process
+};
+
+struct shm_cell {
+  ddsrt_atomic_uint32_t seq;
+  uint32_t value;
+};
+
+// Bounded MPMC queue (Vyukov) of chunk indices, the cells follow elsewhere in the segment
+struct shm_ring {
+  ddsrt_atomic_uint32_t enq_pos;
+  char pad0[SHM_CACHELINE - sizeof (ddsrt_atomic_uint32_t)];
+  ddsrt_atomic_uint32_t deq_pos;
+  char pad1[SHM_CACHELINE - sizeof (ddsrt_atomic_uint32_t)];
+};
+
+// Queue entries are (slot generation << SHM_ENTRY_GEN_SHIFT) | chunk index, which fits
+// because there are at most SHM_MAX_CHUNK_COUNT chunks
+#define SHM_ENTRY_GEN_SHIFT 16u
+#define SHM_ENTRY_IDX_MASK ((1u << SHM_ENTRY_GEN_SHIFT) - 1)
+
+struct shm_reader_slot {
+  ddsrt_atomic_uint32_t state;    // enum shm_slot_state
+  ddsrt_atomic_uint32_t owner;    // attach token of owner process
+  ddsrt_atomic_uint32_t gen;      // incremented on every claim, low 16 bits are used
+  ddsrt_atomic_uint32_t inflight; // number of writers currently delivering to this slot
+  uint32_t block_producer;        // writers wait for space rather than dropping the oldest
+  ddsrt_atomic_uint32_t futex;    // incremented for every chunk enqueued
+  ddsrt_atomic_uint32_t waiting;  // reader may be blocked on futex
+  ddsrt_atomic_uint32_t space;    // incremented for every chunk dequeued while writers wait
+  ddsrt_atomic_uint32_t nspacewait; // number of writers that may be blocked on space
+  char pad[SHM_CACHELINE - 9 * sizeof (uint32_t)];
+  struct shm_ring ring;
+  struct shm_cell cells[SHM_QUEUE_DEPTH];
+};
+
+struct shm_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t chunk_count;
+  uint32_t chunk_size;   // max payload size
+  uint32_t chunk_stride;
+  uint32_t free_mask;    // free queue capacity - 1
+  uint64_t free_cells_off;
+  uint64_t chunks_off;
+  uint64_t size;
+  char identity[SHM_IDENTITY_SIZE];
+  ddsrt_atomic_uint32_t attach_gen;
+  ddsrt_atomic_uint32_t attach[SHM_MAX_ATTACH]; // tokens of attached processes, one entry per mapping
+  struct shm_ring freelist;
+  struct shm_reader_slot readers[SHM_MAX_READERS];
+};
+
+#if ! DDSRT_HAVE_ATOMIC64
+#error "shared memory PSMX requires 64-bit atomic operations"
+#endif
+
+struct shm_chunk {
+  ddsrt_atomic_uint32_t holders; // bit i: reader slot i, SHM_WRITER_HOLD: loaned by writer
+  ddsrt_atomic_uint64_t writer;  // generation << 32 | attach token of the writer that last loaned it
+  ddsrt_atomic_uint32_t hold_gen[SHM_MAX_READERS]; // slot generation the hold of slot i is for
+  dds_psmx_metadata_t metadata;
+};
+
+#define SHM_CHUNK_HDR_SIZE ((sizeof (struct shm_chunk) + SHM_CACHELINE - 1) & ~(size_t) (SHM_CACHELINE - 1))
+
+struct shm_segment {
+  struct shm_segment *next;
+  char *name;
+  uint32_t refc; // protected by psmx lock
+  int fd;
+  uint32_t attach_idx;
+  uint32_t token; // attach token of this process
+  size_t size;
+  struct shm_header *hdr;
+#if DDSRT_HAVE_ATOMIC_LIFO
+  ddsrt_atomic_lifo_t loan_cache; // released struct shm_loaned_sample, for reuse
+#endif
+};
+
+struct shm_psmx {
+  struct dds_psmx c;
+  char *service_name;
+  dds_psmx_node_identifier_t node_id;
+  bool support_keyed_topics;
+  uint32_t chunk_size;
+  uint32_t chunk_count;
+  uint32_t segment_mode;
+  ddsrt_mutex_t lock;
+  struct shm_segment *segments;
+};
+
+struct shm_psmx_endpoint {
+  struct dds_psmx_endpoint c;
+  struct shm_segment *seg;
+  uint32_t slot; // readers only
+  uint32_t gen; // generation of the slot, readers only
+  dds_entity_t cdds_endpoint;
+  ddsrt_atomic_uint32_t terminate;
+  bool have_thread;
+  ddsrt_thread_t tid;
+};
+
+struct shm_loaned_sample {
+  struct dds_loaned_sample c;
+  struct shm_segment *seg;
+  uint32_t chunk;
+  uint32_t hold; // the holder bit owned by this loan
+  struct shm_loaned_sample *next; // link in segment's loan cache
+};
+
+static bool shm_type_qos_supported (struct dds_psmx *psmx, dds_psmx_endpoint_type_t forwhat, dds_data_type_properties_t data_type_props, const struct dds_qos *qos);
+static struct dds_psmx_topic *shm_create_topic (struct dds_psmx *psmx, const char *topic_name, const char *type_name, dds_data_type_properties_t data_type_props);
+static dds_return_t shm_delete_topic (struct dds_psmx_topic *psmx_topic);
+static dds_return_t shm_psmx_deinit (struct dds_psmx *psmx);
+static dds_psmx_node_identifier_t shm_psmx_get_node_id (const struct dds_psmx *psmx);
+static dds_psmx_features_t shm_supported_features (const struct dds_psmx *psmx);
+
+static const dds_psmx_ops_t psmx_ops = {
+  .type_qos_supported = shm_type_qos_supported,
+  .create_topic = shm_create_topic,
+  .delete_topic = shm_delete_topic,
+  .deinit = shm_psmx_deinit,
+  .get_node_id = shm_psmx_get_node_id,
+  .supported_features = shm_supported_features
+};
+
+static struct dds_psmx_endpoint *shm_create_endpoint (struct dds_psmx_topic *psmx_topic, const struct dds_qos *qos, dds_psmx_endpoint_type_t endpoint_type);
+static dds_return_t shm_delete_endpoint (struct dds_psmx_endpoint *psmx_endpoint);
+
+static const dds_psmx_topic_ops_t psmx_topic_ops = {
+  .create_endpoint = shm_create_endpoint,
+  .delete_endpoint = shm_delete_endpoint
+};
+
+static dds_loaned_sample_t *shm_req_loan (struct dds_psmx_endpoint *psmx_endpoint, uint32_t size_requested);
+static dds_return_t shm_write (struct dds_psmx_endpoint *psmx_endpoint, dds_loaned_sample_t *data);
+static dds_loaned_sample_t *shm_take (struct dds_psmx_endpoint *psmx_endpoint);
+static dds_return_t shm_on_data_available (struct dds_psmx_endpoint *psmx_endpoint, dds_entity_t reader);
+
+static const dds_psmx_endpoint_ops_t psmx_ep_ops = {
+  .request_loan = shm_req_loan,
+  .write = shm_write,
+  .take = shm_take,
+  .on_data_available = shm_on_data_available
+};
+
+static void shm_loaned_sample_free (dds_loaned_sample_t *loan);
+
+static const dds_loaned_sample_ops_t ls_ops = {
+  .free = shm_loaned_sample_free
+};
+
+/* Primitives */
+
+static int attach_lock_op (int fd, int cmd, uint32_t idx, struct flock *fl)
+{
+  memset (fl, 0, sizeof (*fl));
+  fl->l_type = F_WRLCK;
+  fl->l_whence = SEEK_SET;
+  fl->l_start = (off_t) idx;
+  fl->l_len = 1;
+  return fcntl (fd, cmd, fl);
+}
+
+static bool attach_try_lock (int fd, uint32_t idx)
+{
+  struct flock fl;
+  return attach_lock_op (fd, F_OFD_SETLK, idx, &fl) == 0;
+}
+
+static bool attach_locked (const struct shm_segment *seg, uint32_t idx)
+{
+  // locks held through our own open file description never conflict
+  if (idx == seg->attach_idx)
+    return true;
+  struct flock fl;
+  if (attach_lock_op (seg->fd, F_OFD_GETLK, idx, &fl) < 0)
+    return true; // can't tell, so better not reclaim anything
+  return fl.l_type != F_UNLCK;
+}
+
+static bool token_registered (const struct shm_header *hdr, uint32_t token)
+{
+  const uint32_t idx = (token & SHM_TOKEN_IDX_MASK) - 1;
+  return token != 0 && idx < SHM_MAX_ATTACH && ddsrt_atomic_ld32 (&hdr->attach[idx]) == token;
+}
+
+static bool token_alive (const struct shm_segment *seg, uint32_t token)
+{
+  return token_registered (seg->hdr, token) && attach_locked (seg, (token & SHM_TOKEN_IDX_MASK) - 1);
+}
+
+static void futex_wait (ddsrt_atomic_uint32_t *addr, uint32_t val, dds_duration_t timeout)
+{
+  const struct timespec ts = { .tv_sec = (time_t) (timeout / DDS_NSECS_IN_SEC), .tv_nsec = (long) (timeout % DDS_NSECS_IN_SEC) };
+  // not FUTEX_PRIVATE_FLAG: the futex lives in memory shared between processes
+  (void) syscall (SYS_futex, &addr->v, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake (ddsrt_atomic_uint32_t *addr)
+{
+  (void) syscall (SYS_futex, &addr->v, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void ring_init (struct shm_ring *ring, struct shm_cell *cells, uint32_t capacity, uint32_t nfilled)
+{
+  for (uint32_t i = 0; i < capacity; i++)
+  {
+    cells[i].value = i;
+    ddsrt_atomic_st32 (&cells[i].seq, (i < nfilled) ? i + 1 : i);
+  }
+  ddsrt_atomic_st32 (&ring->enq_pos, nfilled);
+  ddsrt_atomic_st32 (&ring->deq_pos, 0);
+}
+
+static bool ring_enqueue (struct shm_ring *ring, struct shm_cell *cells, uint32_t mask, uint32_t value)
+{
+  uint32_t pos = ddsrt_atomic_ld32 (&ring->enq_pos);
+  struct shm_cell *cell;
+  while (true)
+  {
+    cell = &cells[pos & mask];
+    const uint32_t seq = ddsrt_atomic_ld32 (&cell->seq);
+    ddsrt_atomic_fence_acq ();
+    const int32_t dif = (int32_t) (seq - pos);
+    if (dif == 0)
+    {
+      if (ddsrt_atomic_cas32 (&ring->enq_pos, pos, pos + 1))
+        break;
+      pos = ddsrt_atomic_ld32 (&ring->enq_pos);
+    }
+    else if (dif < 0)
+      return false;
+    else
+      pos = ddsrt_atomic_ld32 (&ring->enq_pos);
+  }
+  cell->value = value;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&cell->seq, pos + 1);
+  return true;
+}
+
+static bool ring_dequeue (struct shm_ring *ring, struct shm_cell *cells, uint32_t mask, uint32_t *value)
+{
+  uint32_t pos = ddsrt_atomic_ld32 (&ring->deq_pos);
+  struct shm_cell *cell;
+  while (true)
+  {
+    cell = &cells[pos & mask];
+    const uint32_t seq = ddsrt_atomic_ld32 (&cell->seq);
+    ddsrt_atomic_fence_acq ();
+    const int32_t dif = (int32_t) (seq - (pos + 1));
+    if (dif == 0)
+    {
+      if (ddsrt_atomic_cas32 (&ring->deq_pos, pos, pos + 1))
+        break;
+      pos = ddsrt_atomic_ld32 (&ring->deq_pos);
+    }
+    else if (dif < 0)
+      return false;
+    else
+      pos = ddsrt_atomic_ld32 (&ring->deq_pos);
+  }
+  *value = cell->value;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&cell->seq, pos + mask + 1);
+  return true;
+}
+
+static bool ring_nonempty (struct shm_ring *ring, struct shm_cell *cells, uint32_t mask)
+{
+  const uint32_t pos = ddsrt_atomic_ld32 (&ring->deq_pos);
+  return (int32_t) (ddsrt_atomic_ld32 (&cells[pos & mask].seq) - (pos + 1)) >= 0;
+}
+
+/* Chunks */
+
+static struct shm_cell *free_cells (const struct shm_segment *seg)
+{
+  return (struct shm_cell *) ((char *) seg->hdr + seg->hdr->free_cells_off);
+}
+
+static struct shm_chunk *get_chunk (const struct shm_segment *seg, uint32_t idx)
+{
+  assert (idx < seg->hdr->chunk_count);
+  return (struct shm_chunk *) ((char *) seg->hdr + seg->hdr->chunks_off + (size_t) idx * seg->hdr->chunk_stride);
+}
+
+static void *chunk_payload (struct shm_chunk *chunk)
+{
+  return (char *) chunk + SHM_CHUNK_HDR_SIZE;
+}
+
+static void chunk_release (const struct shm_segment *seg, uint32_t idx, uint32_t hold)
+{
+  struct shm_chunk * const chunk = get_chunk (seg, idx);
+  const uint32_t ov = ddsrt_atomic_and32_ov (&chunk->holders, ~hold);
+  // only the one clearing the final bit returns it; a hold may already have been released
+  // by the dead peer clean-up
+  if ((ov & hold) && (ov & ~hold) == 0)
+  {
+    const bool ok = ring_enqueue (&seg->hdr->freelist, free_cells (seg), seg->hdr->free_mask, idx);
+    assert (ok);
+    (void) ok;
+  }
+}
+
+static bool chunk_alloc (const struct shm_segment *seg, uint32_t *idx)
+{
+  if (!ring_dequeue (&seg->hdr->freelist, free_cells (seg), seg->hdr->free_mask, idx))
+    return false;
+  struct shm_chunk * const chunk = get_chunk (seg, *idx);
+  // a new generation for every loan, so that the writer hold of a dead process can be
+  // taken over with a CAS without any risk of taking over a later loan of the chunk
+  const uint64_t gen = (ddsrt_atomic_ld64 (&chunk->writer) >> 32) + 1;
+  ddsrt_atomic_st64 (&chunk->writer, (gen << 32) | seg->token);
+  memset (&chunk->metadata, 0, sizeof (chunk->metadata));
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&chunk->holders, SHM_WRITER_HOLD);
+  return true;
+}
+
+/* Reader slots */
+
+static void hold_set (const struct shm_segment *seg, uint32_t idx, uint32_t slot_idx, uint32_t gen)
+{
+  // the writer holds the chunk while delivering, so no one else touches this hold
+  struct shm_chunk * const chunk = get_chunk (seg, idx);
+  ddsrt_atomic_st32 (&chunk->hold_gen[slot_idx], gen);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_or32 (&chunk->holders, 1u << slot_idx);
+}
+
+static void entry_release (const struct shm_segment *seg, uint32_t slot_idx, uint32_t entry)
+{
+  // If the hold was released when a dead reader was cleaned up, the chunk may since have
+  // been delivered to a later reader in the slot: then the generation no longer matches
+  // and the hold is not ours to release
+  const uint32_t idx = entry & SHM_ENTRY_IDX_MASK;
+  if (ddsrt_atomic_ld32 (&get_chunk (seg, idx)->hold_gen[slot_idx]) == (entry >> SHM_ENTRY_GEN_SHIFT))
+    chunk_release (seg, idx, 1u << slot_idx);
+}
+
+static void slot_drain (const struct shm_segment *seg, uint32_t slot_idx)
+{
+  struct shm_reader_slot * const slot = &seg->hdr->readers[slot_idx];
+  uint32_t entry;
+  while (ring_dequeue (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1, &entry))
+    entry_release (seg, slot_idx, entry);
+}
+
+static void slot_notify_space (struct shm_reader_slot *slot)
+{
+  ddsrt_atomic_inc32 (&slot->space);
+  futex_wake (&slot->space);
+}
+
+static void slot_close (const struct shm_segment *seg, uint32_t slot_idx, bool owner_dead)
+{
+  struct shm_reader_slot * const slot = &seg->hdr->readers[slot_idx];
+  assert (ddsrt_atomic_ld32 (&slot->state) == (owner_dead ? SLOT_RECLAIMING : SLOT_CLOSING));
+  ddsrt_atomic_fence ();
+  // writers waiting for space check the state when woken up
+  slot_notify_space (slot);
+  // Writers check the state after incrementing "inflight" and wake us when they leave a
+  // closing slot, so once it drops to 0 no one will push anything into the queue
+  // anymore.  A writer crashing while delivering would leave it stuck, hence the upper
+  // bound: anything that still arrives carries the generation of this reader and is
+  // discarded by whoever dequeues it.
+  const dds_time_t tend = dds_time () + SHM_CLOSE_MAX_WAIT;
+  uint32_t n;
+  dds_time_t tnow;
+  while ((n = ddsrt_atomic_ld32 (&slot->inflight)) > 0 && (tnow = dds_time ()) < tend)
+    futex_wait (&slot->inflight, n, tend - tnow);
+  slot_drain (seg, slot_idx);
+  if (owner_dead)
+  {
+    // a dead reader may have held any number of chunks, but holds of an earlier reader
+    // in this slot are released by whoever dequeues the late delivery that set it
+    const uint32_t hold = 1u << slot_idx, gen = ddsrt_atomic_ld32 (&slot->gen);
+    for (uint32_t i = 0; i < seg->hdr->chunk_count; i++)
+    {
+      struct shm_chunk * const chunk = get_chunk (seg, i);
+      if (!(ddsrt_atomic_ld32 (&chunk->holders) & hold))
+        continue;
+      ddsrt_atomic_fence_acq ();
+      if (ddsrt_atomic_ld32 (&chunk->hold_gen[slot_idx]) == gen)
+        chunk_release (seg, i, hold);
+    }
+  }
+  ddsrt_atomic_st32 (&slot->owner, 0);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&slot->state, SLOT_FREE);
+}
+
+static void reclaim_dead_peers (const struct shm_segment *seg)
+{
+  struct shm_header * const hdr = seg->hdr;
+  // A process holds the lock before it registers its token and unregisters it before it
+  // releases the lock, so an unlocked entry with a token belongs to a dead process.
+  // Having removed those, a token that is still registered is one of a live process
+  // (or one that died just now, which will be noticed next time).
+  for (uint32_t i = 0; i < SHM_MAX_ATTACH; i++)
+  {
+    const uint32_t token = ddsrt_atomic_ld32 (&hdr->attach[i]);
+    if (token != 0 && !attach_locked (seg, i))
+      (void) ddsrt_atomic_cas32 (&hdr->attach[i], token, 0);
+  }
+  for (uint32_t i = 0; i < SHM_MAX_READERS; i++)
+  {
+    struct shm_reader_slot * const slot = &hdr->readers[i];
+    const uint32_t state = ddsrt_atomic_ld32 (&slot->state);
+    const uint32_t owner = ddsrt_atomic_ld32 (&slot->owner);
+    // owner == 0 for a claimed slot means it is still being initialized
+    if (state == SLOT_FREE || state == SLOT_RECLAIMING || owner == 0 || token_registered (hdr, owner))
+      continue;
+    if (ddsrt_atomic_cas32 (&slot->state, state, SLOT_RECLAIMING))
+      slot_close (seg, i, true);
+  }
+  for (uint32_t i = 0; i < hdr->chunk_count; i++)
+  {
+    struct shm_chunk * const chunk = get_chunk (seg, i);
+    // the writer word is set before the hold, so a hold seen after reading it is the
+    // one of that loan or of a later one; in the latter case the CAS fails
+    const uint64_t writer = ddsrt_atomic_ld64 (&chunk->writer);
+    ddsrt_atomic_fence_acq ();
+    const uint32_t owner = (uint32_t) writer;
+    if (owner == 0 || !(ddsrt_atomic_ld32 (&chunk->holders) & SHM_WRITER_HOLD) || token_registered (hdr, owner))
+      continue;
+    // only one of the processes that concurrently find the dead writer gets to release it
+    if (ddsrt_atomic_cas64 (&chunk->writer, writer, writer & ~(uint64_t) UINT32_MAX))
+      chunk_release (seg, i, SHM_WRITER_HOLD);
+  }
+}
+
+static bool slot_claim (const struct shm_segment *seg, bool block_producer, uint32_t *slot_idx, uint32_t *gen)
+{
+  struct shm_header * const hdr = seg->hdr;
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    for (uint32_t i = 0; i < SHM_MAX_READERS; i++)
+    {
+      struct shm_reader_slot * const slot = &hdr->readers[i];
+      if (ddsrt_atomic_ld32 (&slot->state) != SLOT_FREE || !ddsrt_atomic_cas32 (&slot->state, SLOT_FREE, SLOT_CLAIMED))
+        continue;
+      slot->block_producer = block_producer;
+      *gen = (ddsrt_atomic_ld32 (&slot->gen) + 1) & SHM_ENTRY_IDX_MASK;
+      ddsrt_atomic_st32 (&slot->gen, *gen);
+      ddsrt_atomic_st32 (&slot->waiting, 0);
+      ddsrt_atomic_st32 (&slot->owner, seg->token);
+      // anything still in the queue arrived after the previous owner closed it
+      slot_drain (seg, i);
+      ddsrt_atomic_fence_rel ();
+      ddsrt_atomic_st32 (&slot->state, SLOT_ACTIVE);
+      *slot_idx = i;
+      return true;
+    }
+    reclaim_dead_peers (seg);
+  }
+  return false;
+}
+
+static void slot_release (const struct shm_segment *seg, uint32_t slot_idx)
+{
+  struct shm_reader_slot * const slot = &seg->hdr->readers[slot_idx];
+  ddsrt_atomic_st32 (&slot->state, SLOT_CLOSING);
+  slot_close (seg, slot_idx, false);
+}
+
+static void slot_notify (struct shm_reader_slot *slot)
+{
+  ddsrt_atomic_inc32 (&slot->futex);
+  if (ddsrt_atomic_ld32 (&slot->waiting))
+    futex_wake (&slot->futex);
+}
+
+static bool slot_wait_for_space (const struct shm_segment *seg, struct shm_reader_slot *slot, uint32_t gen, uint32_t entry)
+{
+  // The reader only wakes writers waiting for space if it sees "nspacewait" set, the
+  // fences make sure it does if the queue was still full when we looked
+  bool enqueued = false;
+  ddsrt_atomic_inc32 (&slot->nspacewait);
+  while (!enqueued)
+  {
+    ddsrt_atomic_fence ();
+    const uint32_t seq = ddsrt_atomic_ld32 (&slot->space);
+    if (ddsrt_atomic_ld32 (&slot->state) != SLOT_ACTIVE || ddsrt_atomic_ld32 (&slot->gen) != gen ||
+        !token_alive (seg, ddsrt_atomic_ld32 (&slot->owner)))
+      break;
+    if (!(enqueued = ring_enqueue (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1, entry)))
+    {
+      slot_notify (slot);
+      futex_wait (&slot->space, seq, SHM_READER_POLL_INTERVAL);
+    }
+  }
+  ddsrt_atomic_dec32 (&slot->nspacewait);
+  return enqueued;
+}
+
+static void slot_deliver (const struct shm_segment *seg, uint32_t slot_idx, uint32_t gen, uint32_t idx)
+{
+  struct shm_reader_slot * const slot = &seg->hdr->readers[slot_idx];
+  const uint32_t entry = (gen << SHM_ENTRY_GEN_SHIFT) | idx;
+  hold_set (seg, idx, slot_idx, gen);
+  while (!ring_enqueue (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1, entry))
+  {
+    if (slot->block_producer)
+    {
+      // reliable/keep-all reader: wait for it to catch up, unless it goes away
+      if (!slot_wait_for_space (seg, slot, gen, entry))
+      {
+        chunk_release (seg, idx, 1u << slot_idx);
+        return;
+      }
+      break;
+    }
+    uint32_t oldest;
+    if (ring_dequeue (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1, &oldest))
+      entry_release (seg, slot_idx, oldest);
+  }
+  slot_notify (slot);
+}
+
+/* Segments */
+
+static size_t segment_size (uint32_t chunk_count, uint32_t chunk_size, uint32_t *free_capacity, uint32_t *chunk_stride, size_t *free_cells_off, size_t *chunks_off)
+{
+  uint32_t cap = 1;
+  while (cap < chunk_count)
+    cap <<= 1;
+  *free_capacity = cap;
+  *chunk_stride = (uint32_t) ((SHM_CHUNK_HDR_SIZE + chunk_size + SHM_CACHELINE - 1) & ~(size_t) (SHM_CACHELINE - 1));
+  *free_cells_off = (sizeof (struct shm_header) + SHM_CACHELINE - 1) & ~(size_t) (SHM_CACHELINE - 1);
+  *chunks_off = (*free_cells_off + cap * sizeof (struct shm_cell) + SHM_CACHELINE - 1) & ~(size_t) (SHM_CACHELINE - 1);
+  return *chunks_off + (size_t) chunk_count * *chunk_stride;
+}
+
+static void segment_init (struct shm_header *hdr, const char *identity, uint32_t chunk_count, uint32_t chunk_size)
+{
+  uint32_t free_capacity, chunk_stride;
+  size_t free_cells_off, chunks_off;
+  const size_t size = segment_size (chunk_count, chunk_size, &free_capacity, &chunk_stride, &free_cells_off, &chunks_off);
+  memset (hdr, 0, sizeof (*hdr));
+  hdr->version = SHM_VERSION;
+  hdr->chunk_count = chunk_count;
+  hdr->chunk_size = chunk_size;
+  hdr->chunk_stride = chunk_stride;
+  hdr->free_mask = free_capacity - 1;
+  hdr->free_cells_off = free_cells_off;
+  hdr->chunks_off = chunks_off;
+  hdr->size = size;
+  (void) ddsrt_strlcpy (hdr->identity, identity, sizeof (hdr->identity));
+  ring_init (&hdr->freelist, (struct shm_cell *) ((char *) hdr + free_cells_off), free_capacity, chunk_count);
+  for (uint32_t i = 0; i < SHM_MAX_READERS; i++)
+    ring_init (&hdr->readers[i].ring, hdr->readers[i].cells, SHM_QUEUE_DEPTH, 0);
+  for (uint32_t i = 0; i < chunk_count; i++)
+  {
+    struct shm_chunk * const chunk = (struct shm_chunk *) ((char *) hdr + chunks_off + (size_t) i * chunk_stride);
+    memset (chunk, 0, SHM_CHUNK_HDR_SIZE);
+  }
+  ddsrt_atomic_fence ();
+  hdr->magic = SHM_MAGIC;
+}
+
+static bool segment_has_live_attachments (const struct shm_segment *seg)
+{
+  for (uint32_t i = 0; i < SHM_MAX_ATTACH; i++)
+    if (ddsrt_atomic_ld32 (&seg->hdr->attach[i]) != 0 && attach_locked (seg, i))
+      return true;
+  return false;
+}
+
+static struct shm_segment *segment_attach (const struct shm_psmx *psmx, const char *name, const char *identity)
+{
+  struct shm_segment *seg = ddsrt_malloc (sizeof (*seg));
+  seg->next = NULL;
+  seg->name = ddsrt_strdup (name);
+  seg->refc = 1;
+  seg->attach_idx = SHM_MAX_ATTACH;
+  seg->token = 0;
+  seg->hdr = NULL;
+#if DDSRT_HAVE_ATOMIC_LIFO
+  ddsrt_atomic_lifo_init (&seg->loan_cache);
+#endif
+
+retry:
+  if ((seg->fd = shm_open (name, O_RDWR | O_CREAT | O_CLOEXEC, (mode_t) psmx->segment_mode)) < 0)
+  {
+    fprintf (stderr, ERROR_PREFIX "shm_open %s failed: %s\n", name, strerror (errno));
+    goto err_open;
+  }
+  if (flock (seg->fd, LOCK_EX) < 0)
+    goto err_lock;
+
+  struct stat st;
+  if (fstat (seg->fd, &st) < 0)
+    goto err_locked;
+  if ((size_t) st.st_size >= sizeof (struct shm_header))
+  {
+    seg->size = (size_t) st.st_size;
+    if ((seg->hdr = mmap (NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0)) == MAP_FAILED)
+      goto err_locked;
+    if (seg->hdr->magic == SHM_MAGIC_UNLINKED)
+    {
+      // lost the race with the last process detaching from it
+      (void) munmap (seg->hdr, seg->size);
+      (void) close (seg->fd);
+      goto retry;
+    }
+    const bool valid = (seg->hdr->magic == SHM_MAGIC && seg->hdr->version == SHM_VERSION && seg->hdr->size == seg->size);
+    if (segment_has_live_attachments (seg))
+    {
+      // initialization is done while holding the lock, so it can only be invalid if
+      // something else is using the same name
+      if (!valid || strncmp (seg->hdr->identity, identity, sizeof (seg->hdr->identity) - 1) != 0)
+      {
+        fprintf (stderr, ERROR_PREFIX "segment %s is in use for something else\n", name);
+        goto err_mapped;
+      }
+      reclaim_dead_peers (seg);
+    }
+    else
+    {
+      // left behind by processes that have all gone: start afresh
+      (void) munmap (seg->hdr, seg->size);
+      seg->hdr = NULL;
+    }
+  }
+  if (seg->hdr == NULL)
+  {
+    uint32_t free_capacity, chunk_stride;
+    size_t free_cells_off, chunks_off;
+    seg->size = segment_size (psmx->chunk_count, psmx->chunk_size, &free_capacity, &chunk_stride, &free_cells_off, &chunks_off);
+    if (ftruncate (seg->fd, 0) < 0 || ftruncate (seg->fd, (off_t) seg->size) < 0)
+    {
+      fprintf (stderr, ERROR_PREFIX "could not size segment %s: %s\n", name, strerror (errno));
+      goto err_locked;
+    }
+    // shm_open applies the umask, and a stale segment may have a different mode
+    (void) fchmod (seg->fd, (mode_t) psmx->segment_mode);
+    if ((seg->hdr = mmap (NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0)) == MAP_FAILED)
+      goto err_locked;
+    segment_init (seg->hdr, identity, psmx->chunk_count, psmx->chunk_size);
+  }
+
+  // Getting the lock makes the entry ours, any token still in it is of a dead process
+  // and is simply overwritten.  Closing the file releases the lock.
+  for (seg->attach_idx = 0; seg->attach_idx < SHM_MAX_ATTACH; seg->attach_idx++)
+    if (attach_try_lock (seg->fd, seg->attach_idx))
+      break;
+  if (seg->attach_idx == SHM_MAX_ATTACH)
+  {
+    fprintf (stderr, ERROR_PREFIX "too many processes attached to segment %s\n", name);
+    goto err_mapped;
+  }
+  const uint32_t gen = ddsrt_atomic_inc32_nv (&seg->hdr->attach_gen);
+  seg->token = (gen << SHM_TOKEN_IDX_BITS) | (seg->attach_idx + 1);
+  ddsrt_atomic_st32 (&seg->hdr->attach[seg->attach_idx], seg->token);
+  (void) flock (seg->fd, LOCK_UN);
+  return seg;
+
+err_mapped:
+  (void) munmap (seg->hdr, seg->size);
+err_locked:
+  (void) flock (seg->fd, LOCK_UN);
+err_lock:
+  (void) close (seg->fd);
+err_open:
+  ddsrt_free (seg->name);
+  ddsrt_free (seg);
+  return NULL;
+}
+
+static void segment_detach (struct shm_segment *seg)
+{
+  (void) flock (seg->fd, LOCK_EX);
+  ddsrt_atomic_st32 (&seg->hdr->attach[seg->attach_idx], 0);
+  reclaim_dead_peers (seg);
+  if (!segment_has_live_attachments (seg))
+  {
+    // anyone who opened it before the unlink will see the marker once it gets the lock
+    seg->hdr->magic = SHM_MAGIC_UNLINKED;
+    (void) shm_unlink (seg->name);
+  }
+  (void) flock (seg->fd, LOCK_UN);
+  (void) munmap (seg->hdr, seg->size);
+  (void) close (seg->fd);
+#if DDSRT_HAVE_ATOMIC_LIFO
+  struct shm_loaned_sample *ls;
+  while ((ls = ddsrt_atomic_lifo_pop (&seg->loan_cache, offsetof (struct shm_loaned_sample, next))) != NULL)
+    dds_free (ls);
+#endif
+  ddsrt_free (seg->name);
+  ddsrt_free (seg);
+}
+
+static struct shm_segment *segment_ref (struct shm_psmx *psmx, const char *identity)
+{
+  char name[64];
+  const size_t len = strlen (identity);
+  (void) snprintf (name, sizeof (name), "/cdds_psmx_%08"PRIx32"%08"PRIx32, ddsrt_mh3 (identity, len, 0), ddsrt_mh3 (identity, len, 0x9e3779b9));
+  struct shm_segment *seg;
+  ddsrt_mutex_lock (&psmx->lock);
+  for (seg = psmx->segments; seg; seg = seg->next)
+    if (strcmp (seg->name, name) == 0)
+      break;
+  if (seg)
+    seg->refc++;
+  else if ((seg = segment_attach (psmx, name, identity)) != NULL)
+  {
+    seg->next = psmx->segments;
+    psmx->segments = seg;
+  }
+  ddsrt_mutex_unlock (&psmx->lock);
+  return seg;
+}
+
+static void segment_unref (struct shm_psmx *psmx, struct shm_segment *seg)
+{
+  ddsrt_mutex_lock (&psmx->lock);
+  if (--seg->refc == 0)
+  {
+    struct shm_segment **pseg = &psmx->segments;
+    while (*pseg != seg)
+      pseg = &(*pseg)->next;
+    *pseg = seg->next;
+    segment_detach (seg);
+  }
+  ddsrt_mutex_unlock (&psmx->lock);
+}
+
+/* dds_psmx_ops_t implementation */
+
+static bool is_wildcard_partition (const char *str)
+{
+  return strchr (str, '*') || strchr (str, '?');
+}
+
+static bool shm_type_qos_supported (struct dds_psmx *psmx, dds_psmx_endpoint_type_t forwhat, dds_data_type_properties_t data_type_props, const struct dds_qos *qos)
+{
+  const struct shm_psmx *shm_psmx = (const struct shm_psmx *) psmx;
+  if ((data_type_props & DDS_DATA_TYPE_CONTAINS_KEY) && !shm_psmx->support_keyed_topics)
+    return false;
+  // Everything else is really dependent on the endpoint QoS, not the topic QoS
+  if (forwhat == DDS_PSMX_ENDPOINT_TYPE_UNSET)
+    return true;
+
+  // There is no history in the segment, so late-joining readers can't be served
+  dds_durability_kind_t d_kind = DDS_DURABILITY_VOLATILE;
+  if (dds_qget_durability (qos, &d_kind) && d_kind != DDS_DURABILITY_VOLATILE)
+    return false;
+
+  uint32_t n_partitions;
+  char **partitions;
+  if (dds_qget_partition (qos, &n_partitions, &partitions))
+  {
+    bool supported = n_partitions == 0 || (n_partitions == 1 && !is_wildcard_partition (partitions[0]));
+    for (uint32_t n = 0; n < n_partitions; n++)
+      dds_free (partitions[n]);
+    if (n_partitions > 0)
+      dds_free (partitions);
+    if (!supported)
+      return false;
+  }
+
+  dds_ignorelocal_kind_t ignore_local;
+  if (dds_qget_ignorelocal (qos, &ignore_local) && ignore_local != DDS_IGNORELOCAL_NONE)
+    return false;
+  dds_liveliness_kind_t liveliness_kind;
+  if (dds_qget_liveliness (qos, &liveliness_kind, NULL) && liveliness_kind != DDS_LIVELINESS_AUTOMATIC)
+    return false;
+  dds_duration_t deadline_duration;
+  if (dds_qget_deadline (qos, &deadline_duration) && deadline_duration != DDS_INFINITY)
+    return false;
+  return true;
+}
+
+static struct dds_psmx_topic *shm_create_topic (struct dds_psmx *psmx, const char *topic_name, const char *type_name, dds_data_type_properties_t data_type_props)
+{
+  struct dds_psmx_topic *psmx_topic = dds_alloc (sizeof (*psmx_topic));
+  if (psmx_topic == NULL)
+    return NULL;
+  dds_psmx_topic_init_generic (psmx_topic, &psmx_topic_ops, psmx, topic_name, type_name, data_type_props);
+  if (dds_add_psmx_topic_to_list (psmx_topic, &psmx->psmx_topics) != DDS_RETCODE_OK)
+  {
+    (void) dds_psmx_topic_cleanup_generic (psmx_topic);
+    dds_free (psmx_topic);
+    return NULL;
+  }
+  return psmx_topic;
+}
+
+static dds_return_t shm_delete_topic (struct dds_psmx_topic *psmx_topic)
+{
+  dds_return_t ret = dds_psmx_topic_cleanup_generic (psmx_topic);
+  dds_free (psmx_topic);
+  return ret;
+}
+
+static dds_return_t shm_psmx_deinit (struct dds_psmx *psmx)
+{
+  struct shm_psmx *shm_psmx = (struct shm_psmx *) psmx;
+  dds_return_t ret = dds_psmx_cleanup_generic (&shm_psmx->c);
+  assert (shm_psmx->segments == NULL);
+  ddsrt_mutex_destroy (&shm_psmx->lock);
+  ddsrt_free (shm_psmx->service_name);
+  dds_free (shm_psmx);
+  return ret;
+}
+
+static dds_psmx_node_identifier_t shm_psmx_get_node_id (const struct dds_psmx *psmx)
+{
+  return ((const struct shm_psmx *) psmx)->node_id;
+}
+
+static dds_psmx_features_t shm_supported_features (const struct dds_psmx *psmx)
+{
+  (void) psmx;
+  return DDS_PSMX_FEATURE_SHARED_MEMORY | DDS_PSMX_FEATURE_ZERO_COPY;
+}
+
+/* dds_psmx_topic_ops_t implementation */
+
+static char *get_identity (const struct shm_psmx *psmx, const struct dds_psmx_topic *psmx_topic, const char *partition)
+{
+  assert (!is_wildcard_partition (partition));
+  // escape dots and backslashes in the partition so that "partition.topic" is unambiguous
+  size_t size = strlen (partition) + 1;
+  for (char const *src = partition; *src; src++)
+    if (*src == '\\' || *src == '.')
+      size++;
+  char *escaped = ddsrt_malloc (size), *dst = escaped;
+  for (char const *src = partition; *src; src++)
+  {
+    if (*src == '\\' || *src == '.')
+      *dst++ = '\\';
+    *dst++ = *src;
+  }
+  *dst = 0;
+  char *identity;
+  (void) ddsrt_asprintf (&identity, "%s|%s|%s.%s", psmx->service_name, psmx_topic->type_name, escaped, psmx_topic->topic_name);
+  ddsrt_free (escaped);
+  return identity;
+}
+
+static bool reader_blocks_producer (const struct dds_psmx_topic *psmx_topic, const struct dds_qos *qos)
+{
+  // keyed topics: the queue may contain samples of multiple instances, so dropping the
+  // oldest is not equivalent to keep-last on the reader
+  if (psmx_topic->data_type_props & DDS_DATA_TYPE_CONTAINS_KEY)
+    return true;
+  dds_history_kind_t h_kind = DDS_HISTORY_KEEP_LAST;
+  int32_t h_depth = 1;
+  (void) dds_qget_history (qos, &h_kind, &h_depth);
+  return h_kind != DDS_HISTORY_KEEP_LAST || (uint32_t) h_depth > SHM_QUEUE_DEPTH;
+}
+
+static struct dds_psmx_endpoint *shm_create_endpoint (struct dds_psmx_topic *psmx_topic, const struct dds_qos *qos, dds_psmx_endpoint_type_t endpoint_type)
+{
+  struct shm_psmx * const psmx = (struct shm_psmx *) psmx_topic->psmx_instance;
+  if (endpoint_type != DDS_PSMX_ENDPOINT_TYPE_READER && endpoint_type != DDS_PSMX_ENDPOINT_TYPE_WRITER)
+    return NULL;
+
+  uint32_t n_partitions = 0;
+  char **partitions = NULL;
+  (void) dds_qget_partition (qos, &n_partitions, &partitions);
+  assert (n_partitions == 0 || n_partitions == 1);
+  char *identity = get_identity (psmx, psmx_topic, (n_partitions == 0) ? "" : partitions[0]);
+  if (n_partitions > 0)
+  {
+    dds_free (partitions[0]);
+    dds_free (partitions);
+  }
+
+  struct shm_psmx_endpoint *ep = dds_alloc (sizeof (*ep));
+  memset (ep, 0, sizeof (*ep));
+  ep->c.ops = psmx_ep_ops;
+  ep->c.psmx_topic = psmx_topic;
+  ep->c.endpoint_type = endpoint_type;
+  ddsrt_atomic_st32 (&ep->terminate, 0);
+  ep->seg = segment_ref (psmx, identity);
+  ddsrt_free (identity);
+  if (ep->seg == NULL)
+    goto err_segment;
+  if (endpoint_type == DDS_PSMX_ENDPOINT_TYPE_READER && !slot_claim (ep->seg, reader_blocks_producer (psmx_topic, qos), &ep->slot, &ep->gen))
+  {
+    fprintf (stderr, ERROR_PREFIX "no reader slot available in segment %s\n", ep->seg->name);
+    goto err_slot;
+  }
+  if (dds_add_psmx_endpoint_to_list (&ep->c, &psmx_topic->psmx_endpoints) != DDS_RETCODE_OK)
+    goto err_list;
+  return &ep->c;
+
+err_list:
+  if (endpoint_type == DDS_PSMX_ENDPOINT_TYPE_READER)
+    slot_release (ep->seg, ep->slot);
+err_slot:
+  segment_unref (psmx, ep->seg);
+err_segment:
+  dds_free (ep);
+  return NULL;
+}
+
+static dds_return_t shm_delete_endpoint (struct dds_psmx_endpoint *psmx_endpoint)
+{
+  struct shm_psmx_endpoint * const ep = (struct shm_psmx_endpoint *) psmx_endpoint;
+  struct shm_psmx * const psmx = (struct shm_psmx *) ep->c.psmx_topic->psmx_instance;
+  if (ep->c.endpoint_type == DDS_PSMX_ENDPOINT_TYPE_READER)
+  {
+    if (ep->have_thread)
+    {
+      struct shm_reader_slot * const slot = &ep->seg->hdr->readers[ep->slot];
+      ddsrt_atomic_st32 (&ep->terminate, 1);
+      ddsrt_atomic_inc32 (&slot->futex);
+      futex_wake (&slot->futex);
+      (void) ddsrt_thread_join (ep->tid, NULL);
+    }
+    slot_release (ep->seg, ep->slot);
+  }
+  segment_unref (psmx, ep->seg);
+  dds_free (ep);
+  return DDS_RETCODE_OK;
+}
+
+/* dds_psmx_endpoint_ops_t implementation */
+
+static dds_loaned_sample_t *make_loan (struct shm_psmx_endpoint *ep, uint32_t idx, uint32_t hold)
+{
+  struct shm_chunk * const chunk = get_chunk (ep->seg, idx);
+  struct shm_loaned_sample *ls;
+#if DDSRT_HAVE_ATOMIC_LIFO
+  if ((ls = ddsrt_atomic_lifo_pop (&ep->seg->loan_cache, offsetof (struct shm_loaned_sample, next))) == NULL)
+#endif
+    ls = dds_alloc (sizeof (*ls));
+  ls->c.ops = ls_ops;
+  ls->c.loan_origin.origin_kind = DDS_LOAN_ORIGIN_KIND_PSMX;
+  ls->c.loan_origin.psmx_endpoint = &ep->c;
+  ls->c.metadata = &chunk->metadata;
+  ls->c.sample_ptr = chunk_payload (chunk);
+  ddsrt_atomic_st32 (&ls->c.refc, 1);
+  ls->seg = ep->seg;
+  ls->chunk = idx;
+  ls->hold = hold;
+  return &ls->c;
+}
+
+static dds_loaned_sample_t *shm_req_loan (struct dds_psmx_endpoint *psmx_endpoint, uint32_t size_requested)
+{
+  struct shm_psmx_endpoint * const ep = (struct shm_psmx_endpoint *) psmx_endpoint;
+  if (psmx_endpoint->endpoint_type != DDS_PSMX_ENDPOINT_TYPE_WRITER)
+    return NULL;
+  if (size_requested > ep->seg->hdr->chunk_size)
+    return NULL;
+  uint32_t idx;
+  if (!chunk_alloc (ep->seg, &idx))
+  {
+    // chunks may be held by processes that have died
+    reclaim_dead_peers (ep->seg);
+    if (!chunk_alloc (ep->seg, &idx))
+      return NULL;
+  }
+  return make_loan (ep, idx, SHM_WRITER_HOLD);
+}
+
+static dds_return_t shm_write (struct dds_psmx_endpoint *psmx_endpoint, dds_loaned_sample_t *data)
+{
+  assert (psmx_endpoint->endpoint_type == DDS_PSMX_ENDPOINT_TYPE_WRITER);
+  (void) psmx_endpoint;
+  const struct shm_loaned_sample * const ls = (const struct shm_loaned_sample *) data;
+  const struct shm_segment * const seg = ls->seg;
+  assert (ls->hold == SHM_WRITER_HOLD);
+  for (uint32_t i = 0; i < SHM_MAX_READERS; i++)
+  {
+    struct shm_reader_slot * const slot = &seg->hdr->readers[i];
+    if (ddsrt_atomic_ld32 (&slot->state) != SLOT_ACTIVE)
+      continue;
+    ddsrt_atomic_inc32 (&slot->inflight);
+    ddsrt_atomic_fence ();
+    if (ddsrt_atomic_ld32 (&slot->state) == SLOT_ACTIVE)
+    {
+      ddsrt_atomic_fence_acq ();
+      slot_deliver (seg, i, ddsrt_atomic_ld32 (&slot->gen), ls->chunk);
+    }
+    if (ddsrt_atomic_dec32_nv (&slot->inflight) == 0)
+    {
+      // the one closing the slot waits for the last writer to leave
+      ddsrt_atomic_fence ();
+      if (ddsrt_atomic_ld32 (&slot->state) != SLOT_ACTIVE)
+        futex_wake (&slot->inflight);
+    }
+  }
+  // The writer's hold is released when the loan is freed
+  return DDS_RETCODE_OK;
+}
+
+static dds_loaned_sample_t *shm_take (struct dds_psmx_endpoint *psmx_endpoint)
+{
+  struct shm_psmx_endpoint * const ep = (struct shm_psmx_endpoint *) psmx_endpoint;
+  assert (psmx_endpoint->endpoint_type == DDS_PSMX_ENDPOINT_TYPE_READER);
+  struct shm_reader_slot * const slot = &ep->seg->hdr->readers[ep->slot];
+  uint32_t entry;
+  while (ring_dequeue (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1, &entry))
+  {
+    ddsrt_atomic_fence ();
+    if (ddsrt_atomic_ld32 (&slot->nspacewait))
+      slot_notify_space (slot);
+    if ((entry >> SHM_ENTRY_GEN_SHIFT) == ep->gen)
+      return make_loan (ep, entry & SHM_ENTRY_IDX_MASK, 1u << ep->slot);
+    // a late delivery to a previous reader in this slot
+    entry_release (ep->seg, ep->slot, entry);
+  }
+  return NULL;
+}
+
+static uint32_t reader_thread (void *varg)
+{
+  struct shm_psmx_endpoint * const ep = varg;
+  struct shm_reader_slot * const slot = &ep->seg->hdr->readers[ep->slot];
+  int polls = 0;
+  while (!ddsrt_atomic_ld32 (&ep->terminate))
+  {
+    dds_loaned_sample_t *data;
+    while ((data = shm_take (&ep->c)) != NULL)
+    {
+      (void) dds_reader_store_loaned_sample (ep->cdds_endpoint, data);
+      dds_loaned_sample_unref (data);
+    }
+
+    ddsrt_atomic_st32 (&slot->waiting, 1);
+    ddsrt_atomic_fence ();
+    const uint32_t seq = ddsrt_atomic_ld32 (&slot->futex);
+    if (!ring_nonempty (&slot->ring, slot->cells, SHM_QUEUE_DEPTH - 1) && !ddsrt_atomic_ld32 (&ep->terminate))
+    {
+      futex_wait (&slot->futex, seq, SHM_READER_POLL_INTERVAL);
+      if (ddsrt_atomic_ld32 (&slot->futex) == seq && ++polls == SHM_RECLAIM_POLLS)
+      {
+        polls = 0;
+        reclaim_dead_peers (ep->seg);
+      }
+    }
+    ddsrt_atomic_st32 (&slot->waiting, 0);
+  }
+  return 0;
+}
+
+static dds_return_t shm_on_data_available (struct dds_psmx_endpoint *psmx_endpoint, dds_entity_t reader)
+{
+  struct shm_psmx_endpoint * const ep = (struct shm_psmx_endpoint *) psmx_endpoint;
+  assert (ep->c.endpoint_type == DDS_PSMX_ENDPOINT_TYPE_READER && !ep->have_thread);
+  ep->cdds_endpoint = reader;
+  ddsrt_threadattr_t tattr;
+  ddsrt_threadattr_init (&tattr);
+  if (ddsrt_thread_create (&ep->tid, "psmx_shm_rd", &tattr, reader_thread, ep) != DDS_RETCODE_OK)
+    return DDS_RETCODE_ERROR;
+  ep->have_thread = true;
+  return DDS_RETCODE_OK;
+}
+
+/* dds_loaned_sample_ops_t implementation */
+
+static void shm_loaned_sample_free (dds_loaned_sample_t *loan)
+{
+  struct shm_loaned_sample * const ls = (struct shm_loaned_sample *) loan;
+  struct shm_segment * const seg = ls->seg;
+  chunk_release (seg, ls->chunk, ls->hold);
+#if DDSRT_HAVE_ATOMIC_LIFO
+  // the number of these is bounded by the number of chunks and holders, caching them
+  // all avoids a malloc/free pair for every sample in the steady state
+  ddsrt_atomic_lifo_push (&seg->loan_cache, ls, offsetof (struct shm_loaned_sample, next));
+#else
+  dds_free (ls);
+#endif
+}
+
+/* Construction */
+
+static char *get_config_option_value (const char *conf, const char *option_name)
+{
+  char *copy = ddsrt_strdup (conf), *cursor = copy, *tok;
+  while ((tok = ddsrt_strsep (&cursor, ";")) != NULL)
+  {
+    if (strlen (tok) == 0)
+      continue;
+    char *name = ddsrt_strsep (&tok, "=");
+    if (name == NULL || tok == NULL)
+      break;
+    if (strcmp (name, option_name) == 0)
+    {
+      char *ret = ddsrt_strdup (tok);
+      ddsrt_free (copy);
+      return ret;
+    }
+  }
+  ddsrt_free (copy);
+  return NULL;
+}
+
+static bool to_node_identifier (const char *str, dds_psmx_node_identifier_t *id)
+{
+  if (strlen (str) != 2 * sizeof (id->x))
+    return false;
+  for (uint32_t n = 0; n < 2 * sizeof (id->x); n++)
+  {
+    int32_t num;
+    if ((num = ddsrt_todigit (str[n])) < 0 || num >= 16)
+      return false;
+    if ((n % 2) == 0)
+      id->x[n / 2] = (uint8_t) (num << 4);
+    else
+      id->x[n / 2] |= (uint8_t) num;
+  }
+  return true;
+}
+
+static bool get_machine_id (dds_psmx_node_identifier_t *id)
+{
+  // Shared memory is shared by all processes on the host, so the machine id (or
+  // failing that, the boot id) is exactly what we need
+  static const char *files[] = { "/etc/machine-id", "/var/lib/dbus/machine-id", "/proc/sys/kernel/random/boot_id" };
+  for (size_t i = 0; i < sizeof (files) / sizeof (files[0]); i++)
+  {
+    FILE *fp;
+    char buf[64];
+    size_t n;
+    if ((fp = fopen (files[i], "r")) == NULL)
+      continue;
+    n = fread (buf, 1, sizeof (buf), fp);
+    (void) fclose (fp);
+    if (n == 0)
+      continue;
+    ddsrt_md5_state_t md5st;
+    ddsrt_md5_init (&md5st);
+    ddsrt_md5_append (&md5st, (const ddsrt_md5_byte_t *) buf, (unsigned) n);
+    ddsrt_md5_finish (&md5st, (ddsrt_md5_byte_t *) id->x);
+    return true;
+  }
+  return false;
+}
+
+static bool get_uint32_option (const char *config, const char *option_name, int base, uint32_t min, uint32_t max, uint32_t *value)
+{
+  char *str = get_config_option_value (config, option_name);
+  if (str == NULL)
+    return true;
+  unsigned long long v;
+  char *endp;
+  bool ok = (ddsrt_strtoull (str, &endp, base, &v) == DDS_RETCODE_OK && *endp == 0 && v >= min && v <= max);
+  if (ok)
+    *value = (uint32_t) v;
+  else
+    fprintf (stderr, ERROR_PREFIX "invalid value for %s\n", option_name);
+  ddsrt_free (str);
+  return ok;
+}
+
+dds_return_t shm_create_psmx (struct dds_psmx **psmx_out, dds_psmx_instance_id_t instance_id, const char *config)
+{
+  assert (psmx_out);
+  struct shm_psmx *psmx = dds_alloc (sizeof (*psmx));
+  memset (psmx, 0, sizeof (*psmx));
+  psmx->c.ops = psmx_ops;
+  psmx->c.instance_name = dds_string_dup ("CycloneDDS-SHM-PSMX");
+  psmx->c.instance_id = instance_id;
+  psmx->chunk_size = SHM_DEFAULT_CHUNK_SIZE;
+  psmx->chunk_count = SHM_DEFAULT_CHUNK_COUNT;
+  psmx->segment_mode = SHM_DEFAULT_SEGMENT_MODE;
+
+  if ((psmx->service_name = get_config_option_value (config, "SERVICE_NAME")) == NULL)
+    (void) ddsrt_asprintf (&psmx->service_name, "CycloneDDS shm_psmx %"PRIu32, instance_id);
+
+  char *str;
+  if ((str = get_config_option_value (config, "LOCATOR")) != NULL)
+  {
+    const bool ok = to_node_identifier (str, &psmx->node_id);
+    ddsrt_free (str);
+    if (!ok)
+      goto err_config;
+  }
+  else if (!get_machine_id (&psmx->node_id))
+  {
+    fprintf (stderr, ERROR_PREFIX "could not determine machine id, set LOCATOR\n");
+    goto err_config;
+  }
+
+  if ((str = get_config_option_value (config, "KEYED_TOPICS")) != NULL)
+  {
+    const bool ok = (strcmp (str, "true") == 0 || strcmp (str, "false") == 0);
+    psmx->support_keyed_topics = (strcmp (str, "true") == 0);
+    ddsrt_free (str);
+    if (!ok)
+      goto err_config;
+  }
+
+  if (!get_uint32_option (config, "CHUNK_SIZE", 10, 1, INT32_MAX / 2, &psmx->chunk_size) ||
+      !get_uint32_option (config, "CHUNK_COUNT", 10, 1, SHM_MAX_CHUNK_COUNT, &psmx->chunk_count) ||
+      !get_uint32_option (config, "SEGMENT_MODE", 8, 0, 0777, &psmx->segment_mode))
+    goto err_config;
+  if ((psmx->segment_mode & 0600) != 0600)
+  {
+    fprintf (stderr, ERROR_PREFIX "SEGMENT_MODE must give the owner read and write access\n");
+    goto err_config;
+  }
+
+  ddsrt_mutex_init (&psmx->lock);
+  if (dds_psmx_init_generic (&psmx->c) != DDS_RETCODE_OK)
+  {
+    ddsrt_mutex_destroy (&psmx->lock);
+    goto err_config;
+  }
+  *psmx_out = &psmx->c;
+  return DDS_RETCODE_OK;
+
+err_config:
+  dds_free ((void *) psmx->c.instance_name);
+  ddsrt_free (psmx->service_name);
+  dds_free (psmx);
+  return DDS_RETCODE_ERROR;
+}
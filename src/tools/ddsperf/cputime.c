@@ -25,6 +25,7 @@
 #include "dds/ddsrt/misc.h"
 
 #include "cputime.h"
+#include "report.h"
 #include "ddsperf_types.h"
 
 static void print_one (char *line, size_t sz, size_t *pos, const char *name, double du, double ds)
@@ -33,8 +34,32 @@ static void print_one (char *line, size_t sz, size_t *pos, const char *name, dou
     *pos += (size_t) snprintf (line + *pos, sz - *pos, " %s:%.0f%%+%.0f%%", name, 100.0 * du, 100.0 * ds);
 }
 
-bool print_cputime (const struct CPUStats *s, const char *prefix, bool print_host, bool is_fresh)
+static void report_cputime (const struct CPUStats *s, bool print_host, struct report *rep)
 {
+  char peer[128], name[48];
+  if (!print_host)
+    peer[0] = 0;
+  else
+    (void) snprintf (peer, sizeof (peer), "%s:%"PRIu32, s->hostname, s->pid);
+  report_begin (rep, "cpu", peer);
+  report_double (rep, "rss", s->maxrss);
+  report_uint64 (rep, "vcsw", s->vcsw);
+  report_uint64 (rep, "ivcsw", s->ivcsw);
+  for (uint32_t i = 0; i < s->cpu._length; i++)
+  {
+    struct CPUStatThread * const thr = &s->cpu._buffer[i];
+    (void) snprintf (name, sizeof (name), "usr.%s", thr->name);
+    report_double (rep, name, (double) thr->u_pct);
+    (void) snprintf (name, sizeof (name), "sys.%s", thr->name);
+    report_double (rep, name, (double) thr->s_pct);
+  }
+  report_end (rep);
+}
+
+bool print_cputime (const struct CPUStats *s, const char *prefix, bool print_host, bool is_fresh, struct report *rep)
+{
+  if (is_fresh)
+    report_cputime (s, print_host, rep);
   if (!s->some_above)
     return false;
   else
@@ -113,7 +138,7 @@ static bool above_threshold (double *max, double *du_skip, double *ds_skip, doub
   }
 }
 
-bool record_cputime (struct record_cputime_state *state, const char *prefix, dds_time_t tnow)
+bool record_cputime (struct record_cputime_state *state, const char *prefix, dds_time_t tnow, struct report *rep)
 {
   if (state == NULL)
     return false;
@@ -180,7 +205,7 @@ bool record_cputime (struct record_cputime_state *state, const char *prefix, dds
   state->tprev = tnow;
   state->s.some_above = some_above;
   (void) dds_write (state->wr, &state->s);
-  return print_cputime (&state->s, prefix, false, true);
+  return print_cputime (&state->s, prefix, false, true, rep);
 }
 
 double record_cputime_read_rss (const struct record_cputime_state *state)
@@ -259,11 +284,12 @@ void record_cputime_free (struct record_cputime_state *state)
 
 #else
 
-bool record_cputime (struct record_cputime_state *state, const char *prefix, dds_time_t tnow)
+bool record_cputime (struct record_cputime_state *state, const char *prefix, dds_time_t tnow, struct report *rep)
 {
   (void) state;
   (void) prefix;
   (void) tnow;
+  (void) rep;
   return false;
 }
 
@@ -37,9 +37,11 @@
 #include "dds/ddsrt/fibheap.h"
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hdrhist.h"
 
 #include "cputime.h"
 #include "netload.h"
+#include "report.h"
 
 #if !defined(_WIN32) && !defined(LWIP_SOCKET)
 #include <errno.h>
@@ -48,7 +50,9 @@
 #define UDATA_MAGIC "DDSPerf:"
 #define UDATA_MAGIC_SIZE (sizeof (UDATA_MAGIC) - 1)
 
-#define PINGPONG_RAWSIZE 20000
+/* Latency histograms: 1.6% resolution, separate buckets up to ~18 minutes */
+#define LATENCY_SUB_BUCKET_BITS 6
+#define LATENCY_VALUE_BITS 40
 
 enum topicsel {
   KS,    /* KeyedSeq type: seq#, key, sequence-of-octet */
@@ -85,10 +89,15 @@ static dds_entity_t rd_participants, rd_subscriptions, rd_publications;
 
 /* Topics, readers, writers (except for pong writers: there are
    many of those) */
-static dds_entity_t tp_data, tp_ping, tp_pong, tp_stat;
+static dds_entity_t tp_ping, tp_pong, tp_stat;
 static char tpname_data[32], tpname_ping[32], tpname_pong[32];
 static dds_entity_t sub, pub, wr_data, wr_ping, wr_stat, rd_data, rd_ping, rd_pong, rd_stat;
 
+/* Data topics: the first one is always there and uses the standard name,
+   additional ones get a "_N" suffix (all of the same type) */
+static uint32_t ntp_data = 1;
+static dds_entity_t *tp_data;
+
 /* Number of different key values to use (must be 1 for OU type) */
 static unsigned nkeyvals = 1;
 
@@ -102,12 +111,16 @@ static enum submode pingpongmode = SM_LISTENER;
 /* Whether to show "sub" stats every second even when nothing happens */
 static bool substat_every_second = false;
 
-/* Whether to show extended statistics (currently just rexmit info) */
+/* Whether to show extended statistics (currently rexmit info and writer loan reuse) */
 static bool extended_stats = false;
 
 /* Size of the sequence in KeyedSeq type in bytes */
 static uint32_t baggagesize = 0;
 
+/* Number of times to create and delete a participant in "startup" mode, 0 if not in
+   that mode */
+static uint32_t startup_iters = 0;
+
 /* Whether or not to register instances prior to writing */
 static bool register_instances = true;
 
@@ -134,9 +147,6 @@ static uint32_t matchcount = 0;
    time (5s, currently) [protected by disc_lock] */
 static uint32_t matchtimeout = 0;
 
-/* Data is published in bursts of this many samples */
-static uint32_t burstsize = 1;
-
 /* Whether to use reliable or best-effort readers/writers */
 static bool reliable = true;
 
@@ -145,13 +155,33 @@ static bool reliable = true;
    always uses KEEP_LAST 1. */
 static int32_t histdepth = 0;
 
-/* Publishing rate in Hz, HUGE_VAL means as fast as possible,
-   0 means no throughput data is published at all */
-static double pub_rate;
+/* Each "pub" mode defines a group of writers that all publish with the
+   same parameters, each writer from its own thread:
+   - rate in Hz, HUGE_VAL means as fast as possible
+   - data is published in bursts of this many samples
+   - size of the sequence in KeyedSeq type in bytes, UINT32_MAX means
+     not specified and to use the value from the last size specification
+   - the fraction of throughput data samples that double as a ping message
+   - the fraction of samples that get unregistered immediately after being
+     written, so that the instances continually get created and deleted
+   - ntopics data topics with nwriters writers for each topic */
+struct pubspec {
+  double rate;
+  uint32_t burstsize;
+  uint32_t baggagesize;
+  uint32_t ping_frac;
+  uint32_t churn_frac;
+  bool loan;
+  uint32_t ntopics;
+  uint32_t nwriters;
+};
 
-/* Fraction of throughput data samples that double as a ping
-   message */
-static uint32_t ping_frac = 0;
+static uint32_t npubspecs = 0;
+static struct pubspec *pubspecs;
+
+/* Number of data topics and number of readers per topic in "sub" mode */
+static uint32_t sub_ntopics = 1;
+static uint32_t sub_nreaders = 1;
 
 /* Setting for "ignore local" reader/writer QoS: whether or
    not to ignore readers and writers in the same particiapnt
@@ -188,9 +218,12 @@ static uint64_t min_roundtrips = 0;
 /* Whether to gather/show latency information in "sub" mode */
 static bool sublatency = false;
 
-/* Use writer loans (only for memcpy-able types) */
+/* Use writer loans (only for memcpy-able types), set if any "pub" uses them */
 static bool use_writer_loan = false;
 
+/* Machine-readable output, null if not requested */
+static struct report *report;
+
 /* Event queue for processing discovery events (data available on
    DCPSParticipant, subscription & publication matched)
    asynchronously to avoid deadlocking on creating a reader from
@@ -214,11 +247,8 @@ static ddsrt_mutex_t pubstat_lock;
 static struct hist *pubstat_hist;
 
 struct latencystat {
-  int64_t min, max;
-  int64_t sum;
-  uint32_t cnt;
+  struct ddsrt_hdrhist *hist;
   uint64_t totcnt;
-  int64_t *raw;
 };
 
 /* Subscriber statistics for tracking number of samples received
@@ -253,7 +283,10 @@ struct eseq_admin {
   uint32_t **eseq;
 };
 
-static struct eseq_admin eseq_admin;
+/* One for each data reader: multiple readers receive the same samples and
+   must track sequence numbers independently */
+static uint32_t nrd_data = 1;
+static struct eseq_admin *eseq_admin;
 
 /* Entry for mapping ping/data publication handle to pong writer */
 struct subthread_arg_pongwr {
@@ -303,6 +336,7 @@ static struct subthread_arg_pongwr *pongwr;
    set of samples (it does use a loan, but that loan gets reused) */
 struct subthread_arg {
   dds_entity_t rd;
+  struct eseq_admin *eseq_admin; /* null for ping/pong */
   uint32_t max_samples;
   dds_sample_info_t *iseq;
   void **mseq;
@@ -543,6 +577,22 @@ static void xsnprintf(char *buf, size_t bufsz, size_t *p, const char *fmt, ...)
   }
 }
 
+static void hist_report (struct hist *h, dds_time_t dt)
+{
+  uint64_t cnt = h->under + h->over;
+  for (unsigned i = 0; i < h->nbins; i++)
+    cnt += h->bins[i];
+  report_begin (report, "pub", NULL);
+  report_uint64 (report, "cnt", cnt);
+  report_double (report, "rate", (double) cnt / ((double) dt / 1e9));
+  if (cnt > 0)
+  {
+    report_uint64 (report, "min_ns", h->min);
+    report_uint64 (report, "max_ns", h->max);
+  }
+  report_end (report);
+}
+
 static void hist_print (const char *prefix, struct hist *h, dds_time_t dt, int reset)
 {
   const size_t l_size = sizeof(char) * h->nbins + 200 + strlen (prefix);
@@ -683,32 +733,44 @@ static size_t getkeyvaloff (void)
   return 0;
 }
 
-static void *init_sample (union data *data, uint32_t seq)
+static void *init_sample (union data *data, uint32_t seq, uint32_t bgsize)
 {
   void *baggage = NULL;
   memset (data, 0xee, sizeof (*data));
   if (topicsel == KS)
-    baggage = make_baggage (&data->ks.baggage, baggagesize);
+    baggage = make_baggage (&data->ks.baggage, bgsize);
   *((uint32_t *) ((char *) data + getseqoff ())) = seq;
   if (getkeyvaloff () != SIZE_MAX)
     *((uint32_t *) ((char *) data + getkeyvaloff ())) = 0;
   return baggage;
 }
 
+/* Publisher threads: one for each writer */
+struct pubthread_arg {
+  const struct pubspec *spec;
+  dds_entity_t wr;
+  ddsrt_thread_t tid;
+};
+
+static uint32_t npubthreads = 0;
+static struct pubthread_arg *pubthreads;
+
 static uint32_t pubthread (void *varg)
 {
+  const struct pubthread_arg * const arg = varg;
+  const struct pubspec * const spec = arg->spec;
+  const dds_entity_t wr_data = arg->wr;
   int result;
   dds_instance_handle_t *ihs;
   dds_time_t ntot = 0, tfirst;
   union data data;
   void *baggage = NULL;
-  (void) varg;
 
   memset (&data, 0, sizeof (data));
   assert (nkeyvals > 0);
   assert (topicsel != OU || nkeyvals == 1);
 
-  baggage = init_sample (&data, 0);
+  baggage = init_sample (&data, 0, spec->baggagesize);
   size_t seqoff = getseqoff ();
   size_t keyvaloff = getkeyvaloff ();
   ihs = malloc (nkeyvals * sizeof (dds_instance_handle_t));
@@ -743,9 +805,9 @@ static uint32_t pubthread (void *varg)
   while (!ddsrt_atomic_ld32 (&termflag))
   {
     /* lsb of timestamp is abused to signal whether the sample is a ping requiring a response or not */
-    bool reqresp = (ping_frac == 0) ? 0 : (ping_frac == UINT32_MAX) ? 1 : (ddsrt_random () <= ping_frac);
+    bool reqresp = (spec->ping_frac == 0) ? 0 : (spec->ping_frac == UINT32_MAX) ? 1 : (ddsrt_random () <= spec->ping_frac);
     void *dataptr;
-    if (!use_writer_loan)
+    if (!spec->loan)
       dataptr = &data;
     else if ((result = dds_request_loan (wr_data, &dataptr)) < 0)
     {
@@ -776,6 +838,16 @@ static uint32_t pubthread (void *varg)
     {
       dds_write_flush (wr_data);
     }
+    if (spec->churn_frac > 0 && (spec->churn_frac == UINT32_MAX || ddsrt_random () <= spec->churn_frac))
+    {
+      /* the key value is still in "data" even if a loan was used for writing */
+      if ((result = dds_unregister_instance (wr_data, &data)) != DDS_RETCODE_OK && result != DDS_RETCODE_TIMEOUT)
+      {
+        printf ("unregister error: %d\n", result);
+        fflush (stdout);
+        exit (2);
+      }
+    }
 
     const dds_time_t t_post_write = (time_counter == 1) ? dds_time () : t_write;
     const dds_duration_t dt = t_post_write - t_write;
@@ -807,12 +879,12 @@ static uint32_t pubthread (void *varg)
     }
 
     t_write = t_post_write;
-    if (pub_rate < HUGE_VAL)
+    if (spec->rate < HUGE_VAL)
     {
-      if (++batch_counter == burstsize)
+      if (++batch_counter == spec->burstsize)
       {
         /* FIXME: should average rate over a short-ish period, rather than over the entire run */
-        while (((double) (ntot / burstsize) / ((double) (t_write - tfirst) / 1e9 + 5e-3)) > pub_rate && !ddsrt_atomic_ld32 (&termflag))
+        while (((double) (ntot / spec->burstsize) / ((double) (t_write - tfirst) / 1e9 + 5e-3)) > spec->rate && !ddsrt_atomic_ld32 (&termflag))
         {
           /* FIXME: flushing manually because batching is not yet implemented properly */
           dds_write_flush (wr_data);
@@ -852,69 +924,111 @@ static uint32_t topic_payload_size (enum topicsel tp, uint32_t bgsize)
 
 static void latencystat_init (struct latencystat *x)
 {
-  x->min = INT64_MAX;
-  x->max = INT64_MIN;
-  x->sum = x->cnt = 0;
-  x->raw = malloc (PINGPONG_RAWSIZE * sizeof (*x->raw));
-  assert(x->raw);
+  x->hist = ddsrt_hdrhist_new (LATENCY_SUB_BUCKET_BITS, LATENCY_VALUE_BITS);
+  assert (x->hist);
+  x->totcnt = 0;
 }
 
 static void latencystat_fini (struct latencystat *x)
 {
-  free (x->raw);
+  ddsrt_hdrhist_free (x->hist);
 }
 
-static void latencystat_reset (struct latencystat *x, int64_t *newraw)
+static bool latencystat_print (struct ddsrt_hdrhist *snap, struct ddsrt_hdrhist *hist, const char *prefix, const char *subprefix, const char *repkind, dds_instance_handle_t pubhandle, dds_instance_handle_t pphandle, uint32_t size)
 {
-  x->raw = newraw;
-  x->min = INT64_MAX;
-  x->max = INT64_MIN;
-  x->sum = x->cnt = 0;
-}
+  /* moving the contents to the snapshot means recording can continue without losing values */
+  ddsrt_hdrhist_reset (snap);
+  (void) ddsrt_hdrhist_drain (snap, hist);
+  const uint64_t cnt = ddsrt_hdrhist_count (snap);
+  if (cnt == 0)
+    return false;
 
-static int cmp_int64 (const void *va, const void *vb)
-{
-  const int64_t *a = va;
-  const int64_t *b = vb;
-  return (*a == *b) ? 0 : (*a < *b) ? -1 : 1;
-}
+  char ppinfo[128];
+  struct ppant *pp;
+  ddsrt_mutex_lock (&disc_lock);
+  if ((pp = ddsrt_avl_lookup (&ppants_td, &ppants, &pphandle)) == NULL)
+    snprintf (ppinfo, sizeof (ppinfo), "%"PRIx64, pubhandle);
+  else
+    snprintf (ppinfo, sizeof (ppinfo), "%s:%"PRIu32, pp->hostname, pp->pid);
+  ddsrt_mutex_unlock (&disc_lock);
 
-static int64_t *latencystat_print (struct latencystat *y, const char *prefix, const char *subprefix, dds_instance_handle_t pubhandle, dds_instance_handle_t pphandle, uint32_t size)
-{
-  if (y->cnt > 0)
-  {
-    const uint32_t rawcnt = (y->cnt > PINGPONG_RAWSIZE) ? PINGPONG_RAWSIZE : y->cnt;
-    char ppinfo[128];
-    struct ppant *pp;
-    ddsrt_mutex_lock (&disc_lock);
-    if ((pp = ddsrt_avl_lookup (&ppants_td, &ppants, &pphandle)) == NULL)
-      snprintf (ppinfo, sizeof (ppinfo), "%"PRIx64, pubhandle);
-    else
-      snprintf (ppinfo, sizeof (ppinfo), "%s:%"PRIu32, pp->hostname, pp->pid);
-    ddsrt_mutex_unlock (&disc_lock);
+  const double mean = ddsrt_hdrhist_mean (snap) / 1e3;
+  const double min = (double) ddsrt_hdrhist_min (snap) / 1e3;
+  const double max = (double) ddsrt_hdrhist_max (snap) / 1e3;
+  const double p50 = (double) ddsrt_hdrhist_percentile (snap, 50.0) / 1e3;
+  const double p90 = (double) ddsrt_hdrhist_percentile (snap, 90.0) / 1e3;
+  const double p99 = (double) ddsrt_hdrhist_percentile (snap, 99.0) / 1e3;
+  const double p999 = (double) ddsrt_hdrhist_percentile (snap, 99.9) / 1e3;
+  printf ("%s%s %s size %"PRIu32" mean %.3fus min %.3fus 50%% %.3fus 90%% %.3fus 99%% %.3fus max %.3fus cnt %"PRIu64"\n",
+          prefix, subprefix, ppinfo, size, mean, min, p50, p90, p99, max, cnt);
+  report_begin (report, repkind, ppinfo);
+  report_uint64 (report, "size", size);
+  report_uint64 (report, "cnt", cnt);
+  report_double (report, "mean_us", mean);
+  report_double (report, "min_us", min);
+  report_double (report, "p50_us", p50);
+  report_double (report, "p90_us", p90);
+  report_double (report, "p99_us", p99);
+  report_double (report, "p999_us", p999);
+  report_double (report, "max_us", max);
+  report_end (report);
+  return true;
+}
 
-    qsort (y->raw, rawcnt, sizeof (*y->raw), cmp_int64);
-    printf ("%s%s %s size %"PRIu32" mean %.3fus min %.3fus 50%% %.3fus 90%% %.3fus 99%% %.3fus max %.3fus cnt %"PRIu32"\n",
-            prefix, subprefix, ppinfo, size,
-            (double) y->sum / (double) y->cnt / 1e3,
-            (double) y->min / 1e3,
-            (double) y->raw[rawcnt - (rawcnt + 1) / 2] / 1e3,
-            (double) y->raw[rawcnt - (rawcnt + 9) / 10] / 1e3,
-            (double) y->raw[rawcnt - (rawcnt + 99) / 100] / 1e3,
-            (double) y->max / 1e3,
-            y->cnt);
-  }
-  return y->raw;
+static void startup_print (struct ddsrt_hdrhist *hist, const char *what)
+{
+  const double mean = ddsrt_hdrhist_mean (hist) / 1e3;
+  const double min = (double) ddsrt_hdrhist_min (hist) / 1e3;
+  const double max = (double) ddsrt_hdrhist_max (hist) / 1e3;
+  const double p50 = (double) ddsrt_hdrhist_percentile (hist, 50.0) / 1e3;
+  const double p90 = (double) ddsrt_hdrhist_percentile (hist, 90.0) / 1e3;
+  const double p99 = (double) ddsrt_hdrhist_percentile (hist, 99.0) / 1e3;
+  const uint64_t cnt = ddsrt_hdrhist_count (hist);
+  printf ("[%"PRIdPID"] startup %s mean %.3fus min %.3fus 50%% %.3fus 90%% %.3fus 99%% %.3fus max %.3fus cnt %"PRIu64"\n",
+          ddsrt_getpid (), what, mean, min, p50, p90, p99, max, cnt);
+  char kind[32];
+  (void) snprintf (kind, sizeof (kind), "startup_%s", what);
+  report_begin (report, kind, NULL);
+  report_uint64 (report, "cnt", cnt);
+  report_double (report, "mean_us", mean);
+  report_double (report, "min_us", min);
+  report_double (report, "p50_us", p50);
+  report_double (report, "p90_us", p90);
+  report_double (report, "p99_us", p99);
+  report_double (report, "max_us", max);
+  report_end (report);
+}
+
+static void startup_benchmark (uint32_t n)
+{
+  /* Each iteration creates the first participant in the domain, and hence the domain
+     itself, and deletes it again, so this includes all of the domain initialisation */
+  struct ddsrt_hdrhist *create = ddsrt_hdrhist_new (LATENCY_SUB_BUCKET_BITS, LATENCY_VALUE_BITS);
+  struct ddsrt_hdrhist *delete = ddsrt_hdrhist_new (LATENCY_SUB_BUCKET_BITS, LATENCY_VALUE_BITS);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    const ddsrt_mtime_t t0 = ddsrt_time_monotonic ();
+    const dds_entity_t pp = dds_create_participant (did, NULL, NULL);
+    const ddsrt_mtime_t t1 = ddsrt_time_monotonic ();
+    if (pp < 0)
+      error2 ("dds_create_participant(domain %d) failed: %d\n", (int) did, (int) pp);
+    dds_return_t rc;
+    if ((rc = dds_delete (pp)) < 0)
+      error2 ("dds_delete(participant) failed: %d\n", (int) rc);
+    const ddsrt_mtime_t t2 = ddsrt_time_monotonic ();
+    ddsrt_hdrhist_record (create, (uint64_t) (t1.v - t0.v));
+    ddsrt_hdrhist_record (delete, (uint64_t) (t2.v - t1.v));
+  }
+  startup_print (create, "create");
+  startup_print (delete, "delete");
+  ddsrt_hdrhist_free (create);
+  ddsrt_hdrhist_free (delete);
 }
 
 static void latencystat_update (struct latencystat *x, int64_t tdelta)
 {
-  if (tdelta < x->min) x->min = tdelta;
-  if (tdelta > x->max) x->max = tdelta;
-  x->sum += tdelta;
-  if (x->cnt < PINGPONG_RAWSIZE)
-    x->raw[x->cnt] = tdelta;
-  x->cnt++;
+  /* one-way latencies can come out negative if the clocks are not well synchronised */
+  ddsrt_hdrhist_record (x->hist, (tdelta < 0) ? 0 : (uint64_t) tdelta);
   x->totcnt++;
 }
 
@@ -1145,7 +1259,7 @@ static bool process_data (dds_entity_t rd, struct subthread_arg *arg)
         case S4k:    { Struct4k *d    = mseq[i]; keyval = d->keyval; seq = d->seq; size = topic_payload_size (topicsel, 0); } break;
         case S32k:   { Struct32k *d   = mseq[i]; keyval = d->keyval; seq = d->seq; size = topic_payload_size (topicsel, 0); } break;
       }
-      (void) check_eseq (&eseq_admin, seq, keyval, size, iseq[i].publication_handle, tdelta);
+      (void) check_eseq (arg->eseq_admin, seq, keyval, size, iseq[i].publication_handle, tdelta);
       if (iseq[i].source_timestamp & 1)
       {
         dds_entity_t wr_pong;
@@ -1263,7 +1377,7 @@ static void maybe_send_new_ping (dds_time_t tnow, dds_time_t *tnextping)
       *tnextping = cur_ping_time + ping_intv;
     }
     cur_ping_seq++;
-    baggage = init_sample (&data, cur_ping_seq);
+    baggage = init_sample (&data, cur_ping_seq, baggagesize);
     ddsrt_mutex_unlock (&pongwr_lock);
     if ((rc = dds_write_ts (wr_ping, &data, dds_time () | 1)) < 0 && rc != DDS_RETCODE_TIMEOUT)
       error2 ("send_new_ping: dds_write (wr_ping, &data): %d\n", (int) rc);
@@ -1289,10 +1403,10 @@ static dds_entity_t make_reader_waitset (dds_entity_t rd)
 static uint32_t subthread_waitset (void *varg)
 {
   struct subthread_arg * const arg = varg;
-  dds_entity_t ws = make_reader_waitset (rd_data);
+  dds_entity_t ws = make_reader_waitset (arg->rd);
   while (!ddsrt_atomic_ld32 (&termflag))
   {
-    if (!process_data (rd_data, arg))
+    if (!process_data (arg->rd, arg))
     {
       /* when we use DATA_AVAILABLE, we must read until nothing remains, or we would deadlock
          if more than max_samples were available and nothing further is received */
@@ -1337,7 +1451,7 @@ static uint32_t subthread_polling (void *varg)
   struct subthread_arg * const arg = varg;
   while (!ddsrt_atomic_ld32 (&termflag))
   {
-    if (!process_data (rd_data, arg))
+    if (!process_data (arg->rd, arg))
       dds_sleepfor (DDS_MSECS (1));
   }
   return 0;
@@ -1659,6 +1773,8 @@ struct dds_stats {
   const struct dds_stat_keyvalue *time_throttle;
   const struct dds_stat_keyvalue *time_rexmit;
   const struct dds_stat_keyvalue *throttle_count;
+  const struct dds_stat_keyvalue *loan_allocs;
+  const struct dds_stat_keyvalue *loan_reuses;
   struct dds_statistics *substat;
   const struct dds_stat_keyvalue *discarded_bytes;
 };
@@ -1669,45 +1785,50 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
   const double ts = (double) (tnow - tref) / 1e9;
   bool output = false;
   snprintf (prefix, sizeof (prefix), "[%"PRIdPID"] %.3f ", ddsrt_getpid (), ts);
+  report_set_time (report, ts);
 
-  if (pub_rate > 0)
+  if (npubspecs > 0)
   {
     ddsrt_mutex_lock (&pubstat_lock);
+    hist_report (pubstat_hist, tnow - tprev);
     hist_print (prefix, pubstat_hist, tnow - tprev, 1);
     ddsrt_mutex_unlock (&pubstat_lock);
     output = true;
   }
 
-  int64_t *newraw = malloc (PINGPONG_RAWSIZE * sizeof (*newraw));
-  assert(newraw);
+  struct ddsrt_hdrhist *snap = ddsrt_hdrhist_new (LATENCY_SUB_BUCKET_BITS, LATENCY_VALUE_BITS);
+  assert (snap);
   if (submode != SM_NONE)
   {
-    struct eseq_admin * const ea = &eseq_admin;
     uint64_t tot_nrecv = 0, tot_nlost = 0, nlost = 0;
     uint64_t nrecv = 0, nrecv_bytes = 0;
     uint64_t nrecv10s = 0, nrecv10s_bytes = 0;
     uint32_t last_size = 0;
-    ddsrt_mutex_lock (&ea->lock);
-    for (uint32_t i = 0; i < ea->nph; i++)
+    for (uint32_t r = 0; r < nrd_data; r++)
     {
-      struct eseq_stat * const x = &ea->stats[i];
-      unsigned refidx1s = (x->refidx == 0) ? (unsigned) (sizeof (x->ref) / sizeof (x->ref[0]) - 1) : (x->refidx - 1);
-      unsigned refidx10s = x->refidx;
-      tot_nrecv += x->nrecv;
-      tot_nlost += x->nlost;
-      nrecv += x->nrecv - x->ref[refidx1s].nrecv;
-      nlost += x->nlost - x->ref[refidx1s].nlost;
-      nrecv_bytes += x->nrecv_bytes - x->ref[refidx1s].nrecv_bytes;
-      nrecv10s += x->nrecv - x->ref[refidx10s].nrecv;
-      nrecv10s_bytes += x->nrecv_bytes - x->ref[refidx10s].nrecv_bytes;
-      last_size = x->last_size;
-      x->ref[x->refidx].nrecv = x->nrecv;
-      x->ref[x->refidx].nlost = x->nlost;
-      x->ref[x->refidx].nrecv_bytes = x->nrecv_bytes;
-      if (++x->refidx == (unsigned) (sizeof (x->ref) / sizeof (x->ref[0])))
-        x->refidx = 0;
+      struct eseq_admin * const ea = &eseq_admin[r];
+      ddsrt_mutex_lock (&ea->lock);
+      for (uint32_t i = 0; i < ea->nph; i++)
+      {
+        struct eseq_stat * const x = &ea->stats[i];
+        unsigned refidx1s = (x->refidx == 0) ? (unsigned) (sizeof (x->ref) / sizeof (x->ref[0]) - 1) : (x->refidx - 1);
+        unsigned refidx10s = x->refidx;
+        tot_nrecv += x->nrecv;
+        tot_nlost += x->nlost;
+        nrecv += x->nrecv - x->ref[refidx1s].nrecv;
+        nlost += x->nlost - x->ref[refidx1s].nlost;
+        nrecv_bytes += x->nrecv_bytes - x->ref[refidx1s].nrecv_bytes;
+        nrecv10s += x->nrecv - x->ref[refidx10s].nrecv;
+        nrecv10s_bytes += x->nrecv_bytes - x->ref[refidx10s].nrecv_bytes;
+        last_size = x->last_size;
+        x->ref[x->refidx].nrecv = x->nrecv;
+        x->ref[x->refidx].nlost = x->nlost;
+        x->ref[x->refidx].nrecv_bytes = x->nrecv_bytes;
+        if (++x->refidx == (unsigned) (sizeof (x->ref) / sizeof (x->ref[0])))
+          x->refidx = 0;
+      }
+      ddsrt_mutex_unlock (&ea->lock);
     }
-    ddsrt_mutex_unlock (&ea->lock);
 
     if (nrecv > 0 || substat_every_second)
     {
@@ -1716,47 +1837,58 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
               prefix, last_size, tot_nrecv, tot_nlost, nrecv, nlost,
               (double) nrecv * 1e6 / dt, (double) nrecv_bytes * 8 * 1e3 / dt,
               (double) nrecv10s * 1e6 / (10 * dt), (double) nrecv10s_bytes * 8 * 1e3 / (10 * dt));
+      report_begin (report, "sub", NULL);
+      report_uint64 (report, "size", last_size);
+      report_uint64 (report, "total", tot_nrecv);
+      report_uint64 (report, "lost", tot_nlost);
+      report_uint64 (report, "delta", nrecv);
+      report_uint64 (report, "delta_lost", nlost);
+      report_double (report, "rate", (double) nrecv * 1e9 / dt);
+      report_double (report, "bps", (double) nrecv_bytes * 8 * 1e9 / dt);
+      report_end (report);
       output = true;
     }
 
     if (sublatency)
     {
-      ddsrt_mutex_lock (&ea->lock);
-      for (uint32_t i = 0; i < ea->nph; i++)
+      for (uint32_t r = 0; r < nrd_data; r++)
       {
-        struct eseq_stat * const x = &ea->stats[i];
-        struct latencystat y = x->info;
-        latencystat_reset (&x->info, newraw);
-        /* pongwr entries get added at the end, npongwr only grows: so can safely
-         unlock the stats in between nodes for calculating percentiles */
-        ddsrt_mutex_unlock (&ea->lock);
-        if (y.cnt > 0)
-          output = true;
-        newraw = latencystat_print (&y, prefix, " sublat", ea->ph[i], ea->pph[i], x->last_size);
+        struct eseq_admin * const ea = &eseq_admin[r];
         ddsrt_mutex_lock (&ea->lock);
+        for (uint32_t i = 0; i < ea->nph; i++)
+        {
+          struct ddsrt_hdrhist * const hist = ea->stats[i].info.hist;
+          const dds_instance_handle_t ph = ea->ph[i], pph = ea->pph[i];
+          const uint32_t last_size = ea->stats[i].last_size;
+          /* stats entries get added at the end, nph only grows and the histograms
+             themselves never move: so can safely unlock the stats in between nodes
+             for calculating percentiles */
+          ddsrt_mutex_unlock (&ea->lock);
+          if (latencystat_print (snap, hist, prefix, " sublat", "sublat", ph, pph, last_size))
+            output = true;
+          ddsrt_mutex_lock (&ea->lock);
+        }
+        ddsrt_mutex_unlock (&ea->lock);
       }
-      ddsrt_mutex_unlock (&ea->lock);
     }
   }
 
   ddsrt_mutex_lock (&pongstat_lock);
   for (uint32_t i = 0; i < npongstat; i++)
   {
-    struct subthread_arg_pongstat * const x = &pongstat[i];
-    struct subthread_arg_pongstat y = *x;
-    latencystat_reset (&x->info, newraw);
-    /* pongstat entries get added at the end, npongstat only grows: so can safely
-       unlock the stats in between nodes for calculating percentiles */
+    const struct subthread_arg_pongstat y = pongstat[i];
+    /* pongstat entries get added at the end, npongstat only grows and the histograms
+       themselves never move: so can safely unlock the stats in between nodes for
+       calculating percentiles */
     ddsrt_mutex_unlock (&pongstat_lock);
-    if (y.info.cnt > 0)
+    if (latencystat_print (snap, y.info.hist, prefix, "", "rtt", y.pubhandle, y.pphandle, topic_payload_size (topicsel, baggagesize)))
       output = true;
-    newraw = latencystat_print (&y.info, prefix, "", y.pubhandle, y.pphandle, topic_payload_size (topicsel, baggagesize));
     ddsrt_mutex_lock (&pongstat_lock);
   }
   ddsrt_mutex_unlock (&pongstat_lock);
-  free (newraw);
+  ddsrt_hdrhist_free (snap);
 
-  if (record_cputime (cputime_state, prefix, tnow))
+  if (record_cputime (cputime_state, prefix, tnow, report))
     output = true;
 
   if (rd_stat)
@@ -1774,7 +1906,7 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
     {
       for (int32_t i = 0; i < n; i++)
         if (si[i].valid_data && si[i].sample_state == DDS_SST_NOT_READ)
-          if (print_cputime (raw[i], prefix, true, true))
+          if (print_cputime (raw[i], prefix, true, true, report))
             output = true;
       dds_return_loan (rd_stat, raw, n);
     }
@@ -1782,7 +1914,7 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
     {
       for (int32_t i = 0; i < n; i++)
         if (si[i].valid_data)
-          if (print_cputime (raw[i], prefix, true, si[i].sample_state == DDS_SST_NOT_READ))
+          if (print_cputime (raw[i], prefix, true, si[i].sample_state == DDS_SST_NOT_READ, report))
             output = true;
       dds_return_loan (rd_stat, raw, n);
     }
@@ -1790,22 +1922,38 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
   }
 
   if (output)
-    record_netload (netload_state, prefix, tnow);
+    record_netload (netload_state, prefix, tnow, report);
 
   if (extended_stats && output && stats)
   {
     (void) dds_refresh_statistics (stats->substat);
     (void) dds_refresh_statistics (stats->pubstat);
-    printf ("%s discarded %"PRIu64" rexmit %"PRIu64" Trexmit %"PRIu64" Tthrottle %"PRIu64" Nthrottle %"PRIu32"\n", prefix, stats->discarded_bytes->u.u64, stats->rexmit_bytes->u.u64, stats->time_rexmit->u.u64, stats->time_throttle->u.u64, stats->throttle_count->u.u32);
+    printf ("%s discarded %"PRIu64" rexmit %"PRIu64" Trexmit %"PRIu64" Tthrottle %"PRIu64" Nthrottle %"PRIu32, prefix, stats->discarded_bytes->u.u64, stats->rexmit_bytes->u.u64, stats->time_rexmit->u.u64, stats->time_throttle->u.u64, stats->throttle_count->u.u32);
+    if (use_writer_loan)
+      printf (" loanalloc %"PRIu64" loanreuse %"PRIu64, stats->loan_allocs->u.u64, stats->loan_reuses->u.u64);
+    printf ("\n");
+    report_begin (report, "xstats", NULL);
+    report_uint64 (report, "discarded", stats->discarded_bytes->u.u64);
+    report_uint64 (report, "rexmit", stats->rexmit_bytes->u.u64);
+    report_uint64 (report, "Trexmit", stats->time_rexmit->u.u64);
+    report_uint64 (report, "Tthrottle", stats->time_throttle->u.u64);
+    report_uint64 (report, "Nthrottle", stats->throttle_count->u.u32);
+    if (use_writer_loan)
+    {
+      report_uint64 (report, "loanalloc", stats->loan_allocs->u.u64);
+      report_uint64 (report, "loanreuse", stats->loan_reuses->u.u64);
+    }
+    report_end (report);
   }
 
   fflush (stdout);
   return output;
 }
 
-static void subthread_arg_init (struct subthread_arg *arg, dds_entity_t rd, uint32_t max_samples)
+static void subthread_arg_init (struct subthread_arg *arg, dds_entity_t rd, struct eseq_admin *ea, uint32_t max_samples)
 {
   arg->rd = rd;
+  arg->eseq_admin = ea;
   arg->max_samples = max_samples;
   arg->mseq = malloc (arg->max_samples * sizeof (arg->mseq[0]));
   assert(arg->mseq);
@@ -1872,6 +2020,8 @@ static void usage (void)
   printf ("\
 %s help                (this text)\n\
 %s sanity              (ping 1Hz)\n\
+%s [OPTIONS] startup [N]  (time creating and deleting the first participant\n\
+                      in the domain N times, default 100)\n\
 %s [OPTIONS] MODE...\n\
 \n\
 OPTIONS:\n\
@@ -1923,6 +2073,11 @@ OPTIONS:\n\
                       data\n\
   -X                  output extended statistics\n\
   -i ID               use domain ID instead of the default domain\n\
+  -o json:FILE|csv:FILE  also write the statistics in a machine-readable\n\
+                      format to FILE (\"-\" is stdout): JSON writes one\n\
+                      object per line, CSV one row per value\n\
+  -S FILE             read MODE... from FILE (whitespace separated, # starts\n\
+                      a comment), any modes on the command line are added\n\
 \n\
 MODE... is zero or more of:\n\
   ping [R[Hz]] [size S] [waitset|listener]\n\
@@ -1933,10 +2088,13 @@ MODE... is zero or more of:\n\
     A \"dummy\" mode that serves two purposes: configuring the triggering.\n\
     mode (but it is shared with ping's mode), and suppressing the 1Hz ping\n\
     if no other options are selected.  It always responds to pings.\n\
-  sub [waitset|listener|polling]\n\
+  sub [waitset|listener|polling] [topics M] [readers N]\n\
     Subscribe to data, with calls to take occurring either in a listener\n\
-    (default), when a waitset is triggered, or by polling at 1kHz.\n\
-  pub [R[Hz]] [size S] [burst N] [[ping] X%%] [loan]\n\
+    (default), when a waitset is triggered, or by polling at 1kHz.  It\n\
+    subscribes to the first M data topics (default 1), with N readers for\n\
+    each topic (default 1).\n\
+  pub [R[Hz]] [size S] [burst N] [[ping] X%%] [loan] [topics M] [writers N]\n\
+      [churn X%%]\n\
     Publish bursts of data at rate R, optionally suffixed with Hz/kHz.  If\n\
     no rate is given or R is \"inf\", data is published as fast as\n\
     possible.  Each burst is a single sample by default, but can be set\n\
@@ -1945,12 +2103,20 @@ MODE... is zero or more of:\n\
     If desired, a fraction of the samples can be treated as if it were a\n\
     ping, for this, specify a percentage either as \"ping X%%\" (the\n\
     \"ping\" keyword is optional, the %% sign is not).  \"loan\" uses\n\
-    loans on the writer.\n\
+    loans on the writer, -X then also reports how many heap loans had to\n\
+    be allocated and how many were recycled.\n\
+    It publishes on the first M data topics (default 1) using N writers for\n\
+    each topic (default 1), each with its own thread and each at rate R.\n\
+    \"churn X%%\" unregisters the instance immediately after writing for\n\
+    X%% of the samples, so that instances get created and deleted\n\
+    continually.\n\
+    \"pub\" may be given multiple times to publish different mixes of rates\n\
+    and sizes from a single process.\n\
 \n\
   Payload size (including fixed part of topic) may be set as part of a\n\
-  \"ping\" or \"pub\" specification for topic KS (there is only size,\n\
-  the last one given determines it for all) and should be either 0 (minimal,\n\
-  equivalent to 12) or >= 12.\n\
+  \"ping\" or \"pub\" specification for topic KS and should be either 0\n\
+  (minimal, equivalent to 12) or >= 12.  A \"pub\" without a size\n\
+  specification and \"ping\" use the last one given.\n\
 \n\
 EXIT STATUS:\n\
 \n\
@@ -1968,7 +2134,11 @@ EXAMPLES:\n\
   ddsperf -L -TOU -D10 pub sub\n\
     basic throughput test within the process with tiny, keyless samples,\n\
     running for 10s\n\
-", argv0, argv0, argv0);
+  ddsperf -n100 -o json:out.json pub 100Hz size 10k topics 4 writers 2 \\\n\
+      pub 1kHz size 100 churn 10%% sub topics 4\n\
+    mixed workload on 4 topics with 12 writers, 10k samples at 100Hz and\n\
+    100 bytes at 1kHz with instance churn, writing JSON to out.json\n\
+", argv0, argv0, argv0, argv0);
   fflush (stdout);
   exit (3);
 }
@@ -2133,52 +2303,95 @@ static void set_mode_sub (int *xoptind, int xargc, char * const xargv[])
     { NULL, 0 }
   };
   submode = SM_LISTENER;
+  sub_ntopics = sub_nreaders = 1;
   while (*xoptind < xargc && exact_string_int_map_lookup (modestrings, "mode string", xargv[*xoptind], false) == -1)
   {
-    submode = (enum submode) string_int_map_lookup (submodes, "subscription mode", xargv[*xoptind], true);
+    if (set_simple_uint32 (xoptind, xargc, xargv, "topics", NULL, &sub_ntopics))
+    {
+      if (sub_ntopics == 0) error3 ("topics 0 invalid: must subscribe to at least one topic\n");
+    }
+    else if (set_simple_uint32 (xoptind, xargc, xargv, "readers", NULL, &sub_nreaders))
+    {
+      if (sub_nreaders == 0) error3 ("readers 0 invalid: must have at least one reader\n");
+    }
+    else
+    {
+      submode = (enum submode) string_int_map_lookup (submodes, "subscription mode", xargv[*xoptind], true);
+    }
     (*xoptind)++;
   }
 }
 
+static uint32_t parse_fraction (const char *str, const char *what)
+{
+  double r;
+  int pos;
+  if (sscanf (str, "%lf%n", &r, &pos) != 1 || strcmp (str + pos, "%") != 0)
+    error3 ("%s: invalid %s fraction\n", str, what);
+  if (r < 0 || r > 100)
+    error3 ("%s: %s fraction out of range\n", str, what);
+  return (uint32_t) (UINT32_MAX * (r / 100.0) + 0.5);
+}
+
 static void set_mode_pub (int *xoptind, int xargc, char * const xargv[])
 {
-  pub_rate = HUGE_VAL;
-  burstsize = 1;
-  ping_frac = 0;
+  pubspecs = realloc (pubspecs, (npubspecs + 1) * sizeof (*pubspecs));
+  assert (pubspecs);
+  struct pubspec * const spec = &pubspecs[npubspecs++];
+  spec->rate = HUGE_VAL;
+  spec->burstsize = 1;
+  spec->baggagesize = UINT32_MAX;
+  spec->ping_frac = 0;
+  spec->churn_frac = 0;
+  spec->loan = false;
+  spec->ntopics = 1;
+  spec->nwriters = 1;
   while (*xoptind < xargc && exact_string_int_map_lookup (modestrings, "mode string", xargv[*xoptind], false) == -1)
   {
     int pos = 0, mult = 1;
     double r;
     if (strncmp (xargv[*xoptind], "inf", 3) == 0 && lookup_multiplier (frequency_units, xargv[*xoptind] + 3) > 0)
     {
-      pub_rate = HUGE_VAL;
+      spec->rate = HUGE_VAL;
     }
     else if (sscanf (xargv[*xoptind], "%lf%n", &r, &pos) == 1 && (mult = lookup_multiplier (frequency_units, xargv[*xoptind] + pos)) > 0)
     {
       if (r < 0) error3 ("%s: invalid publish rate\n", xargv[*xoptind]);
-      pub_rate = r * mult;
+      spec->rate = r * mult;
     }
-    else if (set_simple_uint32 (xoptind, xargc, xargv, "burst", NULL, &burstsize))
+    else if (set_simple_uint32 (xoptind, xargc, xargv, "burst", NULL, &spec->burstsize))
     {
       /* no further work needed */
     }
-    else if (set_simple_uint32 (xoptind, xargc, xargv, "size", size_units, &baggagesize))
+    else if (set_simple_uint32 (xoptind, xargc, xargv, "size", size_units, &spec->baggagesize))
     {
-      /* no further work needed */
+      baggagesize = spec->baggagesize;
+    }
+    else if (set_simple_uint32 (xoptind, xargc, xargv, "topics", NULL, &spec->ntopics))
+    {
+      if (spec->ntopics == 0) error3 ("topics 0 invalid: must publish on at least one topic\n");
+    }
+    else if (set_simple_uint32 (xoptind, xargc, xargv, "writers", NULL, &spec->nwriters))
+    {
+      if (spec->nwriters == 0) error3 ("writers 0 invalid: must have at least one writer\n");
     }
     else if (sscanf (xargv[*xoptind], "%lf%n", &r, &pos) == 1 && strcmp (xargv[*xoptind] + pos, "%") == 0)
     {
-      if (r < 0 || r > 100) error3 ("%s: ping fraction out of range\n", xargv[*xoptind]);
-      ping_frac = (uint32_t) (UINT32_MAX * (r / 100.0) + 0.5);
+      spec->ping_frac = parse_fraction (xargv[*xoptind], "ping");
     }
-    else if (strcmp (xargv[*xoptind], "ping") == 0 && *xoptind + 1 < xargc && sscanf (xargv[*xoptind + 1], "%lf%%%n", &pub_rate, &pos) == 1 && xargv[*xoptind + 1][pos] == 0)
+    else if (strcmp (xargv[*xoptind], "ping") == 0 && *xoptind + 1 < xargc)
     {
       ++(*xoptind);
-      if (r < 0 || r > 100) error3 ("%s: ping fraction out of range\n", xargv[*xoptind]);
-      ping_frac = (uint32_t) (UINT32_MAX * (r / 100.0) + 0.5);
+      spec->ping_frac = parse_fraction (xargv[*xoptind], "ping");
+    }
+    else if (strcmp (xargv[*xoptind], "churn") == 0 && *xoptind + 1 < xargc)
+    {
+      ++(*xoptind);
+      spec->churn_frac = parse_fraction (xargv[*xoptind], "churn");
     }
     else if (strcmp (xargv[*xoptind], "loan") == 0)
     {
+      spec->loan = true;
       use_writer_loan = true;
     }
     else
@@ -2192,11 +2405,10 @@ static void set_mode_pub (int *xoptind, int xargc, char * const xargv[])
 static void set_mode (int xoptind, int xargc, char * const xargv[])
 {
   int code;
-  pub_rate = 0.0;
+  npubspecs = 0;
   submode = SM_NONE;
   pingpongmode = SM_LISTENER;
   ping_intv = DDS_INFINITY;
-  ping_frac = 0;
   while (xoptind < xargc && (code = exact_string_int_map_lookup (modestrings, "mode string", xargv[xoptind], true)) != -1)
   {
     xoptind++;
@@ -2214,6 +2426,39 @@ static void set_mode (int xoptind, int xargc, char * const xargv[])
   }
 }
 
+static void add_scenario_token (int *xargc, char ***xargv, const char *tok)
+{
+  *xargv = realloc (*xargv, ((size_t) *xargc + 1) * sizeof (**xargv));
+  assert (*xargv);
+  (*xargv)[(*xargc)++] = ddsrt_strdup (tok);
+}
+
+static void read_scenario (const char *file, int *xargc, char ***xargv)
+{
+  /* A scenario is simply a sequence of MODE... tokens as would otherwise be
+     given on the command line, spread over as many lines as desired with
+     comments starting with # and extending to the end of the line */
+  char line[1024];
+  FILE *fp;
+DDSRT_WARNING_MSVC_OFF(4996);
+  if ((fp = fopen (file, "r")) == NULL)
+    error3 ("%s: can't open scenario file\n", file);
+DDSRT_WARNING_MSVC_ON(4996);
+  *xargc = 0;
+  *xargv = NULL;
+  while (fgets (line, (int) sizeof (line), fp) != NULL)
+  {
+    char *cursor = line, *tok;
+    if (strchr (line, '\n') == NULL && !feof (fp))
+      error3 ("%s: line too long in scenario file\n", file);
+    cursor[strcspn (cursor, "#")] = 0;
+    while ((tok = ddsrt_strsep (&cursor, " \t\r\n")) != NULL)
+      if (*tok)
+        add_scenario_token (xargc, xargv, tok);
+  }
+  fclose (fp);
+}
+
 static bool wait_for_initial_matches (void)
 {
   dds_time_t tnow = dds_time ();
@@ -2250,7 +2495,9 @@ int main (int argc, char *argv[])
   bool collect_stats = false;
   dds_time_t tref = DDS_INFINITY;
   ddsrt_threadattr_t attr;
-  ddsrt_thread_t pubtid, subtid, subpingtid, subpongtid;
+  ddsrt_thread_t subpingtid, subpongtid;
+  const char *scenario = NULL;
+  const char *report_spec = NULL;
 #if !_WIN32 && !DDSRT_WITH_FREERTOS && !__ZEPHYR__
   sigset_t sigset, osigset;
   ddsrt_thread_t sigtid;
@@ -2263,7 +2510,7 @@ int main (int argc, char *argv[])
 
   argv0 = argv[0];
 
-  while ((opt = getopt (argc, argv, "1cd:D:i:n:k:ulLK:T:Q:R:Xh")) != EOF)
+  while ((opt = getopt (argc, argv, "1cd:D:i:n:k:o:ulLK:S:T:Q:R:Xh")) != EOF)
   {
     int pos;
     switch (opt)
@@ -2290,6 +2537,8 @@ int main (int argc, char *argv[])
       case 'k': histdepth = atoi (optarg); if (histdepth < 0) histdepth = 0; break;
       case 'l': sublatency = true; break;
       case 'L': ignorelocal = DDS_IGNORELOCAL_NONE; break;
+      case 'o': report_spec = optarg; break;
+      case 'S': scenario = optarg; break;
       case 'T':
         if (strcmp (optarg, "KS") == 0) topicsel = KS;
         else if (strcmp (optarg, "K32") == 0) topicsel = K32;
@@ -2340,13 +2589,34 @@ int main (int argc, char *argv[])
     }
   }
 
-  if (optind == argc || (optind + 1 == argc && strcmp (argv[optind], "help") == 0))
+  if (scenario != NULL)
+  {
+    int xargc;
+    char **xargv;
+    read_scenario (scenario, &xargc, &xargv);
+    for (int i = optind; i < argc; i++)
+      add_scenario_token (&xargc, &xargv, argv[i]);
+    set_mode (0, xargc, xargv);
+    for (int i = 0; i < xargc; i++)
+      ddsrt_free (xargv[i]);
+    free (xargv);
+  }
+  else if (optind == argc || (optind + 1 == argc && strcmp (argv[optind], "help") == 0))
     usage ();
   else if (optind + 1 == argc && strcmp (argv[optind], "sanity") == 0)
   {
     char * const sanity[] = { "ping", "1Hz" };
     set_mode (0, 2, sanity);
   }
+  else if (strcmp (argv[optind], "startup") == 0)
+  {
+    int pos;
+    startup_iters = 100;
+    if (optind + 2 < argc || (optind + 2 == argc && (sscanf (argv[optind + 1], "%"SCNu32"%n", &startup_iters, &pos) != 1 || argv[optind + 1][pos] != 0)))
+      error3 ("usage: startup [N]\n");
+    else if (startup_iters == 0)
+      error3 ("startup 0 invalid: must create at least one participant\n");
+  }
   else
   {
     set_mode (optind, argc, argv);
@@ -2364,6 +2634,32 @@ int main (int argc, char *argv[])
     error3 ("size %"PRIu32" invalid: too small to allow for overhead\n", baggagesize);
   else if (baggagesize > 0)
     baggagesize -= 12;
+  for (uint32_t i = 0; i < npubspecs; i++)
+  {
+    struct pubspec * const spec = &pubspecs[i];
+    if (spec->baggagesize == UINT32_MAX)
+      spec->baggagesize = baggagesize;
+    else if (topicsel != KS && spec->baggagesize != 0)
+      error3 ("size %"PRIu32" invalid: only topic KS has a sequence\n", spec->baggagesize);
+    else if (spec->baggagesize != 0 && spec->baggagesize < 12)
+      error3 ("size %"PRIu32" invalid: too small to allow for overhead\n", spec->baggagesize);
+    else if (spec->baggagesize > 0)
+      spec->baggagesize -= 12;
+    if (spec->churn_frac > 0 && getkeyvaloff () == SIZE_MAX)
+      error3 ("churn invalid: topic has no key\n");
+    if (spec->ntopics > ntp_data)
+      ntp_data = spec->ntopics;
+  }
+  if (submode != SM_NONE && sub_ntopics > ntp_data)
+    ntp_data = sub_ntopics;
+  if (report_spec && (report = report_new (report_spec)) == NULL)
+    error3 ("-o %s: invalid output specification or can't open file\n", report_spec);
+  if (startup_iters > 0)
+  {
+    startup_benchmark (startup_iters);
+    report_free (report);
+    exit (0);
+  }
   
   if (livemem_check)
   {
@@ -2449,8 +2745,18 @@ int main (int argc, char *argv[])
     snprintf (tpname_pong, sizeof (tpname_pong), "DDSPerf%cPong%s", reliable ? 'R' : 'U', tp_suf);
     qos = dds_create_qos ();
     dds_qset_reliability (qos, reliable ? DDS_RELIABILITY_RELIABLE : DDS_RELIABILITY_BEST_EFFORT, DDS_SECS (10));
-    if ((tp_data = dds_create_topic (dp, tp_desc, tpname_data, qos, NULL)) < 0)
-      error2 ("dds_create_topic(%s) failed: %d\n", tpname_data, (int) tp_data);
+    tp_data = malloc (ntp_data * sizeof (*tp_data));
+    assert (tp_data);
+    for (uint32_t i = 0; i < ntp_data; i++)
+    {
+      char tpname[sizeof (tpname_data) + 16];
+      if (i == 0)
+        (void) ddsrt_strlcpy (tpname, tpname_data, sizeof (tpname));
+      else
+        (void) snprintf (tpname, sizeof (tpname), "%s_%"PRIu32, tpname_data, i);
+      if ((tp_data[i] = dds_create_topic (dp, tp_desc, tpname, qos, NULL)) < 0)
+        error2 ("dds_create_topic(%s) failed: %d\n", tpname, (int) tp_data[i]);
+    }
     if ((tp_ping = dds_create_topic (dp, tp_desc, tpname_ping, qos, NULL)) < 0)
       error2 ("dds_create_topic(%s) failed: %d\n", tpname_ping, (int) tp_ping);
     if ((tp_pong = dds_create_topic (dp, tp_desc, tpname_pong, qos, NULL)) < 0)
@@ -2518,16 +2824,43 @@ int main (int argc, char *argv[])
     dds_qset_history (qos, DDS_HISTORY_KEEP_LAST, histdepth);
   dds_qset_resource_limits (qos, 10000, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
   dds_qset_ignorelocal (qos, ignorelocal);
+  /* there is always an entry for at least one reader, even if there is no reader, that way
+     there is no need for special-casing the absence of a reader in the statistics */
+  nrd_data = (submode == SM_NONE) ? 1 : sub_ntopics * sub_nreaders;
+  dds_entity_t *rds_data = malloc (nrd_data * sizeof (*rds_data));
+  assert (rds_data);
   listener = dds_create_listener ((void *) (uintptr_t) MM_WR_DATA);
   dds_lset_subscription_matched (listener, subscription_matched_listener);
-  if (submode != SM_NONE && (rd_data = dds_create_reader (sub, tp_data, qos, listener)) < 0)
-    error2 ("dds_create_reader(%s) failed: %d\n", tpname_data, (int) rd_data);
+  for (uint32_t i = 0; i < nrd_data; i++)
+  {
+    rds_data[i] = 0;
+    if (submode != SM_NONE && (rds_data[i] = dds_create_reader (sub, tp_data[i / sub_nreaders], qos, listener)) < 0)
+      error2 ("dds_create_reader(%s) failed: %d\n", tpname_data, (int) rds_data[i]);
+  }
+  rd_data = rds_data[0];
   dds_delete_listener (listener);
   listener = dds_create_listener ((void *) (uintptr_t) MM_RD_DATA);
   dds_lset_publication_matched (listener, publication_matched_listener);
   dds_qset_writer_batching (qos, true);
-  if ((wr_data = dds_create_writer (pub, tp_data, qos, listener)) < 0)
+  if ((wr_data = dds_create_writer (pub, tp_data[0], qos, listener)) < 0)
     error2 ("dds_create_writer(%s) failed: %d\n", tpname_data, (int) wr_data);
+  /* one writer (and thread) for each writer specified in all "pub" modes, the
+     very first one is the writer that always exists */
+  for (uint32_t i = 0; i < npubspecs; i++)
+    npubthreads += pubspecs[i].ntopics * pubspecs[i].nwriters;
+  pubthreads = malloc (npubthreads * sizeof (*pubthreads));
+  assert (pubthreads || npubthreads == 0);
+  for (uint32_t i = 0, k = 0; i < npubspecs; i++)
+  {
+    for (uint32_t j = 0; j < pubspecs[i].ntopics * pubspecs[i].nwriters; j++, k++)
+    {
+      pubthreads[k].spec = &pubspecs[i];
+      if (k == 0)
+        pubthreads[k].wr = wr_data;
+      else if ((pubthreads[k].wr = dds_create_writer (pub, tp_data[j / pubspecs[i].nwriters], qos, listener)) < 0)
+        error2 ("dds_create_writer(%s) failed: %d\n", tpname_data, (int) pubthreads[k].wr);
+    }
+  }
   dds_qset_writer_batching (qos, false);
   dds_delete_listener (listener);
 
@@ -2567,11 +2900,21 @@ int main (int argc, char *argv[])
   /* Make publisher & subscriber thread arguments and start the threads we
      need (so what if we allocate memory for reading data even if we don't
      have a reader or will never really be receiving data) */
-  struct subthread_arg subarg_data, subarg_ping, subarg_pong;
-  init_eseq_admin (&eseq_admin, nkeyvals);
-  subthread_arg_init (&subarg_data, rd_data, 1000);
-  subthread_arg_init (&subarg_ping, rd_ping, 100);
-  subthread_arg_init (&subarg_pong, rd_pong, 100);
+  struct subthread_arg *subarg_data, subarg_ping, subarg_pong;
+  eseq_admin = malloc (nrd_data * sizeof (*eseq_admin));
+  assert (eseq_admin);
+  subarg_data = malloc (nrd_data * sizeof (*subarg_data));
+  assert (subarg_data);
+  ddsrt_thread_t *subtids = malloc (nrd_data * sizeof (*subtids));
+  assert (subtids);
+  for (uint32_t i = 0; i < nrd_data; i++)
+  {
+    init_eseq_admin (&eseq_admin[i], nkeyvals);
+    subthread_arg_init (&subarg_data[i], rds_data[i], &eseq_admin[i], 1000);
+  }
+  free (rds_data);
+  subthread_arg_init (&subarg_ping, rd_ping, NULL, 100);
+  subthread_arg_init (&subarg_pong, rd_pong, NULL, 100);
   uint32_t (*subthread_func) (void *arg) = NULL;
   switch (submode)
   {
@@ -2580,8 +2923,7 @@ int main (int argc, char *argv[])
     case SM_POLLING:  subthread_func = subthread_polling; break;
     case SM_LISTENER: break;
   }
-  memset (&pubtid, 0, sizeof (pubtid));
-  memset (&subtid, 0, sizeof (subtid));
+  memset (subtids, 0, nrd_data * sizeof (*subtids));
   memset (&subpingtid, 0, sizeof (subpingtid));
   memset (&subpongtid, 0, sizeof (subpongtid));
 
@@ -2590,12 +2932,29 @@ int main (int argc, char *argv[])
   if (initmaxwait > 0 && !wait_for_initial_matches())
     goto err_minmatch_wait;
 
-  if (pub_rate > 0)
-    ddsrt_thread_create (&pubtid, "pub", &attr, pubthread, NULL);
-  if (subthread_func != NULL)
-    ddsrt_thread_create (&subtid, "sub", &attr, subthread_func, &subarg_data);
-  else if (submode == SM_LISTENER)
-    set_data_available_listener (rd_data, "rd_data", data_available_listener, &subarg_data);
+  for (uint32_t i = 0; i < npubthreads; i++)
+  {
+    char name[32];
+    if (i == 0)
+      (void) ddsrt_strlcpy (name, "pub", sizeof (name));
+    else
+      (void) snprintf (name, sizeof (name), "pub%"PRIu32, i);
+    ddsrt_thread_create (&pubthreads[i].tid, name, &attr, pubthread, &pubthreads[i]);
+  }
+  for (uint32_t i = 0; i < nrd_data; i++)
+  {
+    if (subthread_func != NULL)
+    {
+      char name[32];
+      if (i == 0)
+        (void) ddsrt_strlcpy (name, "sub", sizeof (name));
+      else
+        (void) snprintf (name, sizeof (name), "sub%"PRIu32, i);
+      ddsrt_thread_create (&subtids[i], name, &attr, subthread_func, &subarg_data[i]);
+    }
+    else if (submode == SM_LISTENER)
+      set_data_available_listener (subarg_data[i].rd, "rd_data", data_available_listener, &subarg_data[i]);
+  }
   /* Need to handle incoming "pong"s only if we can be sending "ping"s (whether that
      be pings from the "ping" mode (i.e. ping_intv != DDS_NEVER), or pings embedded
      in the published data stream (i.e. rate > 0 && ping_frac > 0).  The trouble with
@@ -2629,6 +2988,8 @@ int main (int argc, char *argv[])
   stats.time_rexmit = dds_lookup_statistic (stats.pubstat, "time_rexmit");
   stats.time_throttle = dds_lookup_statistic (stats.pubstat, "time_throttle");
   stats.throttle_count = dds_lookup_statistic (stats.pubstat, "throttle_count");
+  stats.loan_allocs = dds_lookup_statistic (stats.pubstat, "loan_allocs");
+  stats.loan_reuses = dds_lookup_statistic (stats.pubstat, "loan_reuses");
   if (stats.discarded_bytes == NULL)
     stats.discarded_bytes = &dummy_u64;
   if (stats.rexmit_bytes == NULL)
@@ -2639,11 +3000,17 @@ int main (int argc, char *argv[])
     stats.time_throttle = &dummy_u64;
   if (stats.throttle_count == NULL)
     stats.throttle_count = &dummy_u32;
+  if (stats.loan_allocs == NULL)
+    stats.loan_allocs = &dummy_u64;
+  if (stats.loan_reuses == NULL)
+    stats.loan_reuses = &dummy_u64;
   if (stats.discarded_bytes->kind != DDS_STAT_KIND_UINT64 ||
       stats.rexmit_bytes->kind != DDS_STAT_KIND_UINT64 ||
       stats.time_rexmit->kind != DDS_STAT_KIND_UINT64 ||
       stats.time_throttle->kind != DDS_STAT_KIND_UINT64 ||
-      stats.throttle_count->kind != DDS_STAT_KIND_UINT32)
+      stats.throttle_count->kind != DDS_STAT_KIND_UINT32 ||
+      stats.loan_allocs->kind != DDS_STAT_KIND_UINT64 ||
+      stats.loan_reuses->kind != DDS_STAT_KIND_UINT64)
   {
     abort ();
   }
@@ -2801,10 +3168,13 @@ int main (int argc, char *argv[])
   }
 #endif
 
-  if (pub_rate > 0)
-    ddsrt_thread_join (pubtid, NULL);
+  for (uint32_t i = 0; i < npubthreads; i++)
+    ddsrt_thread_join (pubthreads[i].tid, NULL);
   if (subthread_func != NULL)
-    ddsrt_thread_join (subtid, NULL);
+  {
+    for (uint32_t i = 0; i < nrd_data; i++)
+      ddsrt_thread_join (subtids[i], NULL);
+  }
   if (pingpong_waitset)
   {
     ddsrt_thread_join (subpingtid, NULL);
@@ -2817,7 +3187,8 @@ err_minmatch_wait:
      (not quite good, but ...) */
   dds_set_listener (rd_ping, NULL);
   dds_set_listener (rd_pong, NULL);
-  dds_set_listener (rd_data, NULL);
+  for (uint32_t i = 0; i < nrd_data; i++)
+    dds_set_listener (subarg_data[i].rd, NULL);
   dds_set_listener (rd_participants, NULL);
   dds_set_listener (rd_subscriptions, NULL);
   dds_set_listener (rd_publications, NULL);
@@ -2834,18 +3205,26 @@ err_minmatch_wait:
      The fix is to eliminate the waiting and retrying, and instead
      flip the reader's state to out-of-sync and rely on retransmits
      to let it make progress once room is available again.  */
-  dds_delete (rd_data);
+  for (uint32_t i = 0; i < nrd_data; i++)
+    dds_delete (subarg_data[i].rd);
 
-  uint64_t nlost = 0;
+  uint64_t nrecv = 0, nlost = 0;
   bool received_ok = true;
-  for (uint32_t i = 0; i < eseq_admin.nph; i++)
+  for (uint32_t r = 0; r < nrd_data; r++)
   {
-    nlost += eseq_admin.stats[i].nlost;
-    if (eseq_admin.stats[i].nrecv < (uint64_t) min_received)
-      received_ok = false;
+    for (uint32_t i = 0; i < eseq_admin[r].nph; i++)
+    {
+      nrecv += eseq_admin[r].stats[i].nrecv;
+      nlost += eseq_admin[r].stats[i].nlost;
+      if (eseq_admin[r].stats[i].nrecv < (uint64_t) min_received)
+        received_ok = false;
+    }
+    fini_eseq_admin (&eseq_admin[r]);
+    subthread_arg_fini (&subarg_data[r]);
   }
-  fini_eseq_admin (&eseq_admin);
-  subthread_arg_fini (&subarg_data);
+  free (eseq_admin);
+  free (subarg_data);
+  free (subtids);
   subthread_arg_fini (&subarg_ping);
   subthread_arg_fini (&subarg_pong);
   dds_delete (dp);
@@ -2862,11 +3241,16 @@ err_minmatch_wait:
   ddsrt_mutex_destroy (&pubstat_lock);
   hist_free (pubstat_hist);
   free (pongwr);
+  free (pubthreads);
+  free (pubspecs);
+  free (tp_data);
   bool roundtrips_ok = true;
+  uint64_t nroundtrips = 0;
   for (uint32_t i = 0; i < npongstat; i++)
   {
     if (pongstat[i].info.totcnt < min_roundtrips)
       roundtrips_ok = false;
+    nroundtrips += pongstat[i].info.totcnt;
     latencystat_fini (&pongstat[i].info);
   }
   free (pongstat);
@@ -2918,6 +3302,18 @@ err_minmatch_wait:
     ok = false;
   }
 
+  report_set_time (report, (double) (dds_time () - tref) / 1e9);
+  report_begin (report, "summary", NULL);
+  report_uint64 (report, "received", nrecv);
+  report_uint64 (report, "lost", nlost);
+  report_uint64 (report, "roundtrips", nroundtrips);
+  report_uint64 (report, "ping_timeouts", ping_timeouts);
+  report_double (report, "rss_init", rss_init);
+  report_double (report, "rss_final", rss_final);
+  report_uint64 (report, "ok", ok);
+  report_end (report);
+  report_free (report);
+
   if (livemem_check)
   {
     printf ("[%"PRIdPID"] note: livemem init %.1fMB peak %.1fMB final %.1fMB\n", ddsrt_getpid (), livemem_init / 1048576.0, (double) ddsrt_atomic_ld32 (&ddsperf_malloc_peak) / 1048576.0, livemem_final / 1048576.0);
@@ -21,6 +21,7 @@
 #include "dds/ddsrt/misc.h"
 
 #include "netload.h"
+#include "report.h"
 
 #if DDSRT_HAVE_NETSTAT
 
@@ -35,7 +36,7 @@ struct record_netload_state {
   uint64_t obytes;
 };
 
-void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow)
+void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow, struct report *rep)
 {
   if (st && !st->errored)
   {
@@ -50,6 +51,15 @@ void record_netload (struct record_netload_state *st, const char *prefix, dds_ti
         const double dt = (double) (tnow - st->tprev) / 1e9;
         const double dx = 8 * (double) (x.obytes - st->obytes) / dt;
         const double dr = 8 * (double) (x.ibytes - st->ibytes) / dt;
+        report_begin (rep, "net", st->name);
+        report_double (rep, "xmit_bps", dx);
+        report_double (rep, "recv_bps", dr);
+        if (st->bw > 0)
+        {
+          report_double (rep, "xmit_pct", 100.0 * dx / st->bw);
+          report_double (rep, "recv_pct", 100.0 * dr / st->bw);
+        }
+        report_end (rep);
         if (st->bw > 0)
         {
           const double dxpct = 100.0 * dx / st->bw;
@@ -90,7 +100,7 @@ DDSRT_WARNING_MSVC_OFF(4996);
   st->bw = bw;
   st->data_valid = false;
   st->errored = false;
-  record_netload (st, "", dds_time ());
+  record_netload (st, "", dds_time (), NULL);
   return st;
 DDSRT_WARNING_MSVC_ON(4996);
 }
@@ -107,11 +117,12 @@ void record_netload_free (struct record_netload_state *st)
 
 #else
 
-void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow)
+void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow, struct report *rep)
 {
   (void) st;
   (void) prefix;
   (void ) tnow;
+  (void) rep;
 }
 
 struct record_netload_state *record_netload_new (const char *dev, double bw)
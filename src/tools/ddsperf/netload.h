@@ -14,8 +14,9 @@
 #include <dds/dds.h>
 
 struct record_netload_state;
+struct report;
 
-void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow);
+void record_netload (struct record_netload_state *st, const char *prefix, dds_time_t tnow, struct report *rep);
 struct record_netload_state *record_netload_new (const char *dev, double bw);
 void record_netload_free (struct record_netload_state *st);
 
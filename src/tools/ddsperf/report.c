@@ -0,0 +1,214 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <math.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/process.h"
+#include "dds/ddsrt/misc.h"
+
+#include "report.h"
+
+enum report_format {
+  RF_JSON,
+  RF_CSV
+};
+
+struct report {
+  enum report_format format;
+  FILE *fp;
+  bool close;
+  double ts;
+  char kind[32];
+  char peer[160];
+};
+
+static void write_string (const struct report *rep, const char *str)
+{
+  switch (rep->format)
+  {
+    case RF_JSON:
+      fputc ('"', rep->fp);
+      for (const char *s = str; *s; s++)
+      {
+        if (*s == '"' || *s == '\\')
+          fprintf (rep->fp, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+          fprintf (rep->fp, "\\u%04x", (unsigned) (unsigned char) *s);
+        else
+          fputc (*s, rep->fp);
+      }
+      fputc ('"', rep->fp);
+      break;
+    case RF_CSV:
+      if (strpbrk (str, ",\"\r\n") == NULL)
+        fputs (str, rep->fp);
+      else
+      {
+        fputc ('"', rep->fp);
+        for (const char *s = str; *s; s++)
+        {
+          if (*s == '"')
+            fputc ('"', rep->fp);
+          fputc (*s, rep->fp);
+        }
+        fputc ('"', rep->fp);
+      }
+      break;
+  }
+}
+
+struct report *report_new (const char *spec)
+{
+  enum report_format format;
+  const char *file;
+  if (strncmp (spec, "json:", 5) == 0)
+  {
+    format = RF_JSON;
+    file = spec + 5;
+  }
+  else if (strncmp (spec, "csv:", 4) == 0)
+  {
+    format = RF_CSV;
+    file = spec + 4;
+  }
+  else
+  {
+    return NULL;
+  }
+
+  struct report *rep = malloc (sizeof (*rep));
+  assert (rep);
+  rep->format = format;
+  rep->ts = 0.0;
+  rep->kind[0] = 0;
+  rep->peer[0] = 0;
+  if (strcmp (file, "-") == 0)
+  {
+    rep->fp = stdout;
+    rep->close = false;
+  }
+  else
+  {
+DDSRT_WARNING_MSVC_OFF(4996);
+    rep->fp = fopen (file, "w");
+DDSRT_WARNING_MSVC_ON(4996);
+    if (rep->fp == NULL)
+    {
+      free (rep);
+      return NULL;
+    }
+    rep->close = true;
+  }
+  if (rep->format == RF_CSV)
+  {
+    fputs ("ts,pid,kind,peer,metric,value\n", rep->fp);
+    fflush (rep->fp);
+  }
+  return rep;
+}
+
+void report_free (struct report *rep)
+{
+  if (rep)
+  {
+    if (rep->close)
+      fclose (rep->fp);
+    else
+      fflush (rep->fp);
+    free (rep);
+  }
+}
+
+void report_set_time (struct report *rep, double ts)
+{
+  if (rep)
+    rep->ts = ts;
+}
+
+void report_begin (struct report *rep, const char *kind, const char *peer)
+{
+  if (rep == NULL)
+    return;
+  (void) snprintf (rep->kind, sizeof (rep->kind), "%s", kind);
+  (void) snprintf (rep->peer, sizeof (rep->peer), "%s", peer ? peer : "");
+  if (rep->format == RF_JSON)
+  {
+    fprintf (rep->fp, "{\"ts\":%.6f,\"pid\":%"PRIdPID",\"kind\":", rep->ts, ddsrt_getpid ());
+    write_string (rep, rep->kind);
+    if (rep->peer[0])
+    {
+      fputs (",\"peer\":", rep->fp);
+      write_string (rep, rep->peer);
+    }
+  }
+}
+
+static void begin_value (struct report *rep, const char *name)
+{
+  switch (rep->format)
+  {
+    case RF_JSON:
+      fputc (',', rep->fp);
+      write_string (rep, name);
+      fputc (':', rep->fp);
+      break;
+    case RF_CSV:
+      fprintf (rep->fp, "%.6f,%"PRIdPID",", rep->ts, ddsrt_getpid ());
+      write_string (rep, rep->kind);
+      fputc (',', rep->fp);
+      write_string (rep, rep->peer);
+      fputc (',', rep->fp);
+      write_string (rep, name);
+      fputc (',', rep->fp);
+      break;
+  }
+}
+
+static void end_value (struct report *rep)
+{
+  if (rep->format == RF_CSV)
+    fputc ('\n', rep->fp);
+}
+
+void report_uint64 (struct report *rep, const char *name, uint64_t v)
+{
+  if (rep == NULL)
+    return;
+  begin_value (rep, name);
+  fprintf (rep->fp, "%"PRIu64, v);
+  end_value (rep);
+}
+
+void report_double (struct report *rep, const char *name, double v)
+{
+  if (rep == NULL)
+    return;
+  begin_value (rep, name);
+  if (isfinite (v))
+    fprintf (rep->fp, "%.9g", v);
+  else
+    fputs ((rep->format == RF_JSON) ? "null" : "", rep->fp);
+  end_value (rep);
+}
+
+void report_end (struct report *rep)
+{
+  if (rep == NULL)
+    return;
+  if (rep->format == RF_JSON)
+    fputs ("}\n", rep->fp);
+  fflush (rep->fp);
+}
@@ -0,0 +1,35 @@
+// Copyright(c) 2024 ZettaScale Technology and others
+//
+// This program and the accompanying materials are made available under the
+// terms of the Eclipse Public License v. 2.0 which is available at
+// http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+// v. 1.0 which is available at
+// http://www.eclipse.org/org/documents/edl-v10.php.
+//
+// SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Machine-readable output of the statistics.  All functions accept a null
+   pointer for the report, in which case they do nothing.
+
+   A record consists of a time stamp, a kind ("pub", "sub", "rtt", ...), an
+   optional peer (the process the measurement relates to) and a set of named
+   values.  In JSON format, each record is written as a single object on a
+   line of its own; in CSV format, each value is written as a separate row
+   "ts,pid,kind,peer,metric,value". */
+struct report;
+
+struct report *report_new (const char *spec);
+void report_free (struct report *rep);
+void report_set_time (struct report *rep, double ts);
+void report_begin (struct report *rep, const char *kind, const char *peer);
+void report_uint64 (struct report *rep, const char *name, uint64_t v);
+void report_double (struct report *rep, const char *name, double v);
+void report_end (struct report *rep);
+
+#endif
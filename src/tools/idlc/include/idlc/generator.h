@@ -27,6 +27,11 @@ struct idlc_generator_config {
   Passing a pointer to a generator function is a reasonable way of avoiding the layering problems
   this introduces. May be a null pointer */
   idl_retcode_t (*generate_typeinfo_typemap) (const idl_pstate_t *pstate, const idl_node_t *node, idl_typeinfo_typemap_t *result);
+
+  /** Generators call this with the path of each file they write, so that idlc can verify
+  the generated files before skipping an unchanged input (-f cache). Inputs are always
+  compiled again for generators that don't. May be a null pointer */
+  idl_retcode_t (*output_file) (const char *path);
 };
 
 typedef struct idlc_generator_config idlc_generator_config_t;
@@ -38,6 +43,7 @@ typedef int(*idlc_generate_t)(const idl_pstate_t *, const idlc_generator_config_
 typedef struct idlc_generator_plugin idlc_generator_plugin_t;
 struct idlc_generator_plugin {
   void *handle;
+  char *path; /* file the generator was loaded from, or NULL if unknown */
   idlc_generator_options_t generator_options; /* optional */
   idlc_generator_annotations_t generator_annotations; /* optional */
   idlc_generate_t generate;
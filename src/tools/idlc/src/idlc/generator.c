@@ -8,6 +8,8 @@
 //
 // SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
 
+#define _GNU_SOURCE /* for dladdr */
+
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -90,6 +92,20 @@ static void liberror(char *buffer, size_t bufferlen)
   buffer[bufferlen - 1] = 0; /* ensure final zero in all cases */
 }
 
+static char *libpath(void *handle, void *symbol)
+{
+#if WIN32
+  char buf[MAX_PATH];
+  DWORD n = GetModuleFileName((HMODULE)handle, buf, (DWORD)sizeof(buf));
+  (void)symbol;
+  return (n > 0 && n < sizeof(buf)) ? idl_strdup(buf) : NULL;
+#else
+  Dl_info info;
+  (void)handle;
+  return (dladdr(symbol, &info) != 0 && info.dli_fname != NULL) ? idl_strdup(info.dli_fname) : NULL;
+#endif
+}
+
 #define SUBPROCESS_PIPE_MEMORY_LIMIT 1024 * 1024
 static int run_library_locator(const char *command, char **out_output) {
   size_t output_size = 0;
@@ -202,6 +218,7 @@ int idlc_load_generator(idlc_generator_plugin_t *plugin, const char *lang)
     generate = loadsym(handle, "generate");
     if (generate) {
       plugin->handle = handle;
+      plugin->path = libpath(handle, loadsym(handle, "generate"));
       plugin->generate = generate;
       plugin->generator_options = loadsym(handle, "generator_options");
       plugin->generator_annotations = loadsym(handle, "generator_annotations");
@@ -229,6 +246,9 @@ void idlc_unload_generator(idlc_generator_plugin_t *plugin)
     return;
   closelib(plugin->handle);
   plugin->handle = NULL;
+  if (plugin->path)
+    idl_free(plugin->path);
+  plugin->path = NULL;
   plugin->generator_options = 0;
   plugin->generator_annotations = 0;
   plugin->generate = 0;
@@ -18,6 +18,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "dds/features.h"
 #include "dds/cdr/dds_cdrstream.h"
@@ -59,6 +64,8 @@ static struct {
   const char *lang;
   const char *output_dir; /* path to write completed files */
   const char* base_dir; /* Path to start reconstruction of dir structure */
+  const char *cache_dir; /* path to record digests of compiled files */
+  int jobs; /* number of files to compile in parallel */
   int compile;
   int preprocess;
   int keylist;
@@ -89,14 +96,29 @@ static int idlc_printf(MCPP_OUTDEST od, const char *str, ...);
 
 static idl_md5_state_t md5state;
 
+/* Files are skipped if the preprocessed input, the options and the generator are the
+   same as the last time the file was compiled successfully using the same cache
+   directory, and the files generated then are still present and unmodified. The
+   preprocessed input includes the contents of all included files. */
+static struct {
+  idl_md5_byte_t options[16]; /* digest of the options, the idlc version and the generator */
+  char *stamp; /* path of stamp file for the current input, or NULL */
+  char digest[33]; /* hex digest of the preprocessed input */
+  char **outputs; /* absolute paths of the files written by the generator */
+  size_t noutputs;
+  bool outputs_unknown; /* generator wrote a file that can't be recorded */
+  bool up_to_date;
+} cache;
+
 #define CHUNK (4096)
 
 static int idlc_putn(const char *str, size_t len)
 {
   assert(pstate->config.flags & IDL_WRITE);
 
-  /* tokenize to free up space */
-  if (pstate->buffer.data && (pstate->buffer.size - pstate->buffer.used) <= len) {
+  /* tokenize to free up space, unless the complete input is needed to check the
+     cache before parsing it */
+  if (pstate->buffer.data && cache.stamp == NULL && (pstate->buffer.size - pstate->buffer.used) <= len) {
     if ((retcode = idl_parse(pstate)) == IDL_RETCODE_NEED_REFILL)
       retcode = IDL_RETCODE_OK;
     /* move non-tokenized data to start of buffer */
@@ -318,6 +340,179 @@ static idl_source_t *idlc_parse_make_source (idl_position_t *position, idl_file_
   return source;
 }
 
+static void format_digest(char str[33], const idl_md5_byte_t digest[16])
+{
+  for (size_t i = 0; i < 16; i++)
+    (void)snprintf(str + 2*i, 3, "%02x", digest[i]);
+}
+
+static bool file_digest(const char *path, char str[33])
+{
+  FILE *fp;
+  unsigned char buf[CHUNK];
+  size_t n;
+  bool ok;
+  idl_md5_state_t st;
+  idl_md5_byte_t digest[16];
+  if ((fp = idl_fopen(path, "rb")) == NULL)
+    return false;
+  idl_md5_init(&st);
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    idl_md5_append(&st, buf, (unsigned int)n);
+  ok = !ferror(fp);
+  fclose(fp);
+  idl_md5_finish(&st, digest);
+  format_digest(str, digest);
+  return ok;
+}
+
+static bool cache_init(int argc, char **argv, const char *lang, const idlc_generator_plugin_t *gen)
+{
+  idl_md5_state_t st;
+  char gendigest[33];
+  /* the generator is identified by the contents of the library it was loaded from,
+     which covers both the generator and its version */
+  if (gen->path == NULL || !file_digest(gen->path, gendigest))
+    return false;
+  idl_md5_init(&st);
+  idl_md5_append(&st, (const idl_md5_byte_t *)IDL_VERSION, sizeof(IDL_VERSION));
+  idl_md5_append(&st, (const idl_md5_byte_t *)lang, (unsigned int)strlen(lang) + 1);
+  idl_md5_append(&st, (const idl_md5_byte_t *)gendigest, sizeof(gendigest));
+  for (int i = 1; i < argc; i++) {
+    /* the number of jobs does not affect the output */
+    if (strncmp(argv[i], "-j", 2) == 0) {
+      i += (argv[i][2] == '\0');
+      continue;
+    }
+    idl_md5_append(&st, (const idl_md5_byte_t *)argv[i], (unsigned int)strlen(argv[i]) + 1);
+  }
+  idl_md5_finish(&st, cache.options);
+  return true;
+}
+
+static idl_retcode_t cache_open(const char *path)
+{
+  idl_md5_state_t st;
+  idl_md5_byte_t digest[16];
+  char name[33];
+  idl_md5_init(&st);
+  idl_md5_append(&st, cache.options, sizeof(cache.options));
+  idl_md5_append(&st, (const idl_md5_byte_t *)path, (unsigned int)strlen(path));
+  idl_md5_finish(&st, digest);
+  format_digest(name, digest);
+  if (idl_asprintf(&cache.stamp, "%s/%s.stamp", config.cache_dir, name) < 0) {
+    cache.stamp = NULL;
+    return IDL_RETCODE_NO_MEMORY;
+  }
+  return IDL_RETCODE_OK;
+}
+
+static void cache_close(void)
+{
+  if (cache.stamp)
+    idl_free(cache.stamp);
+  cache.stamp = NULL;
+  for (size_t i = 0; i < cache.noutputs; i++)
+    idl_free(cache.outputs[i]);
+  if (cache.outputs)
+    idl_free(cache.outputs);
+  cache.outputs = NULL;
+  cache.noutputs = 0;
+  cache.outputs_unknown = false;
+  cache.up_to_date = false;
+}
+
+static idl_retcode_t cache_add_output(const char *path)
+{
+  char *abspath, **outputs;
+  /* a file that can't be recorded only means the file is compiled again next time */
+  if (cache.outputs_unknown || strchr(path, '\n') != NULL)
+    goto err_path;
+  if (idl_normalize_path(path, &abspath) < 0)
+    goto err_path;
+  if (!(outputs = idl_realloc(cache.outputs, (cache.noutputs + 1) * sizeof(*outputs))))
+    goto err_outputs;
+  cache.outputs = outputs;
+  cache.outputs[cache.noutputs++] = abspath;
+  return IDL_RETCODE_OK;
+err_outputs:
+  idl_free(abspath);
+err_path:
+  cache.outputs_unknown = true;
+  return IDL_RETCODE_OK;
+}
+
+static char *cache_read_stamp(void)
+{
+  FILE *fp;
+  long size;
+  char *buf = NULL;
+  if ((fp = idl_fopen(cache.stamp, "rb")) == NULL)
+    return NULL;
+  if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0 &&
+      (buf = idl_malloc((size_t)size + 1)) != NULL) {
+    if (fread(buf, 1, (size_t)size, fp) == (size_t)size) {
+      buf[size] = '\0';
+    } else {
+      idl_free(buf);
+      buf = NULL;
+    }
+  }
+  fclose(fp);
+  return buf;
+}
+
+static bool cache_check(const idl_md5_byte_t digest[16])
+{
+  /* the stamp holds the digest of the preprocessed input on the first line, followed
+     by a line with the digest and the path of each generated file */
+  char *stamp, *line, *eol, outdigest[33];
+  size_t noutputs = 0;
+  bool eq = false;
+  format_digest(cache.digest, digest);
+  if ((stamp = cache_read_stamp()) == NULL)
+    return false;
+  if (strncmp(stamp, cache.digest, 32) == 0 && stamp[32] == '\n') {
+    eq = true;
+    for (line = stamp + 33; eq && *line != '\0'; line = eol + 1, noutputs++) {
+      if ((eol = strchr(line, '\n')) == NULL || eol - line < 34 || line[32] != ' ') {
+        eq = false;
+        break;
+      }
+      *eol = '\0';
+      eq = (file_digest(line + 33, outdigest) && strncmp(line, outdigest, 32) == 0);
+    }
+  }
+  idl_free(stamp);
+  /* nothing can be verified if the generator did not report the files it wrote */
+  return eq && noutputs > 0;
+}
+
+static void cache_update(void)
+{
+  FILE *fp;
+  char outdigest[33];
+  /* failing to record the digest only means the file is compiled again next time */
+  if (cache.outputs_unknown || cache.noutputs == 0) {
+    (void)remove(cache.stamp);
+    return;
+  }
+  if (idl_mkpath(config.cache_dir) < 0 || (fp = idl_fopen(cache.stamp, "wb")) == NULL)
+    return;
+  if (fprintf(fp, "%s\n", cache.digest) < 0)
+    goto err_write;
+  for (size_t i = 0; i < cache.noutputs; i++) {
+    if (!file_digest(cache.outputs[i], outdigest) || fprintf(fp, "%s %s\n", outdigest, cache.outputs[i]) < 0)
+      goto err_write;
+  }
+  if (fclose(fp) != 0)
+    (void)remove(cache.stamp);
+  return;
+err_write:
+  fclose(fp);
+  (void)remove(cache.stamp);
+}
+
 static idl_retcode_t idlc_parse(const idl_builtin_annotation_t ** generator_annotations)
 {
   idl_retcode_t ret = IDL_RETCODE_OK;
@@ -360,6 +555,11 @@ static idl_retcode_t idlc_parse(const idl_builtin_annotation_t ** generator_anno
 #if __GNUC__ >= 12
     IDL_WARNING_GNUC_ON(analyzer-malloc-leak)
 #endif
+    if (config.cache_dir && pstate->paths && (ret = cache_open(pstate->paths->name)) != IDL_RETCODE_OK) {
+      idl_delete_pstate(pstate);
+      pstate = NULL;
+      return ret;
+    }
     pstate->config.flags |= IDL_WRITE;
     pstate->config.default_extensibility = config.default_extensibility;
     pstate->config.default_nested = config.default_nested;
@@ -421,6 +621,12 @@ static idl_retcode_t idlc_parse(const idl_builtin_annotation_t ** generator_anno
   if (ret == IDL_RETCODE_OK && config.compile) {
     assert(pstate);
     idl_md5_finish(&md5state, pstate->digest);
+    if (cache.stamp && cache_check(pstate->digest)) {
+      cache.up_to_date = true;
+      idl_delete_pstate(pstate);
+      pstate = NULL;
+      return IDL_RETCODE_OK;
+    }
     ret = idl_parse(pstate);
     assert(ret != IDL_RETCODE_NEED_REFILL);
     if (ret == IDL_RETCODE_OK) {
@@ -550,6 +756,18 @@ static int config_warning(const idlc_option_t *opt, const char *arg)
   return 0;
 }
 
+static int set_jobs(const idlc_option_t *opt, const char *arg)
+{
+  char *end;
+  long jobs;
+  (void)opt;
+  jobs = strtol(arg, &end, 10);
+  if (*arg == '\0' || *end != '\0' || jobs < 1 || jobs > 1024)
+    return IDLC_BAD_ARGUMENT;
+  config.jobs = (int)jobs;
+  return 0;
+}
+
 static int add_include(const idlc_option_t *opt, const char *arg)
 {
   (void)opt;
@@ -594,6 +812,13 @@ static const idlc_option_t *compopts[] = {
     IDLC_FLAG, { .flag = &config.case_sensitive }, 'f', "case-sensitive", "",
     "Switch to case-sensitive mode of operation. e.g. to allow constructed "
     "entities to contain fields that differ only in case." },
+  &(idlc_option_t){
+    IDLC_STRING, { .string = &config.cache_dir }, 'f', "cache", "<directory>",
+    "Record a digest of the preprocessed input and of the generated files of "
+    "each compiled file in <directory> and skip files for which the "
+    "preprocessed input, including all included files, the options and the "
+    "generator did not change since, provided the generated files are "
+    "unmodified. Remove <directory> to force compilation." },
   &(idlc_option_t){
     IDLC_FLAG, { .flag = &config.help }, 'h', "", "",
     "Display available options." },
@@ -606,6 +831,10 @@ static const idlc_option_t *compopts[] = {
   &(idlc_option_t){
     IDLC_STRING, { .string = &config.lang }, 'l', "", "<language>",
     "Compile representation for <language>. (default:c)." },
+  &(idlc_option_t){
+    IDLC_FUNCTION, { .function = &set_jobs }, 'j', "", "<jobs>",
+    "Compile up to <jobs> files in parallel (default: 1). Ignored on "
+    "platforms without fork." },
   &(idlc_option_t){
     IDLC_FLAG, { .flag = &config.version }, 'v', "", "",
     "Display version information." },
@@ -672,6 +901,111 @@ static const char *figure_language(int argc, char **argv)
   return lang;
 }
 
+static int compile_file(const idlc_generator_plugin_t *gen, const idl_builtin_annotation_t **generator_annotations, char *file)
+{
+  idl_retcode_t ret;
+  int exit_code = EXIT_FAILURE;
+
+  config.file = file;
+  config.argv[config.argc - 1] = file;
+  retcode = IDL_RETCODE_OK;
+  has_warnings = false;
+  if ((ret = idlc_parse(generator_annotations))) {
+    /* assume other errors are reported by processor */
+    if (ret == IDL_RETCODE_NO_MEMORY)
+      fprintf(stderr, "Out of memory\n");
+    goto err_parse;
+  } else if (config.compile && !cache.up_to_date) {
+    idlc_generator_config_t generator_config;
+    memset(&generator_config, 0, sizeof(generator_config));
+    if (cache.stamp)
+      generator_config.output_file = cache_add_output;
+
+    // Duplicate/Untaint the output dir to keep header guards neat
+    if(config.output_dir) {
+      if(!(generator_config.output_dir = idl_strdup(config.output_dir)))
+        goto err_generate;
+      if(idl_untaint_path(generator_config.output_dir) < 0)
+        goto err_generate;
+    }
+    // Root dir must be normalized because relativity comparison will be done
+    if(config.base_dir) {
+      if(idl_normalize_path(config.base_dir, &generator_config.base_dir) < 0)
+        goto err_generate;
+    }
+#ifdef DDS_HAS_TYPELIB
+    if(!config.no_type_info)
+      generator_config.generate_type_info = true;
+    generator_config.generate_typeinfo_typemap = generate_type_meta_ser;
+#endif // DDS_HAS_TYPELIB
+    if (gen->generate)
+      ret = gen->generate(pstate, &generator_config);
+
+    if(generator_config.output_dir)
+      idl_free(generator_config.output_dir);
+    if(generator_config.base_dir)
+      idl_free(generator_config.base_dir);
+    if (ret) {
+      fprintf(stderr, "Failed to compile '%s'\n", config.file);
+      goto err_generate;
+    }
+  }
+  exit_code = (has_warnings && config.werror) ? EXIT_FAILURE : EXIT_SUCCESS;
+  if (exit_code == EXIT_SUCCESS && cache.stamp && !cache.up_to_date)
+    cache_update();
+
+err_generate:
+err_parse:
+  cache_close();
+  idl_delete_pstate(pstate);
+  pstate = NULL;
+  return exit_code;
+}
+
+static int compile_files_sequential(const idlc_generator_plugin_t *gen, const idl_builtin_annotation_t **generator_annotations, int nfiles, char **files, int first, int step)
+{
+  int exit_code = EXIT_SUCCESS;
+  for (int i = first; i < nfiles; i += step) {
+    if (compile_file(gen, generator_annotations, files[i]) != EXIT_SUCCESS)
+      exit_code = EXIT_FAILURE;
+  }
+  return exit_code;
+}
+
+static int compile_files(const idlc_generator_plugin_t *gen, const idl_builtin_annotation_t **generator_annotations, int nfiles, char **files)
+{
+#if !defined(_WIN32)
+  /* the preprocessor is not reentrant, so files are compiled in parallel by forking
+     worker processes that each take every n-th file */
+  if (config.compile && config.jobs > 1 && nfiles > 1) {
+    const int nworkers = (config.jobs < nfiles) ? config.jobs : nfiles;
+    int exit_code = EXIT_SUCCESS;
+    int nforked = 0;
+    fflush(NULL);
+    for (int w = 0; w < nworkers; w++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        /* the worker shares everything with the parent, so skip the exit handlers */
+        const int worker_exit_code = compile_files_sequential(gen, generator_annotations, nfiles, files, w, nworkers);
+        fflush(NULL);
+        _exit(worker_exit_code);
+      } else if (pid > 0) {
+        nforked++;
+      } else if (compile_files_sequential(gen, generator_annotations, nfiles, files, w, nworkers) != EXIT_SUCCESS) {
+        exit_code = EXIT_FAILURE;
+      }
+    }
+    for (int w = 0; w < nforked; w++) {
+      int status;
+      if (wait(&status) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        exit_code = EXIT_FAILURE;
+    }
+    return exit_code;
+  }
+#endif
+  return compile_files_sequential(gen, generator_annotations, nfiles, files, 0, 1);
+}
+
 #define xstr(s) str(s)
 #define str(s) #s
 
@@ -699,6 +1033,7 @@ int main(int argc, char *argv[])
   config.disable_warnings.size = 0;
   config.disable_warnings.count = 0;
   config.werror = false;
+  config.jobs = 1;
 #ifdef DDS_HAS_TYPELIB
   config.no_type_info = 0;
 #endif
@@ -710,7 +1045,8 @@ int main(int argc, char *argv[])
     fprintf(stderr, "%s: cannot load generator %s\n", prog, lang);
 
   config.argc = 0;
-  if (!(config.argv = idl_calloc((size_t)argc + 7, sizeof(config.argv[0]))))
+  /* -Ifoo and -Dfoo take two slots */
+  if (!(config.argv = idl_calloc(2 * (size_t)argc + 7, sizeof(config.argv[0]))))
     goto err_argv;
 
   config.argv[config.argc++] = argv[0];
@@ -746,72 +1082,37 @@ int main(int argc, char *argv[])
       fprintf(stderr, "%s: conflicting options in generator %s\n", prog, lang);
       /* fall through */
     default:
-      print_usage(prog, "[OPTIONS] FILE");
+      print_usage(prog, "[OPTIONS] FILE...");
       goto err_parse_opts;
   }
 
   if (config.help) {
-    print_help(prog, "[OPTIONS] FILE", opts);
+    print_help(prog, "[OPTIONS] FILE...", opts);
+    exit_code = EXIT_SUCCESS;
   } else if (config.version) {
     print_version(prog);
+    exit_code = EXIT_SUCCESS;
   } else {
-    idl_retcode_t ret;
-    if (optind != (argc - 1)) {
-      print_usage(prog, "[OPTIONS] FILE");
+    if (optind >= argc) {
+      print_usage(prog, "[OPTIONS] FILE...");
       goto err_parse_opts;
     }
-    config.file = argv[optind];
-    config.argv[config.argc++] = config.file;
+    /* replaced by the file to compile */
+    config.argv[config.argc++] = argv[optind];
 
     if (gen.generator_annotations) {
       generator_annotations = gen.generator_annotations();
     } else {
       generator_annotations = NULL;
     }
-
-    if ((ret = idlc_parse(generator_annotations))) {
-      /* assume other errors are reported by processor */
-      if (ret == IDL_RETCODE_NO_MEMORY)
-        fprintf(stderr, "Out of memory\n");
-      goto err_parse;
-    } else if (config.compile) {
-      idlc_generator_config_t generator_config;
-      memset(&generator_config, 0, sizeof(generator_config));
-
-      // Duplicate/Untaint the output dir to keep header guards neat
-      if(config.output_dir) {
-        if(!(generator_config.output_dir = idl_strdup(config.output_dir)))
-          goto err_generate;
-        if(idl_untaint_path(generator_config.output_dir) < 0)
-          goto err_generate;
-      }
-      // Root dir must be normalized because relativity comparison will be done
-      if(config.base_dir) {
-        if(idl_normalize_path(config.base_dir, &generator_config.base_dir) < 0)
-          goto err_generate;
-      }
-#ifdef DDS_HAS_TYPELIB
-      if(!config.no_type_info)
-        generator_config.generate_type_info = true;
-      generator_config.generate_typeinfo_typemap = generate_type_meta_ser;
-#endif // DDS_HAS_TYPELIB
-      if (gen.generate)
-        ret = gen.generate(pstate, &generator_config);
-
-      if(generator_config.output_dir)
-        idl_free(generator_config.output_dir);
-      if(generator_config.base_dir)
-        idl_free(generator_config.base_dir);
-      if (ret) {
-        fprintf(stderr, "Failed to compile '%s'\n", config.file);
-        goto err_generate;
-      }
+    if (config.cache_dir && !cache_init(optind, argv, lang, &gen)) {
+      fprintf(stderr, "%s: cannot identify generator %s, not using cache\n", prog, lang);
+      config.cache_dir = NULL;
     }
+
+    exit_code = compile_files(&gen, generator_annotations, argc - optind, argv + optind);
   }
-  exit_code = (has_warnings && config.werror) ? EXIT_FAILURE : EXIT_SUCCESS;
 
-err_generate:
-err_parse:
 err_parse_opts:
   idl_free(opts);
 err_alloc_opts:
@@ -820,5 +1121,7 @@ err_alloc_opts:
   idl_free(config.argv);
 err_argv:
   idl_delete_pstate(pstate);
+  if (gen.path)
+    idl_free(gen.path);
   return exit_code;
 }
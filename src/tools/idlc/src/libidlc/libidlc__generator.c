@@ -241,6 +241,10 @@ generate(const idl_pstate_t *pstate, const idlc_generator_config_t *config)
     goto err_options;
   generator.config.generate_cdrstream_desc = (generate_cdrstream_desc != 0);
   ret = generate_nosetup(pstate, &generator);
+  if (ret == IDL_RETCODE_OK && config->output_file) {
+    if ((ret = config->output_file(generator.header.path)) == IDL_RETCODE_OK)
+      ret = config->output_file(generator.source.path);
+  }
   if(generator.config.guard_macro)
     idl_free(generator.config.guard_macro);
 
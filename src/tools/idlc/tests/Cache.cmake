@@ -0,0 +1,114 @@
+#
+# Copyright(c) 2024 ZettaScale Technology and others
+#
+# This program and the accompanying materials are made available under the
+# terms of the Eclipse Public License v. 2.0 which is available at
+# http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+# v. 1.0 which is available at
+# http://www.eclipse.org/org/documents/edl-v10.php.
+#
+# SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+#
+cmake_minimum_required(VERSION 3.16)
+
+# Compiles several files at once, sequentially and in parallel, using a cache
+# directory and checks which of the generated files are written again by looking at
+# their modification times.
+set(_idl_compiler "$ENV{IDLC}")
+set(_idl_backend "$ENV{IDLC_BACKEND}")
+if(NOT _idl_compiler)
+  message(FATAL_ERROR "IDL compiler not set")
+endif()
+if(NOT _idl_backend)
+  message(FATAL_ERROR "IDL compiler backend not set")
+endif()
+
+set(_dir "${CMAKE_CURRENT_BINARY_DIR}/idlc_cache")
+file(REMOVE_RECURSE "${_dir}")
+file(MAKE_DIRECTORY "${_dir}")
+file(WRITE "${_dir}/inc.idl" "module m { struct inc { long x; }; };\n")
+file(WRITE "${_dir}/a.idl" "#include \"inc.idl\"\nmodule m { struct a { inc i; }; };\n")
+file(WRITE "${_dir}/b.idl" "module n { struct b { long y; }; };\n")
+file(WRITE "${_dir}/c.idl" "module o { struct c { string z; }; };\n")
+file(WRITE "${_dir}/d.idl" "module p { struct d { double w; }; };\n")
+set(_outputs a.h a.c b.h b.c c.h c.c d.h d.c)
+
+function(idlc)
+  execute_process(
+    COMMAND ${_idl_compiler} -l${_idl_backend} ${ARGN}
+    COMMAND_ECHO STDOUT
+    WORKING_DIRECTORY "${_dir}"
+    RESULT_VARIABLE _result)
+  if(NOT _result EQUAL "0")
+    message(FATAL_ERROR "idlc ${ARGN} failed")
+  endif()
+endfunction()
+
+macro(record_mtimes)
+  foreach(_f ${_outputs})
+    if(NOT EXISTS "${_dir}/out/${_f}")
+      message(FATAL_ERROR "${_f} not generated")
+    endif()
+    file(TIMESTAMP "${_dir}/out/${_f}" _mtime_${_f} "%s" UTC)
+  endforeach()
+  # modification times have a resolution of a second
+  execute_process(COMMAND ${CMAKE_COMMAND} -E sleep 1.1)
+endmacro()
+
+macro(check_regenerated)
+  set(_regenerated ${ARGN})
+  foreach(_f ${_outputs})
+    if(NOT EXISTS "${_dir}/out/${_f}")
+      message(FATAL_ERROR "${_f} not generated")
+    endif()
+    file(TIMESTAMP "${_dir}/out/${_f}" _mtime "%s" UTC)
+    if(_f IN_LIST _regenerated AND _mtime STREQUAL _mtime_${_f})
+      message(FATAL_ERROR "${_f} not generated again")
+    elseif(NOT _f IN_LIST _regenerated AND NOT _mtime STREQUAL _mtime_${_f})
+      message(FATAL_ERROR "${_f} generated again")
+    endif()
+  endforeach()
+endmacro()
+
+macro(check_same_as_uncached)
+  foreach(_f ${ARGN})
+    execute_process(
+      COMMAND ${CMAKE_COMMAND} -E compare_files "${_dir}/out/${_f}" "${_dir}/ref/${_f}"
+      RESULT_VARIABLE _result)
+    if(NOT _result EQUAL "0")
+      message(FATAL_ERROR "${_f} differs from output without cache")
+    endif()
+  endforeach()
+endmacro()
+
+# reference output, compiled one file at a time without the cache
+foreach(_f a b c d)
+  idlc(-o out ${_f}.idl)
+endforeach()
+file(RENAME "${_dir}/out" "${_dir}/ref")
+
+# several files in one run fill the cache
+idlc(-f cache=cache -o out a.idl b.idl c.idl d.idl)
+check_same_as_uncached(${_outputs})
+record_mtimes()
+
+# nothing changed: everything comes from the cache, the number of jobs doesn't matter
+idlc(-j 2 -f cache=cache -o out a.idl b.idl c.idl d.idl)
+check_regenerated()
+
+# a change in an included file, a deleted and a modified output are all noticed
+record_mtimes()
+file(APPEND "${_dir}/inc.idl" "module m { struct inc2 { long y; }; };\n")
+file(REMOVE "${_dir}/out/b.h")
+file(APPEND "${_dir}/out/c.c" "/* modified */\n")
+idlc(-j 3 -f cache=cache -o out a.idl b.idl c.idl d.idl)
+check_regenerated(a.h a.c b.h b.c c.h c.c)
+check_same_as_uncached(b.h b.c c.h c.c d.h d.c)
+
+# different options are cached separately
+record_mtimes()
+idlc(-j 2 -f cache=cache -f case-sensitive -o out a.idl b.idl c.idl d.idl)
+check_regenerated(a.h a.c b.h b.c c.h c.c d.h d.c)
+record_mtimes()
+idlc(-f cache=cache -f case-sensitive -o out b.idl)
+check_regenerated()
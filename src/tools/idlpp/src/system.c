@@ -310,6 +310,8 @@ static char *   mkdep_mt;               /* Argument of -MT option   */
 
 /* sharp_filename is filename for #line line, used only in cur_file()   */
 static char *   sharp_filename = NULL;
+static FILEINFO *   sh_file;    /* File and line of last line number    */
+static size_t   sh_line;        /*      output by sharp()               */
 static char *   argv0;      /* argv[ 0] for usage() and version()   */
 static int      ansi;           /* __STRICT_ANSI__ flag for GNUC    */
 static int      compat_mode;
@@ -3976,8 +3978,6 @@ void    sharp(
  * else (i.e. 'sharp_file' is NULL) 'infile'.
  */
 {
-    static FILEINFO *     sh_file;
-    static size_t         sh_line;
     FILEINFO *    file;
     size_t        line;
 
@@ -5093,4 +5093,8 @@ void clean_system(void)
 {
   if (sharp_filename != NULL)
     free(sharp_filename);
+  sharp_filename = NULL;
+  /* the FILEINFO of the next input file may well be at the same address */
+  sh_file = NULL;
+  sh_line = 0;
 }